@@ -0,0 +1,391 @@
+"""
+Roofline design-space exploration for the tiled convolution accelerator.
+
+Implements the analytical model of "Optimizing FPGA-based Accelerator Design for
+Deep Convolutional Neural Networks" (Zhang et al., FPGA'15) for the loop tiling
+used by v2_optimized and v3_hls_compatible:
+
+- For every conv layer, enumerate tile sizes <Tm, Tn, Tr, Tc> that fit the KV260
+  DSP and BRAM budget (K26_* constants from cpp_fashion_mnist/headers/defines.h).
+- Compute the computational roof, the computation-to-communication (CTC) ratio,
+  the attainable performance min(roof, CTC x BW) and the DDR bandwidth needed to
+  reach the roof.
+- Print the Pareto set per layer and the best cross-layer design: one <Tm, Tn>
+  shared by all layers (the compute engine), with <Tr, Tc> chosen per layer.
+
+Usage:
+    python roofline_dse.py                        # AlexNet, KV260 defaults
+    python roofline_dse.py --network fashion_mnist
+    python roofline_dse.py --network my_net.txt --bandwidth 12.8 --top 15
+
+A network file has one conv layer per line: name N M R C K S
+(input channels, output channels, output rows, output cols, kernel, stride).
+"""
+
+import argparse
+import math
+import os
+import re
+import sys
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+DEFINES_H = os.path.join(SCRIPT_DIR, "..", "cpp_fashion_mnist", "headers", "defines.h")
+V3_PARAMS_H = os.path.join(SCRIPT_DIR, "v3_hls_compatible", "cnn_params.h")
+V3_HLS_CFG = os.path.join(SCRIPT_DIR, "v3_hls_compatible", "mnist_hls_config.cfg")
+V2_CONV_H = os.path.join(SCRIPT_DIR, "v2_optimized", "ConvolutionalLayerV2.h")
+
+BRAM18_BITS = 18 * 1024
+# Arrays up to this size are mapped to LUTRAM/registers by HLS and cost no BRAM
+LUTRAM_THRESHOLD_BITS = 1024
+# Depth of one LUT6 used as distributed RAM (RAM64X1D: 2 LUTs for a 64 x 1 dual-port RAM)
+LUTRAM_DEPTH = 64
+
+# Conv layers as (name, N, M, R, C, K, S)
+NETWORKS = {
+    "alexnet": [
+        ("conv1", 3, 64, 55, 55, 11, 4),
+        ("conv2", 64, 192, 27, 27, 5, 1),
+        ("conv3", 192, 384, 13, 13, 3, 1),
+        ("conv4", 384, 256, 13, 13, 3, 1),
+        ("conv5", 256, 256, 13, 13, 3, 1),
+    ],
+    "fashion_mnist": [
+        ("conv1", 1, 32, 28, 28, 3, 1),
+        ("conv2", 32, 64, 14, 14, 3, 1),
+    ],
+}
+
+
+def read_defines(path):
+    """Return the integer #defines of a header, evaluating simple expressions of earlier defines"""
+    defines = {}
+    if not os.path.exists(path):
+        return defines
+    with open(path) as f:
+        for line in f:
+            match = re.match(r"\s*#define\s+(\w+)\s+(.+)", line.split("//")[0])
+            if not match:
+                continue
+            name, expr = match.group(1), match.group(2).strip()
+            expr = re.sub(r"\b([A-Z_][A-Z0-9_]*)\b", lambda m: str(defines.get(m.group(1), m.group(1))), expr)
+            if expr and re.fullmatch(r"[\d\s\+\-\*/\(\)]+", expr):
+                defines[name] = int(eval(expr.replace("/", "//")))
+    return defines
+
+
+def read_clock_mhz(path, default=200.0):
+    if os.path.exists(path):
+        with open(path) as f:
+            match = re.search(r"clock\s*=\s*([\d.]+)\s*MHz", f.read())
+            if match:
+                return float(match.group(1))
+    return default
+
+
+def read_v2_tiles(path):
+    """Default <Tm, Tn, Tr, Tc> of the ConvolutionalLayerV2 constructor"""
+    tiles = {}
+    if os.path.exists(path):
+        with open(path) as f:
+            for dim, value in re.findall(r"tileSize([MNRC])\s*=\s*(\d+)", f.read()):
+                tiles[dim] = int(value)
+    if len(tiles) != 4:
+        return None
+    return (tiles["M"], tiles["N"], tiles["R"], tiles["C"])
+
+
+def load_network(spec):
+    if spec in NETWORKS:
+        return NETWORKS[spec]
+    layers = []
+    with open(spec) as f:
+        for line in f:
+            line = line.split("#")[0].strip()
+            if not line:
+                continue
+            fields = line.split()
+            if len(fields) != 7:
+                sys.exit(f"Error: expected 'name N M R C K S' in {spec}, got: {line}")
+            layers.append((fields[0],) + tuple(int(v) for v in fields[1:]))
+    return layers
+
+
+def tile_candidates(dim):
+    """Smallest tile size for every distinct trip count ceil(dim / t); larger sizes only waste resources"""
+    candidates = sorted({math.ceil(dim / steps) for steps in range(1, dim + 1)})
+    return candidates
+
+
+def shared_bank_bram18(elements, bits):
+    """BRAM18 of one double-buffered input or weight bank. The load stage writes
+    one copy while the compute stage reads the other, one port each, so both
+    copies share a true dual-port BRAM18 as long as they fit in it."""
+    if elements * bits <= LUTRAM_THRESHOLD_BITS:
+        return 0
+    return math.ceil(2 * elements * bits / BRAM18_BITS)
+
+
+def output_bank_bram18(elements, bits):
+    """BRAM18 of one double-buffered output bank: the compute stage reads and
+    writes its copy (both ports) while the store stage reads the other"""
+    if elements * bits <= LUTRAM_THRESHOLD_BITS:
+        return 0
+    return 2 * math.ceil(elements * bits / BRAM18_BITS)
+
+
+def weight_buffer_usage(tm, tn, k, hw):
+    """(BRAM18, LUTs) of the Tm x Tn weight banks. As many banks as the LUTRAM
+    budget holds go to dual-port LUTRAM, the rest to shared dual-port BRAM18."""
+    banks = tm * tn
+    bank_bram = shared_bank_bram18(k * k, hw["bits"])
+    if bank_bram == 0:
+        return 0, 0
+    bank_luts = hw["bits"] * 2 * math.ceil(2 * k * k / LUTRAM_DEPTH)
+    lut_banks = min(banks, hw["lutram"] // bank_luts)
+    return (banks - lut_banks) * bank_bram, lut_banks * bank_luts
+
+
+def input_bank_elements(tr, tc, k, s):
+    return (s * tr + k - s) * (s * tc + k - s)
+
+
+def bram18_usage(tm, tn, tr, tc, k, s, hw):
+    """BRAM18 blocks of the double-buffered input, weight and output buffers, partitioned per bank"""
+    weight_bram, _ = weight_buffer_usage(tm, tn, k, hw)
+    return (tn * shared_bank_bram18(input_bank_elements(tr, tc, k, s), hw["bits"]) + weight_bram
+            + tm * output_bank_bram18(tr * tc, hw["bits"]))
+
+
+def evaluate(layer, tiling, hw):
+    """Roofline metrics of one layer for one tiling"""
+    _, n, m, r, c, k, s = layer
+    tm, tn, tr, tc = tiling
+    ops = 2.0 * r * c * m * n * k * k
+
+    trips_m = math.ceil(m / tm)
+    trips_n = math.ceil(n / tn)
+    trips_rc = math.ceil(r / tr) * math.ceil(c / tc)
+    cycles = trips_m * trips_n * trips_rc * tr * tc * k * k
+    roof = ops / cycles * hw["freq_hz"] / 1e9
+
+    # External accesses: input and weight tiles per (m, n, r, c) tile, output tiles per (m, r, c) tile
+    alpha_in = alpha_wght = trips_m * trips_n * trips_rc
+    alpha_out = trips_m * trips_rc
+    beta_in = tn * (s * tr + k - s) * (s * tc + k - s)
+    beta_wght = tm * tn * k * k
+    beta_out = tm * tr * tc
+    traffic_bytes = (alpha_in * beta_in + alpha_wght * beta_wght + alpha_out * beta_out) * hw["bytes"]
+    ctc = ops / traffic_bytes
+
+    attainable = min(roof, ctc * hw["bandwidth"])
+    return {
+        "tiling": tiling,
+        "ops": ops,
+        "roof": roof,
+        "ctc": ctc,
+        "attainable": attainable,
+        "bandwidth": roof / ctc,
+        "time": ops / (attainable * 1e9),
+    }
+
+
+def fits(tiling, k, s, hw):
+    tm, tn, tr, tc = tiling
+    if tm * tn * hw["dsp_per_mac"] > hw["dsp"]:
+        return False
+    return bram18_usage(tm, tn, tr, tc, k, s, hw) <= hw["bram"]
+
+
+def pareto(points):
+    """Points not dominated in (computational roof, CTC ratio); both are maximized"""
+    points = sorted(points, key=lambda p: (-p["roof"], -p["ctc"]))
+    front = []
+    best_ctc = -1.0
+    for p in points:
+        if p["ctc"] > best_ctc:
+            front.append(p)
+            best_ctc = p["ctc"]
+    return front
+
+
+def explore_layer(layer, hw):
+    _, n, m, r, c, k, s = layer
+    points = []
+    rc_pairs = [(tr, tc) for tr in tile_candidates(r) for tc in tile_candidates(c)]
+    for tm in tile_candidates(m):
+        for tn in tile_candidates(n):
+            if tm * tn * hw["dsp_per_mac"] > hw["dsp"]:
+                continue
+            for tr, tc in rc_pairs:
+                tiling = (tm, tn, tr, tc)
+                if fits(tiling, k, s, hw):
+                    points.append(evaluate(layer, tiling, hw))
+    return points
+
+
+def explore_unified(layers, hw):
+    """Cross-layer design (Zhang et al., Sec. 4.3): one <Tm, Tn> for every layer,
+    since it fixes the compute engine, and the best <Tr, Tc> per layer. The
+    shared buffers are sized for the largest input tile, output tile and kernel
+    of the layers, so the BRAM budget couples the per-layer choices: for every
+    bound on the BRAM18 per input and per output bank, each layer takes its
+    fastest <Tr, Tc> within the bounds."""
+    k_max = max(layer[5] for layer in layers)
+    s_max = max(layer[6] for layer in layers)
+    tm_set = sorted({t for layer in layers for t in tile_candidates(layer[2])})
+    tn_set = sorted({t for layer in layers for t in tile_candidates(layer[1])})
+
+    # <Tr, Tc> options of every layer with the BRAM18 of one input and one output bank
+    options = []
+    for layer in layers:
+        _, _, _, r, c, k, s = layer
+        options.append([(tr, tc, shared_bank_bram18(input_bank_elements(tr, tc, k, s), hw["bits"]),
+                         output_bank_bram18(tr * tc, hw["bits"]))
+                        for tr in tile_candidates(r) for tc in tile_candidates(c)])
+    in_caps = sorted({opt[2] for layer_options in options for opt in layer_options})
+    out_caps = sorted({opt[3] for layer_options in options for opt in layer_options})
+
+    best = None
+    for tm in tm_set:
+        for tn in tn_set:
+            if tm * tn * hw["dsp_per_mac"] > hw["dsp"]:
+                continue
+            weight_bram, _ = weight_buffer_usage(tm, tn, k_max, hw)
+
+            # Fastest option of each layer for every (input cap, output cap) pair:
+            # the minimum over the options at or below both caps
+            fastest = []
+            for layer, layer_options in zip(layers, options):
+                grid = [[None] * len(out_caps) for _ in in_caps]
+                for tr, tc, in_bram, out_bram in layer_options:
+                    res = evaluate(layer, (tm, tn, tr, tc), hw)
+                    i, j = in_caps.index(in_bram), out_caps.index(out_bram)
+                    if grid[i][j] is None or res["time"] < grid[i][j]["time"]:
+                        grid[i][j] = res
+                for i in range(len(in_caps)):
+                    for j in range(len(out_caps)):
+                        for prev in (grid[i - 1][j] if i else None, grid[i][j - 1] if j else None):
+                            if prev is not None and (grid[i][j] is None or prev["time"] < grid[i][j]["time"]):
+                                grid[i][j] = prev
+                fastest.append(grid)
+
+            for i, in_cap in enumerate(in_caps):
+                for j, out_cap in enumerate(out_caps):
+                    bram = tn * in_cap + weight_bram + tm * out_cap
+                    if bram > hw["bram"]:
+                        break
+                    results = [grid[i][j] for grid in fastest]
+                    if any(res is None for res in results):
+                        continue
+                    total_time = sum(res["time"] for res in results)
+                    peak_bw = max(res["bandwidth"] for res in results)
+                    key = (total_time, peak_bw, bram)
+                    if best is None or key < best[0]:
+                        best = (key, (tm, tn), results)
+    return best, k_max, s_max
+
+
+def print_point_header(label=""):
+    print(f"  {label:<7}{'Tm':>4} {'Tn':>4} {'Tr':>4} {'Tc':>4} {'DSP':>6} {'BRAM18':>7} "
+          f"{'roof GF/s':>10} {'CTC F/B':>9} {'attain GF/s':>12} {'req BW GB/s':>12}")
+
+
+def print_point(point, k, s, hw, label="", bram=None):
+    """Print one tiling; bram replaces the BRAM18 of the tiling alone, e.g. by that of a shared design"""
+    tm, tn, tr, tc = point["tiling"]
+    if bram is None:
+        bram = bram18_usage(tm, tn, tr, tc, k, s, hw)
+    print(f"  {label:<7}{tm:>4} {tn:>4} {tr:>4} {tc:>4} {tm * tn * hw['dsp_per_mac']:>6} "
+          f"{bram:>7} {point['roof']:>10.2f} {point['ctc']:>9.2f} "
+          f"{point['attainable']:>12.2f} {point['bandwidth']:>12.2f}")
+
+
+def main():
+    defines = read_defines(DEFINES_H)
+    v3_params = read_defines(V3_PARAMS_H)
+
+    parser = argparse.ArgumentParser(description="Roofline design-space exploration of conv tile sizes")
+    parser.add_argument("--network", default="alexnet",
+                        help="alexnet, fashion_mnist or a file with 'name N M R C K S' lines")
+    parser.add_argument("--bandwidth", type=float, default=19.2,
+                        help="DDR bandwidth in GB/s (KV260 DDR4-2400 x64: 19.2)")
+    parser.add_argument("--freq", type=float, default=read_clock_mhz(V3_HLS_CFG), help="Clock in MHz")
+    parser.add_argument("--bits", type=int, default=defines.get("EXP_WIDTH", 16),
+                        help="Bits per element in DDR and on-chip buffers")
+    parser.add_argument("--dsp-per-mac", type=int, default=1,
+                        help="DSP48E2 slices per multiply-accumulate (1 for fixed point, 5 for float)")
+    parser.add_argument("--lutram-share", type=float, default=0.25,
+                        help="Share of the available LUTs usable as distributed RAM for the weight banks")
+    parser.add_argument("--top", type=int, default=10, help="Pareto points printed per layer")
+    args = parser.parse_args()
+
+    if "AVAILABLE_DSP" not in defines or "AVAILABLE_BRAM" not in defines:
+        sys.exit(f"Error: could not read K26 resource constants from {DEFINES_H}")
+
+    hw = {
+        "dsp": defines["AVAILABLE_DSP"],
+        "bram": defines["AVAILABLE_BRAM"],
+        "freq_hz": args.freq * 1e6,
+        "bandwidth": args.bandwidth,
+        "bits": args.bits,
+        "bytes": math.ceil(args.bits / 8),
+        "dsp_per_mac": args.dsp_per_mac,
+        "lutram": int(defines.get("AVAILABLE_LUT", 0) * args.lutram_share),
+    }
+    layers = load_network(args.network)
+
+    print(f"Network: {args.network} ({len(layers)} conv layers)")
+    print(f"Budget: {hw['dsp']} DSP48E2 ({defines['MAX_DSP_USAGE']}% of {defines['K26_DSP_COUNT']}), "
+          f"{hw['bram']} BRAM18 ({defines['MAX_BRAM_USAGE']}% of {defines['K26_BRAM_COUNT']})")
+    print(f"Clock: {args.freq:.0f} MHz, DDR bandwidth: {args.bandwidth:.1f} GB/s, "
+          f"{args.bits}-bit data, {args.dsp_per_mac} DSP/MAC, {hw['lutram']} LUTs of LUTRAM for weights")
+
+    for layer in layers:
+        name, n, m, r, c, k, s = layer
+        points = explore_layer(layer, hw)
+        print(f"\n=== {name}: N={n} M={m} R={r} C={c} K={k} S={s} "
+              f"({2.0 * r * c * m * n * k * k / 1e6:.1f} MOP, {len(points)} feasible tilings) ===")
+        if not points:
+            print("  No tiling fits the resource budget")
+            continue
+        front = sorted(pareto(points), key=lambda p: (-p["attainable"], p["bandwidth"]))
+        print(f"  Pareto set (roof vs CTC), {len(front)} points, best {min(args.top, len(front))} by attainable performance:")
+        print_point_header()
+        for point in front[:args.top]:
+            print_point(point, k, s, hw)
+
+    best, k_max, s_max = explore_unified(layers, hw)
+    print(f"\n=== Recommended cross-layer design (shared <Tm, Tn>, <Tr, Tc> per layer, weights sized for K={k_max}) ===")
+    if best is None:
+        print("  No unified tiling fits the resource budget")
+        return
+
+    (total_time, peak_bw, bram), (tm, tn), results = best
+    total_ops = sum(res["ops"] for res in results)
+    _, weight_luts = weight_buffer_usage(tm, tn, k_max, hw)
+    print(f"  <Tm, Tn> = <{tm}, {tn}>: {tm * tn * hw['dsp_per_mac']} DSP, {bram} BRAM18, {weight_luts} LUTs of LUTRAM; "
+          f"{total_time * 1e3:.3f} ms, {total_ops / total_time / 1e9:.2f} GFLOP/s overall, "
+          f"peak required bandwidth {peak_bw:.2f} GB/s")
+    print_point_header("layer")
+    for layer, res in zip(layers, results):
+        print_point(res, layer[5], layer[6], hw, layer[0], bram)
+
+    # Compare against the hand-picked tilings of v2 and v3
+    hand_picked = []
+    if all(key in v3_params for key in ("TM", "TN", "TR", "TC")):
+        hand_picked.append(("v3 cnn_params.h", (v3_params["TM"], v3_params["TN"], v3_params["TR"], v3_params["TC"])))
+    v2_tiles = read_v2_tiles(V2_CONV_H)
+    if v2_tiles:
+        hand_picked.append(("v2 ConvolutionalLayerV2", v2_tiles))
+
+    print("\n=== Hand-picked tilings ===")
+    for label, tiling in hand_picked:
+        results = [evaluate(layer, tiling, hw) for layer in layers]
+        total_time = sum(res["time"] for res in results)
+        feasible = fits(tiling, k_max, s_max, hw)
+        print(f"  {label} <{tiling[0]}, {tiling[1]}, {tiling[2]}, {tiling[3]}>: {total_time * 1e3:.3f} ms"
+              f"{'' if feasible else ' (exceeds the resource budget)'}")
+
+
+if __name__ == "__main__":
+    main()
@@ -90,8 +90,16 @@ bool ConvolutionalLayer::loadWeights(const std::string& filename) {
     size_t biasSize = static_cast<size_t>(outputChannels) * sizeof(float);
 
     std::vector<float> weightsData(outputChannels * inputChannels * kernelSize * kernelSize);
+    std::vector<float> biasData(outputChannels);
     file.read(reinterpret_cast<char*>(weightsData.data()), weightsSize);
+    file.read(reinterpret_cast<char*>(biasData.data()), biasSize);
 
+    setWeights(weightsData, biasData);
+    return true;
+}
+
+// Set weights from memory (same [outputChannels][inputChannels][kernelSize*kernelSize] layout as the weight files)
+void ConvolutionalLayer::setWeights(const std::vector<float>& weightsData, const std::vector<float>& biasData) {
     for (int to = 0; to < outputChannels; to++) {
         for (int ti = 0; ti < inputChannels; ti++) {
             for (int k = 0; k < kernelSize * kernelSize; k++) {
@@ -100,8 +108,6 @@ bool ConvolutionalLayer::loadWeights(const std::string& filename) {
                 weights.at(to, ti, k) = weightsData[idx];
             }
         }
+        bias[to] = biasData[to];
     }
-
-    file.read(reinterpret_cast<char*>(bias.data()), biasSize);
-    return true;
 }
\ No newline at end of file
@@ -31,6 +31,7 @@ public:
     virtual Tensor3D forward(const Tensor3D& input) override;
     void initializeWeights(float stddev = 0.01f);
     virtual bool loadWeights(const std::string& filename) override;
+    void setWeights(const std::vector<float>& weightsData, const std::vector<float>& biasData);
 };
 
 #endif // CONVOLUTIONALLAYER_H
\ No newline at end of file
@@ -64,14 +64,20 @@ bool FullyConnectedLayer::loadWeights(const std::string& filename) {
     size_t biasSize = outputSize * sizeof(float);
 
     std::vector<float> weightsData(outputSize * inputSize);
+    std::vector<float> biasData(outputSize);
     file.read(reinterpret_cast<char*>(weightsData.data()), weightsSize);
+    file.read(reinterpret_cast<char*>(biasData.data()), biasSize);
 
+    setWeights(weightsData, biasData);
+    return true;
+}
+
+// Set weights from memory (same [outputSize][inputSize] layout as the weight files)
+void FullyConnectedLayer::setWeights(const std::vector<float>& weightsData, const std::vector<float>& biasData) {
     for (int i = 0; i < outputSize; i++) {
         for (int j = 0; j < inputSize; j++) {
             weights[i][j] = weightsData[i * inputSize + j];
         }
+        bias[i] = biasData[i];
     }
-
-    file.read(reinterpret_cast<char*>(bias.data()), biasSize);
-    return true;
 }
\ No newline at end of file
@@ -1,13 +1,86 @@
 #include "ConvolutionalLayerV2.h"
+#include <chrono>
 
-ConvolutionalLayerV2::TileBuffers::TileBuffers(int tm, int tn, int tr, int tc, int k, int s)
-    : tileRows(tr), tileCols(tc), tiSize(tn), toSize(tm) {
+ConvolutionalLayerV2::TileBuffers::TileBuffers()
+    : tileRows(0), tileCols(0), tileInputHeight(0), tileInputWidth(0), tiSize(0), toSize(0) {
+}
+
+ConvolutionalLayerV2::TileBuffers::TileBuffers(int tm, int tn, int tr, int tc, int k, int s) {
+    reshape(tm, tn, tr, tc, k, s);
+}
+
+void ConvolutionalLayerV2::TileBuffers::reshape(int tm, int tn, int tr, int tc, int k, int s) {
+    tileRows = tr;
+    tileCols = tc;
+    tiSize = tn;
+    toSize = tm;
     tileInputHeight = tr * s + k - s;
     tileInputWidth = tc * s + k - s;
 
-    inputBuffer.resize(tn * tileInputHeight * tileInputWidth, 0.0f);
-    weightBuffer.resize(tm * tn * k * k, 0.0f);
-    outputBuffer.resize(tm * tr * tc, 0.0f);
+    inputBuffer.assign(tn * tileInputHeight * tileInputWidth, 0.0f);
+    weightBuffer.assign(tm * tn * k * k, 0.0f);
+    outputBuffer.assign(tm * tr * tc, 0.0f);
+}
+
+ConvolutionalLayerV2::PrefetchThread::PrefetchThread()
+    : busy(false), stopping(false) {
+    thread = std::thread(&PrefetchThread::threadLoop, this);
+}
+
+ConvolutionalLayerV2::PrefetchThread::~PrefetchThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_one();
+    thread.join();
+}
+
+void ConvolutionalLayerV2::PrefetchThread::post(std::function<void()> newJob) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = std::move(newJob);
+        error = nullptr;
+        busy = true;
+    }
+    jobReady.notify_one();
+}
+
+void ConvolutionalLayerV2::PrefetchThread::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock, [this]() { return !busy; });
+    std::exception_ptr jobError = error;
+    error = nullptr;
+    lock.unlock();
+    if (jobError) {
+        std::rethrow_exception(jobError);
+    }
+}
+
+void ConvolutionalLayerV2::PrefetchThread::threadLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        jobReady.wait(lock, [this]() { return stopping || busy; });
+        if (!busy) {
+            return;
+        }
+        std::function<void()> current;
+        current.swap(job);
+        lock.unlock();
+
+        std::exception_ptr jobError;
+        try {
+            current();
+        }
+        catch (...) {
+            jobError = std::current_exception();
+        }
+
+        lock.lock();
+        error = jobError;
+        busy = false;
+        jobDone.notify_all();
+    }
 }
 
 ConvolutionalLayerV2::ConvolutionalLayerV2(const std::string& name,
@@ -31,7 +104,10 @@ ConvolutionalLayerV2::ConvolutionalLayerV2(const std::string& name,
     Tm(tileSizeM),
     Tn(tileSizeN),
     Tr(tileSizeR),
-    Tc(tileSizeC) {
+    Tc(tileSizeC),
+    useTemplatedKernels(true),
+    prefetchTiles(false),
+    numThreads(1) {
 }
 
 Tensor3D ConvolutionalLayerV2::forward(const Tensor3D& input) {
@@ -54,58 +130,289 @@ Tensor3D ConvolutionalLayerV2::forward(const Tensor3D& input) {
         }
     }
 
-    // Perform tiled convolution operation
-    for (int to = 0; to < outputChannels; to += Tm) {
-        int toLimit = std::min(to + Tm, outputChannels);
+    // Resolve a compile-time specialized kernel for this layer's tile shape (nullptr -> macro path)
+    int tmKernel = std::min(Tm, outputChannels);
+    int tnKernel = std::min(Tn, inputChannels);
+    TileKernelFn tileKernel = useTemplatedKernels ?
+        findTileKernel(tmKernel, tnKernel, kernelSize, stride) : nullptr;
 
-        for (int ti = 0; ti < inputChannels; ti += Tn) {
-            int tiLimit = std::min(ti + Tn, inputChannels);
+    if (numThreads > 1) {
+        // Output tiles spread over the work-stealing pool, ti reduction kept inside each tile
+        forwardParallel(input, output, tileKernel, outputHeight, outputWidth);
+    }
+    else if (prefetchTiles) {
+        // Ping-pong buffers: the next tile is loaded while the current one is computed
+        forwardDoubleBuffered(input, output, tileKernel, outputHeight, outputWidth);
+    }
+    else {
+        // Perform tiled convolution operation
+        for (int to = 0; to < outputChannels; to += Tm) {
+            int toLimit = std::min(to + Tm, outputChannels);
+
+            for (int ti = 0; ti < inputChannels; ti += Tn) {
+                int tiLimit = std::min(ti + Tn, inputChannels);
+
+                for (int row = 0; row < outputHeight; row += Tr) {
+                    int rowLimit = std::min(row + Tr, outputHeight);
+
+                    for (int col = 0; col < outputWidth; col += Tc) {
+                        int colLimit = std::min(col + Tc, outputWidth);
+
+                        // Allocate buffers for the current tile (full Tm x Tn for the templated
+                        // kernels, edge tiles stay zero-padded)
+                        TileBuffers buffers(
+                            tileKernel ? tmKernel : toLimit - to,
+                            tileKernel ? tnKernel : tiLimit - ti,
+                            rowLimit - row,
+                            colLimit - col,
+                            kernelSize,
+                            stride
+                        );
+
+                        // Load input tile data with padding handling
+                        loadInputTile(input, buffers, ti, tiLimit, row, rowLimit, col, colLimit);
+
+                        // Load weight tile data
+                        loadWeightTile(buffers, to, toLimit, ti, tiLimit);
+
+                        // Initialize output buffer with ZEROS (not bias)
+                        initOutputTileZero(buffers);
+
+                        // Process tile using optimized loop ordering
+                        computeTile(buffers, tileKernel, ti, tiLimit, to, toLimit);
+
+                        // ACCUMULATE to output tensor (not overwrite)
+                        accumulateOutputTile(output, buffers, to, toLimit, row, rowLimit, col, colLimit);
+                    }
+                }
+            }
+        }
+    }
 
-            for (int row = 0; row < outputHeight; row += Tr) {
-                int rowLimit = std::min(row + Tr, outputHeight);
+    // Apply ReLU activation ONCE at the end (not per tile)
+    for (int to = 0; to < outputChannels; to++) {
+        for (int row = 0; row < outputHeight; row++) {
+            for (int col = 0; col < outputWidth; col++) {
+                output.at(to, row, col) = std::max(0.0f, output.at(to, row, col));
+            }
+        }
+    }
 
-                for (int col = 0; col < outputWidth; col += Tc) {
-                    int colLimit = std::min(col + Tc, outputWidth);
+    return output;
+}
 
-                    // Allocate buffers for the current tile
-                    TileBuffers buffers(
-                        toLimit - to,
-                        tiLimit - ti,
-                        rowLimit - row,
-                        colLimit - col,
-                        kernelSize,
-                        stride
-                    );
+void ConvolutionalLayerV2::setUseTemplatedKernels(bool enable) {
+    useTemplatedKernels = enable;
+}
 
-                    // Load input tile data with padding handling
-                    loadInputTile(input, buffers, ti, tiLimit, row, rowLimit, col, colLimit);
+bool ConvolutionalLayerV2::usesTemplatedKernels() const {
+    return useTemplatedKernels &&
+        findTileKernel(std::min(Tm, outputChannels), std::min(Tn, inputChannels), kernelSize, stride) != nullptr;
+}
 
-                    // Load weight tile data
-                    loadWeightTile(buffers, to, toLimit, ti, tiLimit);
+void ConvolutionalLayerV2::setPrefetchTiles(bool enable) {
+    prefetchTiles = enable;
+    if (!enable) {
+        prefetchThread.reset();
+    }
+    else if (!prefetchThread) {
+        prefetchThread = std::make_unique<PrefetchThread>();
+    }
+}
 
-                    // Initialize output buffer with ZEROS (not bias)
-                    initOutputTileZero(buffers);
+const ConvolutionalLayerV2::PrefetchStats& ConvolutionalLayerV2::getPrefetchStats() const {
+    return prefetchStats;
+}
 
-                    // Process tile using optimized loop ordering
-                    processTile(buffers, ti, tiLimit, to, toLimit);
+void ConvolutionalLayerV2::setNumThreads(int threads) {
+    numThreads = std::max(1, threads);
+    if (numThreads == 1) {
+        tilePool.reset();
+    }
+    else if (!tilePool || tilePool->getNumWorkers() != numThreads) {
+        tilePool = std::make_unique<WorkStealingPool>(numThreads);
+    }
+}
+
+int ConvolutionalLayerV2::getNumThreads() const {
+    return numThreads;
+}
 
-                    // ACCUMULATE to output tensor (not overwrite)
-                    accumulateOutputTile(output, buffers, to, toLimit, row, rowLimit, col, colLimit);
+std::vector<WorkStealingPool::WorkerStats> ConvolutionalLayerV2::getWorkerStats() const {
+    return tilePool ? tilePool->getStats() : std::vector<WorkStealingPool::WorkerStats>();
+}
+
+std::vector<ConvolutionalLayerV2::TileCoord> ConvolutionalLayerV2::enumerateTiles(int outputHeight, int outputWidth) const {
+    // Same order as the loop nest in forward(): to -> ti -> row -> col
+    std::vector<TileCoord> tiles;
+    for (int to = 0; to < outputChannels; to += Tm) {
+        for (int ti = 0; ti < inputChannels; ti += Tn) {
+            for (int row = 0; row < outputHeight; row += Tr) {
+                for (int col = 0; col < outputWidth; col += Tc) {
+                    tiles.push_back({
+                        to, std::min(to + Tm, outputChannels),
+                        ti, std::min(ti + Tn, inputChannels),
+                        row, std::min(row + Tr, outputHeight),
+                        col, std::min(col + Tc, outputWidth)
+                    });
                 }
             }
         }
     }
+    return tiles;
+}
 
-    // Apply ReLU activation ONCE at the end (not per tile)
-    for (int to = 0; to < outputChannels; to++) {
-        for (int row = 0; row < outputHeight; row++) {
-            for (int col = 0; col < outputWidth; col++) {
-                output.at(to, row, col) = std::max(0.0f, output.at(to, row, col));
+void ConvolutionalLayerV2::forwardDoubleBuffered(const Tensor3D& input, Tensor3D& output, TileKernelFn tileKernel,
+    int outputHeight, int outputWidth) {
+    using Clock = std::chrono::high_resolution_clock;
+    using Milliseconds = std::chrono::duration<double, std::milli>;
+
+    std::vector<TileCoord> tiles = enumerateTiles(outputHeight, outputWidth);
+    prefetchStats = PrefetchStats();
+    prefetchStats.tiles = static_cast<int>(tiles.size());
+    if (tiles.empty()) {
+        return;
+    }
+
+    // Two buffer sets (slots), as the ping-pong buffers of the FPGA design.
+    // The helper thread loads tile t into slot t % 2 as soon as the compute
+    // thread has released it, so it runs up to one tile ahead; the compute
+    // thread waits until slot t % 2 is full, computes it and releases it.
+    TileBuffers buffers[2];
+    bool slotFull[2] = { false, false };
+    bool loaderStopped = false;  // The helper gave up (an exception, or the compute thread stopped)
+    bool computeStopped = false;
+    std::mutex slotMutex;
+    std::condition_variable slotChanged;
+    double loadMs = 0.0;
+
+    prefetchThread->post([&]() {
+        try {
+            for (size_t t = 0; t < tiles.size(); t++) {
+                int slot = static_cast<int>(t % 2);
+                {
+                    std::unique_lock<std::mutex> lock(slotMutex);
+                    slotChanged.wait(lock, [&]() { return !slotFull[slot] || computeStopped; });
+                    if (computeStopped) {
+                        break;
+                    }
+                }
+                auto start = Clock::now();
+                loadTile(input, buffers[slot], tiles[t], tileKernel);
+                loadMs += Milliseconds(Clock::now() - start).count();
+                {
+                    std::lock_guard<std::mutex> lock(slotMutex);
+                    slotFull[slot] = true;
+                }
+                slotChanged.notify_all();
+            }
+        }
+        catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(slotMutex);
+                loaderStopped = true;
+            }
+            slotChanged.notify_all();
+            throw;
+        }
+    });
+
+    try {
+        for (size_t t = 0; t < tiles.size(); t++) {
+            int slot = static_cast<int>(t % 2);
+            const TileCoord& tile = tiles[t];
+
+            // Any time spent waiting here is load time that was not hidden
+            auto waitStart = Clock::now();
+            {
+                std::unique_lock<std::mutex> lock(slotMutex);
+                slotChanged.wait(lock, [&]() { return slotFull[slot] || loaderStopped; });
+                if (!slotFull[slot]) {
+                    break;
+                }
             }
+            prefetchStats.exposedLoadMs += Milliseconds(Clock::now() - waitStart).count();
+
+            auto computeStart = Clock::now();
+            computeTile(buffers[slot], tileKernel, tile.tiStart, tile.tiEnd, tile.toStart, tile.toEnd);
+            accumulateOutputTile(output, buffers[slot], tile.toStart, tile.toEnd,
+                tile.rowStart, tile.rowEnd, tile.colStart, tile.colEnd);
+            prefetchStats.computeMs += Milliseconds(Clock::now() - computeStart).count();
+
+            {
+                std::lock_guard<std::mutex> lock(slotMutex);
+                slotFull[slot] = false;
+            }
+            slotChanged.notify_all();
         }
     }
+    catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(slotMutex);
+            computeStopped = true;
+        }
+        slotChanged.notify_all();
+        prefetchThread->wait();
+        throw;
+    }
 
-    return output;
+    // Rethrows a failed load
+    prefetchThread->wait();
+    prefetchStats.loadMs = loadMs;
+}
+
+void ConvolutionalLayerV2::forwardParallel(const Tensor3D& input, Tensor3D& output, TileKernelFn tileKernel,
+    int outputHeight, int outputWidth) {
+    // One task per (to, row, col) output tile. The tiles write disjoint regions of the
+    // output tensor, so the workers never need to synchronize on it.
+    std::vector<TileCoord> outputTiles;
+    for (int to = 0; to < outputChannels; to += Tm) {
+        for (int row = 0; row < outputHeight; row += Tr) {
+            for (int col = 0; col < outputWidth; col += Tc) {
+                outputTiles.push_back({
+                    to, std::min(to + Tm, outputChannels),
+                    0, inputChannels,
+                    row, std::min(row + Tr, outputHeight),
+                    col, std::min(col + Tc, outputWidth)
+                });
+            }
+        }
+    }
+
+    // Each worker owns its tile buffers
+    std::vector<TileBuffers> workerBuffers(tilePool->getNumWorkers());
+
+    tilePool->run(static_cast<int>(outputTiles.size()), [&](int taskIndex, int workerId) {
+        TileBuffers& buffers = workerBuffers[workerId];
+        TileCoord tile = outputTiles[taskIndex];
+
+        // Accumulate over the input channel tiles in the same order as the serial loop nest
+        for (int ti = 0; ti < inputChannels; ti += Tn) {
+            tile.tiStart = ti;
+            tile.tiEnd = std::min(ti + Tn, inputChannels);
+
+            loadTile(input, buffers, tile, tileKernel);
+            computeTile(buffers, tileKernel, tile.tiStart, tile.tiEnd, tile.toStart, tile.toEnd);
+            accumulateOutputTile(output, buffers, tile.toStart, tile.toEnd,
+                tile.rowStart, tile.rowEnd, tile.colStart, tile.colEnd);
+        }
+    });
+}
+
+void ConvolutionalLayerV2::loadTile(const Tensor3D& input, TileBuffers& buffers, const TileCoord& tile,
+    TileKernelFn tileKernel) {
+    // Full Tm x Tn buffers for the templated kernels (edge tiles zero-padded)
+    buffers.reshape(
+        tileKernel ? std::min(Tm, outputChannels) : tile.toEnd - tile.toStart,
+        tileKernel ? std::min(Tn, inputChannels) : tile.tiEnd - tile.tiStart,
+        tile.rowEnd - tile.rowStart,
+        tile.colEnd - tile.colStart,
+        kernelSize,
+        stride
+    );
+
+    loadInputTile(input, buffers, tile.tiStart, tile.tiEnd, tile.rowStart, tile.rowEnd, tile.colStart, tile.colEnd);
+    loadWeightTile(buffers, tile.toStart, tile.toEnd, tile.tiStart, tile.tiEnd);
 }
 
 void ConvolutionalLayerV2::initializeWeights(float stddev) {
@@ -230,6 +537,17 @@ void ConvolutionalLayerV2::initOutputTile(TileBuffers& buffers, int toStart, int
     }
 }
 
+void ConvolutionalLayerV2::computeTile(TileBuffers& buffers, TileKernelFn tileKernel,
+    int tiStart, int tiEnd, int toStart, int toEnd) {
+    if (tileKernel) {
+        tileKernel(buffers.inputBuffer.data(), buffers.weightBuffer.data(), buffers.outputBuffer.data(),
+            buffers.tileRows, buffers.tileCols, buffers.tileInputHeight, buffers.tileInputWidth);
+    }
+    else {
+        processTile(buffers, tiStart, tiEnd, toStart, toEnd);
+    }
+}
+
 void ConvolutionalLayerV2::processTile(TileBuffers& buffers, int tiStart, int tiEnd, int toStart, int toEnd) {
     // Following the paper's proposed accelerator structure (Code 3):
         // Loop order: i -> j -> trr -> tcc -> too -> tii
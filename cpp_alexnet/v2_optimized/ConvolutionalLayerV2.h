@@ -2,12 +2,20 @@
 
 #include "Layer.h"
 #include "Tensor3D.h"
+#include "TileKernels.h"
+#include "WorkStealingPool.h"
 #include <vector>
 #include <string>
 #include <random>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 /**
  * Optimized ConvolutionalLayer implementation following the loop optimization
@@ -30,6 +38,40 @@ private:
     int Tr; // Tile size for output rows
     int Tc; // Tile size for output columns
 
+    bool useTemplatedKernels; // Use compile-time specialized tile kernels when available
+    bool prefetchTiles;       // Load the next tile on a helper thread (ping-pong buffers)
+    int numThreads;           // Workers for the parallel tile scheduler (1 = serial)
+    std::unique_ptr<WorkStealingPool> tilePool;
+
+    // Persistent helper thread of the prefetch mode. It runs one posted job at
+    // a time, so no thread is created per tile or per forward() call.
+    class PrefetchThread {
+    public:
+        PrefetchThread();
+        ~PrefetchThread();
+
+        PrefetchThread(const PrefetchThread&) = delete;
+        PrefetchThread& operator=(const PrefetchThread&) = delete;
+
+        // Start job on the helper thread (the previous job must have been waited for)
+        void post(std::function<void()> job);
+        // Block until the posted job has finished; rethrows an exception it threw
+        void wait();
+
+    private:
+        void threadLoop();
+
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable jobReady;
+        std::condition_variable jobDone;
+        std::function<void()> job;
+        std::exception_ptr error;
+        bool busy;
+        bool stopping;
+    };
+    std::unique_ptr<PrefetchThread> prefetchThread;
+
     // Helper class for input and weight buffers to simulate optimized memory access
     struct TileBuffers {
         std::vector<float> inputBuffer;  // [Tn][TrxS+K-S][TcxS+K-S]
@@ -42,9 +84,35 @@ private:
         int tiSize;                     // Number of input channels in this tile
         int toSize;                     // Number of output channels in this tile
 
+        TileBuffers();
         TileBuffers(int tm, int tn, int tr, int tc, int k, int s);
+
+        // Resize for a new tile and clear all buffers, reusing the allocated storage
+        void reshape(int tm, int tn, int tr, int tc, int k, int s);
+    };
+
+    // Bounds of one (to, ti, row, col) tile of the loop nest in forward()
+    struct TileCoord {
+        int toStart, toEnd;
+        int tiStart, tiEnd;
+        int rowStart, rowEnd;
+        int colStart, colEnd;
     };
 
+public:
+    // Timing of the double-buffered (prefetch) mode, collected per forward() call
+    struct PrefetchStats {
+        int tiles = 0;              // Number of tiles processed
+        double loadMs = 0.0;        // Total time spent loading tiles (on either thread)
+        double exposedLoadMs = 0.0; // Load time the compute thread actually waited for
+        double computeMs = 0.0;     // Time spent computing and accumulating tiles
+
+        double hiddenLoadMs() const { return std::max(0.0, loadMs - exposedLoadMs); }
+    };
+
+private:
+    PrefetchStats prefetchStats;
+
 public:
     ConvolutionalLayerV2(const std::string& name,
         int inputChannels,
@@ -61,7 +129,31 @@ public:
     void initializeWeights(float stddev = 0.01f);
     virtual bool loadWeights(const std::string& filename) override;
 
+    // Select between the templated tile kernels and the PROCESS_TOO/PROCESS_TII macro path
+    void setUseTemplatedKernels(bool enable);
+    bool usesTemplatedKernels() const;
+
+    // Overlap loading of the next tile with computation of the current one
+    void setPrefetchTiles(bool enable);
+    const PrefetchStats& getPrefetchStats() const;
+
+    // Distribute output tiles over a work-stealing pool of numThreads workers (takes precedence over prefetch)
+    void setNumThreads(int threads);
+    int getNumThreads() const;
+    // Per-worker tile counts of the last parallel forward()
+    std::vector<WorkStealingPool::WorkerStats> getWorkerStats() const;
+
 private:
+    std::vector<TileCoord> enumerateTiles(int outputHeight, int outputWidth) const;
+
+    void forwardDoubleBuffered(const Tensor3D& input, Tensor3D& output, TileKernelFn tileKernel,
+        int outputHeight, int outputWidth);
+
+    void forwardParallel(const Tensor3D& input, Tensor3D& output, TileKernelFn tileKernel,
+        int outputHeight, int outputWidth);
+
+    void loadTile(const Tensor3D& input, TileBuffers& buffers, const TileCoord& tile, TileKernelFn tileKernel);
+
     void loadInputTile(const Tensor3D& input, TileBuffers& buffers,
         int tiStart, int tiEnd, int rowStart, int rowEnd, int colStart, int colEnd);
 
@@ -69,6 +161,9 @@ private:
 
     void initOutputTile(TileBuffers& buffers, int toStart, int toEnd);
 
+    void computeTile(TileBuffers& buffers, TileKernelFn tileKernel,
+        int tiStart, int tiEnd, int toStart, int toEnd);
+
     void processTile(TileBuffers& buffers, int tiStart, int tiEnd, int toStart, int toEnd);
 
     void computeTileUnitToo(TileBuffers& buffers, int i, int j, int trr, int tcc,
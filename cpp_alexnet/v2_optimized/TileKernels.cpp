@@ -0,0 +1,31 @@
+#include "TileKernels.h"
+
+namespace {
+
+struct TileKernelEntry {
+    int tm;
+    int tn;
+    int kernelSize;
+    int stride;
+    TileKernelFn kernel;
+};
+
+// Instantiations for the AlexNet layer shapes with the default tile sizes
+// (Tm = 64, Tn = 7). Tn is clamped to the layer's input channels, hence 3 for conv1.
+const TileKernelEntry tileKernelTable[] = {
+    { 64, 3, 11, 4, &convTileKernel<64, 3, 11, 4> },  // conv1
+    { 64, 7,  5, 1, &convTileKernel<64, 7,  5, 1> },  // conv2
+    { 64, 7,  3, 1, &convTileKernel<64, 7,  3, 1> },  // conv3, conv4, conv5
+};
+
+} // namespace
+
+TileKernelFn findTileKernel(int tm, int tn, int kernelSize, int stride) {
+    for (const TileKernelEntry& entry : tileKernelTable) {
+        if (entry.tm == tm && entry.tn == tn &&
+            entry.kernelSize == kernelSize && entry.stride == stride) {
+            return entry.kernel;
+        }
+    }
+    return nullptr;
+}
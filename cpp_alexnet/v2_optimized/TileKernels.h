@@ -0,0 +1,62 @@
+#pragma once
+
+/**
+ * Compile-time specialized tile kernels for ConvolutionalLayerV2.
+ *
+ * The PROCESS_TOO/PROCESS_TII macros in ConvolutionalLayerV2 work on runtime tile
+ * sizes, so every unrolled step carries an `if` guard and the compiler never sees
+ * a fixed trip count. The kernels below take Tm, Tn, K and S as template
+ * parameters instead: the channel and kernel loops have constant bounds and the
+ * innermost loop walks one contiguous output row, which lets the compiler unroll
+ * and vectorize it.
+ *
+ * Buffer layout is the same as ConvolutionalLayerV2::TileBuffers, with the input
+ * and weight buffers sized for the full Tm x Tn tile. Edge tiles with fewer
+ * channels are zero-padded by the caller, so they contribute nothing.
+ */
+using TileKernelFn = void (*)(const float* inputBuffer,   // [TN][tileInputHeight][tileInputWidth]
+                              const float* weightBuffer,  // [TM][TN][K][K]
+                              float* outputBuffer,        // [TM][tileRows][tileCols]
+                              int tileRows,
+                              int tileCols,
+                              int tileInputHeight,
+                              int tileInputWidth);
+
+template <int TM, int TN, int K, int S>
+void convTileKernel(const float* inputBuffer, const float* weightBuffer, float* outputBuffer,
+    int tileRows, int tileCols, int tileInputHeight, int tileInputWidth) {
+    const int inputChannelSize = tileInputHeight * tileInputWidth;
+
+    for (int too = 0; too < TM; too++) {
+        const float* weightsToo = weightBuffer + too * TN * K * K;
+        float* outputToo = outputBuffer + too * tileRows * tileCols;
+
+        for (int trr = 0; trr < tileRows; trr++) {
+            float* outputRow = outputToo + trr * tileCols;
+
+            for (int tii = 0; tii < TN; tii++) {
+                const float* inputTii = inputBuffer + tii * inputChannelSize;
+                const float* weightsTii = weightsToo + tii * K * K;
+
+                for (int i = 0; i < K; i++) {
+                    const float* inputRow = inputTii + (trr * S + i) * tileInputWidth;
+
+                    for (int j = 0; j < K; j++) {
+                        const float weight = weightsTii[i * K + j];
+
+                        // Contiguous output row, fixed input stride S: vectorizable
+                        for (int tcc = 0; tcc < tileCols; tcc++) {
+                            outputRow[tcc] += weight * inputRow[tcc * S + j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Look up the specialized kernel for a (Tm, Tn, K, S) tile shape.
+ * Returns nullptr when no instantiation exists; callers fall back to the macro path.
+ */
+TileKernelFn findTileKernel(int tm, int tn, int kernelSize, int stride);
@@ -0,0 +1,156 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int numWorkers)
+    : numWorkers(std::max(1, numWorkers)),
+    currentTask(nullptr),
+    generation(0),
+    busyWorkers(0),
+    stopping(false) {
+    for (int w = 0; w < this->numWorkers; w++) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    stats.resize(this->numWorkers);
+    errors.resize(this->numWorkers);
+
+    // Worker 0 is the thread that calls run()
+    for (int w = 1; w < this->numWorkers; w++) {
+        threads.emplace_back(&WorkStealingPool::workerThread, this, w);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::run(int numTasks, const Task& task) {
+    std::fill(stats.begin(), stats.end(), WorkerStats());
+
+    // Contiguous blocks keep neighbouring tiles on the same worker
+    for (int w = 0; w < numWorkers; w++) {
+        int begin = static_cast<int>(static_cast<long long>(numTasks) * w / numWorkers);
+        int end = static_cast<int>(static_cast<long long>(numTasks) * (w + 1) / numWorkers);
+        std::lock_guard<std::mutex> lock(queues[w]->mutex);
+        queues[w]->tasks.clear();
+        for (int t = begin; t < end; t++) {
+            queues[w]->tasks.push_back(t);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(controlMutex);
+        currentTask = &task;
+        busyWorkers = numWorkers - 1;
+        generation++;
+    }
+    startCondition.notify_all();
+
+    drainQueues(0);
+
+    std::unique_lock<std::mutex> lock(controlMutex);
+    doneCondition.wait(lock, [this]() { return busyWorkers == 0; });
+    currentTask = nullptr;
+
+    std::exception_ptr error;
+    for (std::exception_ptr& workerError : errors) {
+        if (!error) {
+            error = workerError;
+        }
+        workerError = nullptr;
+    }
+    lock.unlock();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+int WorkStealingPool::getNumWorkers() const {
+    return numWorkers;
+}
+
+const std::vector<WorkStealingPool::WorkerStats>& WorkStealingPool::getStats() const {
+    return stats;
+}
+
+void WorkStealingPool::workerThread(int workerId) {
+    int seenGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(controlMutex);
+            startCondition.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        drainQueues(workerId);
+
+        {
+            std::lock_guard<std::mutex> lock(controlMutex);
+            busyWorkers--;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+void WorkStealingPool::drainQueues(int workerId) {
+    // All tasks are queued before the workers start, so empty deques mean the run is finished
+    int taskIndex;
+    while (true) {
+        bool stolen = false;
+        if (!popLocal(workerId, taskIndex)) {
+            if (!steal(workerId, taskIndex)) {
+                return;
+            }
+            stolen = true;
+        }
+
+        // An exception must not leave this thread: run() rethrows it after
+        // the other workers, which still call currentTask, are done
+        try {
+            (*currentTask)(taskIndex, workerId);
+        }
+        catch (...) {
+            if (!errors[workerId]) {
+                errors[workerId] = std::current_exception();
+            }
+        }
+        stats[workerId].executed++;
+        if (stolen) {
+            stats[workerId].stolen++;
+        }
+    }
+}
+
+bool WorkStealingPool::popLocal(int workerId, int& taskIndex) {
+    WorkerQueue& queue = *queues[workerId];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    taskIndex = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int workerId, int& taskIndex) {
+    for (int offset = 1; offset < numWorkers; offset++) {
+        WorkerQueue& victim = *queues[(workerId + offset) % numWorkers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            taskIndex = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
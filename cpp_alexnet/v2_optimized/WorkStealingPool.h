@@ -0,0 +1,70 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Small work-stealing thread pool used to distribute the output tiles of
+ * ConvolutionalLayerV2 across cores.
+ *
+ * run() splits the task indices into contiguous blocks, one deque per worker.
+ * Each worker pops from the back of its own deque and, once it is empty, steals
+ * from the front of the other workers' deques. The calling thread acts as
+ * worker 0, so a pool of N workers starts N - 1 threads. A task that throws
+ * does not stop the run: the other tasks still run, and run() rethrows the
+ * first exception (in worker order) once every worker is done.
+ */
+class WorkStealingPool {
+public:
+    struct WorkerStats {
+        int executed = 0; // Tasks run by this worker
+        int stolen = 0;   // Tasks taken from another worker's deque
+    };
+
+    // task(taskIndex, workerId)
+    using Task = std::function<void(int, int)>;
+
+    explicit WorkStealingPool(int numWorkers);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Run task for every index in [0, numTasks) and block until all are done;
+    // rethrows an exception of a task
+    void run(int numTasks, const Task& task);
+
+    int getNumWorkers() const;
+    const std::vector<WorkerStats>& getStats() const;
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    void workerThread(int workerId);
+    void drainQueues(int workerId);
+    bool popLocal(int workerId, int& taskIndex);
+    bool steal(int workerId, int& taskIndex);
+
+    int numWorkers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<WorkerStats> stats;
+    std::vector<std::exception_ptr> errors; // First exception of each worker in this run
+    std::vector<std::thread> threads;
+
+    std::mutex controlMutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    const Task* currentTask;
+    int generation;
+    int busyWorkers;
+    bool stopping;
+};
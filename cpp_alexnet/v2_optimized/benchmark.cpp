@@ -0,0 +1,212 @@
+#include "ConvolutionalLayerV2.h"
+#include "Tensor3D.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+/**
+ * Benchmark for the AlexNet convolutional layers of ConvolutionalLayerV2.
+ * Runs every layer with random weights and inputs and compares the execution
+ * modes of the tiled convolution against the original macro path.
+ */
+
+struct ConvLayerSpec {
+    const char* name;
+    int inputChannels;
+    int outputChannels;
+    int kernelSize;
+    int stride;
+    int padding;
+    int inputSize;
+};
+
+// AlexNet convolutional layers as built in CNNV2
+static const ConvLayerSpec alexnetConvLayers[] = {
+    { "conv1",   3,  64, 11, 4, 2, 224 },
+    { "conv2",  64, 192,  5, 1, 2,  27 },
+    { "conv3", 192, 384,  3, 1, 1,  13 },
+    { "conv4", 384, 256,  3, 1, 1,  13 },
+    { "conv5", 256, 256,  3, 1, 1,  13 },
+};
+
+static Tensor3D makeRandomInput(int channels, int size, unsigned seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    Tensor3D input(channels, size, size);
+    for (float& value : input.getData()) {
+        value = dist(gen);
+    }
+    return input;
+}
+
+// Returns the best-of-N forward time in milliseconds and the output of the last run
+static double timeForward(ConvolutionalLayerV2& layer, const Tensor3D& input, int repeats, Tensor3D& output) {
+    double best = 0.0;
+    for (int r = 0; r < repeats; r++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        output = layer.forward(input);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double, std::milli> duration = end - start;
+        if (r == 0 || duration.count() < best) {
+            best = duration.count();
+        }
+    }
+    return best;
+}
+
+static float maxAbsDiff(const Tensor3D& a, const Tensor3D& b) {
+    float diff = 0.0f;
+    for (size_t i = 0; i < a.getData().size(); i++) {
+        diff = std::max(diff, std::abs(a.getData()[i] - b.getData()[i]));
+    }
+    return diff;
+}
+
+static void benchmarkTemplatedKernels(int repeats) {
+    std::cout << "\n=== Templated tile kernels vs PROCESS_TOO/PROCESS_TII macro path ===" << std::endl;
+    std::cout << std::left << std::setw(8) << "layer"
+              << std::right << std::setw(14) << "macro (ms)"
+              << std::setw(16) << "templated (ms)"
+              << std::setw(10) << "speedup"
+              << std::setw(14) << "max |diff|" << std::endl;
+
+    for (const ConvLayerSpec& spec : alexnetConvLayers) {
+        ConvolutionalLayerV2 layer(spec.name, spec.inputChannels, spec.outputChannels,
+            spec.kernelSize, spec.stride, spec.padding);
+        layer.initializeWeights();
+        Tensor3D input = makeRandomInput(spec.inputChannels, spec.inputSize, 1234);
+        Tensor3D macroOutput(1, 1, 1);
+        Tensor3D templatedOutput(1, 1, 1);
+
+        layer.setUseTemplatedKernels(false);
+        double macroMs = timeForward(layer, input, repeats, macroOutput);
+
+        layer.setUseTemplatedKernels(true);
+        double templatedMs = timeForward(layer, input, repeats, templatedOutput);
+
+        std::cout << std::left << std::setw(8) << spec.name
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(14) << macroMs
+                  << std::setw(16) << templatedMs
+                  << std::setw(9) << (macroMs / templatedMs) << "x"
+                  << std::setw(14) << std::scientific << std::setprecision(2)
+                  << maxAbsDiff(macroOutput, templatedOutput)
+                  << (layer.usesTemplatedKernels() ? "" : "  (no specialization)") << std::endl;
+    }
+}
+
+static void benchmarkPrefetch(int repeats) {
+    std::cout << "\n=== Double-buffered tile prefetch (templated kernels) ===" << std::endl;
+    std::cout << std::left << std::setw(8) << "layer"
+              << std::right << std::setw(8) << "tiles"
+              << std::setw(13) << "serial (ms)"
+              << std::setw(15) << "prefetch (ms)"
+              << std::setw(10) << "speedup"
+              << std::setw(11) << "load (ms)"
+              << std::setw(13) << "hidden (ms)"
+              << std::setw(10) << "hidden %" << std::endl;
+
+    for (const ConvLayerSpec& spec : alexnetConvLayers) {
+        ConvolutionalLayerV2 layer(spec.name, spec.inputChannels, spec.outputChannels,
+            spec.kernelSize, spec.stride, spec.padding);
+        layer.initializeWeights();
+        Tensor3D input = makeRandomInput(spec.inputChannels, spec.inputSize, 1234);
+        Tensor3D serialOutput(1, 1, 1);
+        Tensor3D prefetchOutput(1, 1, 1);
+
+        layer.setPrefetchTiles(false);
+        double serialMs = timeForward(layer, input, repeats, serialOutput);
+
+        layer.setPrefetchTiles(true);
+        double prefetchMs = timeForward(layer, input, repeats, prefetchOutput);
+        const ConvolutionalLayerV2::PrefetchStats& stats = layer.getPrefetchStats();
+
+        if (maxAbsDiff(serialOutput, prefetchOutput) != 0.0f) {
+            std::cout << "  WARNING: prefetch output differs from serial output" << std::endl;
+        }
+
+        std::cout << std::left << std::setw(8) << spec.name
+                  << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << stats.tiles
+                  << std::setw(13) << serialMs
+                  << std::setw(15) << prefetchMs
+                  << std::setw(9) << (serialMs / prefetchMs) << "x"
+                  << std::setw(11) << stats.loadMs
+                  << std::setw(13) << stats.hiddenLoadMs()
+                  << std::setw(9) << (stats.loadMs > 0.0 ? 100.0 * stats.hiddenLoadMs() / stats.loadMs : 0.0)
+                  << "%" << std::endl;
+    }
+}
+
+static void benchmarkParallelTiles(int repeats) {
+    const int threadCounts[] = { 1, 2, 4, 8 };
+
+    std::cout << "\n=== Work-stealing parallel tile scheduler (templated kernels) ===" << std::endl;
+    std::cout << std::left << std::setw(8) << "layer"
+              << std::right << std::setw(14) << "output tiles"
+              << std::setw(13) << "serial (ms)";
+    for (int threads : threadCounts) {
+        std::cout << std::setw(12) << (std::to_string(threads) + " thr (x)");
+    }
+    std::cout << std::setw(9) << "steals" << std::endl;
+
+    for (const ConvLayerSpec& spec : alexnetConvLayers) {
+        ConvolutionalLayerV2 layer(spec.name, spec.inputChannels, spec.outputChannels,
+            spec.kernelSize, spec.stride, spec.padding);
+        layer.initializeWeights();
+        Tensor3D input = makeRandomInput(spec.inputChannels, spec.inputSize, 1234);
+        Tensor3D serialOutput(1, 1, 1);
+        Tensor3D parallelOutput(1, 1, 1);
+
+        layer.setNumThreads(1);
+        double serialMs = timeForward(layer, input, repeats, serialOutput);
+        int outputTiles = 0;
+
+        std::cout << std::left << std::setw(8) << spec.name << std::right;
+        std::ostringstream speedups;
+        int steals = 0;
+        for (int threads : threadCounts) {
+            layer.setNumThreads(threads);
+            double parallelMs = timeForward(layer, input, repeats, parallelOutput);
+            if (maxAbsDiff(serialOutput, parallelOutput) != 0.0f) {
+                std::cout << "  WARNING: " << threads << "-thread output differs from serial output" << std::endl;
+            }
+
+            outputTiles = 0;
+            steals = 0;
+            for (const WorkStealingPool::WorkerStats& worker : layer.getWorkerStats()) {
+                outputTiles += worker.executed;
+                steals += worker.stolen;
+            }
+            speedups << std::fixed << std::setprecision(2) << std::setw(12) << (serialMs / parallelMs);
+        }
+
+        std::cout << std::setw(14) << outputTiles
+                  << std::fixed << std::setprecision(2) << std::setw(13) << serialMs
+                  << speedups.str()
+                  << std::setw(9) << steals << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int repeats = 3;
+    if (argc > 1) {
+        repeats = std::max(1, std::atoi(argv[1]));
+    }
+
+    std::cout << "ConvolutionalLayerV2 benchmark (best of " << repeats << " runs)" << std::endl;
+
+    benchmarkTemplatedKernels(repeats);
+    benchmarkPrefetch(repeats);
+    benchmarkParallelTiles(repeats);
+
+    std::cout << "\nHardware threads: " << std::thread::hardware_concurrency() << std::endl;
+
+    return 0;
+}
@@ -2,8 +2,8 @@
 
 // Function to initialize output buffer with bias values
 void init_output_buffer(
-    data_t output_buffer[TM][TR][TC], 
-    data_t bias_buffer[TM],
+    acc_t output_buffer[TM][TR][TC], 
+    weight_t bias_buffer[TM],
     int tm_bound) {
     
     #pragma HLS INLINE
@@ -14,8 +14,45 @@ void init_output_buffer(
             #pragma HLS PIPELINE II=1
             init_c: for (int tcc = 0; tcc < TC; tcc++) {
                 // Initialize with bias if within valid bounds, otherwise zero
-                output_buffer[too][trr][tcc] = (too < tm_bound) ? bias_buffer[too] : data_t(0);
+                output_buffer[too][trr][tcc] = (too < tm_bound) ? acc_t(bias_buffer[too]) : acc_t(0);
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// Reuse schedule: keep the halo_cols columns starting at first_col, which the
+// next tc tile of the same row band reads again, for all TN channels
+void save_input_halo(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    data_t halo_buffer[TN][INPUT_TILE_HEIGHT][MAX_KERNEL_SIZE-1],
+    int first_col, int halo_cols, int rows) {
+
+    #pragma HLS INLINE off
+
+    save_halo: for (int h = 0; h < rows; h++) {
+        for (int w = 0; w < halo_cols; w++) {
+            #pragma HLS PIPELINE II=1
+            for (int n = 0; n < TN; n++) {
+                halo_buffer[n][h][w] = input_buffer[n][h][first_col + w];
+            }
+        }
+    }
+}
+
+// Reuse schedule: the saved halo becomes the first halo_cols columns of the tile
+void restore_input_halo(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    data_t halo_buffer[TN][INPUT_TILE_HEIGHT][MAX_KERNEL_SIZE-1],
+    int halo_cols, int rows) {
+
+    #pragma HLS INLINE off
+
+    restore_halo: for (int h = 0; h < rows; h++) {
+        for (int w = 0; w < halo_cols; w++) {
+            #pragma HLS PIPELINE II=1
+            for (int n = 0; n < TN; n++) {
+                input_buffer[n][h][w] = halo_buffer[n][h][w];
+            }
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #ifndef CNN_FUNCTIONS_H
 #define CNN_FUNCTIONS_H
 
+#include <ap_utils.h>
+#include <hls_stream.h>
 #include "cnn_types.h"
 
 // Memory transfer functions
@@ -10,45 +12,420 @@ void load_input_tile(
     int n_offset, int h_offset, int w_offset,
     int N, int H, int W, int S, int P);
 
+// Rows [0, rows) and columns [first_col, cols) of an input tile; the rest of
+// the buffer is left untouched (reuse schedule)
+void load_input_window(
+    data_t* input_ddr,
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    int n_offset, int h_offset, int w_offset,
+    int first_col, int rows, int cols,
+    int N, int H, int W, int S, int P);
+
 void load_weight_tile(
-    data_t* weights_ddr,
-    data_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    weight_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int m_offset, int n_offset,
+    int M, int N, int K);
+
+// Same tile from tile-major weights: the m_limit x n_limit x K*K block is
+// contiguous in DDR and read as one run
+void load_weight_tile_tiled(
+    weight_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
     int m_offset, int n_offset,
     int M, int N, int K);
 
 void load_bias(
-    data_t* bias_ddr,
-    data_t bias_buffer[TM],
+    weight_t* bias_ddr,
+    weight_t bias_buffer[TM],
     int m_offset, int M);
 
 void init_output_buffer(
-    data_t output_buffer[TM][TR][TC],
-    data_t bias_buffer[TM],
+    acc_t output_buffer[TM][TR][TC],
+    weight_t bias_buffer[TM],
     int tm_bound);
 
 void store_output_tile(
     data_t* output_ddr,
-    data_t output_buffer[TM][TR][TC],
+    acc_t output_buffer[TM][TR][TC],
+    int m_offset, int h_offset, int w_offset,
+    int M, int R, int C);
+
+// Same store limited to the first tr_bound x tc_bound pixels of the buffer
+// (the pooled tiles of a fused conv+pool layer are smaller than TR x TC)
+void store_output_block(
+    data_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
     int m_offset, int h_offset, int w_offset,
+    int tr_bound, int tc_bound,
     int M, int R, int C);
 
+// Fully-connected layers (see process_layer in cnn_top.cpp). Image i of an FC
+// call is column i % W of batch image i / W. load_fc_inputs copies features
+// [n_offset, n_offset + n_count) of the input vectors of images
+// [first_image, first_image + images) to fc_input, image g at g * n_count.
+void load_fc_inputs(
+    data_t* input_ddr,
+    data_t fc_input[FC_INPUT_BUFFER_SIZE],
+    int first_image, int images, int N, int W,
+    int n_offset, int n_count);
+
+// The weights of output channels [m_offset, m_offset + tm_bound) and input
+// features [n_offset, n_offset + n_count) in DDR order. They are one
+// contiguous run in the tile-major layout (n_offset is a multiple of TN) and
+// for whole rows, otherwise one run per output channel.
+void stream_fc_weights(
+    weight_t* weights_ddr,
+    hls::stream<weight_t>& weights,
+    int m_offset, int tm_bound, int N,
+    int n_offset, int n_count, bool tiled);
+
+void store_fc_outputs(
+    data_t* output_ddr,
+    acc_t fc_acc[MAX_BATCH][TM],
+    int first_image, int images,
+    int m_offset, int tm_bound, int M, int W);
+
+// Persistent weight store (weight_store.cpp). A preload copies weight_count
+// weights followed by M biases to [offset, offset + weight_count + M).
+void preload_resident_weights(
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    int offset, int weight_count, int M);
+
+void preload_resident_weights(
+    ddr_word_t* weights_ddr,
+    ddr_word_t* bias_ddr,
+    int offset, int weight_count, int M);
+
+void load_resident_weight_tile(
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int offset, int m_offset, int n_offset,
+    int M, int N, int K);
+
+void load_resident_bias(
+    weight_t bias_buffer[TM],
+    int bias_offset, int m_offset, int M);
+
+void stream_resident_fc_weights(
+    hls::stream<weight_t>& weights,
+    int offset, int m_offset, int tm_bound, int N,
+    int n_offset, int n_count, bool tiled);
+
+// Line-buffer streaming conv engine (line_buffer_engine.cpp); the layer must
+// satisfy line_buffer_fits()
+void line_buffer_conv(
+    data_t* input_ddr,
+    data_t* output_ddr,
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    LayerConfig layer_config);
+
+// Input halo of the reuse schedule: the K - S columns shared by adjacent tc tiles
+void save_input_halo(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    data_t halo_buffer[TN][INPUT_TILE_HEIGHT][MAX_KERNEL_SIZE-1],
+    int first_col, int halo_cols, int rows);
+
+void restore_input_halo(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    data_t halo_buffer[TN][INPUT_TILE_HEIGHT][MAX_KERNEL_SIZE-1],
+    int halo_cols, int rows);
+
+// Memory transfer functions for the packed 128-bit DDR interface (data_mover_wide.cpp).
+// Same tiles as above; the DDR tensors are packed DDR_PACK elements per word.
+void load_input_tile(
+    ddr_word_t* input_ddr,
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    int n_offset, int h_offset, int w_offset,
+    int N, int H, int W, int S, int P);
+
+void load_input_window(
+    ddr_word_t* input_ddr,
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    int n_offset, int h_offset, int w_offset,
+    int first_col, int rows, int cols,
+    int N, int H, int W, int S, int P);
+
+void load_weight_tile(
+    ddr_word_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int m_offset, int n_offset,
+    int M, int N, int K);
+
+void load_weight_tile_tiled(
+    ddr_word_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int m_offset, int n_offset,
+    int M, int N, int K);
+
+void load_bias(
+    ddr_word_t* bias_ddr,
+    weight_t bias_buffer[TM],
+    int m_offset, int M);
+
+void load_fc_inputs(
+    ddr_word_t* input_ddr,
+    data_t fc_input[FC_INPUT_BUFFER_SIZE],
+    int first_image, int images, int N, int W,
+    int n_offset, int n_count);
+
+void stream_fc_weights(
+    ddr_word_t* weights_ddr,
+    hls::stream<weight_t>& weights,
+    int m_offset, int tm_bound, int N,
+    int n_offset, int n_count, bool tiled);
+
+void store_fc_outputs(
+    ddr_word_t* output_ddr,
+    acc_t fc_acc[MAX_BATCH][TM],
+    int first_image, int images,
+    int m_offset, int tm_bound, int M, int W);
+
+void store_output_tile(
+    ddr_word_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
+    int m_offset, int h_offset, int w_offset,
+    int M, int R, int C);
+
+void store_output_block(
+    ddr_word_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
+    int m_offset, int h_offset, int w_offset,
+    int tr_bound, int tc_bound,
+    int M, int R, int C);
+
+// The data movers count their AXI beats in C simulation, and in synthesis
+// for the hardware counters (USE_PERF_COUNTERS)
+#if USE_PERF_COUNTERS || !defined(__SYNTHESIS__)
+#define AXI_TRAFFIC_COUNTERS 1
+#else
+#define AXI_TRAFFIC_COUNTERS 0
+#endif
+
+#if AXI_TRAFFIC_COUNTERS
+// AXI beats moved by the data movers
+typedef struct {
+    long long read_beats;
+    long long write_beats;
+    long long input_beats;   // Part of read_beats spent on input feature maps
+    long long weight_beats;  // Part of read_beats spent on weights
+    long long bias_beats;    // Part of read_beats spent on biases
+} AxiTrafficCounters;
+
+extern CU_LOCAL AxiTrafficCounters axi_traffic;
+
+// Beats moved on one m_axi bundle (PERF_BUNDLE_*); the reads not spent on
+// inputs, weights or biases are the partial words of the packed store
+inline long long axi_bundle_beats(const AxiTrafficCounters& traffic, int bundle) {
+    switch (bundle) {
+    case PERF_BUNDLE_INPUT:
+        return traffic.input_beats;
+    case PERF_BUNDLE_WEIGHTS:
+        return traffic.weight_beats;
+    case PERF_BUNDLE_BIAS:
+        return traffic.bias_beats;
+    default:
+        return traffic.write_beats + traffic.read_beats - traffic.input_beats - traffic.weight_beats - traffic.bias_beats;
+    }
+}
+#endif
+
+// One read of the ap_none cycle_clock port. Nothing orders a plain read of
+// that port against the m_axi accesses around it, so HLS could schedule it
+// in the middle of the transfer it is meant to bracket. The fixed protocol
+// region with a clock boundary on either side keeps every earlier access
+// before the sample and every later one after it.
+inline long long sample_cycle_clock(const volatile long long* cycle_clock) {
+    #pragma HLS INLINE
+    long long cycle;
+    {
+        #pragma HLS PROTOCOL fixed
+        ap_wait();
+        cycle = *cycle_clock;
+        ap_wait();
+    }
+    return cycle;
+}
+
+// Transfer timing of fashion_mnist_cnn_accelerator_counted: every transfer of
+// the tiled engine samples cycle_clock and the beats of its bundle before and
+// after, and the cycles that moved no beat are stall cycles of the bundle.
+// The other tops pass a clock that does not advance; without
+// USE_PERF_COUNTERS the samples are not built at all.
+typedef struct {
+    long long cycle;
+    long long beats;
+} TransferMark;
+
+inline TransferMark begin_transfer(const volatile long long* cycle_clock, int bundle) {
+    #pragma HLS INLINE
+    TransferMark mark = { 0, 0 };
+#if USE_PERF_COUNTERS
+    mark.cycle = sample_cycle_clock(cycle_clock);
+    mark.beats = axi_bundle_beats(axi_traffic, bundle);
+#else
+    (void)cycle_clock;
+    (void)bundle;
+#endif
+    return mark;
+}
+
+inline void end_transfer(const volatile long long* cycle_clock, PerfCounters& counters, int bundle, TransferMark mark) {
+    #pragma HLS INLINE
+#if USE_PERF_COUNTERS
+    long long cycles = sample_cycle_clock(cycle_clock) - mark.cycle;
+    long long beats = axi_bundle_beats(axi_traffic, bundle) - mark.beats;
+    if (cycles > beats) {
+        counters.stall_cycles[bundle] += cycles - beats;
+    }
+#else
+    (void)cycle_clock;
+    (void)counters;
+    (void)bundle;
+    (void)mark;
+#endif
+}
+
 // Compute engine functions
 void compute_tile(
     data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
-    data_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
-    data_t output_buffer[TM][TR][TC],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    acc_t output_buffer[TM][TR][TC],
+    int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound);
+
+// Same computation on a TN x TM systolic array (systolic_engine.cpp)
+void systolic_compute_tile(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    acc_t output_buffer[TM][TR][TC],
+    int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound);
+
+#ifndef __SYNTHESIS__
+// Clock cycles of the systolic array, counted in C simulation only
+extern CU_LOCAL long long systolic_array_cycles;
+#endif
+
+// compute_tile that skips pixels whose activations are all zero (zero_skip_engine.cpp)
+void zero_skip_compute_tile(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    acc_t output_buffer[TM][TR][TC],
     int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound);
 
+#ifndef __SYNTHESIS__
+// Work of zero_skip_compute_tile, counted in C simulation only. A slot is one
+// output pixel of one kernel tap, i.e. one too_batch_loop run of compute_tile.
+typedef struct {
+    long long pixel_slots;
+    long long skipped_slots;  // Slots with a zero activation in every input channel
+    long long dense_macs;     // MACs compute_tile issues: tm_bound * tn_bound per slot
+    long long skipped_macs;   // Part of dense_macs in skipped slots (cycles saved)
+    long long gated_macs;     // Part of dense_macs with a zero activation in issued slots
+} ZeroSkipCounters;
+
+extern CU_LOCAL ZeroSkipCounters zero_skip_counters;
+#endif
+
+// Conv engine of the tiled paths (USE_SYSTOLIC_ENGINE, USE_ZERO_SKIP_ENGINE)
+inline void conv_tile(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    acc_t output_buffer[TM][TR][TC],
+    int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
+    #pragma HLS INLINE
+#if USE_SYSTOLIC_ENGINE
+    systolic_compute_tile(input_buffer, weight_buffer, output_buffer, kernel_size, stride, tm_bound, tn_bound, tr_bound, tc_bound);
+#elif USE_ZERO_SKIP_ENGINE
+    zero_skip_compute_tile(input_buffer, weight_buffer, output_buffer, kernel_size, stride, tm_bound, tn_bound, tr_bound, tc_bound);
+#else
+    compute_tile(input_buffer, weight_buffer, output_buffer, kernel_size, stride, tm_bound, tn_bound, tr_bound, tc_bound);
+#endif
+}
+
+void pool_tile(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    acc_t output_buffer[TM][TR][TC],
+    int kernel_size, int stride, int tn_bound, int tr_bound, int tc_bound);
+
+// Fused max-pooling of a conv output tile into a tr_bound x tc_bound pooled tile
+void pool_output_tile(
+    acc_t output_buffer[TM][TR][TC],
+    acc_t pool_buffer[TM][TR][TC],
+    int pool_size, int stride, int tm_bound, int tr_bound, int tc_bound);
+
 void apply_relu(
-    data_t buffer[TM][TR][TC], 
+    acc_t buffer[TM][TR][TC], 
     int tm, int tr, int tc);
 
+// Multiply-accumulate of one FC output channel group over the weights of
+// stream_fc_weights, for `images` input vectors of fc_input holding n_count
+// features each. The accumulators start from the bias on the first chunk of
+// the input vectors and get the ReLU after the last one.
+void fc_tile(
+    hls::stream<weight_t>& weights,
+    data_t fc_input[FC_INPUT_BUFFER_SIZE],
+    weight_t bias_buffer[TM],
+    acc_t fc_acc[MAX_BATCH][TM],
+    int tm_bound, int n_count, int images, bool tiled, int relu_enable,
+    bool first_chunk, bool last_chunk);
+
 // Top-level accelerator function
 void fashion_mnist_cnn_accelerator(
     data_t* input_ddr,
     data_t* output_ddr,
-    data_t* weights_ddr,
-    data_t* bias_ddr,
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    LayerConfig layer_config,
+    int layer_idx);
+
+// Same accelerator with hardware performance counters (USE_PERF_COUNTERS):
+// cycle_clock is a free-running 64-bit counter of the accelerator clock in the
+// block design (e.g. a Binary Counter IP on ap_clk), sampled around the call
+// and around every transfer; the PerfCounters of the call are returned over
+// s_axilite. In C simulation cycle_clock does not advance, so only the words
+// are counted; perf_predict_counters() models the cycles.
+void fashion_mnist_cnn_accelerator_counted(
+    data_t* input_ddr,
+    data_t* output_ddr,
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    LayerConfig layer_config,
+    int layer_idx,
+    const volatile long long* cycle_clock,
+    PerfCounters* counters);
+
+// Same accelerator started once for a whole network: walks layer_count
+// entries of the layer table in DDR (see layer_table.h). input_ddr and
+// output_ddr point to the same activation buffer, weights_ddr and bias_ddr to
+// the same parameter buffer.
+void fashion_mnist_cnn_accelerator_network(
+    data_t* input_ddr,
+    data_t* output_ddr,
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    LayerDescriptor* layer_table_ddr,
+    int layer_count);
+
+// Same accelerator with double-buffered tiles: loading the next tile, computing
+// the current one and storing the previous output tile overlap (cnn_top_pingpong.cpp).
+// Layers without pingpong_supports() (fused pooling, the weight store or the
+// reuse schedule) are rejected: the call returns without writing output_ddr.
+void fashion_mnist_cnn_accelerator_pingpong(
+    data_t* input_ddr,
+    data_t* output_ddr,
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    LayerConfig layer_config,
+    int layer_idx);
+
+// Same accelerator with 128-bit AXI ports moving DDR_PACK elements per beat.
+// Every DDR tensor is packed (see ddr_packer.h).
+void fashion_mnist_cnn_accelerator_wide(
+    ddr_word_t* input_ddr,
+    ddr_word_t* output_ddr,
+    ddr_word_t* weights_ddr,
+    ddr_word_t* bias_ddr,
     LayerConfig layer_config,
     int layer_idx);
 
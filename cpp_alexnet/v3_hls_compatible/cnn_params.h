@@ -11,12 +11,138 @@
 #define MAX_KERNEL_SIZE 5  // Most CNN kernels are 3x3 or 5x5
 #define MAX_STRIDE 2       // MNIST typically uses stride 1 or 2
 
+// INT8 build: 1 = compute_tile takes the products of the two output channels
+// of a too_batch_loop iteration from one DSP48E2 multiply (dsp_packing.h).
+// Weights and activations must have at most 8 bits; the precision defaults to
+// the 8-bit row of precision_sweep instead of ap_fixed<12,6>.
+#ifndef USE_DSP_PACKING
+#define USE_DSP_PACKING 0
+#endif
+
+#if USE_DSP_PACKING
+#ifndef WEIGHT_BITS
+#define WEIGHT_BITS 8
+#endif
+#ifndef WEIGHT_INT_BITS
+#define WEIGHT_INT_BITS 1
+#endif
+#ifndef ACT_BITS
+#define ACT_BITS 8
+#endif
+#ifndef ACT_INT_BITS
+#define ACT_INT_BITS 4
+#endif
+#ifndef ACC_BITS
+#define ACC_BITS 16
+#endif
+#ifndef ACC_INT_BITS
+#define ACC_INT_BITS 6
+#endif
+#endif
+
+// Fixed-point precision as total bits and integer bits: weights (and biases),
+// activations and the on-chip accumulators. The defaults are ap_fixed<12,6>
+// weights and activations and an ap_fixed<24,10> accumulator, which holds the
+// full product and keeps the float class (a 12-bit accumulator loses it, see
+// precision_sweep); weights and activations must fit a DDR_ELEMENT_BITS lane.
+#ifndef WEIGHT_BITS
+#define WEIGHT_BITS 12
+#endif
+#ifndef WEIGHT_INT_BITS
+#define WEIGHT_INT_BITS 6
+#endif
+#ifndef ACT_BITS
+#define ACT_BITS 12
+#endif
+#ifndef ACT_INT_BITS
+#define ACT_INT_BITS 6
+#endif
+#ifndef ACC_BITS
+#define ACC_BITS 24
+#endif
+#ifndef ACC_INT_BITS
+#define ACC_INT_BITS 10
+#endif
+
+// Reuse schedule: weights of an output channel group stay on chip for layers
+// with up to MAX_RESIDENT_CHANNELS input channels (AlexNet conv4 has 384)
+#define MAX_RESIDENT_CHANNELS 384
+#define MAX_RESIDENT_TILES ((MAX_RESIDENT_CHANNELS + TN - 1) / TN)
+
+// Batch mode (LayerConfig.batch_size): the general tiled path keeps one output
+// tile per image so a weight tile serves up to MAX_BATCH images before it is
+// replaced; larger batches are processed in groups of MAX_BATCH
+#ifndef MAX_BATCH
+#define MAX_BATCH 16
+#endif
+
+// FC layers with up to FC_INPUT_BUFFER_SIZE inputs stream their weights once
+// per group of up to MAX_BATCH images. The input vectors of the group are
+// kept on chip in chunks of at most FC_INPUT_BUFFER_SIZE / MAX_BATCH features
+// when they do not fit whole: AlexNet fc6 (9216 inputs) fits one whole image,
+// Fashion-MNIST fc1 (3136) two
+#ifndef FC_INPUT_BUFFER_SIZE
+#define FC_INPUT_BUFFER_SIZE 9216
+#endif
+
+// Persistent weight store (LayerConfig.weight_mode): the conv1, conv2 and
+// fc2 weights and biases of Fashion-MNIST (20106 elements) fit
+#define RESIDENT_STORE_SIZE 20480
+
+// Conv engine selected at build time: 0 = tiled engine, 1 = line-buffer
+// streaming engine for conv layers within the LB_MAX_* limits
+#ifndef USE_LINE_BUFFER_ENGINE
+#define USE_LINE_BUFFER_ENGINE 0
+#endif
+
+// Engine of compute_tile in the tiled paths, selected at build time: 0 = the
+// loop nest of compute_engine.cpp, 1 = TM x TN systolic array (systolic_engine.cpp)
+#ifndef USE_SYSTOLIC_ENGINE
+#define USE_SYSTOLIC_ENGINE 0
+#endif
+
+// 1 = compute_tile skips output pixels whose activations are zero in every
+// input channel of the tile (zero_skip_engine.cpp); excludes USE_SYSTOLIC_ENGINE
+#ifndef USE_ZERO_SKIP_ENGINE
+#define USE_ZERO_SKIP_ENGINE 0
+#endif
+
+// 1 = the data movers also count their AXI beats in synthesis, and
+// fashion_mnist_cnn_accelerator_counted times every transfer against a
+// free-running cycle counter (PerfCounters, read over s_axilite)
+#ifndef USE_PERF_COUNTERS
+#define USE_PERF_COUNTERS 0
+#endif
+
+#if USE_SYSTOLIC_ENGINE && USE_ZERO_SKIP_ENGINE
+#error "USE_SYSTOLIC_ENGINE and USE_ZERO_SKIP_ENGINE select different compute_tile engines"
+#endif
+
+#if USE_DSP_PACKING && (WEIGHT_BITS > 8 || ACT_BITS > 8)
+#error "USE_DSP_PACKING needs weights and activations of at most 8 bits"
+#endif
+
+#if USE_DSP_PACKING && USE_SYSTOLIC_ENGINE
+#error "USE_DSP_PACKING pairs the output channels of compute_tile; the systolic PEs multiply one each"
+#endif
+
+#if FC_INPUT_BUFFER_SIZE / MAX_BATCH < TN
+#error "FC_INPUT_BUFFER_SIZE must hold a chunk of TN features for each of MAX_BATCH images"
+#endif
+
+// Line-buffer engine limits - sized for the Fashion-MNIST conv layers
+#define LB_MAX_WIDTH 32                 // Padded input width held by the line buffer
+#define LB_MAX_OUTPUT_CHANNELS 64       // Output planes accumulated on chip
+#define LB_MAX_OUTPUT_PIXELS (28*28)    // R*C of one output plane
+
 // Derived parameters for buffer sizes
 #define INPUT_TILE_HEIGHT (TR*MAX_STRIDE + MAX_KERNEL_SIZE - MAX_STRIDE)
 #define INPUT_TILE_WIDTH (TC*MAX_STRIDE + MAX_KERNEL_SIZE - MAX_STRIDE)
 
 // Memory interface parameters for KV260
 #define DDR_INTERFACE_WIDTH 128
+#define DDR_ELEMENT_BITS 16   // Each data_t or weight_t occupies a 16-bit lane of a DDR word
+#define DDR_PACK (DDR_INTERFACE_WIDTH / DDR_ELEMENT_BITS)  // Elements per DDR word
 #define AXI_BURST_LEN 8
 
 // Test parameters for co-simulation
@@ -24,5 +150,12 @@
 #define TEST_MAX_OUTPUT_SIZE 512
 #define TEST_MAX_WEIGHT_SIZE 1024
 #define TEST_MAX_BIAS_SIZE 32
+#define TEST_MAX_LAYERS 16
+
+// Same limits in packed DDR words (size / DDR_PACK)
+#define TEST_MAX_INPUT_WORDS 64
+#define TEST_MAX_OUTPUT_WORDS 64
+#define TEST_MAX_WEIGHT_WORDS 128
+#define TEST_MAX_BIAS_WORDS 4
 
 #endif // CNN_PARAMS_H
\ No newline at end of file
@@ -1,23 +1,137 @@
 #include "cnn_functions.h"
 
-// Top-level accelerator function
-void fashion_mnist_cnn_accelerator(
-    data_t* input_ddr,      // Input feature maps in DDR
-    data_t* output_ddr,     // Output feature maps in DDR
-    data_t* weights_ddr,    // Weights in DDR
-    data_t* bias_ddr,       // Bias values in DDR
-    LayerConfig layer_config,// Layer configuration
-    int layer_idx           // Current layer index
-) {
-    // Specify interface types with optimized parameters for KV260
-    #pragma HLS INTERFACE m_axi port=input_ddr offset=slave bundle=INPUT_AXI depth=TEST_MAX_INPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
-    #pragma HLS INTERFACE m_axi port=output_ddr offset=slave bundle=OUTPUT_AXI depth=TEST_MAX_OUTPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
-    #pragma HLS INTERFACE m_axi port=weights_ddr offset=slave bundle=WEIGHTS_AXI depth=TEST_MAX_WEIGHT_SIZE max_read_burst_length=8 max_write_burst_length=8
-    #pragma HLS INTERFACE m_axi port=bias_ddr offset=slave bundle=BIAS_AXI depth=TEST_MAX_BIAS_SIZE max_read_burst_length=8 max_write_burst_length=8
-    #pragma HLS INTERFACE s_axilite port=layer_config bundle=CONTROL
-    #pragma HLS INTERFACE s_axilite port=layer_idx bundle=CONTROL
-    #pragma HLS INTERFACE s_axilite port=return bundle=CONTROL
+// Weight and bias tiles come from the DDR ports, in the layer's weight_layout,
+// or from the resident store for WEIGHTS_RESIDENT calls
+template <typename weight_ddr_t>
+static void fetch_weight_tile(
+    weight_ddr_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int m_offset, int n_offset, int M, int N, int K,
+    bool resident, int resident_offset, bool tiled,
+    const volatile long long* cycle_clock, PerfCounters& counters) {
+    
+    #pragma HLS INLINE
+    
+    if (resident) {
+        load_resident_weight_tile(weight_buffer, resident_offset, m_offset, n_offset, M, N, K);
+    } else {
+        TransferMark mark = begin_transfer(cycle_clock, PERF_BUNDLE_WEIGHTS);
+        if (tiled) {
+            load_weight_tile_tiled(weights_ddr, weight_buffer, m_offset, n_offset, M, N, K);
+        } else {
+            load_weight_tile(weights_ddr, weight_buffer, m_offset, n_offset, M, N, K);
+        }
+        end_transfer(cycle_clock, counters, PERF_BUNDLE_WEIGHTS, mark);
+    }
+}
+
+template <typename weight_ddr_t>
+static void fetch_bias(
+    weight_ddr_t* bias_ddr,
+    weight_t bias_buffer[TM],
+    int m_offset, int M,
+    bool resident, int bias_offset,
+    const volatile long long* cycle_clock, PerfCounters& counters) {
     
+    #pragma HLS INLINE
+    
+    if (resident) {
+        load_resident_bias(bias_buffer, bias_offset, m_offset, M);
+    } else {
+        TransferMark mark = begin_transfer(cycle_clock, PERF_BUNDLE_BIAS);
+        load_bias(bias_ddr, bias_buffer, m_offset, M);
+        end_transfer(cycle_clock, counters, PERF_BUNDLE_BIAS, mark);
+    }
+}
+
+// Weight source of an FC output channel group and input chunk: the DDR port
+// in either layout, or the resident store for WEIGHTS_RESIDENT calls
+template <typename weight_ddr_t>
+static void read_fc_weights(
+    weight_ddr_t* weights_ddr,
+    hls::stream<weight_t>& weights,
+    int m_offset, int tm_bound, int N, int n_offset, int n_count,
+    bool resident, int resident_offset, bool tiled) {
+    
+    #pragma HLS INLINE off
+    
+    if (resident) {
+        stream_resident_fc_weights(weights, resident_offset, m_offset, tm_bound, N, n_offset, n_count, tiled);
+    } else {
+        stream_fc_weights(weights_ddr, weights, m_offset, tm_bound, N, n_offset, n_count, tiled);
+    }
+}
+
+// One FC output channel group over one input chunk: the weight reader and
+// fc_tile run as a dataflow region, so every weight is used as it arrives
+template <typename weight_ddr_t>
+static void fc_weight_pass(
+    weight_ddr_t* weights_ddr,
+    data_t fc_input[FC_INPUT_BUFFER_SIZE],
+    weight_t bias_buffer[TM],
+    acc_t fc_acc[MAX_BATCH][TM],
+    int m_offset, int tm_bound, int N, int n_offset, int n_count, int images,
+    bool resident, int resident_offset, bool tiled, int relu_enable,
+    bool first_chunk, bool last_chunk) {
+    
+    #pragma HLS INLINE off
+    #pragma HLS DATAFLOW
+    
+    hls::stream<weight_t> weights("fc_weights");
+    
+    read_fc_weights(weights_ddr, weights, m_offset, tm_bound, N, n_offset, n_count,
+        resident, resident_offset, tiled);
+    fc_tile(weights, fc_input, bias_buffer, fc_acc, tm_bound, n_count, images, tiled, relu_enable,
+        first_chunk, last_chunk);
+}
+
+// Output stage of a conv or FC tile: ReLU, then the store of the tile or,
+// for a fused conv+pool layer, the max-pooling of the tile into pool_buffer
+// and the store of the pooled tile. h_offset, w_offset, R and C address the
+// map in DDR, which is the pooled map when pool_size > 0.
+template <typename ddr_t>
+static void write_output_tile(
+    ddr_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
+    acc_t pool_buffer[TM][TR][TC],
+    int m_offset, int h_offset, int w_offset, int M, int R, int C,
+    int tm_bound, int tr_bound, int tc_bound,
+    int relu_enable, int pool_size, int pool_stride,
+    const volatile long long* cycle_clock, PerfCounters& counters) {
+    
+    #pragma HLS INLINE
+    
+    if (relu_enable) {
+        apply_relu(output_buffer, tm_bound, tr_bound, tc_bound);
+    }
+    if (pool_size > 0) {
+        int pr_bound = fused_pool_extent(tr_bound, pool_size, pool_stride);
+        int pc_bound = fused_pool_extent(tc_bound, pool_size, pool_stride);
+        pool_output_tile(output_buffer, pool_buffer, pool_size, pool_stride, tm_bound, pr_bound, pc_bound);
+        TransferMark mark = begin_transfer(cycle_clock, PERF_BUNDLE_OUTPUT);
+        store_output_block(output_ddr, pool_buffer, m_offset, h_offset, w_offset, pr_bound, pc_bound, M, R, C);
+        end_transfer(cycle_clock, counters, PERF_BUNDLE_OUTPUT, mark);
+    }
+    else {
+        TransferMark mark = begin_transfer(cycle_clock, PERF_BUNDLE_OUTPUT);
+        store_output_tile(output_ddr, output_buffer, m_offset, h_offset, w_offset, M, R, C);
+        end_transfer(cycle_clock, counters, PERF_BUNDLE_OUTPUT, mark);
+    }
+}
+
+// Layer processing shared by both top functions. ddr_t and weight_ddr_t are
+// data_t and weight_t for the element-wide ports and ddr_word_t for the packed
+// 128-bit ports; the data mover overloads are picked by the pointer type.
+template <typename ddr_t, typename weight_ddr_t>
+static void process_layer(
+    ddr_t* input_ddr,
+    ddr_t* output_ddr,
+    weight_ddr_t* weights_ddr,
+    weight_ddr_t* bias_ddr,
+    LayerConfig layer_config,
+    const volatile long long* cycle_clock,
+    PerfCounters& counters
+) {
     // Extract layer parameters
     int N = layer_config.input_channels;
     int M = layer_config.output_channels;
@@ -28,73 +142,460 @@ void fashion_mnist_cnn_accelerator(
     int K = layer_config.kernel_size;
     int S = layer_config.stride;
     int P = layer_config.padding;
+    int layer_type = layer_config.layer_type;
+    int relu_enable = layer_config.relu_enable;
+    
+    // FC layers have a [N][W] input: the input features are the input
+    // channels and W images run along the width of a single-row feature map.
+    // Beyond FC_INPUT_BUFFER_SIZE inputs they run as a 1x1 convolution.
+    if (layer_type == LAYER_FC) {
+        input_H = 1;
+        output_H = 1;
+        output_W = input_W;
+        K = 1;
+        S = 1;
+        P = 0;
+    }
+    
+    // Fused max-pooling of conv layers. An output tile holds the conv rows of
+    // pool_tr pooled rows: tiles start pool_tr * pool_S conv rows apart, and
+    // overlapping windows (pool_K > pool_S) compute the pool_K - pool_S rows
+    // they share with the next tile in both tiles. Without pooling the same
+    // geometry with a 1 x 1 window gives the plain TR x TC tiles.
+    int pool_size = (layer_type == LAYER_CONV) ? layer_config.pool_size : 0;
+    int pool_stride = layer_config.pool_stride;
+    int pool_K = (pool_size > 0) ? pool_size : 1;
+    int pool_S = (pool_size > 0) ? pool_stride : 1;
+    int pool_tr = (TR - pool_K) / pool_S + 1;
+    int pool_tc = (TC - pool_K) / pool_S + 1;
+    int store_H = fused_pool_extent(output_H, pool_size, pool_stride);
+    int store_W = fused_pool_extent(output_W, pool_size, pool_stride);
+    
+    // A preload call only fills the resident weight store
+    if (layer_config.weight_mode == WEIGHTS_PRELOAD) {
+        preload_resident_weights(weights_ddr, bias_ddr, layer_config.resident_offset, M * N * K * K, M);
+        return;
+    }
+    bool resident = (layer_config.weight_mode == WEIGHTS_RESIDENT);
+    bool tiled = (layer_config.weight_layout == WEIGHT_LAYOUT_TILED);
+    int resident_offset = layer_config.resident_offset;
+    int bias_offset = resident_offset + M * N * K * K;
     
     // On-chip buffers with balanced partitioning for KV260
     data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH];
     #pragma HLS ARRAY_PARTITION variable=input_buffer dim=1 complete
     
-    data_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
     #pragma HLS ARRAY_PARTITION variable=weight_buffer dim=1 cyclic factor=2
     #pragma HLS ARRAY_PARTITION variable=weight_buffer dim=2 cyclic factor=2
     
-    data_t output_buffer[TM][TR][TC];
-    #pragma HLS ARRAY_PARTITION variable=output_buffer dim=1 cyclic factor=2
+    // One output tile per image of a batch group; the other paths use tile 0.
+    // The systolic array writes one pixel of every output channel per cycle.
+    acc_t output_buffer[MAX_BATCH][TM][TR][TC];
+#if USE_SYSTOLIC_ENGINE
+    #pragma HLS ARRAY_PARTITION variable=output_buffer dim=2 complete
+#else
+    #pragma HLS ARRAY_PARTITION variable=output_buffer dim=2 cyclic factor=2
+#endif
+    
+    // Pooled tile of a fused conv+pool layer
+    acc_t pool_buffer[TM][TR][TC];
     
-    data_t bias_buffer[TM];
+    weight_t bias_buffer[TM];
     #pragma HLS ARRAY_PARTITION variable=bias_buffer cyclic factor=2
     
+    // Image b of a batch is channels [b*N, b*N + N) of a [B*N][H][W] tensor, so
+    // the data movers address it by channel offset with N raised to b*N + N
+    // (the limit they clip the tile against); the same holds for the output
+    int B = layer_config.batch_size;
+    
+    // Max-pooling, TN channels at a time: only the rows and columns the
+    // pooling windows of a tile cover are loaded
+    if (layer_type == LAYER_MAXPOOL) {
+        int tn_steps = (N + TN - 1) / TN;
+        int tr_steps = (output_H + TR - 1) / TR;
+        int tc_steps = (output_W + TC - 1) / TC;
+        
+        pool_batch_loop: for (int b = 0; b < B; b++) {
+            pool_tn_loop: for (int tn = 0; tn < tn_steps; tn++) {
+                int n_offset = b * N + tn * TN;
+                int tn_bound = (N - tn * TN < TN) ? (N - tn * TN) : TN;
+                
+                pool_tr_loop: for (int tr = 0; tr < tr_steps; tr++) {
+                    int r_offset = tr * TR;
+                    int tr_bound = (output_H - r_offset < TR) ? (output_H - r_offset) : TR;
+                    
+                    pool_tc_loop: for (int tc = 0; tc < tc_steps; tc++) {
+                        int c_offset = tc * TC;
+                        int tc_bound = (output_W - c_offset < TC) ? (output_W - c_offset) : TC;
+                        int rows = (tr_bound - 1) * S + K;
+                        int cols = (tc_bound - 1) * S + K;
+                        
+                        TransferMark load_mark = begin_transfer(cycle_clock, PERF_BUNDLE_INPUT);
+                        load_input_window(input_ddr, input_buffer, n_offset, r_offset, c_offset, 0, rows, cols,
+                            b * N + N, input_H, input_W, S, P);
+                        end_transfer(cycle_clock, counters, PERF_BUNDLE_INPUT, load_mark);
+                        pool_tile(input_buffer, output_buffer[0], K, S, tn_bound, tr_bound, tc_bound);
+                        if (relu_enable) {
+                            apply_relu(output_buffer[0], tn_bound, tr_bound, tc_bound);
+                        }
+                        // Limit the store to the tn_bound channels of this tile
+                        TransferMark store_mark = begin_transfer(cycle_clock, PERF_BUNDLE_OUTPUT);
+                        store_output_tile(output_ddr, output_buffer[0], n_offset, r_offset, c_offset, n_offset + tn_bound, output_H, output_W);
+                        end_transfer(cycle_clock, counters, PERF_BUNDLE_OUTPUT, store_mark);
+                    }
+                }
+            }
+        }
+    }
+    // Fully-connected layers: the [out][in] weights of each output channel
+    // group stream past the input vectors of a group of up to MAX_BATCH images
+    // in DDR order, into TM accumulators per image. Image i is column i % W of
+    // batch image i / W. When the group's vectors do not fit fc_input they are
+    // split into chunks of input features (fc_input_chunk): the accumulators
+    // keep their partial sums from chunk to chunk, so the weights are still
+    // read once per group. The chunks are visited forwards and backwards on
+    // alternate output channel groups, and the chunk already in fc_input is
+    // not loaded again.
+    else if (layer_type == LAYER_FC && N <= FC_INPUT_BUFFER_SIZE) {
+        data_t fc_input[FC_INPUT_BUFFER_SIZE];
+        
+        acc_t fc_acc[MAX_BATCH][TM];
+        #pragma HLS ARRAY_PARTITION variable=fc_acc complete
+        
+        int images = B * output_W;
+        int tm_steps = (M + TM - 1) / TM;
+        
+        fc_group_loop: for (int i0 = 0; i0 < images; i0 += MAX_BATCH) {
+            int group_bound = (images - i0 < MAX_BATCH) ? (images - i0) : MAX_BATCH;
+            int chunk = fc_input_chunk(N, group_bound);
+            int chunk_steps = (N + chunk - 1) / chunk;
+            int loaded = -1;
+            
+            fc_tm_loop: for (int tm = 0; tm < tm_steps; tm++) {
+                int m_offset = tm * TM;
+                int tm_bound = (M - m_offset < TM) ? (M - m_offset) : TM;
+                fetch_bias(bias_ddr, bias_buffer, m_offset, M, resident, bias_offset, cycle_clock, counters);
+                
+                fc_chunk_loop: for (int k = 0; k < chunk_steps; k++) {
+                    int c = (tm % 2 == 0) ? k : (chunk_steps - 1 - k);
+                    int n_offset = c * chunk;
+                    int n_count = (N - n_offset < chunk) ? (N - n_offset) : chunk;
+                    
+                    if (c != loaded) {
+                        TransferMark load_mark = begin_transfer(cycle_clock, PERF_BUNDLE_INPUT);
+                        load_fc_inputs(input_ddr, fc_input, i0, group_bound, N, output_W, n_offset, n_count);
+                        end_transfer(cycle_clock, counters, PERF_BUNDLE_INPUT, load_mark);
+                        loaded = c;
+                    }
+                    
+                    TransferMark weight_mark = begin_transfer(cycle_clock, PERF_BUNDLE_WEIGHTS);
+                    fc_weight_pass(weights_ddr, fc_input, bias_buffer, fc_acc, m_offset, tm_bound, N,
+                        n_offset, n_count, group_bound, resident, resident_offset, tiled, relu_enable,
+                        k == 0, k == chunk_steps - 1);
+                    if (!resident) {
+                        end_transfer(cycle_clock, counters, PERF_BUNDLE_WEIGHTS, weight_mark);
+                    }
+                }
+                
+                TransferMark store_mark = begin_transfer(cycle_clock, PERF_BUNDLE_OUTPUT);
+                store_fc_outputs(output_ddr, fc_acc, i0, group_bound, m_offset, tm_bound, M, output_W);
+                end_transfer(cycle_clock, counters, PERF_BUNDLE_OUTPUT, store_mark);
+            }
+        }
+    }
+    // Reuse schedule: the weights of an output channel group are loaded once
+    // and stay resident for all of its spatial tiles and all images of the
+    // batch, input tiles are read only over the rows and columns they cover,
+    // and the K - S columns shared by adjacent tc tiles are kept on chip
+    // instead of being read again
+    else if (layer_config.reuse_enable && N <= MAX_RESIDENT_CHANNELS) {
+        static CU_LOCAL weight_t weight_cache[MAX_RESIDENT_TILES][TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+        #pragma HLS ARRAY_PARTITION variable=weight_cache dim=2 cyclic factor=2
+        #pragma HLS ARRAY_PARTITION variable=weight_cache dim=3 cyclic factor=2
+        
+        static CU_LOCAL data_t halo_cache[MAX_RESIDENT_TILES][TN][INPUT_TILE_HEIGHT][MAX_KERNEL_SIZE-1];
+        #pragma HLS ARRAY_PARTITION variable=halo_cache dim=2 complete
+        
+        int tm_steps = (M + TM - 1) / TM;
+        int tn_steps = (N + TN - 1) / TN;
+        int tr_steps = (store_H + pool_tr - 1) / pool_tr;
+        int tc_steps = (store_W + pool_tc - 1) / pool_tc;
+        
+        // Input columns shared by adjacent tc tiles; overlapping fused pooling
+        // windows share more than halo_cache holds, and the rest is read again
+        int shared_cols = K - S + (pool_K - pool_S) * S;
+        int halo_cols = (shared_cols < 0) ? 0 : (shared_cols > MAX_KERNEL_SIZE - 1) ? MAX_KERNEL_SIZE - 1 : shared_cols;
+        
+        reuse_tm_loop: for (int tm = 0; tm < tm_steps; tm++) {
+            int m_offset = tm * TM;
+            int tm_bound = (M - m_offset < TM) ? (M - m_offset) : TM;
+            fetch_bias(bias_ddr, bias_buffer, m_offset, M, resident, bias_offset, cycle_clock, counters);
+            
+            reuse_load_weights: for (int tn = 0; tn < tn_steps; tn++) {
+                fetch_weight_tile(weights_ddr, weight_cache[tn], m_offset, tn * TN, M, N, K, resident, resident_offset, tiled, cycle_clock, counters);
+            }
+            
+            reuse_batch_loop: for (int b = 0; b < B; b++) {
+                reuse_tr_loop: for (int tr = 0; tr < tr_steps; tr++) {
+                    int pr_offset = tr * pool_tr;
+                    int pr_bound = (store_H - pr_offset < pool_tr) ? (store_H - pr_offset) : pool_tr;
+                    int r_offset = pr_offset * pool_S;
+                    int tr_bound = (pr_bound - 1) * pool_S + pool_K;
+                    int rows = (tr_bound - 1) * S + K;
+                    
+                    reuse_tc_loop: for (int tc = 0; tc < tc_steps; tc++) {
+                        int pc_offset = tc * pool_tc;
+                        int pc_bound = (store_W - pc_offset < pool_tc) ? (store_W - pc_offset) : pool_tc;
+                        int c_offset = pc_offset * pool_S;
+                        int tc_bound = (pc_bound - 1) * pool_S + pool_K;
+                        int cols = (tc_bound - 1) * S + K;
+                        
+                        init_output_buffer(output_buffer[0], bias_buffer, tm_bound);
+                        
+                        reuse_tn_loop: for (int tn = 0; tn < tn_steps; tn++) {
+                            int n_offset = tn * TN;
+                            int tn_bound = (N - n_offset < TN) ? (N - n_offset) : TN;
+                            int first_col = 0;
+                            
+                            if (tc > 0) {
+                                restore_input_halo(input_buffer, halo_cache[tn], halo_cols, rows);
+                                first_col = halo_cols;
+                            }
+                            TransferMark load_mark = begin_transfer(cycle_clock, PERF_BUNDLE_INPUT);
+                            load_input_window(input_ddr, input_buffer, b * N + n_offset, r_offset, c_offset, first_col, rows, cols,
+                                b * N + N, input_H, input_W, S, P);
+                            end_transfer(cycle_clock, counters, PERF_BUNDLE_INPUT, load_mark);
+                            if (tc + 1 < tc_steps) {
+                                save_input_halo(input_buffer, halo_cache[tn], pool_tc * pool_S * S, halo_cols, rows);
+                            }
+                            
+                            conv_tile(input_buffer, weight_cache[tn], output_buffer[0], K, S, tm_bound, tn_bound, tr_bound, tc_bound);
+                        }
+                        
+                        write_output_tile(output_ddr, output_buffer[0], pool_buffer, b * M + m_offset, pr_offset, pc_offset, b * M + M,
+                            store_H, store_W, tm_bound, tr_bound, tc_bound, relu_enable, pool_size, pool_stride, cycle_clock, counters);
+                    }
+                }
+            }
+        }
+    }
     // Processing logic - single tile case
-    if (N <= TN && M <= TM && output_H <= TR && output_W <= TC) {
-        load_bias(bias_ddr, bias_buffer, 0, M);
-        load_weight_tile(weights_ddr, weight_buffer, 0, 0, M, N, K);
-        load_input_tile(input_ddr, input_buffer, 0, 0, 0, N, input_H, input_W, S, P);
-        init_output_buffer(output_buffer, bias_buffer, M);
-        compute_tile(input_buffer, weight_buffer, output_buffer, K, S, M, N, output_H, output_W);
-        apply_relu(output_buffer, M, output_H, output_W);
-        store_output_tile(output_ddr, output_buffer, 0, 0, 0, M, output_H, output_W);
+    else if (N <= TN && M <= TM && output_H <= TR && output_W <= TC) {
+        fetch_bias(bias_ddr, bias_buffer, 0, M, resident, bias_offset, cycle_clock, counters);
+        fetch_weight_tile(weights_ddr, weight_buffer, 0, 0, M, N, K, resident, resident_offset, tiled, cycle_clock, counters);
+        
+        single_batch_loop: for (int b = 0; b < B; b++) {
+            TransferMark load_mark = begin_transfer(cycle_clock, PERF_BUNDLE_INPUT);
+            load_input_tile(input_ddr, input_buffer, b * N, 0, 0, b * N + N, input_H, input_W, S, P);
+            end_transfer(cycle_clock, counters, PERF_BUNDLE_INPUT, load_mark);
+            init_output_buffer(output_buffer[0], bias_buffer, M);
+            conv_tile(input_buffer, weight_buffer, output_buffer[0], K, S, M, N, output_H, output_W);
+            write_output_tile(output_ddr, output_buffer[0], pool_buffer, b * M, 0, 0, b * M + M,
+                store_H, store_W, M, output_H, output_W, relu_enable, pool_size, pool_stride, cycle_clock, counters);
+        }
     }
     else {
         // General tiled processing 
         int tm_steps = (M + TM - 1) / TM;
         int tn_steps = (N + TN - 1) / TN;
-        int tr_steps = (output_H + TR - 1) / TR;
-        int tc_steps = (output_W + TC - 1) / TC;
+        int tr_steps = (store_H + pool_tr - 1) / pool_tr;
+        int tc_steps = (store_W + pool_tc - 1) / pool_tc;
         
-        // Implement tiling following the paper's approach
-        tm_loop: for (int tm = 0; tm < tm_steps; tm++) {
-            int m_offset = tm * TM;
-            int tm_bound = (M - m_offset < TM) ? (M - m_offset) : TM;
-            load_bias(bias_ddr, bias_buffer, m_offset, M);
+        batch_group_loop: for (int b0 = 0; b0 < B; b0 += MAX_BATCH) {
+            int batch_bound = (B - b0 < MAX_BATCH) ? (B - b0) : MAX_BATCH;
             
-            tr_loop: for (int tr = 0; tr < tr_steps; tr++) {
-                int r_offset = tr * TR;
-                int tr_bound = (output_H - r_offset < TR) ? (output_H - r_offset) : TR;
+            // Implement tiling following the paper's approach
+            tm_loop: for (int tm = 0; tm < tm_steps; tm++) {
+                int m_offset = tm * TM;
+                int tm_bound = (M - m_offset < TM) ? (M - m_offset) : TM;
+                fetch_bias(bias_ddr, bias_buffer, m_offset, M, resident, bias_offset, cycle_clock, counters);
                 
-                tc_loop: for (int tc = 0; tc < tc_steps; tc++) {
-                    int c_offset = tc * TC;
-                    int tc_bound = (output_W - c_offset < TC) ? (output_W - c_offset) : TC;
+                tr_loop: for (int tr = 0; tr < tr_steps; tr++) {
+                    int pr_offset = tr * pool_tr;
+                    int pr_bound = (store_H - pr_offset < pool_tr) ? (store_H - pr_offset) : pool_tr;
+                    int r_offset = pr_offset * pool_S;
+                    int tr_bound = (pr_bound - 1) * pool_S + pool_K;
                     
-                    // Initialize output with bias
-                    init_output_buffer(output_buffer, bias_buffer, tm_bound);
-                    
-                    // Process input channel tiles
-                    tn_loop: for (int tn = 0; tn < tn_steps; tn++) {
-                        int n_offset = tn * TN;
-                        int tn_bound = (N - n_offset < TN) ? (N - n_offset) : TN;
+                    tc_loop: for (int tc = 0; tc < tc_steps; tc++) {
+                        int pc_offset = tc * pool_tc;
+                        int pc_bound = (store_W - pc_offset < pool_tc) ? (store_W - pc_offset) : pool_tc;
+                        int c_offset = pc_offset * pool_S;
+                        int tc_bound = (pc_bound - 1) * pool_S + pool_K;
+                        
+                        // Initialize output with bias
+                        init_batch_loop: for (int b = 0; b < batch_bound; b++) {
+                            init_output_buffer(output_buffer[b], bias_buffer, tm_bound);
+                        }
                         
-                        // Load data for current tile
-                        load_weight_tile(weights_ddr, weight_buffer, m_offset, n_offset, M, N, K);
-                        load_input_tile(input_ddr, input_buffer, n_offset, r_offset, c_offset, N, input_H, input_W, S, P);
+                        // Process input channel tiles
+                        tn_loop: for (int tn = 0; tn < tn_steps; tn++) {
+                            int n_offset = tn * TN;
+                            int tn_bound = (N - n_offset < TN) ? (N - n_offset) : TN;
+                            
+                            // The weight tile is loaded once and applied to the
+                            // input tiles of every image of the group
+                            fetch_weight_tile(weights_ddr, weight_buffer, m_offset, n_offset, M, N, K, resident, resident_offset, tiled, cycle_clock, counters);
+                            
+                            tn_batch_loop: for (int b = 0; b < batch_bound; b++) {
+                                int image_n = (b0 + b) * N;
+                                TransferMark load_mark = begin_transfer(cycle_clock, PERF_BUNDLE_INPUT);
+                                load_input_tile(input_ddr, input_buffer, image_n + n_offset, r_offset, c_offset, image_n + N, input_H, input_W, S, P);
+                                end_transfer(cycle_clock, counters, PERF_BUNDLE_INPUT, load_mark);
+                                
+                                // Compute convolution
+                                conv_tile(input_buffer, weight_buffer, output_buffer[b], K, S, tm_bound, tn_bound, tr_bound, tc_bound);
+                            }
+                        }
                         
-                        // Compute convolution
-                        compute_tile(input_buffer, weight_buffer, output_buffer, K, S, tm_bound, tn_bound, tr_bound, tc_bound);
+                        // Apply ReLU (if enabled), pool (if fused) and store output
+                        store_batch_loop: for (int b = 0; b < batch_bound; b++) {
+                            int image_m = (b0 + b) * M;
+                            write_output_tile(output_ddr, output_buffer[b], pool_buffer, image_m + m_offset, pr_offset, pc_offset, image_m + M,
+                                store_H, store_W, tm_bound, tr_bound, tc_bound, relu_enable, pool_size, pool_stride, cycle_clock, counters);
+                        }
                     }
-                    
-                    // Apply ReLU and store output
-                    apply_relu(output_buffer, tm_bound, tr_bound, tc_bound);
-                    store_output_tile(output_ddr, output_buffer, m_offset, r_offset, c_offset, M, output_H, output_W);
                 }
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// One layer of either top
+static void run_layer(
+    data_t* input_ddr,
+    data_t* output_ddr,
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    LayerConfig layer_config,
+    const volatile long long* cycle_clock,
+    PerfCounters& counters) {
+    
+#if USE_LINE_BUFFER_ENGINE
+    // Conv layers that fit the line buffer bypass the tiled engine (which
+    // also serves the resident weight store)
+    if (layer_config.weight_mode == WEIGHTS_FROM_DDR && line_buffer_fits(layer_config)) {
+        line_buffer_conv(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config);
+        return;
+    }
+#endif
+    process_layer(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, cycle_clock, counters);
+}
+
+// Top-level accelerator function
+void fashion_mnist_cnn_accelerator(
+    data_t* input_ddr,      // Input feature maps in DDR
+    data_t* output_ddr,     // Output feature maps in DDR
+    weight_t* weights_ddr,  // Weights in DDR
+    weight_t* bias_ddr,     // Bias values in DDR
+    LayerConfig layer_config,// Layer configuration
+    int layer_idx           // Current layer index
+) {
+    // Specify interface types with optimized parameters for KV260
+    #pragma HLS INTERFACE m_axi port=input_ddr offset=slave bundle=INPUT_AXI depth=TEST_MAX_INPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=output_ddr offset=slave bundle=OUTPUT_AXI depth=TEST_MAX_OUTPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=weights_ddr offset=slave bundle=WEIGHTS_AXI depth=TEST_MAX_WEIGHT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=bias_ddr offset=slave bundle=BIAS_AXI depth=TEST_MAX_BIAS_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE s_axilite port=layer_config bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=layer_idx bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=return bundle=CONTROL
+    
+    const long long no_clock = 0;
+    PerfCounters unused_counters;
+    run_layer(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, &no_clock, unused_counters);
+}
+
+// Top-level accelerator function with performance counters
+void fashion_mnist_cnn_accelerator_counted(
+    data_t* input_ddr,      // Input feature maps in DDR
+    data_t* output_ddr,     // Output feature maps in DDR
+    weight_t* weights_ddr,  // Weights in DDR
+    weight_t* bias_ddr,     // Bias values in DDR
+    LayerConfig layer_config,// Layer configuration
+    int layer_idx,          // Current layer index
+    const volatile long long* cycle_clock, // Free-running cycle counter
+    PerfCounters* counters  // Counters of this call
+) {
+    #pragma HLS INTERFACE m_axi port=input_ddr offset=slave bundle=INPUT_AXI depth=TEST_MAX_INPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=output_ddr offset=slave bundle=OUTPUT_AXI depth=TEST_MAX_OUTPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=weights_ddr offset=slave bundle=WEIGHTS_AXI depth=TEST_MAX_WEIGHT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=bias_ddr offset=slave bundle=BIAS_AXI depth=TEST_MAX_BIAS_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE ap_none port=cycle_clock
+    #pragma HLS INTERFACE s_axilite port=layer_config bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=layer_idx bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=counters bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=return bundle=CONTROL
+    
+    PerfCounters call_counters;
+    call_counters.total_cycles = 0;
+    clear_counters_loop: for (int b = 0; b < PERF_BUNDLES; b++) {
+        call_counters.words[b] = 0;
+        call_counters.stall_cycles[b] = 0;
+    }
+    
+#if AXI_TRAFFIC_COUNTERS
+    AxiTrafficCounters traffic_start = axi_traffic;
+#endif
+    long long start_cycle = sample_cycle_clock(cycle_clock);
+    run_layer(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, cycle_clock, call_counters);
+    call_counters.total_cycles = sample_cycle_clock(cycle_clock) - start_cycle;
+#if AXI_TRAFFIC_COUNTERS
+    words_loop: for (int b = 0; b < PERF_BUNDLES; b++) {
+        call_counters.words[b] = axi_bundle_beats(axi_traffic, b) - axi_bundle_beats(traffic_start, b);
+    }
+#endif
+    
+    *counters = call_counters;
+}
+
+// Top-level accelerator function for a whole network: one start runs every
+// entry of the layer table
+void fashion_mnist_cnn_accelerator_network(
+    data_t* input_ddr,      // Activation buffer in DDR (read port)
+    data_t* output_ddr,     // Same activation buffer (write port)
+    weight_t* weights_ddr,  // Parameter buffer in DDR (weight port)
+    weight_t* bias_ddr,     // Same parameter buffer (bias port)
+    LayerDescriptor* layer_table_ddr, // Layer table in DDR
+    int layer_count         // Entries of the layer table
+) {
+    #pragma HLS INTERFACE m_axi port=input_ddr offset=slave bundle=INPUT_AXI depth=TEST_MAX_INPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=output_ddr offset=slave bundle=OUTPUT_AXI depth=TEST_MAX_OUTPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=weights_ddr offset=slave bundle=WEIGHTS_AXI depth=TEST_MAX_WEIGHT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=bias_ddr offset=slave bundle=BIAS_AXI depth=TEST_MAX_BIAS_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=layer_table_ddr offset=slave bundle=TABLE_AXI depth=TEST_MAX_LAYERS max_read_burst_length=8
+    #pragma HLS INTERFACE s_axilite port=layer_count bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=return bundle=CONTROL
+    
+    const long long no_clock = 0;
+    PerfCounters unused_counters;
+    
+    // Each layer reads the output of the previous one, so the layers run in order
+    layer_table_loop: for (int l = 0; l < layer_count; l++) {
+        LayerDescriptor desc = layer_table_ddr[l];
+        run_layer(input_ddr + desc.input_offset, output_ddr + desc.output_offset,
+            weights_ddr + desc.weight_offset, bias_ddr + desc.bias_offset, desc.config,
+            &no_clock, unused_counters);
+    }
+}
+
+// Top-level accelerator function with 128-bit packed AXI ports
+void fashion_mnist_cnn_accelerator_wide(
+    ddr_word_t* input_ddr,  // Packed input feature maps in DDR
+    ddr_word_t* output_ddr, // Packed output feature maps in DDR
+    ddr_word_t* weights_ddr,// Packed weights in DDR
+    ddr_word_t* bias_ddr,   // Packed bias values in DDR
+    LayerConfig layer_config,// Layer configuration
+    int layer_idx           // Current layer index
+) {
+    #pragma HLS INTERFACE m_axi port=input_ddr offset=slave bundle=INPUT_AXI depth=TEST_MAX_INPUT_WORDS max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=output_ddr offset=slave bundle=OUTPUT_AXI depth=TEST_MAX_OUTPUT_WORDS max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=weights_ddr offset=slave bundle=WEIGHTS_AXI depth=TEST_MAX_WEIGHT_WORDS max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=bias_ddr offset=slave bundle=BIAS_AXI depth=TEST_MAX_BIAS_WORDS max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE s_axilite port=layer_config bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=layer_idx bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=return bundle=CONTROL
+    
+    const long long no_clock = 0;
+    PerfCounters unused_counters;
+    process_layer(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, &no_clock, unused_counters);
+}
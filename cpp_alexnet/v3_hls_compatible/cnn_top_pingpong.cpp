@@ -0,0 +1,284 @@
+#include "cnn_functions.h"
+
+// Double-buffered variant of fashion_mnist_cnn_accelerator.
+//
+// The tile loops of cnn_top.cpp are flattened into steps. A step is one input
+// channel tile (tn) of one output tile (tm, tr, tc), or one tile of a
+// max-pooling layer. Step s runs three stages on different buffer halves:
+//   load    - input and weight tiles (and bias) of step s + 1 into the idle half
+//   compute - step s from the active half into the current output buffer
+//   store   - the previous output tile, from the other output buffer
+// The stages are INLINE off functions without data dependences between them,
+// so HLS overlaps them like the tasks of a DATAFLOW region. Every branch of the
+// step loop passes each stage the concrete halves it works on, never a whole
+// ping-pong array with a runtime index, so HLS sees no dependence between the
+// stages. The bias travels with the input and weight half: the first step of
+// every output tile loads it. The ping-pong is explicit rather than a DATAFLOW
+// region because the output tile is accumulated over several steps, which a
+// DATAFLOW channel cannot express.
+
+// Position of one step in the tile loops
+typedef struct {
+    int m_offset;   // First output channel (= n_offset for max-pooling)
+    int n_offset;   // First input channel
+    int r_offset;
+    int c_offset;
+    int tm_bound;
+    int tn_bound;
+    int tr_bound;
+    int tc_bound;
+    bool first_n;   // First input channel tile of the output tile
+    bool last_n;    // Last input channel tile of the output tile
+} TileStep;
+
+static TileStep decode_step(int step, bool pool, int N, int M, int output_H, int output_W) {
+    #pragma HLS INLINE
+
+    int tn_steps = pool ? 1 : (N + TN - 1) / TN;
+    int tr_steps = (output_H + TR - 1) / TR;
+    int tc_steps = (output_W + TC - 1) / TC;
+
+    // Same order as cnn_top.cpp: tm -> tr -> tc -> tn (pooling: tn -> tr -> tc)
+    int tn = step % tn_steps;
+    int tile = step / tn_steps;
+    int tc = tile % tc_steps;
+    int tr = (tile / tc_steps) % tr_steps;
+    int channel_tile = tile / (tc_steps * tr_steps);
+
+    TileStep t;
+    t.r_offset = tr * TR;
+    t.c_offset = tc * TC;
+    t.tr_bound = (output_H - t.r_offset < TR) ? (output_H - t.r_offset) : TR;
+    t.tc_bound = (output_W - t.c_offset < TC) ? (output_W - t.c_offset) : TC;
+    if (pool) {
+        t.n_offset = channel_tile * TN;
+        t.m_offset = t.n_offset;
+        t.tn_bound = (N - t.n_offset < TN) ? (N - t.n_offset) : TN;
+        t.tm_bound = t.tn_bound;
+    }
+    else {
+        t.m_offset = channel_tile * TM;
+        t.n_offset = tn * TN;
+        t.tm_bound = (M - t.m_offset < TM) ? (M - t.m_offset) : TM;
+        t.tn_bound = (N - t.n_offset < TN) ? (N - t.n_offset) : TN;
+    }
+    t.first_n = (tn == 0);
+    t.last_n = (tn == tn_steps - 1);
+    return t;
+}
+
+// Load stage: fill the idle half of the input/weight buffers for step `t`, and
+// its bias buffer on the first input channel tile of an output tile
+static void load_stage(
+    data_t* input_ddr, weight_t* weights_ddr, weight_t* bias_ddr,
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    weight_t bias_buffer[TM],
+    bool valid, bool pool, bool tiled, TileStep t,
+    int N, int M, int H, int W, int K, int S, int P) {
+
+    #pragma HLS INLINE off
+
+    if (!valid) {
+        return;
+    }
+
+    load_input_tile(input_ddr, input_buffer, t.n_offset, t.r_offset, t.c_offset, N, H, W, S, P);
+
+    if (!pool) {
+        // Tile-major weights are read as one burst per tile
+        if (tiled) {
+            load_weight_tile_tiled(weights_ddr, weight_buffer, t.m_offset, t.n_offset, M, N, K);
+        }
+        else {
+            load_weight_tile(weights_ddr, weight_buffer, t.m_offset, t.n_offset, M, N, K);
+        }
+
+        if (t.first_n) {
+            load_bias(bias_ddr, bias_buffer, t.m_offset, M);
+        }
+    }
+}
+
+// Compute stage: accumulate step `t` into the output tile
+static void compute_stage(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    weight_t bias_buffer[TM],
+    acc_t output_buffer[TM][TR][TC],
+    bool pool, TileStep t, int K, int S, int relu_enable) {
+
+    #pragma HLS INLINE off
+
+    if (pool) {
+        pool_tile(input_buffer, output_buffer, K, S, t.tn_bound, t.tr_bound, t.tc_bound);
+    }
+    else {
+        if (t.first_n) {
+            init_output_buffer(output_buffer, bias_buffer, t.tm_bound);
+        }
+        conv_tile(input_buffer, weight_buffer, output_buffer, K, S, t.tm_bound, t.tn_bound, t.tr_bound, t.tc_bound);
+    }
+
+    if (t.last_n && relu_enable) {
+        apply_relu(output_buffer, t.tm_bound, t.tr_bound, t.tc_bound);
+    }
+}
+
+// Store stage: write the finished output tile `t`
+static void store_stage(
+    data_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
+    bool valid, TileStep t, int output_H, int output_W) {
+
+    #pragma HLS INLINE off
+
+    if (valid) {
+        // M is limited to the channels of this tile (see the max-pooling path of cnn_top.cpp)
+        store_output_tile(output_ddr, output_buffer, t.m_offset, t.r_offset, t.c_offset,
+            t.m_offset + t.tm_bound, output_H, output_W);
+    }
+}
+
+// Top-level accelerator function with double-buffered tiles
+void fashion_mnist_cnn_accelerator_pingpong(
+    data_t* input_ddr,      // Input feature maps in DDR
+    data_t* output_ddr,     // Output feature maps in DDR
+    weight_t* weights_ddr,  // Weights in DDR
+    weight_t* bias_ddr,     // Bias values in DDR
+    LayerConfig layer_config,// Layer configuration
+    int layer_idx           // Current layer index
+) {
+    #pragma HLS INTERFACE m_axi port=input_ddr offset=slave bundle=INPUT_AXI depth=TEST_MAX_INPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=output_ddr offset=slave bundle=OUTPUT_AXI depth=TEST_MAX_OUTPUT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=weights_ddr offset=slave bundle=WEIGHTS_AXI depth=TEST_MAX_WEIGHT_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE m_axi port=bias_ddr offset=slave bundle=BIAS_AXI depth=TEST_MAX_BIAS_SIZE max_read_burst_length=8 max_write_burst_length=8
+    #pragma HLS INTERFACE s_axilite port=layer_config bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=layer_idx bundle=CONTROL
+    #pragma HLS INTERFACE s_axilite port=return bundle=CONTROL
+
+    // Fused pooling, the reuse schedule and the weight store are not
+    // implemented here; such calls return without touching DDR
+    if (!pingpong_supports(layer_config)) {
+        return;
+    }
+
+    // Extract layer parameters
+    int N = layer_config.input_channels;
+    int M = layer_config.output_channels;
+    int input_H = layer_config.input_height;
+    int input_W = layer_config.input_width;
+    int output_H = layer_config.output_height;
+    int output_W = layer_config.output_width;
+    int K = layer_config.kernel_size;
+    int S = layer_config.stride;
+    int P = layer_config.padding;
+    int relu_enable = layer_config.relu_enable;
+    bool pool = (layer_config.layer_type == LAYER_MAXPOOL);
+    bool tiled = (layer_config.weight_layout == WEIGHT_LAYOUT_TILED);
+
+    // FC layers run as a 1x1 convolution (see cnn_top.cpp)
+    if (layer_config.layer_type == LAYER_FC) {
+        input_H = 1;
+        output_H = 1;
+        output_W = input_W;
+        K = 1;
+        S = 1;
+        P = 0;
+    }
+
+    // Two halves of every buffer, each half in its own memories
+    data_t input_pp[2][TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH];
+    #pragma HLS ARRAY_PARTITION variable=input_pp dim=1 complete
+    #pragma HLS ARRAY_PARTITION variable=input_pp dim=2 complete
+
+    weight_t weight_pp[2][TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=weight_pp dim=1 complete
+    #pragma HLS ARRAY_PARTITION variable=weight_pp dim=2 cyclic factor=2
+    #pragma HLS ARRAY_PARTITION variable=weight_pp dim=3 cyclic factor=2
+
+    acc_t output_pp[2][TM][TR][TC];
+    #pragma HLS ARRAY_PARTITION variable=output_pp dim=1 complete
+#if USE_SYSTOLIC_ENGINE
+    #pragma HLS ARRAY_PARTITION variable=output_pp dim=2 complete
+#else
+    #pragma HLS ARRAY_PARTITION variable=output_pp dim=2 cyclic factor=2
+#endif
+
+    weight_t bias_pp[2][TM];
+    #pragma HLS ARRAY_PARTITION variable=bias_pp dim=1 complete
+    #pragma HLS ARRAY_PARTITION variable=bias_pp dim=2 cyclic factor=2
+
+    int channel_tiles = pool ? (N + TN - 1) / TN : (M + TM - 1) / TM;
+    int tn_steps = pool ? 1 : (N + TN - 1) / TN;
+    int total_steps = channel_tiles * ((output_H + TR - 1) / TR) * ((output_W + TC - 1) / TC) * tn_steps;
+    int output_channels = pool ? N : M;
+
+    // The images of a batch run one after the other through the step loop;
+    // every image loads its own weight tiles
+    batch_loop: for (int b = 0; b < layer_config.batch_size; b++) {
+        data_t* image_input = input_ddr + b * N * input_H * input_W;
+        data_t* image_output = output_ddr + b * output_channels * output_H * output_W;
+
+        // Prologue: load the first step into half 0
+        TileStep first = decode_step(0, pool, N, M, output_H, output_W);
+        load_stage(image_input, weights_ddr, bias_ddr, input_pp[0], weight_pp[0], bias_pp[0],
+            true, pool, tiled, first, N, M, input_H, input_W, K, S, P);
+
+        TileStep finished = first;   // Last completed output tile, waiting for the store stage
+        bool store_pending = false;
+        int out_sel = 0;
+
+        step_loop: for (int step = 0; step < total_steps; step++) {
+            TileStep cur = decode_step(step, pool, N, M, output_H, output_W);
+            TileStep next = decode_step(step + 1, pool, N, M, output_H, output_W);
+            int in_sel = step % 2;
+
+            // A new output tile goes to the other output buffer
+            if (cur.first_n && step > 0) {
+                out_sel = 1 - out_sel;
+            }
+            bool store_now = store_pending && cur.first_n;
+
+            // Stages of this step, each on its own buffer halves
+            bool load_now = step + 1 < total_steps;
+            if (in_sel == 0 && out_sel == 0) {
+                load_stage(image_input, weights_ddr, bias_ddr, input_pp[1], weight_pp[1], bias_pp[1],
+                    load_now, pool, tiled, next, N, M, input_H, input_W, K, S, P);
+                compute_stage(input_pp[0], weight_pp[0], bias_pp[0], output_pp[0], pool, cur, K, S, relu_enable);
+                store_stage(image_output, output_pp[1], store_now, finished, output_H, output_W);
+            }
+            else if (in_sel == 0) {
+                load_stage(image_input, weights_ddr, bias_ddr, input_pp[1], weight_pp[1], bias_pp[1],
+                    load_now, pool, tiled, next, N, M, input_H, input_W, K, S, P);
+                compute_stage(input_pp[0], weight_pp[0], bias_pp[0], output_pp[1], pool, cur, K, S, relu_enable);
+                store_stage(image_output, output_pp[0], store_now, finished, output_H, output_W);
+            }
+            else if (out_sel == 0) {
+                load_stage(image_input, weights_ddr, bias_ddr, input_pp[0], weight_pp[0], bias_pp[0],
+                    load_now, pool, tiled, next, N, M, input_H, input_W, K, S, P);
+                compute_stage(input_pp[1], weight_pp[1], bias_pp[1], output_pp[0], pool, cur, K, S, relu_enable);
+                store_stage(image_output, output_pp[1], store_now, finished, output_H, output_W);
+            }
+            else {
+                load_stage(image_input, weights_ddr, bias_ddr, input_pp[0], weight_pp[0], bias_pp[0],
+                    load_now, pool, tiled, next, N, M, input_H, input_W, K, S, P);
+                compute_stage(input_pp[1], weight_pp[1], bias_pp[1], output_pp[1], pool, cur, K, S, relu_enable);
+                store_stage(image_output, output_pp[0], store_now, finished, output_H, output_W);
+            }
+
+            if (cur.last_n) {
+                finished = cur;
+                store_pending = true;
+            }
+        }
+
+        // Epilogue: store the last output tile
+        if (out_sel == 0) {
+            store_stage(image_output, output_pp[0], true, finished, output_H, output_W);
+        }
+        else {
+            store_stage(image_output, output_pp[1], true, finished, output_H, output_W);
+        }
+    }
+}
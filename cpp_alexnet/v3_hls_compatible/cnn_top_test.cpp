@@ -4,14 +4,20 @@
 #include <random>
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 #include "cnn_types.h"
 #include "cnn_functions.h"
+#include "ddr_packer.h"
+#include "layer_table.h"
+#include "weight_layout.h"
+#include "dsp_packing.h"
+#include "perf_model.h"
 
 // Reference implementation of convolutional layer for verification
 void conv2d_reference(
     const std::vector<data_t>& input,
-    const std::vector<data_t>& weights,
-    const std::vector<data_t>& bias,
+    const std::vector<weight_t>& weights,
+    const std::vector<weight_t>& bias,
     std::vector<data_t>& output,
     int in_channels, int in_height, int in_width,
     int out_channels, int out_height, int out_width,
@@ -26,7 +32,7 @@ void conv2d_reference(
             for (int ow = 0; ow < out_width; ow++) {
                 // Add bias
                 int out_idx = oc * out_height * out_width + oh * out_width + ow;
-                output[out_idx] = bias[oc];
+                acc_t acc = bias[oc];
                 
                 // Convolve input with kernel
                 for (int ic = 0; ic < in_channels; ic++) {
@@ -49,23 +55,74 @@ void conv2d_reference(
                             int w_idx = oc * in_channels * kernel_size * kernel_size + 
                                       ic * kernel_size * kernel_size + 
                                       kh * kernel_size + kw;
-                            data_t w_val = weights[w_idx];
+                            weight_t w_val = weights[w_idx];
                             
                             // Accumulate
-                            output[out_idx] += in_val * w_val;
+                            acc += in_val * w_val;
                         }
                     }
                 }
                 
                 // Apply ReLU activation
-                if (output[out_idx] < data_t(0)) {
-                    output[out_idx] = data_t(0);
+                if (acc < acc_t(0)) {
+                    acc = acc_t(0);
                 }
+                output[out_idx] = data_t(acc);
             }
         }
     }
 }
 
+// Reference max-pooling with the semantics of the v1 MaxPoolingLayer
+// (no padding, output size rounded down)
+void maxpool_reference(
+    const std::vector<data_t>& input,
+    std::vector<data_t>& output,
+    int channels, int in_height, int in_width,
+    int pool_size, int stride) {
+    
+    int out_height = (in_height - pool_size) / stride + 1;
+    int out_width = (in_width - pool_size) / stride + 1;
+    
+    for (int c = 0; c < channels; c++) {
+        for (int row = 0; row < out_height; row++) {
+            for (int col = 0; col < out_width; col++) {
+                data_t max_val = input[c * in_height * in_width + row * stride * in_width + col * stride];
+                for (int i = 0; i < pool_size; i++) {
+                    for (int j = 0; j < pool_size; j++) {
+                        data_t value = input[c * in_height * in_width + (row * stride + i) * in_width + col * stride + j];
+                        if (value > max_val) {
+                            max_val = value;
+                        }
+                    }
+                }
+                output[c * out_height * out_width + row * out_width + col] = max_val;
+            }
+        }
+    }
+}
+
+// Reference fully-connected layer with the semantics of the v1 FullyConnectedLayer
+// for one flattened input vector: weights are [out][in], ReLU unless disabled
+void fc_reference(
+    const std::vector<data_t>& input,
+    const std::vector<weight_t>& weights,
+    const std::vector<weight_t>& bias,
+    std::vector<data_t>& output,
+    int in_features, int out_features, bool relu) {
+    
+    for (int i = 0; i < out_features; i++) {
+        acc_t sum = bias[i];
+        for (int j = 0; j < in_features; j++) {
+            sum += weights[i * in_features + j] * input[j];
+        }
+        if (relu && sum < acc_t(0)) {
+            sum = acc_t(0);
+        }
+        output[i] = data_t(sum);
+    }
+}
+
 // Test data generator with fixed seed for reproducibility
 class TestDataGenerator {
 private:
@@ -75,10 +132,11 @@ public:
     TestDataGenerator(unsigned seed = 42) : gen(seed) {}
     
     // Generate random data within range
-    void generateRandomData(std::vector<data_t>& data, float min_val = -1.0f, float max_val = 1.0f) {
+    template <typename T>
+    void generateRandomData(std::vector<T>& data, float min_val = -1.0f, float max_val = 1.0f) {
         std::uniform_real_distribution<float> dist(min_val, max_val);
         for (size_t i = 0; i < data.size(); i++) {
-            data[i] = data_t(dist(gen));
+            data[i] = T(dist(gen));
         }
     }
     
@@ -147,8 +205,8 @@ bool testComputeTile() {
     
     // Allocate full-sized buffers as required by the function signature
     data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH];
-    data_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
-    data_t output_buffer[TM][TR][TC];
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+    acc_t output_buffer[TM][TR][TC];
     
     // Clear memory
     for (int n = 0; n < TN; n++) {
@@ -162,7 +220,7 @@ bool testComputeTile() {
     for (int m = 0; m < TM; m++) {
         for (int n = 0; n < TN; n++) {
             for (int k = 0; k < MAX_KERNEL_SIZE*MAX_KERNEL_SIZE; k++) {
-                weight_buffer[m][n][k] = data_t(0);
+                weight_buffer[m][n][k] = weight_t(0);
             }
         }
     }
@@ -170,7 +228,7 @@ bool testComputeTile() {
     for (int m = 0; m < TM; m++) {
         for (int r = 0; r < TR; r++) {
             for (int c = 0; c < TC; c++) {
-                output_buffer[m][r][c] = data_t(0);
+                output_buffer[m][r][c] = acc_t(0);
             }
         }
     }
@@ -187,7 +245,7 @@ bool testComputeTile() {
     for (int m = 0; m < test_tm; m++) {
         for (int n = 0; n < test_tn; n++) {
             for (int k = 0; k < test_kernel_size*test_kernel_size; k++) {
-                weight_buffer[m][n][k] = data_t(0.01f * (m+1) * (n+1) * (k+1));
+                weight_buffer[m][n][k] = weight_t(0.01f * (m+1) * (n+1) * (k+1));
             }
         }
     }
@@ -248,6 +306,55 @@ bool testComputeTile() {
     }
 }
 
+// Run systolic_compute_tile and compute_tile on the same random tile. The
+// outputs must be identical and the array must take the cycles of its model:
+// per kernel tap, TN cycles of weight shift plus P + TN + TM - 2 cycles for
+// P = tr_bound * tc_bound pixels.
+bool testSystolicTile(int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
+    std::cout << "Testing systolic array: K=" << kernel_size << " S=" << stride << ", " << tm_bound << "x" << tn_bound
+              << " channels, " << tr_bound << "x" << tc_bound << " pixels" << std::endl;
+    
+    TestDataGenerator dataGen(kernel_size * 100 + tm_bound * 10 + tn_bound);
+    std::vector<data_t> input(TN * INPUT_TILE_HEIGHT * INPUT_TILE_WIDTH);
+    std::vector<weight_t> weights(TM * TN * MAX_KERNEL_SIZE * MAX_KERNEL_SIZE);
+    std::vector<acc_t> bias(TM * TR * TC);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    
+    static data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH];
+    static weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+    static acc_t loop_output[TM][TR][TC];
+    static acc_t systolic_output[TM][TR][TC];
+    std::copy(input.begin(), input.end(), &input_buffer[0][0][0]);
+    std::copy(weights.begin(), weights.end(), &weight_buffer[0][0][0]);
+    std::copy(bias.begin(), bias.end(), &loop_output[0][0][0]);
+    std::copy(bias.begin(), bias.end(), &systolic_output[0][0][0]);
+    
+    compute_tile(input_buffer, weight_buffer, loop_output, kernel_size, stride, tm_bound, tn_bound, tr_bound, tc_bound);
+    systolic_array_cycles = 0;
+    systolic_compute_tile(input_buffer, weight_buffer, systolic_output, kernel_size, stride, tm_bound, tn_bound, tr_bound, tc_bound);
+    
+    long long expected_cycles = (long long)kernel_size * kernel_size * (TN + tr_bound * tc_bound + TN + TM - 2);
+    std::cout << "  Array cycles: " << systolic_array_cycles << " (model " << expected_cycles << "), "
+              << kernel_size * kernel_size * tm_bound * tn_bound * tr_bound * tc_bound << " MACs" << std::endl;
+    
+    // Every element, including the channels and pixels outside the bounds
+    bool match = true;
+    for (int e = 0; e < TM * TR * TC; e++) {
+        match &= ((&loop_output[0][0][0])[e] == (&systolic_output[0][0][0])[e]);
+    }
+    match &= (systolic_array_cycles == expected_cycles);
+    
+    if (match) {
+        std::cout << "Systolic array test PASSED!" << std::endl;
+    } else {
+        std::cout << "Systolic array test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
 // Test a single convolutional layer with small dimensions
 bool testConvLayer(
     int in_channels, int in_height, int in_width,
@@ -273,8 +380,8 @@ bool testConvLayer(
     
     // Allocate vectors for CPU computation
     std::vector<data_t> input(in_channels * in_height * in_width);
-    std::vector<data_t> weights(out_channels * in_channels * kernel_size * kernel_size);
-    std::vector<data_t> bias(out_channels);
+    std::vector<weight_t> weights(out_channels * in_channels * kernel_size * kernel_size);
+    std::vector<weight_t> bias(out_channels);
     std::vector<data_t> ref_output(out_channels * out_height * out_width);
     std::vector<data_t> hls_output(out_channels * out_height * out_width, data_t(0));
     
@@ -283,12 +390,12 @@ bool testConvLayer(
     
     // Generate weights with small values
     for (size_t i = 0; i < weights.size(); i++) {
-        weights[i] = data_t(0.01f * ((i % 10) + 1));
+        weights[i] = weight_t(0.01f * ((i % 10) + 1));
     }
     
     // Generate bias values
     for (size_t i = 0; i < bias.size(); i++) {
-        bias[i] = data_t(0.1f * (i + 1));
+        bias[i] = weight_t(0.1f * (i + 1));
     }
     
     // Compute reference output using CPU
@@ -302,8 +409,8 @@ bool testConvLayer(
     // Allocate aligned memory for HLS implementation to avoid segfaults
     data_t* input_ddr = new data_t[TEST_MAX_INPUT_SIZE]();  // Initialize with zeros
     data_t* output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
-    data_t* weights_ddr = new data_t[TEST_MAX_WEIGHT_SIZE]();
-    data_t* bias_ddr = new data_t[TEST_MAX_BIAS_SIZE]();
+    weight_t* weights_ddr = new weight_t[TEST_MAX_WEIGHT_SIZE]();
+    weight_t* bias_ddr = new weight_t[TEST_MAX_BIAS_SIZE]();
     
     // Copy data to HLS memory
     for (size_t i = 0; i < input.size(); i++) input_ddr[i] = input[i];
@@ -311,7 +418,7 @@ bool testConvLayer(
     for (size_t i = 0; i < bias.size(); i++) bias_ddr[i] = bias[i];
     
     // Create layer configuration
-    LayerConfig layer_config;
+    LayerConfig layer_config = default_layer_config();
     layer_config.input_channels = in_channels;
     layer_config.output_channels = out_channels;
     layer_config.input_height = in_height;
@@ -321,6 +428,8 @@ bool testConvLayer(
     layer_config.kernel_size = kernel_size;
     layer_config.stride = stride;
     layer_config.padding = padding;
+    layer_config.layer_type = LAYER_CONV;
+    layer_config.relu_enable = 1;
     
     // Call HLS accelerator function
     fashion_mnist_cnn_accelerator(
@@ -355,13 +464,1078 @@ bool testConvLayer(
     return match;
 }
 
+// Test a max-pooling layer executed by the accelerator
+bool testMaxPoolLayer(int channels, int in_height, int in_width, int pool_size, int stride) {
+    int out_height = (in_height - pool_size) / stride + 1;
+    int out_width = (in_width - pool_size) / stride + 1;
+    
+    std::cout << "Testing max-pooling layer:" << std::endl;
+    std::cout << "  Input: " << channels << "x" << in_height << "x" << in_width << std::endl;
+    std::cout << "  Output: " << channels << "x" << out_height << "x" << out_width << std::endl;
+    std::cout << "  Pool: " << pool_size << "x" << pool_size << ", stride=" << stride << std::endl;
+    
+    if (channels * in_height * in_width > TEST_MAX_INPUT_SIZE ||
+        channels * out_height * out_width > TEST_MAX_OUTPUT_SIZE) {
+        std::cout << "Test dimensions exceed maximum size limits. Skipping test." << std::endl;
+        return true;
+    }
+    
+    // Signed inputs, so the maximum is not hidden by a ReLU or by zero padding
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(channels * in_height * in_width);
+    std::vector<data_t> ref_output(channels * out_height * out_width);
+    std::vector<data_t> hls_output(channels * out_height * out_width);
+    dataGen.generateRandomData(input);
+    
+    maxpool_reference(input, ref_output, channels, in_height, in_width, pool_size, stride);
+    
+    data_t* input_ddr = new data_t[TEST_MAX_INPUT_SIZE]();
+    data_t* output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
+    weight_t* weights_ddr = new weight_t[TEST_MAX_WEIGHT_SIZE]();
+    weight_t* bias_ddr = new weight_t[TEST_MAX_BIAS_SIZE]();
+    
+    for (size_t i = 0; i < input.size(); i++) input_ddr[i] = input[i];
+    
+    LayerConfig layer_config = default_layer_config();
+    layer_config.input_channels = channels;
+    layer_config.output_channels = channels;
+    layer_config.input_height = in_height;
+    layer_config.input_width = in_width;
+    layer_config.output_height = out_height;
+    layer_config.output_width = out_width;
+    layer_config.kernel_size = pool_size;
+    layer_config.stride = stride;
+    layer_config.padding = 0;
+    layer_config.layer_type = LAYER_MAXPOOL;
+    
+    fashion_mnist_cnn_accelerator(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, 0);
+    
+    for (size_t i = 0; i < hls_output.size(); i++) {
+        hls_output[i] = output_ddr[i];
+    }
+    
+    bool match = compareOutputs(hls_output, ref_output);
+    
+    delete[] input_ddr;
+    delete[] output_ddr;
+    delete[] weights_ddr;
+    delete[] bias_ddr;
+    
+    if (match) {
+        std::cout << "Max-pooling layer test PASSED!" << std::endl;
+    } else {
+        std::cout << "Max-pooling layer test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Test a batch of fully-connected layer inputs executed by the accelerator
+bool testFCLayer(int in_features, int out_features, int batch, bool relu) {
+    std::cout << "Testing fully-connected layer:" << std::endl;
+    std::cout << "  Features: " << in_features << " -> " << out_features << ", batch=" << batch
+              << ", relu=" << (relu ? "on" : "off") << std::endl;
+    
+    if (in_features * batch > TEST_MAX_INPUT_SIZE ||
+        out_features * batch > TEST_MAX_OUTPUT_SIZE ||
+        out_features * in_features > TEST_MAX_WEIGHT_SIZE ||
+        out_features > TEST_MAX_BIAS_SIZE) {
+        std::cout << "Test dimensions exceed maximum size limits. Skipping test." << std::endl;
+        return true;
+    }
+    
+    TestDataGenerator dataGen;
+    std::vector<weight_t> weights(out_features * in_features);
+    std::vector<weight_t> bias(out_features);
+    dataGen.generateRandomData(weights, -0.1f, 0.1f);
+    dataGen.generateRandomData(bias, -0.5f, 0.5f);
+    
+    data_t* input_ddr = new data_t[TEST_MAX_INPUT_SIZE]();
+    data_t* output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
+    weight_t* weights_ddr = new weight_t[TEST_MAX_WEIGHT_SIZE]();
+    weight_t* bias_ddr = new weight_t[TEST_MAX_BIAS_SIZE]();
+    
+    for (size_t i = 0; i < weights.size(); i++) weights_ddr[i] = weights[i];
+    for (size_t i = 0; i < bias.size(); i++) bias_ddr[i] = bias[i];
+    
+    // One flattened input vector per batch entry, interleaved as [in_features][batch]
+    std::vector<std::vector<data_t> > inputs(batch, std::vector<data_t>(in_features));
+    for (int b = 0; b < batch; b++) {
+        dataGen.generateRandomData(inputs[b]);
+        for (int j = 0; j < in_features; j++) {
+            input_ddr[j * batch + b] = inputs[b][j];
+        }
+    }
+    
+    LayerConfig layer_config = default_layer_config();
+    layer_config.input_channels = in_features;
+    layer_config.output_channels = out_features;
+    layer_config.input_height = 1;
+    layer_config.input_width = batch;
+    layer_config.output_height = 1;
+    layer_config.output_width = batch;
+    layer_config.kernel_size = 1;
+    layer_config.stride = 1;
+    layer_config.padding = 0;
+    layer_config.layer_type = LAYER_FC;
+    layer_config.relu_enable = relu ? 1 : 0;
+    
+    fashion_mnist_cnn_accelerator(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, 0);
+    
+    // Compare every batch entry with the reference
+    std::vector<data_t> ref_output(out_features * batch);
+    std::vector<data_t> hls_output(out_features * batch);
+    std::vector<data_t> sample_output(out_features);
+    for (int b = 0; b < batch; b++) {
+        fc_reference(inputs[b], weights, bias, sample_output, in_features, out_features, relu);
+        for (int i = 0; i < out_features; i++) {
+            ref_output[b * out_features + i] = sample_output[i];
+            hls_output[b * out_features + i] = output_ddr[i * batch + b];
+        }
+    }
+    
+    bool match = compareOutputs(hls_output, ref_output);
+    
+    delete[] input_ddr;
+    delete[] output_ddr;
+    delete[] weights_ddr;
+    delete[] bias_ddr;
+    
+    if (match) {
+        std::cout << "Fully-connected layer test PASSED!" << std::endl;
+    } else {
+        std::cout << "Fully-connected layer test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Run one layer through fashion_mnist_cnn_accelerator and the packed 128-bit
+// fashion_mnist_cnn_accelerator_wide, compare the outputs and report the AXI traffic
+bool testWideMover(const char* name, LayerConfig layer_config,
+    int input_size, int weight_size, int bias_size, int output_size) {
+    
+    std::cout << "Testing 128-bit packed data mover: " << name << std::endl;
+    
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(input_size);
+    std::vector<weight_t> weights(weight_size);
+    std::vector<weight_t> bias(bias_size);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    
+    // Element-wide ports
+    data_t* input_ddr = new data_t[TEST_MAX_INPUT_SIZE]();
+    data_t* output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
+    weight_t* weights_ddr = new weight_t[TEST_MAX_WEIGHT_SIZE]();
+    weight_t* bias_ddr = new weight_t[TEST_MAX_BIAS_SIZE]();
+    std::copy(input.begin(), input.end(), input_ddr);
+    std::copy(weights.begin(), weights.end(), weights_ddr);
+    std::copy(bias.begin(), bias.end(), bias_ddr);
+    
+    axi_traffic.read_beats = 0;
+    axi_traffic.write_beats = 0;
+    fashion_mnist_cnn_accelerator(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, 0);
+    AxiTrafficCounters narrow = axi_traffic;
+    std::vector<data_t> narrow_output(output_ddr, output_ddr + output_size);
+    
+    // Packed ports, laid out by the host packer
+    std::vector<ddr_word_t> input_words = ddr_pack(input);
+    std::vector<ddr_word_t> weight_words = ddr_pack_weights(weights);
+    std::vector<ddr_word_t> bias_words = ddr_pack_weights(bias);
+    std::vector<ddr_word_t> output_words(ddr_packed_words(output_size), ddr_word_t(0));
+    
+    axi_traffic.read_beats = 0;
+    axi_traffic.write_beats = 0;
+    fashion_mnist_cnn_accelerator_wide(input_words.data(), output_words.data(), weight_words.data(), bias_words.data(), layer_config, 0);
+    AxiTrafficCounters wide = axi_traffic;
+    std::vector<data_t> wide_output = ddr_unpack(output_words, output_size);
+    
+    // Every narrow beat carries one data_t in a DDR_ELEMENT_BITS lane
+    double payload_bytes = (narrow.read_beats + narrow.write_beats) * DDR_ELEMENT_BITS / 8.0;
+    std::cout << "  Element ports: " << narrow.read_beats << " read + " << narrow.write_beats << " write beats, "
+              << payload_bytes / (narrow.read_beats + narrow.write_beats) << " bytes/beat" << std::endl;
+    std::cout << "  Packed ports:  " << wide.read_beats << " read + " << wide.write_beats << " write beats, "
+              << payload_bytes / (wide.read_beats + wide.write_beats) << " bytes/beat" << std::endl;
+    
+    bool match = compareOutputs(wide_output, narrow_output, 0.0f);
+    
+    delete[] input_ddr;
+    delete[] output_ddr;
+    delete[] weights_ddr;
+    delete[] bias_ddr;
+    
+    if (match) {
+        std::cout << "Packed data mover test PASSED!" << std::endl;
+    } else {
+        std::cout << "Packed data mover test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Run one layer through fashion_mnist_cnn_accelerator and the double-buffered
+// fashion_mnist_cnn_accelerator_pingpong; the outputs must be identical
+bool testPingPong(const char* name, LayerConfig layer_config,
+    int input_size, int weight_size, int bias_size, int output_size) {
+    
+    std::cout << "Testing ping-pong top function: " << name << std::endl;
+    
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(input_size);
+    std::vector<weight_t> weights(weight_size);
+    std::vector<weight_t> bias(bias_size);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    
+    data_t* input_ddr = new data_t[TEST_MAX_INPUT_SIZE]();
+    weight_t* weights_ddr = new weight_t[TEST_MAX_WEIGHT_SIZE]();
+    weight_t* bias_ddr = new weight_t[TEST_MAX_BIAS_SIZE]();
+    data_t* ref_output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
+    data_t* pp_output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
+    std::copy(input.begin(), input.end(), input_ddr);
+    std::copy(weights.begin(), weights.end(), weights_ddr);
+    std::copy(bias.begin(), bias.end(), bias_ddr);
+    
+    fashion_mnist_cnn_accelerator(input_ddr, ref_output_ddr, weights_ddr, bias_ddr, layer_config, 0);
+    fashion_mnist_cnn_accelerator_pingpong(input_ddr, pp_output_ddr, weights_ddr, bias_ddr, layer_config, 0);
+    
+    std::vector<data_t> ref_output(ref_output_ddr, ref_output_ddr + output_size);
+    std::vector<data_t> pp_output(pp_output_ddr, pp_output_ddr + output_size);
+    bool match = compareOutputs(pp_output, ref_output, 0.0f);
+    
+    delete[] input_ddr;
+    delete[] weights_ddr;
+    delete[] bias_ddr;
+    delete[] ref_output_ddr;
+    delete[] pp_output_ddr;
+    
+    if (match) {
+        std::cout << "Ping-pong test PASSED!" << std::endl;
+    } else {
+        std::cout << "Ping-pong test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// fashion_mnist_cnn_accelerator_pingpong must reject a layer without
+// pingpong_supports(): no DDR access (the weight pointers are null) and an
+// untouched output. The performance model must flag the layer as unsupported.
+bool testPingPongRejects(const char* name, LayerConfig layer_config, int input_size, int output_size) {
+    
+    std::cout << "Testing ping-pong rejection: " << name << std::endl;
+    
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(input_size);
+    dataGen.generateRandomData(input);
+    std::vector<data_t> output(output_size, data_t(1.5f));
+    
+    axi_traffic = AxiTrafficCounters();
+    fashion_mnist_cnn_accelerator_pingpong(input.data(), output.data(), nullptr, nullptr, layer_config, 0);
+    
+    PerfModelParams params = perf_default_params();
+    params.pingpong = true;
+    PerfEstimate est = perf_estimate_layer(layer_config, params);
+    
+    bool match = !pingpong_supports(layer_config);
+    match &= (axi_traffic.read_beats == 0 && axi_traffic.write_beats == 0);
+    match &= std::all_of(output.begin(), output.end(), [](data_t value) { return value == data_t(1.5f); });
+    match &= !est.supported;
+    
+    if (match) {
+        std::cout << "Ping-pong rejection test PASSED!" << std::endl;
+    } else {
+        std::cout << "Ping-pong rejection test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Run one layer with and without LayerConfig.reuse_enable, on the element-wide
+// and on the packed ports. All outputs must be identical, and the reuse
+// schedule must not read more input or weight beats than the default one.
+bool testReuseSchedule(const char* name, LayerConfig layer_config,
+    int input_size, int weight_size, int bias_size, int output_size) {
+    
+    std::cout << "Testing reuse schedule: " << name << std::endl;
+    
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(input_size);
+    std::vector<weight_t> weights(weight_size);
+    std::vector<weight_t> bias(bias_size);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    
+    data_t* input_ddr = new data_t[TEST_MAX_INPUT_SIZE]();
+    data_t* output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
+    weight_t* weights_ddr = new weight_t[TEST_MAX_WEIGHT_SIZE]();
+    weight_t* bias_ddr = new weight_t[TEST_MAX_BIAS_SIZE]();
+    std::copy(input.begin(), input.end(), input_ddr);
+    std::copy(weights.begin(), weights.end(), weights_ddr);
+    std::copy(bias.begin(), bias.end(), bias_ddr);
+    
+    std::vector<ddr_word_t> input_words = ddr_pack(input);
+    std::vector<ddr_word_t> weight_words = ddr_pack_weights(weights);
+    std::vector<ddr_word_t> bias_words = ddr_pack_weights(bias);
+    std::vector<ddr_word_t> output_words(ddr_packed_words(output_size), ddr_word_t(0));
+    
+    // [reuse_enable][packed]
+    AxiTrafficCounters traffic[2][2];
+    std::vector<data_t> outputs[2][2];
+    
+    for (int reuse = 0; reuse < 2; reuse++) {
+        layer_config.reuse_enable = reuse;
+        
+        axi_traffic = AxiTrafficCounters();
+        fashion_mnist_cnn_accelerator(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, 0);
+        traffic[reuse][0] = axi_traffic;
+        outputs[reuse][0].assign(output_ddr, output_ddr + output_size);
+        
+        axi_traffic = AxiTrafficCounters();
+        fashion_mnist_cnn_accelerator_wide(input_words.data(), output_words.data(), weight_words.data(), bias_words.data(), layer_config, 0);
+        traffic[reuse][1] = axi_traffic;
+        outputs[reuse][1] = ddr_unpack(output_words, output_size);
+    }
+    
+    bool match = true;
+    for (int packed = 0; packed < 2; packed++) {
+        const AxiTrafficCounters& before = traffic[0][packed];
+        const AxiTrafficCounters& after = traffic[1][packed];
+        std::cout << (packed ? "  Packed ports:  " : "  Element ports: ")
+                  << "input " << before.input_beats << " -> " << after.input_beats
+                  << ", weight " << before.weight_beats << " -> " << after.weight_beats
+                  << ", all reads " << before.read_beats << " -> " << after.read_beats << " beats" << std::endl;
+        
+        match &= compareOutputs(outputs[1][packed], outputs[0][0], 0.0f);
+        match &= (after.input_beats <= before.input_beats && after.weight_beats <= before.weight_beats);
+    }
+    match &= compareOutputs(outputs[0][1], outputs[0][0], 0.0f);
+    
+    delete[] input_ddr;
+    delete[] output_ddr;
+    delete[] weights_ddr;
+    delete[] bias_ddr;
+    
+    if (match) {
+        std::cout << "Reuse schedule test PASSED!" << std::endl;
+    } else {
+        std::cout << "Reuse schedule test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Run `batch` images through one batched call and through one call per image,
+// on the element-wide, packed and ping-pong top functions. The outputs must be
+// identical, and the batched call must read the weights at most once per
+// group of MAX_BATCH images (once per image on the line-buffer engine).
+bool testBatch(const char* name, LayerConfig layer_config, int batch,
+    int input_size, int weight_size, int bias_size, int output_size) {
+    
+    std::cout << "Testing batch of " << batch << ": " << name << std::endl;
+    
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(input_size * batch);
+    std::vector<weight_t> weights(weight_size);
+    std::vector<weight_t> bias(bias_size);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    
+    // One call per image
+    std::vector<data_t> single_output(output_size * batch);
+    axi_traffic = AxiTrafficCounters();
+    for (int b = 0; b < batch; b++) {
+        fashion_mnist_cnn_accelerator(&input[b * input_size], &single_output[b * output_size],
+            weights.data(), bias.data(), layer_config, 0);
+    }
+    AxiTrafficCounters single = axi_traffic;
+    
+    // One call for the batch
+    LayerConfig batch_config = layer_config;
+    batch_config.batch_size = batch;
+    std::vector<data_t> batch_output(output_size * batch);
+    axi_traffic = AxiTrafficCounters();
+    fashion_mnist_cnn_accelerator(input.data(), batch_output.data(), weights.data(), bias.data(), batch_config, 0);
+    AxiTrafficCounters batched = axi_traffic;
+    
+    std::vector<ddr_word_t> input_words = ddr_pack(input);
+    std::vector<ddr_word_t> weight_words = ddr_pack_weights(weights);
+    std::vector<ddr_word_t> bias_words = ddr_pack_weights(bias);
+    std::vector<ddr_word_t> output_words(ddr_packed_words(output_size * batch), ddr_word_t(0));
+    fashion_mnist_cnn_accelerator_wide(input_words.data(), output_words.data(), weight_words.data(), bias_words.data(), batch_config, 0);
+    std::vector<data_t> wide_output = ddr_unpack(output_words, output_size * batch);
+    
+    // The ping-pong top has no reuse schedule, which does not change the output
+    std::vector<data_t> pp_output(output_size * batch);
+    LayerConfig pp_config = batch_config;
+    pp_config.reuse_enable = 0;
+    fashion_mnist_cnn_accelerator_pingpong(input.data(), pp_output.data(), weights.data(), bias.data(), pp_config, 0);
+    
+    // Weight tile loads per call: one per batch group, or one per image on the line-buffer engine
+    long long single_weights = single.weight_beats / batch;
+    long long weight_loads = (batch + MAX_BATCH - 1) / MAX_BATCH;
+#if USE_LINE_BUFFER_ENGINE
+    if (line_buffer_fits(layer_config)) {
+        weight_loads = batch;
+    }
+#endif
+    std::cout << "  Weight beats per image: " << single_weights << " -> " << batched.weight_beats / (double)batch
+              << ", input beats: " << single.input_beats << " -> " << batched.input_beats << std::endl;
+    
+    bool match = compareOutputs(batch_output, single_output, 0.0f);
+    match &= compareOutputs(wide_output, single_output, 0.0f);
+    match &= compareOutputs(pp_output, single_output, 0.0f);
+    match &= (batched.weight_beats <= weight_loads * single_weights);
+    match &= (batched.input_beats == single.input_beats);
+    
+    if (match) {
+        std::cout << "Batch test PASSED!" << std::endl;
+    } else {
+        std::cout << "Batch test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+LayerConfig makeLayerConfig(int layer_type, int N, int H, int W, int M, int R, int C, int K, int S, int P, int relu) {
+    LayerConfig layer_config = default_layer_config();
+    layer_config.input_channels = N;
+    layer_config.output_channels = M;
+    layer_config.input_height = H;
+    layer_config.input_width = W;
+    layer_config.output_height = R;
+    layer_config.output_width = C;
+    layer_config.kernel_size = K;
+    layer_config.stride = S;
+    layer_config.padding = P;
+    layer_config.layer_type = layer_type;
+    layer_config.relu_enable = relu;
+    return layer_config;
+}
+
+// Conv layer with a fused max-pooling vs. the conv layer followed by a
+// separate max-pooling call, for `batch` images, on the element-wide and packed
+// ports and with and without the reuse schedule. The outputs must be
+// identical, the fused call must write every pooled pixel exactly once, and it
+// must move fewer DDR beats than the two separate calls.
+bool testFusedPool(const char* name, LayerConfig layer_config, int pool_size, int pool_stride, int batch) {
+    
+    std::cout << "Testing fused conv+pool: " << name << std::endl;
+    
+    int N = layer_config.input_channels;
+    int M = layer_config.output_channels;
+    int R = layer_config.output_height;
+    int C = layer_config.output_width;
+    int PR = fused_pool_extent(R, pool_size, pool_stride);
+    int PC = fused_pool_extent(C, pool_size, pool_stride);
+    int input_size = N * layer_config.input_height * layer_config.input_width;
+    int weight_size = M * N * layer_config.kernel_size * layer_config.kernel_size;
+    int output_size = M * PR * PC;
+    
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(input_size * batch);
+    std::vector<weight_t> weights(weight_size);
+    std::vector<weight_t> bias(M);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    layer_config.batch_size = batch;
+    
+    // Conv layer, then max-pooling of its output in DDR
+    std::vector<data_t> conv_output(M * R * C * batch);
+    std::vector<data_t> expected(output_size * batch);
+    LayerConfig pool_config = makeLayerConfig(LAYER_MAXPOOL, M, R, C, M, PR, PC, pool_size, pool_stride, 0, 0);
+    pool_config.batch_size = batch;
+    axi_traffic = AxiTrafficCounters();
+    fashion_mnist_cnn_accelerator(input.data(), conv_output.data(), weights.data(), bias.data(), layer_config, 0);
+    fashion_mnist_cnn_accelerator(conv_output.data(), expected.data(), nullptr, nullptr, pool_config, 1);
+    AxiTrafficCounters separate = axi_traffic;
+    
+    layer_config.pool_size = pool_size;
+    layer_config.pool_stride = pool_stride;
+    std::vector<ddr_word_t> input_words = ddr_pack(input);
+    std::vector<ddr_word_t> weight_words = ddr_pack_weights(weights);
+    std::vector<ddr_word_t> bias_words = ddr_pack_weights(bias);
+    
+    bool match = true;
+    AxiTrafficCounters fused = AxiTrafficCounters();
+    for (int reuse = 0; reuse < 2; reuse++) {
+        layer_config.reuse_enable = reuse;
+        
+        std::vector<data_t> output(output_size * batch);
+        axi_traffic = AxiTrafficCounters();
+        fashion_mnist_cnn_accelerator(input.data(), output.data(), weights.data(), bias.data(), layer_config, 0);
+        if (reuse == 0) {
+            fused = axi_traffic;
+        }
+        match &= compareOutputs(output, expected, 0.0f);
+        match &= (axi_traffic.write_beats == (long long)output_size * batch);
+        
+        std::vector<ddr_word_t> output_words(ddr_packed_words(output_size * batch), ddr_word_t(0));
+        fashion_mnist_cnn_accelerator_wide(input_words.data(), output_words.data(), weight_words.data(), bias_words.data(), layer_config, 0);
+        match &= compareOutputs(ddr_unpack(output_words, output_size * batch), expected, 0.0f);
+    }
+    
+    long long separate_beats = separate.read_beats + separate.write_beats;
+    long long fused_beats = fused.read_beats + fused.write_beats;
+    std::cout << "  DDR beats: " << separate.write_beats << " written + " << separate.read_beats << " read (conv, pool) -> "
+              << fused.write_beats << " written + " << fused.read_beats << " read (fused)" << std::endl;
+    match &= (fused.write_beats < separate.write_beats);
+    // Overlapping windows make the fused tiles read the rows they share again,
+    // which can cost more than the reads of the separate pooling call
+    if (pool_size <= pool_stride) {
+        match &= (fused_beats < separate_beats);
+    }
+
+    if (match) {
+        std::cout << "Fused conv+pool test PASSED!" << std::endl;
+    } else {
+        std::cout << "Fused conv+pool test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Run zero_skip_compute_tile and compute_tile on the same post-ReLU tile, with
+// about `zero_pixels` of the input positions zero in every channel. The
+// outputs must be identical, and the skipped slots must be the output
+// pixels x taps whose activations are all zero.
+bool testZeroSkipTile(int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound, float zero_pixels) {
+    std::cout << "Testing zero skipping: K=" << kernel_size << " S=" << stride << ", " << tm_bound << "x" << tn_bound
+              << " channels, " << tr_bound << "x" << tc_bound << " pixels, " << zero_pixels << " zero positions" << std::endl;
+    
+    TestDataGenerator dataGen(kernel_size * 100 + tm_bound * 10 + tn_bound);
+    std::vector<data_t> input(TN * INPUT_TILE_HEIGHT * INPUT_TILE_WIDTH);
+    std::vector<weight_t> weights(TM * TN * MAX_KERNEL_SIZE * MAX_KERNEL_SIZE);
+    std::vector<acc_t> bias(TM * TR * TC);
+    std::vector<float> mask(INPUT_TILE_HEIGHT * INPUT_TILE_WIDTH);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    dataGen.generateRandomData(mask, 0.0f, 1.0f);
+    
+    static data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH];
+    static weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+    static acc_t loop_output[TM][TR][TC];
+    static acc_t skip_output[TM][TR][TC];
+    for (int n = 0; n < TN; n++) {
+        for (int p = 0; p < INPUT_TILE_HEIGHT * INPUT_TILE_WIDTH; p++) {
+            data_t value = input[n * INPUT_TILE_HEIGHT * INPUT_TILE_WIDTH + p];
+            bool zero = (value < 0) || (mask[p] < zero_pixels);
+            (&input_buffer[n][0][0])[p] = zero ? data_t(0) : value;
+        }
+    }
+    std::copy(weights.begin(), weights.end(), &weight_buffer[0][0][0]);
+    std::copy(bias.begin(), bias.end(), &loop_output[0][0][0]);
+    std::copy(bias.begin(), bias.end(), &skip_output[0][0][0]);
+    
+    compute_tile(input_buffer, weight_buffer, loop_output, kernel_size, stride, tm_bound, tn_bound, tr_bound, tc_bound);
+    zero_skip_counters = ZeroSkipCounters();
+    zero_skip_compute_tile(input_buffer, weight_buffer, skip_output, kernel_size, stride, tm_bound, tn_bound, tr_bound, tc_bound);
+    
+    // Slots and zero products counted on the tile
+    long long zero_slots = 0, zero_products = 0;
+    for (int i = 0; i < kernel_size; i++) {
+        for (int j = 0; j < kernel_size; j++) {
+            for (int r = 0; r < tr_bound; r++) {
+                for (int c = 0; c < tc_bound; c++) {
+                    int zeros = 0;
+                    for (int n = 0; n < tn_bound; n++) {
+                        zeros += (input_buffer[n][r * stride + i][c * stride + j] == 0) ? 1 : 0;
+                    }
+                    if (zeros == tn_bound) {
+                        zero_slots++;
+                    } else {
+                        zero_products += zeros * tm_bound;
+                    }
+                }
+            }
+        }
+    }
+    long long slots = (long long)kernel_size * kernel_size * tr_bound * tc_bound;
+    std::cout << "  Skipped " << zero_skip_counters.skipped_slots << " of " << zero_skip_counters.pixel_slots << " slots ("
+              << zero_skip_counters.skipped_macs << " MACs), gated " << zero_skip_counters.gated_macs << " of "
+              << zero_skip_counters.dense_macs << " MACs" << std::endl;
+    
+    // Every element, including the channels and pixels outside the bounds
+    bool match = true;
+    for (int e = 0; e < TM * TR * TC; e++) {
+        match &= ((&loop_output[0][0][0])[e] == (&skip_output[0][0][0])[e]);
+    }
+    match &= (zero_skip_counters.pixel_slots == slots);
+    match &= (zero_skip_counters.skipped_slots == zero_slots);
+    match &= (zero_skip_counters.dense_macs == slots * tm_bound * tn_bound);
+    match &= (zero_skip_counters.skipped_macs == zero_slots * tm_bound * tn_bound);
+    match &= (zero_skip_counters.gated_macs == zero_products);
+    
+    if (match) {
+        std::cout << "Zero skipping test PASSED!" << std::endl;
+    } else {
+        std::cout << "Zero skipping test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// A small network run with one start of fashion_mnist_cnn_accelerator_network
+// vs. one fashion_mnist_cnn_accelerator call per layer: conv, max-pooling, a
+// conv with fused pooling and an FC layer whose weights the table preloads
+// into the resident store. Every layer output must be identical.
+bool testLayerTable() {
+    std::cout << "Testing layer table: conv -> pool -> conv+pool -> preload, FC (resident)" << std::endl;
+    
+    std::vector<LayerConfig> configs;
+    configs.push_back(makeLayerConfig(LAYER_CONV, 2, 12, 12, 6, 12, 12, 3, 1, 1, 1));
+    configs.back().reuse_enable = 1;
+    configs.push_back(makeLayerConfig(LAYER_MAXPOOL, 6, 12, 12, 6, 6, 6, 2, 2, 0, 0));
+    configs.push_back(makeLayerConfig(LAYER_CONV, 6, 6, 6, 8, 6, 6, 3, 1, 1, 1));
+    configs.back().pool_size = 2;
+    configs.back().pool_stride = 2;
+    configs.push_back(makeLayerConfig(LAYER_FC, 72, 1, 1, 10, 1, 1, 1, 1, 0, 0));
+    
+    TestDataGenerator dataGen(44);
+    std::vector<data_t> input(2 * 12 * 12);
+    dataGen.generateRandomData(input);
+    std::vector<std::vector<weight_t>> weights(configs.size());
+    std::vector<std::vector<weight_t>> biases(configs.size());
+    std::vector<int> output_sizes = { 6 * 12 * 12, 6 * 6 * 6, 8 * 3 * 3, 10 };
+    for (size_t l = 0; l < configs.size(); l++) {
+        const LayerConfig& c = configs[l];
+        if (c.layer_type != LAYER_MAXPOOL) {
+            weights[l].resize(c.output_channels * c.input_channels * c.kernel_size * c.kernel_size);
+            biases[l].resize(c.output_channels);
+            dataGen.generateRandomData(weights[l], -0.5f, 0.5f);
+            dataGen.generateRandomData(biases[l], -0.1f, 0.1f);
+        }
+    }
+    
+    // One call per layer
+    std::vector<std::vector<data_t>> expected;
+    std::vector<data_t> current = input;
+    for (size_t l = 0; l < configs.size(); l++) {
+        std::vector<data_t> output(output_sizes[l]);
+        fashion_mnist_cnn_accelerator(current.data(), output.data(), weights[l].data(), biases[l].data(), configs[l], static_cast<int>(l));
+        expected.push_back(output);
+        current = output;
+    }
+    
+    // One start: the layers alternate between two activation regions, and the
+    // FC weights are preloaded by a table entry that moves no activations
+    LayerTableBuilder table;
+    int region = 6 * 12 * 12;
+    int regions[2] = { table.addActivations(region), table.addActivations(region) };
+    std::copy(input.begin(), input.end(), table.activations().begin() + regions[0]);
+    for (size_t l = 0; l < configs.size(); l++) {
+        int weight_offset = table.addParameters(weights[l]);
+        int bias_offset = table.addParameters(biases[l]);
+        LayerConfig config = configs[l];
+        if (config.layer_type == LAYER_FC) {
+            LayerConfig preload = config;
+            preload.weight_mode = WEIGHTS_PRELOAD;
+            table.addLayer(preload, 0, 0, weight_offset, bias_offset);
+            config.weight_mode = WEIGHTS_RESIDENT;
+        }
+        table.addLayer(config, regions[l % 2], regions[(l + 1) % 2], weight_offset, bias_offset);
+    }
+    
+    // Each region still holds the last output written to it
+    table.run();
+    bool match = true;
+    for (size_t l = configs.size() - 2; l < configs.size(); l++) {
+        const data_t* output = table.activations().data() + regions[(l + 1) % 2];
+        match &= std::equal(expected[l].begin(), expected[l].end(), output);
+    }
+    
+    std::cout << "  " << table.layers().size() << " table entries, "
+              << table.parameters().size() << " parameters" << std::endl;
+    if (match) {
+        std::cout << "Layer table test PASSED!" << std::endl;
+    } else {
+        std::cout << "Layer table test FAILED!" << std::endl;
+    }
+    return match;
+}
+
+// FC layer whose input vectors do not fit fc_input for a whole batch group,
+// so they are split into chunks of input features. The outputs of the
+// element and packed ports and of resident weights must match the reference,
+// and the weights must be read once per group of MAX_BATCH images.
+bool testFCChunks(int in_features, int out_features, int batch) {
+    int chunk = fc_input_chunk(in_features, (batch < MAX_BATCH) ? batch : MAX_BATCH);
+    std::cout << "Testing FC input chunks: FC " << in_features << " -> " << out_features << ", batch " << batch
+              << " (" << (in_features + chunk - 1) / chunk << " chunks of up to " << chunk << " features)" << std::endl;
+    
+    TestDataGenerator dataGen(7);
+    std::vector<data_t> input(in_features * batch);
+    std::vector<weight_t> weights(out_features * in_features);
+    std::vector<weight_t> bias(out_features);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.1f, 0.1f);
+    dataGen.generateRandomData(bias, -0.5f, 0.5f);
+    
+    LayerConfig layer_config = makeLayerConfig(LAYER_FC, in_features, 1, 1, out_features, 1, 1, 1, 1, 0, 1);
+    layer_config.batch_size = batch;
+    
+    // Images are [B][N] in and [B][M] out
+    std::vector<data_t> expected(out_features * batch);
+    for (int b = 0; b < batch; b++) {
+        std::vector<data_t> image(input.begin() + b * in_features, input.begin() + (b + 1) * in_features);
+        std::vector<data_t> sample_output(out_features);
+        fc_reference(image, weights, bias, sample_output, in_features, out_features, true);
+        std::copy(sample_output.begin(), sample_output.end(), expected.begin() + b * out_features);
+    }
+    
+    std::vector<data_t> output(out_features * batch);
+    axi_traffic = AxiTrafficCounters();
+    fashion_mnist_cnn_accelerator(input.data(), output.data(), weights.data(), bias.data(), layer_config, 0);
+    bool match = compareOutputs(output, expected);
+    
+    long long groups = (batch + MAX_BATCH - 1) / MAX_BATCH;
+    std::cout << "  Weight beats: " << axi_traffic.weight_beats << " (" << groups << " x " << out_features * in_features
+              << ")" << std::endl;
+    match &= (axi_traffic.weight_beats == groups * out_features * in_features);
+    
+    std::vector<ddr_word_t> input_words = ddr_pack(input);
+    std::vector<ddr_word_t> weight_words = ddr_pack_weights(weights);
+    std::vector<ddr_word_t> bias_words = ddr_pack_weights(bias);
+    std::vector<ddr_word_t> output_words(ddr_packed_words(out_features * batch), ddr_word_t(0));
+    fashion_mnist_cnn_accelerator_wide(input_words.data(), output_words.data(), weight_words.data(), bias_words.data(), layer_config, 0);
+    match &= compareOutputs(ddr_unpack(output_words, out_features * batch), output, 0.0f);
+    
+    // Resident weights: a preload entry, then the layer
+    LayerTableBuilder table;
+    int input_offset = table.addActivations(input.size());
+    int output_offset = table.addActivations(output.size());
+    std::copy(input.begin(), input.end(), table.activations().begin() + input_offset);
+    int weight_offset = table.addParameters(weights);
+    int bias_offset = table.addParameters(bias);
+    LayerConfig preload = layer_config;
+    preload.weight_mode = WEIGHTS_PRELOAD;
+    table.addLayer(preload, 0, 0, weight_offset, bias_offset);
+    LayerConfig resident = layer_config;
+    resident.weight_mode = WEIGHTS_RESIDENT;
+    table.addLayer(resident, input_offset, output_offset, weight_offset, bias_offset);
+    table.run();
+    match &= std::equal(output.begin(), output.end(), table.activations().begin() + output_offset);
+    
+    if (match) {
+        std::cout << "FC input chunks test PASSED!" << std::endl;
+    } else {
+        std::cout << "FC input chunks test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
 // Main test function
+// Same layer with [M][N][K*K] and with tile-major weights (weight_layout.h),
+// for `batch` images, through the general path, the reuse schedule, the packed
+// ports and the double-buffered top. The outputs must be identical, the
+// re-layout must round-trip, and the tiled loads must move the same weight beats.
+bool testTileMajorWeights(const char* name, LayerConfig layer_config, int batch,
+    int input_size, int output_size) {
+    
+    std::cout << "Testing tile-major weights: " << name << std::endl;
+    
+    int M = layer_config.output_channels;
+    int N = layer_config.input_channels;
+    int K = layer_config.kernel_size;
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(input_size * batch);
+    std::vector<weight_t> weights(M * N * K * K);
+    std::vector<weight_t> bias(M);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    
+    std::vector<weight_t> tiled_weights = tile_major_weights(weights, M, N, K);
+    bool match = (oihw_weights(tiled_weights, M, N, K) == weights);
+    
+    layer_config.batch_size = batch;
+    LayerConfig tiled_config = layer_config;
+    tiled_config.weight_layout = WEIGHT_LAYOUT_TILED;
+    
+    std::vector<data_t> expected(output_size * batch);
+    axi_traffic = AxiTrafficCounters();
+    fashion_mnist_cnn_accelerator(input.data(), expected.data(), weights.data(), bias.data(), layer_config, 0);
+    AxiTrafficCounters oihw = axi_traffic;
+    
+    // The line-buffer engine reads [M][N][K*K] weights once per image instead
+    bool same_beats = true;
+#if USE_LINE_BUFFER_ENGINE
+    same_beats = !line_buffer_fits(layer_config);
+#endif
+    
+    std::vector<ddr_word_t> input_words = ddr_pack(input);
+    std::vector<ddr_word_t> weight_words = ddr_pack_weights(tiled_weights);
+    std::vector<ddr_word_t> bias_words = ddr_pack_weights(bias);
+    
+    for (int reuse = 0; reuse <= 1; reuse++) {
+        tiled_config.reuse_enable = reuse;
+        
+        std::vector<data_t> output(output_size * batch);
+        axi_traffic = AxiTrafficCounters();
+        fashion_mnist_cnn_accelerator(input.data(), output.data(), tiled_weights.data(), bias.data(), tiled_config, 0);
+        match &= compareOutputs(output, expected, 0.0f);
+        if (reuse == layer_config.reuse_enable && same_beats) {
+            std::cout << "  Weight beats: " << oihw.weight_beats << " -> " << axi_traffic.weight_beats << std::endl;
+            match &= (axi_traffic.weight_beats == oihw.weight_beats);
+        }
+        
+        std::vector<ddr_word_t> output_words(ddr_packed_words(output_size * batch), ddr_word_t(0));
+        fashion_mnist_cnn_accelerator_wide(input_words.data(), output_words.data(), weight_words.data(), bias_words.data(), tiled_config, 0);
+        match &= compareOutputs(ddr_unpack(output_words, output_size * batch), expected, 0.0f);
+    }
+    
+    std::vector<data_t> pp_output(output_size * batch);
+    tiled_config.reuse_enable = 0;
+    fashion_mnist_cnn_accelerator_pingpong(input.data(), pp_output.data(), tiled_weights.data(), bias.data(), tiled_config, 0);
+    match &= compareOutputs(pp_output, expected, 0.0f);
+    
+    if (match) {
+        std::cout << "Tile-major weights test PASSED!" << std::endl;
+    } else {
+        std::cout << "Tile-major weights test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Packed DSP multiplies: the integer model of two signed 8 x 8 products from
+// one 27 x 18 multiply against plain products, for every weight pair and
+// activation, then compute_tile against a loop of separate multiplies on
+// random tiles at the build precision (the packed engine with USE_DSP_PACKING=1)
+bool testDspPacking() {
+    std::cout << "Testing DSP-packed INT8 multiplies" << (USE_DSP_PACKING ? "" : " (compute_tile unpacked in this build)")
+              << std::endl;
+    
+    long long mismatches = 0;
+    for (int w_lo = -128; w_lo < 128; w_lo++) {
+        for (int w_hi = -128; w_hi < 128; w_hi++) {
+            for (int a = -128; a < 128; a++) {
+                ap_int<16> p_lo, p_hi;
+                dsp_dual_mul<8, 8>(ap_int<8>(w_lo), ap_int<8>(w_hi), ap_int<8>(a), p_lo, p_hi);
+                mismatches += (p_lo.to_int() != w_lo * a || p_hi.to_int() != w_hi * a) ? 1 : 0;
+            }
+        }
+    }
+    std::cout << "  2^24 weight pairs x activations: " << mismatches << " mismatches" << std::endl;
+    bool match = (mismatches == 0);
+    
+    const int shapes[][6] = {
+        // K, S, tm, tn, tr, tc
+        { 3, 1, TM, TN, TR, TC },
+        { 5, 2, 7, TN, 4, 6 },
+        { 1, 1, 3, 2, TR, 1 },
+        { 3, 2, 1, 1, 3, 3 },
+    };
+    for (const int* shape : shapes) {
+        TestDataGenerator dataGen(shape[0] * 100 + shape[2] * 10 + shape[3]);
+        std::vector<data_t> input(TN * INPUT_TILE_HEIGHT * INPUT_TILE_WIDTH);
+        std::vector<weight_t> weights(TM * TN * MAX_KERNEL_SIZE * MAX_KERNEL_SIZE);
+        std::vector<acc_t> bias(TM * TR * TC);
+        dataGen.generateRandomData(input);
+        dataGen.generateRandomData(weights, -0.5f, 0.5f);
+        dataGen.generateRandomData(bias);
+        
+        static data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH];
+        static weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+        static acc_t tile_output[TM][TR][TC];
+        static acc_t loop_output[TM][TR][TC];
+        std::copy(input.begin(), input.end(), &input_buffer[0][0][0]);
+        std::copy(weights.begin(), weights.end(), &weight_buffer[0][0][0]);
+        std::copy(bias.begin(), bias.end(), &tile_output[0][0][0]);
+        std::copy(bias.begin(), bias.end(), &loop_output[0][0][0]);
+        
+        int K = shape[0], S = shape[1];
+        compute_tile(input_buffer, weight_buffer, tile_output, K, S, shape[2], shape[3], shape[4], shape[5]);
+        for (int k = 0; k < K * K; k++) {
+            for (int r = 0; r < shape[4]; r++) {
+                for (int c = 0; c < shape[5]; c++) {
+                    for (int m = 0; m < shape[2]; m++) {
+                        for (int n = 0; n < shape[3]; n++) {
+                            loop_output[m][r][c] += weight_buffer[m][n][k] * input_buffer[n][r * S + k / K][c * S + k % K];
+                        }
+                    }
+                }
+            }
+        }
+        
+        bool tile_match = true;
+        for (int e = 0; e < TM * TR * TC; e++) {
+            tile_match &= ((&tile_output[0][0][0])[e] == (&loop_output[0][0][0])[e]);
+        }
+        std::cout << "  compute_tile K=" << K << " S=" << S << ", " << shape[2] << "x" << shape[3] << " channels, "
+                  << shape[4] << "x" << shape[5] << " pixels: " << (tile_match ? "bit-exact" : "MISMATCH") << std::endl;
+        match &= tile_match;
+    }
+    
+    if (match) {
+        std::cout << "DSP packing test PASSED!" << std::endl;
+    } else {
+        std::cout << "DSP packing test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Performance counters: fashion_mnist_cnn_accelerator_counted must compute the
+// same outputs as fashion_mnist_cnn_accelerator, and its word counters must
+// match the bundle beats of perf_model. The cycle clock does not advance in C
+// simulation, so the cycle counters must stay 0; the table prints the cycles
+// perf_predict_counters() expects on the FPGA.
+bool testPerfCounters(const char* name, LayerConfig layer_config) {
+    
+    std::cout << "Testing performance counters: " << name << std::endl;
+    
+    int B = layer_config.batch_size;
+    int M = layer_config.output_channels;
+    int N = layer_config.input_channels;
+    int K = layer_config.kernel_size;
+    bool pool = (layer_config.layer_type == LAYER_MAXPOOL);
+    TestDataGenerator dataGen;
+    std::vector<data_t> input(N * layer_config.input_height * layer_config.input_width * B);
+    std::vector<weight_t> weights(pool ? 1 : M * N * K * K);
+    std::vector<weight_t> bias(pool ? 1 : M);
+    dataGen.generateRandomData(input);
+    dataGen.generateRandomData(weights, -0.5f, 0.5f);
+    dataGen.generateRandomData(bias);
+    
+    int output_size = M * layer_config.output_height * layer_config.output_width * B;
+    std::vector<data_t> expected(output_size);
+    std::vector<data_t> output(output_size);
+    fashion_mnist_cnn_accelerator(input.data(), expected.data(), weights.data(), bias.data(), layer_config, 0);
+    
+    const long long cycle_clock = 0;
+    PerfCounters counters;
+    fashion_mnist_cnn_accelerator_counted(input.data(), output.data(), weights.data(), bias.data(), layer_config, 0,
+        &cycle_clock, &counters);
+    bool match = compareOutputs(output, expected, 0.0f);
+    match &= (counters.total_cycles == 0);
+    
+    PerfCounters predicted = perf_predict_counters(perf_estimate_layer(layer_config, perf_default_params()));
+    const char* bundles[PERF_BUNDLES] = { "INPUT_AXI", "OUTPUT_AXI", "WEIGHTS_AXI", "BIAS_AXI" };
+    for (int b = 0; b < PERF_BUNDLES; b++) {
+        std::cout << "  " << bundles[b] << ": " << counters.words[b] << " words (model " << predicted.words[b]
+                  << ", " << predicted.stall_cycles[b] << " stall cycles)" << std::endl;
+        match &= (counters.words[b] == predicted.words[b]);
+        match &= (counters.stall_cycles[b] == 0);
+    }
+    std::cout << "  Model cycles: " << predicted.total_cycles << std::endl;
+    
+    if (match) {
+        std::cout << "Performance counters test PASSED!" << std::endl;
+    } else {
+        std::cout << "Performance counters test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
+// Stall counting of begin_transfer/end_transfer with a cycle clock that
+// advances like the hardware counter. Each transfer moves some beats on its
+// bundle while the clock runs on; the cycles beyond the beats are stalls of
+// that bundle only. Without USE_PERF_COUNTERS the samples are not built, so
+// nothing is counted.
+bool testTransferStalls() {
+    
+    std::cout << "Testing transfer stall counting with an advancing clock" << std::endl;
+    
+    struct Transfer {
+        int bundle;
+        long long cycles;
+        long long beats;
+    };
+    // Weights with read latency, an input load without gaps, bias beats
+    // spread over more cycles, and a store of one burst with set-up cycles
+    const Transfer transfers[] = {
+        { PERF_BUNDLE_WEIGHTS, 120, 96 },
+        { PERF_BUNDLE_INPUT, 64, 64 },
+        { PERF_BUNDLE_BIAS, 40, 8 },
+        { PERF_BUNDLE_WEIGHTS, 30, 16 },
+        { PERF_BUNDLE_OUTPUT, 20, 16 },
+    };
+    
+    volatile long long cycle_clock = 5000;
+    PerfCounters counters = {};
+    long long expected[PERF_BUNDLES] = { 0, 0, 0, 0 };
+    AxiTrafficCounters saved_traffic = axi_traffic;
+    for (const Transfer& transfer : transfers) {
+        TransferMark mark = begin_transfer(&cycle_clock, transfer.bundle);
+        cycle_clock += transfer.cycles;
+        switch (transfer.bundle) {
+        case PERF_BUNDLE_INPUT:
+            axi_traffic.input_beats += transfer.beats;
+            axi_traffic.read_beats += transfer.beats;
+            break;
+        case PERF_BUNDLE_WEIGHTS:
+            axi_traffic.weight_beats += transfer.beats;
+            axi_traffic.read_beats += transfer.beats;
+            break;
+        case PERF_BUNDLE_BIAS:
+            axi_traffic.bias_beats += transfer.beats;
+            axi_traffic.read_beats += transfer.beats;
+            break;
+        default:
+            axi_traffic.write_beats += transfer.beats;
+            break;
+        }
+        end_transfer(&cycle_clock, counters, transfer.bundle, mark);
+        // Compute between transfers is no stall of any bundle
+        cycle_clock += 11;
+        if (USE_PERF_COUNTERS) {
+            expected[transfer.bundle] += transfer.cycles - transfer.beats;
+        }
+    }
+    axi_traffic = saved_traffic;
+    
+    bool match = true;
+    const char* bundles[PERF_BUNDLES] = { "INPUT_AXI", "OUTPUT_AXI", "WEIGHTS_AXI", "BIAS_AXI" };
+    for (int b = 0; b < PERF_BUNDLES; b++) {
+        std::cout << "  " << bundles[b] << ": " << counters.stall_cycles[b] << " stall cycles (expected "
+                  << expected[b] << ")" << std::endl;
+        match &= (counters.stall_cycles[b] == expected[b]);
+    }
+    
+    if (match) {
+        std::cout << "Transfer stall counting test PASSED!" << std::endl;
+    } else {
+        std::cout << "Transfer stall counting test FAILED!" << std::endl;
+    }
+    
+    return match;
+}
+
 int main() {
     bool all_tests_passed = true;
     
+    std::cout << "Conv engine: " << (USE_LINE_BUFFER_ENGINE ? "line buffer (tiled for layers beyond the LB_MAX_* limits)" : "tiled")
+              << ", tiled engine: " << (USE_SYSTOLIC_ENGINE ? "systolic array" : (USE_ZERO_SKIP_ENGINE ? "zero skipping" : "compute_tile"))
+              << std::endl;
+    
     // Test 1: Compute tile function
     all_tests_passed &= testComputeTile();
     
+    // Systolic array vs compute_tile: full and partial tiles, both strides, K = 1, 3, 5
+    all_tests_passed &= testSystolicTile(3, 1, TM, TN, TR, TC);
+    all_tests_passed &= testSystolicTile(5, 1, TM, TN, TR, TC);
+    all_tests_passed &= testSystolicTile(3, 2, TM, TN, TR, TC);
+    all_tests_passed &= testSystolicTile(5, 2, 5, 3, 4, 6);
+    all_tests_passed &= testSystolicTile(1, 1, 3, 1, 1, 7);
+    all_tests_passed &= testSystolicTile(3, 1, 1, 2, 7, 2);
+    
+    // Zero skipping vs compute_tile: dense, post-ReLU and mostly zero tiles
+    all_tests_passed &= testZeroSkipTile(3, 1, TM, TN, TR, TC, 0.0f);
+    all_tests_passed &= testZeroSkipTile(5, 1, TM, TN, TR, TC, 0.5f);
+    all_tests_passed &= testZeroSkipTile(3, 2, 5, 3, 4, 6, 0.3f);
+    all_tests_passed &= testZeroSkipTile(1, 1, 3, 1, 1, 7, 0.5f);
+    all_tests_passed &= testZeroSkipTile(5, 2, TM, TN, TR, TC, 0.9f);
+    
     std::cout << "\n-------------------------------\n" << std::endl;
     
     // Test 2: Small convolutional layer (using the actual accelerator)
@@ -378,6 +1552,169 @@ int main() {
         0    // padding
     );
     
+    // Layers covering several spatial tiles, output channel lanes, strides and
+    // kernel sizes, so both conv engines are checked against conv2d_reference
+    all_tests_passed &= testConvLayer(2, 9, 9, 9, 5, 5, 5, 1, 0);
+    all_tests_passed &= testConvLayer(3, 12, 12, 3, 6, 6, 3, 2, 1);
+    all_tests_passed &= testConvLayer(1, 20, 20, 1, 20, 20, 3, 1, 1);
+    all_tests_passed &= testConvLayer(2, 15, 15, 4, 7, 7, 3, 2, 0);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 3: Max-pooling layers, with several channel and spatial tiles
+    all_tests_passed &= testMaxPoolLayer(5, 10, 10, 2, 2);
+    all_tests_passed &= testMaxPoolLayer(2, 16, 16, 2, 2);
+    all_tests_passed &= testMaxPoolLayer(3, 13, 13, 3, 2);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 4: Fully-connected layers, batched and single-input, with and without ReLU
+    all_tests_passed &= testFCLayer(50, 10, 4, true);
+    all_tests_passed &= testFCLayer(64, 12, 1, false);
+    all_tests_passed &= testFCChunks(1202, 10, MAX_BATCH);
+    all_tests_passed &= testFCChunks(3136, 6, MAX_BATCH + 3);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 5: Packed 128-bit AXI data mover, bit-exact against the element-wide ports
+    all_tests_passed &= testWideMover("conv 6x9x9 -> 6x9x9, K=3 S=1 P=1",
+        makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1), 6*9*9, 6*6*9, 6, 6*9*9);
+    all_tests_passed &= testWideMover("conv 2x15x15 -> 4x7x7, K=3 S=2 P=0",
+        makeLayerConfig(LAYER_CONV, 2, 15, 15, 4, 7, 7, 3, 2, 0, 1), 2*15*15, 4*2*9, 4, 4*7*7);
+    all_tests_passed &= testWideMover("max-pool 5x10x10 -> 5x5x5, K=2 S=2",
+        makeLayerConfig(LAYER_MAXPOOL, 5, 10, 10, 5, 5, 5, 2, 2, 0, 0), 5*10*10, 0, 0, 5*5*5);
+    all_tests_passed &= testWideMover("FC 50 -> 10, batch 4",
+        makeLayerConfig(LAYER_FC, 50, 1, 4, 10, 1, 4, 1, 1, 0, 0), 50*4, 10*50, 10, 10*4);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 6: Double-buffered top function, bit-exact against the sequential one
+    all_tests_passed &= testPingPong("conv 2x7x7 -> 4x5x5, single tile",
+        makeLayerConfig(LAYER_CONV, 2, 7, 7, 4, 5, 5, 3, 1, 0, 1), 2*7*7, 4*2*9, 4, 4*5*5);
+    all_tests_passed &= testPingPong("conv 6x9x9 -> 6x9x9, K=3 S=1 P=1",
+        makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1), 6*9*9, 6*6*9, 6, 6*9*9);
+    all_tests_passed &= testPingPong("conv 4x8x8 -> 20x4x4, K=3 S=2 P=1 (3 output channel tiles)",
+        makeLayerConfig(LAYER_CONV, 4, 8, 8, 20, 4, 4, 3, 2, 1, 1), 4*8*8, 20*4*9, 20, 20*4*4);
+    all_tests_passed &= testPingPong("conv 2x16x16 -> 2x12x12, K=5 S=1 P=0",
+        makeLayerConfig(LAYER_CONV, 2, 16, 16, 2, 12, 12, 5, 1, 0, 0), 2*16*16, 2*2*25, 2, 2*12*12);
+    all_tests_passed &= testPingPong("max-pool 5x10x10 -> 5x5x5, K=2 S=2",
+        makeLayerConfig(LAYER_MAXPOOL, 5, 10, 10, 5, 5, 5, 2, 2, 0, 0), 5*10*10, 0, 0, 5*5*5);
+    all_tests_passed &= testPingPong("FC 50 -> 10, batch 4",
+        makeLayerConfig(LAYER_FC, 50, 1, 4, 10, 1, 4, 1, 1, 0, 0), 50*4, 10*50, 10, 10*4);
+    
+    LayerConfig fused_config = makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1);
+    fused_config.pool_size = 2;
+    fused_config.pool_stride = 2;
+    all_tests_passed &= testPingPongRejects("conv 6x9x9 -> 6x9x9 with fused 2x2/2 pooling", fused_config, 6*9*9, 6*9*9);
+    LayerConfig preload_config = makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1);
+    preload_config.weight_mode = WEIGHTS_PRELOAD;
+    all_tests_passed &= testPingPongRejects("WEIGHTS_PRELOAD", preload_config, 6*9*9, 6*9*9);
+    LayerConfig resident_config = makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1);
+    resident_config.weight_mode = WEIGHTS_RESIDENT;
+    all_tests_passed &= testPingPongRejects("WEIGHTS_RESIDENT", resident_config, 6*9*9, 6*9*9);
+    LayerConfig reuse_config = makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1);
+    reuse_config.reuse_enable = 1;
+    all_tests_passed &= testPingPongRejects("reuse schedule", reuse_config, 6*9*9, 6*9*9);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 7: Reuse schedule, bit-exact with fewer DDR reads
+    all_tests_passed &= testReuseSchedule("conv 2x16x16 -> 2x16x16, K=3 S=1 P=1 (3x3 spatial tiles)",
+        makeLayerConfig(LAYER_CONV, 2, 16, 16, 2, 16, 16, 3, 1, 1, 1), 2*16*16, 2*2*9, 2, 2*16*16);
+    all_tests_passed &= testReuseSchedule("conv 6x9x9 -> 6x9x9, K=3 S=1 P=1",
+        makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1), 6*9*9, 6*6*9, 6, 6*9*9);
+    all_tests_passed &= testReuseSchedule("conv 4x8x8 -> 20x4x4, K=3 S=2 P=1 (3 output channel tiles)",
+        makeLayerConfig(LAYER_CONV, 4, 8, 8, 20, 4, 4, 3, 2, 1, 1), 4*8*8, 20*4*9, 20, 20*4*4);
+    all_tests_passed &= testReuseSchedule("conv 2x16x16 -> 2x12x12, K=5 S=1 P=0",
+        makeLayerConfig(LAYER_CONV, 2, 16, 16, 2, 12, 12, 5, 1, 0, 0), 2*16*16, 2*2*25, 2, 2*12*12);
+    all_tests_passed &= testReuseSchedule("conv 1x16x30 -> 2x7x14, K=3 S=2 P=0",
+        makeLayerConfig(LAYER_CONV, 1, 16, 30, 2, 7, 14, 3, 2, 0, 1), 1*16*30, 2*1*9, 2, 2*7*14);
+    all_tests_passed &= testReuseSchedule("FC 50 -> 10, batch 4",
+        makeLayerConfig(LAYER_FC, 50, 1, 4, 10, 1, 4, 1, 1, 0, 0), 50*4, 10*50, 10, 10*4);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 8: Batch mode, every path of process_layer
+    LayerConfig batch_reuse = makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1);
+    batch_reuse.reuse_enable = 1;
+    all_tests_passed &= testBatch("conv 2x7x7 -> 4x5x5, single tile",
+        makeLayerConfig(LAYER_CONV, 2, 7, 7, 4, 5, 5, 3, 1, 0, 1), 3, 2*7*7, 4*2*9, 4, 4*5*5);
+    all_tests_passed &= testBatch("conv 6x9x9 -> 6x9x9, K=3 S=1 P=1",
+        makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1), 3, 6*9*9, 6*6*9, 6, 6*9*9);
+    all_tests_passed &= testBatch("conv 6x9x9 -> 6x9x9, K=3 S=1 P=1, reuse schedule",
+        batch_reuse, 3, 6*9*9, 6*6*9, 6, 6*9*9);
+    all_tests_passed &= testBatch("conv 4x8x8 -> 20x4x4, K=3 S=2 P=1 (3 output channel tiles)",
+        makeLayerConfig(LAYER_CONV, 4, 8, 8, 20, 4, 4, 3, 2, 1, 1), 4, 4*8*8, 20*4*9, 20, 20*4*4);
+    all_tests_passed &= testBatch("conv 5x6x6 -> 10x2x2, K=5 S=1 P=0 (two batch groups)",
+        makeLayerConfig(LAYER_CONV, 5, 6, 6, 10, 2, 2, 5, 1, 0, 1), MAX_BATCH + 2, 5*6*6, 10*5*25, 10, 10*2*2);
+    all_tests_passed &= testBatch("max-pool 5x10x10 -> 5x5x5, K=2 S=2",
+        makeLayerConfig(LAYER_MAXPOOL, 5, 10, 10, 5, 5, 5, 2, 2, 0, 0), 3, 5*10*10, 0, 0, 5*5*5);
+    all_tests_passed &= testBatch("FC 50 -> 10",
+        makeLayerConfig(LAYER_FC, 50, 1, 1, 10, 1, 1, 1, 1, 0, 0), 5, 50, 10*50, 10, 10);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 9: Fused conv+pool, with pooling windows that do and do not overlap
+    // the tile boundaries
+    all_tests_passed &= testFusedPool("conv 2x16x16 -> 4x16x16, K=3 S=1 P=1, pool 2/2 (general path, batch 2)",
+        makeLayerConfig(LAYER_CONV, 2, 16, 16, 4, 16, 16, 3, 1, 1, 1), 2, 2, 2);
+    all_tests_passed &= testFusedPool("conv 1x9x9 -> 2x9x9, K=3 S=1 P=1, pool 2/2 (last row and column unused)",
+        makeLayerConfig(LAYER_CONV, 1, 9, 9, 2, 9, 9, 3, 1, 1, 1), 2, 2, 1);
+    all_tests_passed &= testFusedPool("conv 3x20x20 -> 4x20x20, K=5 S=1 P=2, pool 3/2 (overlapping windows)",
+        makeLayerConfig(LAYER_CONV, 3, 20, 20, 4, 20, 20, 5, 1, 2, 1), 3, 2, 1);
+    all_tests_passed &= testFusedPool("conv 6x13x13 -> 10x13x13, K=3 S=1 P=1, pool 3/1 (2 output channel tiles)",
+        makeLayerConfig(LAYER_CONV, 6, 13, 13, 10, 13, 13, 3, 1, 1, 1), 3, 1, 2);
+    all_tests_passed &= testFusedPool("conv 2x15x15 -> 4x7x7, K=3 S=2 P=0, pool 3/2 (single tile)",
+        makeLayerConfig(LAYER_CONV, 2, 15, 15, 4, 7, 7, 3, 2, 0, 1), 3, 2, 3);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 10: Layer table, a whole network per accelerator start
+    all_tests_passed &= testLayerTable();
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 11: Tile-major weights, with partial tiles along both channel dimensions
+    all_tests_passed &= testTileMajorWeights("conv 2x7x7 -> 4x5x5, single tile",
+        makeLayerConfig(LAYER_CONV, 2, 7, 7, 4, 5, 5, 3, 1, 0, 1), 1, 2*7*7, 4*5*5);
+    all_tests_passed &= testTileMajorWeights("conv 6x9x9 -> 6x9x9, K=3 S=1 P=1 (partial Tm and Tn tiles)",
+        makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1), 2, 6*9*9, 6*9*9);
+    all_tests_passed &= testTileMajorWeights("conv 5x8x8 -> 20x4x4, K=3 S=2 P=1 (3 output channel tiles)",
+        makeLayerConfig(LAYER_CONV, 5, 8, 8, 20, 4, 4, 3, 2, 1, 1), 1, 5*8*8, 20*4*4);
+    all_tests_passed &= testTileMajorWeights("conv 3x16x16 -> 10x12x12, K=5 S=1 P=0",
+        makeLayerConfig(LAYER_CONV, 3, 16, 16, 10, 12, 12, 5, 1, 0, 0), 3, 3*16*16, 10*12*12);
+    all_tests_passed &= testTileMajorWeights("FC 50 -> 10",
+        makeLayerConfig(LAYER_FC, 50, 1, 1, 10, 1, 1, 1, 1, 0, 0), 4, 50, 10);
+    all_tests_passed &= testTileMajorWeights("FC 1202 -> 10 (3 input chunks)",
+        makeLayerConfig(LAYER_FC, 1202, 1, 1, 10, 1, 1, 1, 1, 0, 0), MAX_BATCH, 1202, 10);
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 12: DSP-packed multiplies, bit-exact with separate ones
+    all_tests_passed &= testDspPacking();
+    
+    std::cout << "\n-------------------------------\n" << std::endl;
+    
+    // Test 13: Performance counters against the perf_model bundle beats
+    LayerConfig counted_reuse = makeLayerConfig(LAYER_CONV, 6, 9, 9, 6, 9, 9, 3, 1, 1, 1);
+    counted_reuse.reuse_enable = 1;
+    LayerConfig counted_fused = makeLayerConfig(LAYER_CONV, 2, 16, 16, 4, 16, 16, 3, 1, 1, 1);
+    counted_fused.pool_size = 2;
+    counted_fused.pool_stride = 2;
+    LayerConfig counted_fc = makeLayerConfig(LAYER_FC, 50, 1, 1, 10, 1, 1, 1, 1, 0, 0);
+    counted_fc.batch_size = 3;
+    LayerConfig counted_fc_chunks = makeLayerConfig(LAYER_FC, 1202, 1, 1, 10, 1, 1, 1, 1, 0, 0);
+    counted_fc_chunks.batch_size = MAX_BATCH;
+    all_tests_passed &= testPerfCounters("conv 4x8x8 -> 20x4x4, K=3 S=2 P=1 (3 output channel tiles)",
+        makeLayerConfig(LAYER_CONV, 4, 8, 8, 20, 4, 4, 3, 2, 1, 1));
+    all_tests_passed &= testPerfCounters("conv 6x9x9 -> 6x9x9, K=3 S=1 P=1, reuse schedule", counted_reuse);
+    all_tests_passed &= testPerfCounters("conv 2x16x16 -> 4x16x16, K=3 S=1 P=1, fused pool 2/2", counted_fused);
+    all_tests_passed &= testPerfCounters("max-pool 5x10x10 -> 5x5x5, K=2 S=2",
+        makeLayerConfig(LAYER_MAXPOOL, 5, 10, 10, 5, 5, 5, 2, 2, 0, 0));
+    all_tests_passed &= testPerfCounters("FC 50 -> 10, batch 3", counted_fc);
+    all_tests_passed &= testPerfCounters("FC 1202 -> 10, batch 16 (3 input chunks)", counted_fc_chunks);
+    all_tests_passed &= testTransferStalls();
+    
     if (all_tests_passed) {
         std::cout << "\nAll tests PASSED!" << std::endl;
         return 0;
@@ -5,10 +5,76 @@
 #include <ap_fixed.h>
 #include "cnn_params.h"
 
-// Fixed-point data type optimized for resource usage
-typedef ap_fixed<12, 6> data_t;
+// Static state of the accelerator (on-chip caches, the resident store and the
+// C simulation counters). In C simulation every host thread that calls the
+// accelerator is a separate compute unit with its own copy (compute_units.h).
+#ifdef __SYNTHESIS__
+#define CU_LOCAL
+#else
+#define CU_LOCAL thread_local
+#endif
+
+// Fixed-point types of one precision configuration. Products of weight_t and
+// data_t are truncated to acc_t and accumulated in acc_t; outputs are
+// truncated back to data_t when they are stored.
+template <int W_BITS, int W_INT, int A_BITS, int A_INT, int ACC_W_BITS, int ACC_W_INT>
+struct cnn_precision {
+    typedef ap_fixed<W_BITS, W_INT> weight_t;
+    typedef ap_fixed<A_BITS, A_INT> data_t;
+    typedef ap_fixed<ACC_W_BITS, ACC_W_INT> acc_t;
+};
+
+// Precision of the accelerator build, see cnn_params.h
+typedef cnn_precision<WEIGHT_BITS, WEIGHT_INT_BITS, ACT_BITS, ACT_INT_BITS, ACC_BITS, ACC_INT_BITS> accel_precision;
+typedef accel_precision::data_t data_t;      // Activations (the feature maps in DDR)
+typedef accel_precision::weight_t weight_t;  // Weights and biases
+typedef accel_precision::acc_t acc_t;        // Output tile accumulators
+
+// One beat of the 128-bit DDR interface: DDR_PACK lanes, lane 0 in the low
+// bits. Element i of a packed tensor is lane i % DDR_PACK of word i / DDR_PACK.
+typedef ap_uint<DDR_INTERFACE_WIDTH> ddr_word_t;
+
+static_assert(data_t::width <= DDR_ELEMENT_BITS && weight_t::width <= DDR_ELEMENT_BITS,
+    "data_t and weight_t must fit a DDR lane");
+
+// T is data_t for feature maps and weight_t for weights and biases
+template <typename T = data_t>
+inline T ddr_get_lane(const ddr_word_t& word, int lane) {
+    T value;
+    value.range(T::width - 1, 0) = word.range(lane * DDR_ELEMENT_BITS + T::width - 1, lane * DDR_ELEMENT_BITS);
+    return value;
+}
+
+// The element bits are zero-extended to the lane width
+template <typename T>
+inline void ddr_set_lane(ddr_word_t& word, int lane, T value) {
+    word.range(lane * DDR_ELEMENT_BITS + DDR_ELEMENT_BITS - 1, lane * DDR_ELEMENT_BITS) = value.range(T::width - 1, 0);
+}
+
+// Layer types executed by the accelerator
+#define LAYER_CONV 0      // Convolution
+#define LAYER_MAXPOOL 1   // Max-pooling, K x K window with stride S (output channels = input channels)
+#define LAYER_FC 2        // Fully-connected over a [N][batch] input (see process_layer in cnn_top.cpp)
+
+// Weight source of a conv or FC call (LayerConfig.weight_mode)
+#define WEIGHTS_FROM_DDR 0  // Read weights_ddr and bias_ddr on every call
+#define WEIGHTS_PRELOAD 1   // Only copy the weights and bias into the resident store, no compute
+#define WEIGHTS_RESIDENT 2  // Use the resident copy; weights_ddr and bias_ddr are not accessed
+
+// Order of the weights in weights_ddr (LayerConfig.weight_layout)
+#define WEIGHT_LAYOUT_OIHW 0   // [M][N][K*K]
+#define WEIGHT_LAYOUT_TILED 1  // Tile-major: the [tm][tn][K*K] block of every TM x TN tile is
+                               // contiguous, tiles in (m_offset, n_offset) order (see weight_layout.h)
 
 // Layer configuration structure
+// For LAYER_FC only input_channels (N), output_channels (M) and input_width
+// (batch size) are used; the input is laid out [N][batch], the output [M][batch].
+// With batch_size B the input and output hold B images back to back
+// ([B][N][H][W] and [B][M][R][C]; [B][N] and [B][M] for FC with input_width 1),
+// and one call applies the weights to all of them.
+// A conv layer with pool_size > 0 max-pools its (ReLU) output on chip before
+// the store: output_height and output_width stay the conv output R x C, and
+// the output in DDR is the pooled [M][PR][PC] map (see fused_pool_extent).
 typedef struct {
     int input_channels;   // N
     int output_channels;  // M
@@ -19,6 +85,119 @@ typedef struct {
     int kernel_size;      // K
     int stride;           // S
     int padding;          // P
+    int layer_type;       // LAYER_CONV, LAYER_MAXPOOL or LAYER_FC
+    int relu_enable;      // Apply ReLU to the layer output
+    int reuse_enable;     // Conv/FC: keep weights resident across spatial tiles and reuse input halos
+                          // (only when input_channels <= MAX_RESIDENT_CHANNELS)
+    int weight_mode;      // WEIGHTS_FROM_DDR, WEIGHTS_PRELOAD or WEIGHTS_RESIDENT
+    int resident_offset;  // Resident store offset of the [M][N][K*K] weights, followed by the M biases
+    int batch_size;       // Images per call (B >= 1)
+    int pool_size;        // Conv: window of the fused max-pooling, <= TR and TC (0 = no pooling)
+    int pool_stride;      // Conv: stride of the fused max-pooling
+    int weight_layout;    // Conv/FC: WEIGHT_LAYOUT_OIHW or WEIGHT_LAYOUT_TILED (WEIGHTS_FROM_DDR
+                          // calls; a WEIGHTS_PRELOAD call takes [M][N][K*K] weights)
 } LayerConfig;
 
+// A 1x1 LAYER_CONV with every optional field at its default: no ReLU, no
+// reuse schedule, [M][N][K*K] weights read from DDR, one image, no fused
+// pooling. Construction sites start from it and set the fields of the layer.
+inline LayerConfig default_layer_config() {
+    LayerConfig config;
+    config.input_channels = 1;
+    config.output_channels = 1;
+    config.input_height = 1;
+    config.input_width = 1;
+    config.output_height = 1;
+    config.output_width = 1;
+    config.kernel_size = 1;
+    config.stride = 1;
+    config.padding = 0;
+    config.layer_type = LAYER_CONV;
+    config.relu_enable = 0;
+    config.reuse_enable = 0;
+    config.weight_mode = WEIGHTS_FROM_DDR;
+    config.resident_offset = 0;
+    config.batch_size = 1;
+    config.pool_size = 0;
+    config.pool_stride = 0;
+    config.weight_layout = WEIGHT_LAYOUT_OIHW;
+    return config;
+}
+
+// m_axi bundles of the accelerator, the indices of the PerfCounters arrays
+#define PERF_BUNDLE_INPUT 0    // INPUT_AXI: input feature maps
+#define PERF_BUNDLE_OUTPUT 1   // OUTPUT_AXI: output feature maps (and the partial
+                               // words the packed store reads back)
+#define PERF_BUNDLE_WEIGHTS 2  // WEIGHTS_AXI
+#define PERF_BUNDLE_BIAS 3     // BIAS_AXI
+#define PERF_BUNDLES 4
+
+// Counters of one fashion_mnist_cnn_accelerator_counted call, in accelerator
+// clock cycles and AXI beats. A stall cycle is a cycle of a transfer on the
+// bundle (a load or store function of the tiled engine, from its first to its
+// last cycle) that did not move a beat: read latency, burst set-up, pipeline
+// fill and back-pressure from DDR. perf_predict_counters() in perf_model.h
+// gives the same counters for a LayerConfig.
+typedef struct {
+    long long total_cycles;               // ap_start to ap_done
+    long long words[PERF_BUNDLES];        // Beats read or written on the bundle
+    long long stall_cycles[PERF_BUNDLES]; // Transfer cycles without a beat
+} PerfCounters;
+
+// One entry of the layer table walked by fashion_mnist_cnn_accelerator_network.
+// The offsets are in elements: input and output into the activation buffer,
+// weights and bias into the parameter buffer (unused by pooling layers and
+// WEIGHTS_RESIDENT calls).
+typedef struct {
+    LayerConfig config;
+    int input_offset;
+    int output_offset;
+    int weight_offset;
+    int bias_offset;
+} LayerDescriptor;
+
+// Rows (or columns) of a conv output of the given extent after the fused
+// max-pooling of the layer; without pooling the conv output is stored as is
+inline int fused_pool_extent(int conv_extent, int pool_size, int pool_stride) {
+    return (pool_size > 0) ? (conv_extent - pool_size) / pool_stride + 1 : conv_extent;
+}
+
+// Offset in the tile-major layout of the weight tile at (m_offset, n_offset):
+// the tiles of the output channels before m_offset hold m_offset * N kernels,
+// and the tiles before n_offset in the same row m_limit * n_offset kernels
+inline int tiled_weight_offset(int m_offset, int n_offset, int M, int N, int K) {
+    int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    return (m_offset * N + m_limit * n_offset) * K * K;
+}
+
+// Input features per chunk of the FC path (see cnn_top.cpp) for a group of
+// images: the whole input vector when the group fits fc_input, otherwise the
+// largest multiple of TN that does, so chunks start on tile-major blocks
+inline int fc_input_chunk(int N, int group) {
+    int chunk = FC_INPUT_BUFFER_SIZE / group;
+    return (chunk >= N) ? N : chunk / TN * TN;
+}
+
+// True if the line-buffer engine can run the layer (USE_LINE_BUFFER_ENGINE=1);
+// it reads [M][N][K*K] weights
+inline bool line_buffer_fits(const LayerConfig& layer_config) {
+    return layer_config.layer_type == LAYER_CONV
+        && layer_config.weight_layout == WEIGHT_LAYOUT_OIHW
+        && layer_config.kernel_size <= MAX_KERNEL_SIZE
+        && layer_config.stride <= MAX_STRIDE
+        && layer_config.input_width + 2 * layer_config.padding <= LB_MAX_WIDTH
+        && layer_config.output_channels <= LB_MAX_OUTPUT_CHANNELS
+        && layer_config.output_height * layer_config.output_width <= LB_MAX_OUTPUT_PIXELS;
+}
+
+// True if fashion_mnist_cnn_accelerator_pingpong can run the layer: it reads
+// every weight tile from DDR, stores the conv output unpooled and has no reuse
+// schedule, so it rejects pool_size > 0, WEIGHTS_PRELOAD/WEIGHTS_RESIDENT and
+// reuse_enable
+inline bool pingpong_supports(const LayerConfig& layer_config) {
+    return (layer_config.layer_type != LAYER_CONV || layer_config.pool_size == 0)
+        && layer_config.weight_mode == WEIGHTS_FROM_DDR
+        && layer_config.reuse_enable == 0;
+}
+
 #endif // CNN_TYPES_H
\ No newline at end of file
@@ -1,10 +1,11 @@
 #include "cnn_functions.h"
+#include "dsp_packing.h"
 
 // The core computation engine implementing the optimized loop ordering from the paper
 void compute_tile(
     data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
-    data_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
-    data_t output_buffer[TM][TR][TC],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    acc_t output_buffer[TM][TR][TC],
     int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
     
     #pragma HLS INLINE off
@@ -32,16 +33,85 @@ void compute_tile(
                         // Main computation with optimized pragmas
                         #pragma HLS PIPELINE II=1
                         tii_loop: for (int tii = 0; tii < tn_bound; tii++) {
+#if USE_DSP_PACKING
+                            // Both output feature maps of the batch share the
+                            // activation, so one DSP48E2 computes their products
+                            dsp_mac_pair(output_buffer, weight_buffer, too_base, too_limit, tii, k_idx, trr, tcc,
+                                input_buffer[tii][h][w]);
+#else
                             // Process each output feature map in this batch
                             too_inner_loop: for (int too_offset = 0; too_offset < too_limit; too_offset++) {
                                 #pragma HLS UNROLL
                                 int too = too_base + too_offset;
                                 
-                                // Main convolution operation
+                                // Main convolution operation, each product truncated to acc_t
                                 output_buffer[too][trr][tcc] += 
                                     weight_buffer[too][tii][k_idx] * 
                                     input_buffer[tii][h][w];
                             }
+#endif
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Max-pooling over a loaded input tile, one output channel per input channel.
+// Padded positions hold 0 (see load_input_tile), so use P = 0 unless the
+// input is non-negative.
+void pool_tile(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    acc_t output_buffer[TM][TR][TC],
+    int kernel_size, int stride, int tn_bound, int tr_bound, int tc_bound) {
+    
+    #pragma HLS INLINE off
+    
+    pool_r_loop: for (int trr = 0; trr < tr_bound; trr++) {
+        pool_c_loop: for (int tcc = 0; tcc < tc_bound; tcc++) {
+            pool_i_loop: for (int i = 0; i < kernel_size; i++) {
+                pool_j_loop: for (int j = 0; j < kernel_size; j++) {
+                    #pragma HLS PIPELINE II=1
+                    int h = trr * stride + i;
+                    int w = tcc * stride + j;
+                    
+                    // One input channel per partition of input_buffer
+                    pool_n_loop: for (int tii = 0; tii < TN; tii++) {
+                        #pragma HLS UNROLL
+                        if (tii < tn_bound) {
+                            acc_t value = input_buffer[tii][h][w];
+                            if ((i == 0 && j == 0) || value > output_buffer[tii][trr][tcc]) {
+                                output_buffer[tii][trr][tcc] = value;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Max-pooling of a finished conv output tile (fused pooling). Pooled pixel
+// (trr, tcc) covers the output_buffer window at (trr * stride, tcc * stride).
+// The values are truncated to data_t before they are compared, so the result
+// equals storing the conv output and pooling it in a separate call.
+void pool_output_tile(
+    acc_t output_buffer[TM][TR][TC],
+    acc_t pool_buffer[TM][TR][TC],
+    int pool_size, int stride, int tm_bound, int tr_bound, int tc_bound) {
+    
+    #pragma HLS INLINE off
+    
+    pool_out_m_loop: for (int too = 0; too < tm_bound; too++) {
+        pool_out_r_loop: for (int trr = 0; trr < tr_bound; trr++) {
+            pool_out_c_loop: for (int tcc = 0; tcc < tc_bound; tcc++) {
+                pool_out_i_loop: for (int i = 0; i < pool_size; i++) {
+                    pool_out_j_loop: for (int j = 0; j < pool_size; j++) {
+                        #pragma HLS PIPELINE II=1
+                        acc_t value = data_t(output_buffer[too][trr * stride + i][tcc * stride + j]);
+                        if ((i == 0 && j == 0) || value > pool_buffer[too][trr][tcc]) {
+                            pool_buffer[too][trr][tcc] = value;
                         }
                     }
                 }
@@ -51,7 +121,7 @@ void compute_tile(
 }
 
 // Function to apply ReLU activation
-void apply_relu(data_t buffer[TM][TR][TC], int tm, int tr, int tc) {
+void apply_relu(acc_t buffer[TM][TR][TC], int tm, int tr, int tc) {
     #pragma HLS INLINE off
     
     // Simple loop structure for ReLU
@@ -66,4 +136,70 @@ void apply_relu(data_t buffer[TM][TR][TC], int tm, int tr, int tc) {
             }
         }
     }
-}
\ No newline at end of file
+}
+// Multiply-accumulate of one FC output channel group over one chunk of the
+// input vectors. The accumulators of the images start from the bias on the
+// first chunk and keep their partial sums across chunks. Every weight of the
+// stream is applied to all images before the next one is read: the [m][n]
+// rows of the chunk in the OIHW layout, or its TN-wide [m][n] blocks in the
+// tile-major one. Each product is truncated to acc_t as in compute_tile, so
+// the order does not change the sums.
+void fc_tile(
+    hls::stream<weight_t>& weights,
+    data_t fc_input[FC_INPUT_BUFFER_SIZE],
+    weight_t bias_buffer[TM],
+    acc_t fc_acc[MAX_BATCH][TM],
+    int tm_bound, int n_count, int images, bool tiled, int relu_enable,
+    bool first_chunk, bool last_chunk) {
+
+    #pragma HLS INLINE off
+
+    if (first_chunk) {
+        fc_init: for (int g = 0; g < images; g++) {
+            fc_init_m: for (int m = 0; m < TM; m++) {
+                #pragma HLS PIPELINE II=1
+                fc_acc[g][m] = bias_buffer[m];
+            }
+        }
+    }
+
+    // The next weight is column n0 + n of row m; a row is the whole chunk
+    // for OIHW weights and a block of up to TN columns for tiled ones
+    const int chunk = tiled ? TN : n_count;
+    weight_t w = 0;
+    int n0 = 0;
+    int n_limit = (n_count < chunk) ? n_count : chunk;
+    int m = 0;
+    int n = 0;
+    int g = 0;
+
+    fc_mac_loop: for (int e = 0; e < tm_bound * n_count * images; e++) {
+        #pragma HLS PIPELINE II=1
+        if (g == 0) {
+            w = weights.read();
+        }
+        fc_acc[g][m] += w * fc_input[g * n_count + n0 + n];
+        if (++g == images) {
+            g = 0;
+            if (++n == n_limit) {
+                n = 0;
+                if (++m == tm_bound) {
+                    m = 0;
+                    n0 += chunk;
+                    n_limit = (n_count - n0 < chunk) ? (n_count - n0) : chunk;
+                }
+            }
+        }
+    }
+
+    if (relu_enable && last_chunk) {
+        fc_relu: for (int g = 0; g < images; g++) {
+            fc_relu_m: for (int m = 0; m < tm_bound; m++) {
+                #pragma HLS PIPELINE II=1
+                if (fc_acc[g][m] < 0) {
+                    fc_acc[g][m] = 0;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,177 @@
+#include "compute_units.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+std::vector<ComputeUnitSlice> plan_output_channel_split(
+    const LayerConfig& layer_config, int cu_count, const PerfModelParams& params) {
+
+    const int M = layer_config.output_channels;
+    const int tiles = (M + TM - 1) / TM;
+
+    // Estimates of a slice of t tiles, in the middle or at the end of the
+    // tm range (the end slice holds the partial tile), computed once each
+    std::map<int, long long> middle_cost, last_cost;
+    auto slice_cycles = [&](int t, bool last) {
+        std::map<int, long long>& cache = last ? last_cost : middle_cost;
+        std::map<int, long long>::iterator it = cache.find(t);
+        if (it != cache.end()) {
+            return it->second;
+        }
+        LayerConfig slice_config = layer_config;
+        slice_config.output_channels = last ? M - (tiles - t) * TM : t * TM;
+        long long cycles = perf_estimate_layer(slice_config, params).total_cycles;
+        cache[t] = cycles;
+        return cycles;
+    };
+
+    // Slices for a given number of CUs. The first cus - 1 CUs share the tiles
+    // before the last slice evenly, so only the tiles of the last CU are free.
+    // Its cost rises and the largest cost of the others falls with its size:
+    // bisect for the crossing point.
+    auto split = [&](int cus) {
+        std::vector<ComputeUnitSlice> slices;
+        if (cus == 1) {
+            ComputeUnitSlice slice = { 0, M, slice_cycles(tiles, true) };
+            slices.push_back(slice);
+            return slices;
+        }
+        auto others_cycles = [&](int last_tiles) {
+            int rest = tiles - last_tiles;
+            return slice_cycles((rest + cus - 2) / (cus - 1), false);
+        };
+        int lo = 1;
+        int hi = tiles - (cus - 1);
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (slice_cycles(mid, true) >= others_cycles(mid)) {
+                hi = mid;
+            }
+            else {
+                lo = mid + 1;
+            }
+        }
+        int last_tiles = lo;
+        if (last_tiles > 1 &&
+            std::max(slice_cycles(last_tiles - 1, true), others_cycles(last_tiles - 1)) <
+            std::max(slice_cycles(last_tiles, true), others_cycles(last_tiles))) {
+            last_tiles--;
+        }
+
+        int rest = tiles - last_tiles;
+        int tile = 0;
+        for (int cu = 0; cu < cus - 1; cu++) {
+            int t = rest / (cus - 1) + (cu < rest % (cus - 1) ? 1 : 0);
+            ComputeUnitSlice slice = { tile * TM, t * TM, slice_cycles(t, false) };
+            slices.push_back(slice);
+            tile += t;
+        }
+        ComputeUnitSlice slice = { tile * TM, M - tile * TM, slice_cycles(last_tiles, true) };
+        slices.push_back(slice);
+        return slices;
+    };
+
+    // Every CU used costs the host one more start
+    std::vector<ComputeUnitSlice> best;
+    long long best_cycles = 0;
+    int max_cus = std::max(1, std::min(cu_count, tiles));
+    for (int cus = 1; cus <= max_cus; cus++) {
+        std::vector<ComputeUnitSlice> slices = split(cus);
+        long long cycles = 0;
+        for (const ComputeUnitSlice& slice : slices) {
+            cycles = std::max(cycles, slice.cycles);
+        }
+        cycles += static_cast<long long>(cus) * params.start_cycles;
+        if (best.empty() || cycles < best_cycles) {
+            best = slices;
+            best_cycles = cycles;
+        }
+    }
+    return best;
+}
+
+ComputeUnitPool::ComputeUnitPool(int cu_count) : stopping(false) {
+    if (cu_count < 1) {
+        throw std::invalid_argument("a compute unit pool needs at least one compute unit");
+    }
+    workers.resize(cu_count);
+    for (int cu = 0; cu < cu_count; cu++) {
+        workers[cu].busy = false;
+        workers[cu].thread = std::thread(&ComputeUnitPool::workerLoop, this, cu);
+    }
+}
+
+ComputeUnitPool::~ComputeUnitPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (Worker& worker : workers) {
+        worker.thread.join();
+    }
+}
+
+int ComputeUnitPool::size() const {
+    return static_cast<int>(workers.size());
+}
+
+void ComputeUnitPool::run(const std::vector<std::function<void()>>& jobs) {
+    if (jobs.size() > workers.size()) {
+        throw std::invalid_argument("more jobs than compute units");
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    for (size_t cu = 0; cu < jobs.size(); cu++) {
+        if (jobs[cu]) {
+            workers[cu].job = jobs[cu];
+            workers[cu].busy = true;
+        }
+    }
+    jobReady.notify_all();
+    jobDone.wait(lock, [this]() {
+        for (const Worker& worker : workers) {
+            if (worker.busy) {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    std::exception_ptr error;
+    for (Worker& worker : workers) {
+        if (!error) {
+            error = worker.error;
+        }
+        worker.error = nullptr;
+    }
+    lock.unlock();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ComputeUnitPool::workerLoop(int cu) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        jobReady.wait(lock, [this, cu]() { return stopping || workers[cu].busy; });
+        if (!workers[cu].busy) {
+            return;
+        }
+        std::function<void()> job;
+        job.swap(workers[cu].job);
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            job();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        workers[cu].error = error;
+        workers[cu].busy = false;
+        jobDone.notify_all();
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef COMPUTE_UNITS_H
+#define COMPUTE_UNITS_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cnn_types.h"
+#include "perf_model.h"
+
+// Host support for several instances (compute units) of
+// fashion_mnist_cnn_accelerator. A conv or FC layer is split along its output
+// channels, the tm_loop range of cnn_top.cpp: every CU gets the whole input,
+// the weights and biases of its own channels and writes its own output planes,
+// so the CUs never share an on-chip buffer and need no synchronization.
+// Slices start on TM boundaries, which keeps both weight layouts contiguous:
+// channel m0 of a slice starts at m0 * N * K*K in the OIHW and in the
+// tile-major order.
+
+// Output channels [m_offset, m_offset + m_count) of a layer on one CU
+typedef struct {
+    int m_offset;
+    int m_count;
+    long long cycles;  // perf_estimate_layer of the slice
+} ComputeUnitSlice;
+
+// Split the output channels of a conv or FC call across at most cu_count CUs.
+// For each number of CUs the boundaries minimize the largest perf_model
+// estimate over the slices (the last output channel tile may be partial and
+// costs less); the number used minimizes that estimate plus one start
+// (params.start_cycles) per CU, since the host starts the CUs one after the
+// other. Small layers thus stay on fewer CUs, and layers with fewer TM tiles
+// than CUs leave CUs idle. A single slice is returned for cu_count <= 1.
+std::vector<ComputeUnitSlice> plan_output_channel_split(
+    const LayerConfig& layer_config, int cu_count, const PerfModelParams& params);
+
+// The CUs of the C simulation: one worker thread per CU. The static state of
+// the accelerator is CU_LOCAL (thread_local in C simulation), so every worker
+// has its own on-chip caches, resident store and counters, like a separate
+// instance of the IP. Not copyable.
+class ComputeUnitPool {
+public:
+    explicit ComputeUnitPool(int cu_count);
+    ~ComputeUnitPool();
+
+    int size() const;
+
+    // Run jobs[cu] on CU cu (jobs.size() <= size(), empty jobs are skipped)
+    // and wait for all of them; an exception thrown by a job is rethrown here
+    void run(const std::vector<std::function<void()>>& jobs);
+
+private:
+    ComputeUnitPool(const ComputeUnitPool&);
+    ComputeUnitPool& operator=(const ComputeUnitPool&);
+
+    struct Worker {
+        std::thread thread;
+        std::function<void()> job;
+        std::exception_ptr error;
+        bool busy;
+    };
+
+    void workerLoop(int cu);
+
+    std::vector<Worker> workers;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    bool stopping;
+};
+
+#endif // COMPUTE_UNITS_H
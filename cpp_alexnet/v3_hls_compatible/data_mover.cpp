@@ -1,5 +1,9 @@
 #include "cnn_functions.h"
 
+#if AXI_TRAFFIC_COUNTERS
+CU_LOCAL AxiTrafficCounters axi_traffic = { 0, 0, 0, 0, 0 };
+#endif
+
 // Function to load input feature map from DDR to on-chip buffer
 void load_input_tile(
     data_t* input_ddr,
@@ -40,6 +44,10 @@ void load_input_tile(
                 if (input_h >= 0 && input_h < H && input_w >= 0 && input_w < W) {
                     int input_idx = (n + n_offset) * H * W + input_h * W + input_w;
                     row_buffer[w] = input_ddr[input_idx];
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.read_beats++;
+                    axi_traffic.input_beats++;
+#endif
                 } else {
                     row_buffer[w] = 0;
                 }
@@ -54,10 +62,48 @@ void load_input_tile(
     }
 }
 
+// Function to load part of an input tile for the reuse schedule: only rows
+// [0, rows) and columns [first_col, cols) are read from DDR, the columns below
+// first_col already hold the halo of the previous tc tile
+void load_input_window(
+    data_t* input_ddr,
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    int n_offset, int h_offset, int w_offset,
+    int first_col, int rows, int cols,
+    int N, int H, int W, int S, int P) {
+
+    #pragma HLS INLINE off
+
+    // Channels beyond N are never read by compute_tile, so they are not cleared
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+
+    load_window: for (int n = 0; n < n_limit; n++) {
+        for (int h = 0; h < rows; h++) {
+            int input_h = h + h_offset*S - P;
+
+            load_window_row: for (int w = first_col; w < cols; w++) {
+                #pragma HLS PIPELINE II=2
+                int input_w = w + w_offset*S - P;
+
+                if (input_h >= 0 && input_h < H && input_w >= 0 && input_w < W) {
+                    int input_idx = (n + n_offset) * H * W + input_h * W + input_w;
+                    input_buffer[n][h][w] = input_ddr[input_idx];
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.read_beats++;
+                    axi_traffic.input_beats++;
+#endif
+                } else {
+                    input_buffer[n][h][w] = 0;
+                }
+            }
+        }
+    }
+}
+
 // Function to load weights from DDR to on-chip buffer
 void load_weight_tile(
-    data_t* weights_ddr,
-    data_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    weight_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
     int m_offset, int n_offset,
     int M, int N, int K) {
     
@@ -93,16 +139,68 @@ void load_weight_tile(
                     int k = k_base + k_offset;
                     int weight_idx = (m + m_offset) * N * K2 + (n + n_offset) * K2 + k;
                     weight_buffer[m][n][k] = weights_ddr[weight_idx];
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.read_beats++;
+                    axi_traffic.weight_beats++;
+#endif
                 }
             }
         }
     }
 }
 
+// Function to load a weight tile from tile-major DDR weights. The tile is one
+// contiguous run of m_limit * n_limit * K*K elements, so a single pipelined
+// loop reads it as one burst instead of m_limit * n_limit short ones.
+void load_weight_tile_tiled(
+    weight_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int m_offset, int n_offset,
+    int M, int N, int K) {
+
+    #pragma HLS INLINE off
+
+    // Pre-compute limits
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+    const int K2 = K*K;
+    const int count = m_limit * n_limit * K2;
+    const int base = tiled_weight_offset(m_offset, n_offset, M, N, K);
+
+    // Initialize all weights to zero
+    clear_weights: for (int m = 0; m < TM; m++) {
+        for (int n = 0; n < TN; n++) {
+            #pragma HLS PIPELINE II=1
+            for (int k = 0; k < MAX_KERNEL_SIZE*MAX_KERNEL_SIZE; k++) {
+                weight_buffer[m][n][k] = 0;
+            }
+        }
+    }
+
+    int m = 0;
+    int n = 0;
+    int k = 0;
+    load_tile_burst: for (int e = 0; e < count; e++) {
+        #pragma HLS PIPELINE II=1
+        weight_buffer[m][n][k] = weights_ddr[base + e];
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.read_beats++;
+        axi_traffic.weight_beats++;
+#endif
+        if (++k == K2) {
+            k = 0;
+            if (++n == n_limit) {
+                n = 0;
+                m++;
+            }
+        }
+    }
+}
+
 // Function to load bias values from DDR to on-chip buffer
 void load_bias(
-    data_t* bias_ddr,
-    data_t bias_buffer[TM],
+    weight_t* bias_ddr,
+    weight_t bias_buffer[TM],
     int m_offset, int M) {
     
     #pragma HLS INLINE off
@@ -120,22 +218,27 @@ void load_bias(
     load_bias: for (int m = 0; m < m_limit; m++) {
         #pragma HLS PIPELINE II=1
         bias_buffer[m] = bias_ddr[m + m_offset];
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.read_beats++;
+        axi_traffic.bias_beats++;
+#endif
     }
 }
 
 // Function to store output feature map from on-chip buffer to DDR
-void store_output_tile(
+void store_output_block(
     data_t* output_ddr,
-    data_t output_buffer[TM][TR][TC],
+    acc_t output_buffer[TM][TR][TC],
     int m_offset, int h_offset, int w_offset,
+    int tr_bound, int tc_bound,
     int M, int R, int C) {
     
     #pragma HLS INLINE off
     
     // Pre-compute limits
     const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
-    const int r_limit = ((h_offset + TR) > R) ? (R - h_offset) : TR;
-    const int c_limit = ((w_offset + TC) > C) ? (C - w_offset) : TC;
+    const int r_limit = ((h_offset + tr_bound) > R) ? (R - h_offset) : tr_bound;
+    const int c_limit = ((w_offset + tc_bound) > C) ? (C - w_offset) : tc_bound;
 
     // Use a buffer-based approach to help with optimization
     store_output: for (int m = 0; m < m_limit; m++) {
@@ -144,7 +247,7 @@ void store_output_tile(
             data_t row_buffer[TC];
             #pragma HLS ARRAY_PARTITION variable=row_buffer cyclic factor=2
             
-            // Fill row buffer
+            // Fill row buffer, truncating the accumulators to data_t
             fill_row: for (int c = 0; c < c_limit; c++) {
                 #pragma HLS PIPELINE II=1
                 row_buffer[c] = output_buffer[m][r][c];
@@ -155,7 +258,100 @@ void store_output_tile(
                 #pragma HLS PIPELINE II=2
                 int output_idx = (m + m_offset) * R * C + (r + h_offset) * C + (c + w_offset);
                 output_ddr[output_idx] = row_buffer[c];
+#if AXI_TRAFFIC_COUNTERS
+                axi_traffic.write_beats++;
+#endif
             }
         }
     }
-}
\ No newline at end of file
+}
+
+// A whole TR x TC tile, clipped to the R x C map
+void store_output_tile(
+    data_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
+    int m_offset, int h_offset, int w_offset,
+    int M, int R, int C) {
+    
+    #pragma HLS INLINE
+    
+    store_output_block(output_ddr, output_buffer, m_offset, h_offset, w_offset, TR, TC, M, R, C);
+}
+
+// Function to load features [n_offset, n_offset + n_count) of the input
+// vectors of FC images [first_image, first_image + images) to fc_input. With
+// W = 1 every vector is one contiguous run; wider inputs are read with a
+// stride of W.
+void load_fc_inputs(
+    data_t* input_ddr,
+    data_t fc_input[FC_INPUT_BUFFER_SIZE],
+    int first_image, int images, int N, int W,
+    int n_offset, int n_count) {
+
+    #pragma HLS INLINE off
+
+    load_fc_images: for (int g = 0; g < images; g++) {
+        int b = (first_image + g) / W;
+        int c = (first_image + g) % W;
+
+        load_fc_features: for (int n = 0; n < n_count; n++) {
+            #pragma HLS PIPELINE II=1
+            fc_input[g * n_count + n] = input_ddr[(b * N + n_offset + n) * W + c];
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.read_beats++;
+            axi_traffic.input_beats++;
+#endif
+        }
+    }
+}
+
+// Function to stream the FC weights of an output channel group and a chunk
+// of input features, one per cycle
+void stream_fc_weights(
+    weight_t* weights_ddr,
+    hls::stream<weight_t>& weights,
+    int m_offset, int tm_bound, int N,
+    int n_offset, int n_count, bool tiled) {
+
+    #pragma HLS INLINE off
+
+    const bool one_run = tiled || n_count == N;
+    const int rows = one_run ? 1 : tm_bound;
+    const int run = one_run ? tm_bound * n_count : n_count;
+    const int base = m_offset * N + (tiled ? tm_bound * n_offset : n_offset);
+
+    stream_fc_rows: for (int r = 0; r < rows; r++) {
+        stream_fc_weight: for (int e = 0; e < run; e++) {
+            #pragma HLS PIPELINE II=1
+            weights.write(weights_ddr[base + r * N + e]);
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.read_beats++;
+            axi_traffic.weight_beats++;
+#endif
+        }
+    }
+}
+
+// Function to store the FC accumulators of images [first_image, first_image +
+// images), truncated to data_t, to output channels [m_offset, m_offset + tm_bound)
+void store_fc_outputs(
+    data_t* output_ddr,
+    acc_t fc_acc[MAX_BATCH][TM],
+    int first_image, int images,
+    int m_offset, int tm_bound, int M, int W) {
+
+    #pragma HLS INLINE off
+
+    store_fc_images: for (int g = 0; g < images; g++) {
+        int b = (first_image + g) / W;
+        int c = (first_image + g) % W;
+
+        store_fc_features: for (int m = 0; m < tm_bound; m++) {
+            #pragma HLS PIPELINE II=1
+            output_ddr[(b * M + m_offset + m) * W + c] = fc_acc[g][m];
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.write_beats++;
+#endif
+        }
+    }
+}
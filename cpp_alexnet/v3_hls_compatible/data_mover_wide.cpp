@@ -0,0 +1,497 @@
+#include "cnn_functions.h"
+
+// Data movers for the packed 128-bit DDR interface. Every DDR access moves one
+// ddr_word_t (DDR_PACK elements); a contiguous run of elements is read as the
+// words that cover it and unpacked into a fully partitioned staging buffer, so
+// all DDR_PACK lanes of a word are consumed in the same cycle.
+
+// Function to load input feature map from packed DDR to on-chip buffer
+void load_input_tile(
+    ddr_word_t* input_ddr,
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    int n_offset, int h_offset, int w_offset,
+    int N, int H, int W, int S, int P) {
+
+    #pragma HLS INLINE off
+
+    // Pre-compute limits to avoid complex conditions
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+
+    // Columns of the input covered by the tile (including padding)
+    const int tile_w = w_offset*S - P;
+    const int first_w = (tile_w < 0) ? 0 : tile_w;
+    const int last_w = (tile_w + INPUT_TILE_WIDTH > W) ? W : (tile_w + INPUT_TILE_WIDTH);
+
+    // Clear buffer first (separate loop)
+    clear_input: for (int n = 0; n < TN; n++) {
+        for (int h = 0; h < INPUT_TILE_HEIGHT; h++) {
+            #pragma HLS PIPELINE II=1
+            for (int w = 0; w < INPUT_TILE_WIDTH; w++) {
+                input_buffer[n][h][w] = 0;
+            }
+        }
+    }
+
+    load_input: for (int n = 0; n < n_limit; n++) {
+        for (int h = 0; h < INPUT_TILE_HEIGHT; h++) {
+            data_t row_buffer[INPUT_TILE_WIDTH];
+            #pragma HLS ARRAY_PARTITION variable=row_buffer complete
+
+            clear_row: for (int w = 0; w < INPUT_TILE_WIDTH; w++) {
+                #pragma HLS UNROLL
+                row_buffer[w] = 0;
+            }
+
+            int input_h = h + h_offset*S - P;
+            if (input_h >= 0 && input_h < H && first_w < last_w) {
+                // Words covering input columns [first_w, last_w) of this row
+                int row_base = (n + n_offset) * H * W + input_h * W;
+                int first_word = (row_base + first_w) / DDR_PACK;
+                int last_word = (row_base + last_w - 1) / DDR_PACK;
+
+                load_words: for (int word = first_word; word <= last_word; word++) {
+                    #pragma HLS PIPELINE II=1
+                    ddr_word_t bits = input_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.read_beats++;
+                    axi_traffic.input_beats++;
+#endif
+                    unpack_lanes: for (int lane = 0; lane < DDR_PACK; lane++) {
+                        #pragma HLS UNROLL
+                        int input_w = word * DDR_PACK + lane - row_base;
+                        if (input_w >= first_w && input_w < last_w) {
+                            row_buffer[input_w - tile_w] = ddr_get_lane(bits, lane);
+                        }
+                    }
+                }
+            }
+
+            // Now transfer from row buffer to input buffer
+            transfer_row: for (int w = 0; w < INPUT_TILE_WIDTH; w++) {
+                #pragma HLS PIPELINE II=1
+                input_buffer[n][h][w] = row_buffer[w];
+            }
+        }
+    }
+}
+
+// Function to load part of an input tile for the reuse schedule from packed
+// DDR: rows [0, rows) and columns [first_col, cols) of the tile
+void load_input_window(
+    ddr_word_t* input_ddr,
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    int n_offset, int h_offset, int w_offset,
+    int first_col, int rows, int cols,
+    int N, int H, int W, int S, int P) {
+
+    #pragma HLS INLINE off
+
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+
+    // Input columns of the window that lie inside the feature map
+    const int tile_w = w_offset*S - P;
+    const int first_w = (tile_w + first_col < 0) ? 0 : (tile_w + first_col);
+    const int last_w = (tile_w + cols > W) ? W : (tile_w + cols);
+
+    load_window: for (int n = 0; n < n_limit; n++) {
+        for (int h = 0; h < rows; h++) {
+            data_t row_buffer[INPUT_TILE_WIDTH];
+            #pragma HLS ARRAY_PARTITION variable=row_buffer complete
+
+            clear_row: for (int w = 0; w < INPUT_TILE_WIDTH; w++) {
+                #pragma HLS UNROLL
+                row_buffer[w] = 0;
+            }
+
+            int input_h = h + h_offset*S - P;
+            if (input_h >= 0 && input_h < H && first_w < last_w) {
+                int row_base = (n + n_offset) * H * W + input_h * W;
+                int first_word = (row_base + first_w) / DDR_PACK;
+                int last_word = (row_base + last_w - 1) / DDR_PACK;
+
+                load_words: for (int word = first_word; word <= last_word; word++) {
+                    #pragma HLS PIPELINE II=1
+                    ddr_word_t bits = input_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.read_beats++;
+                    axi_traffic.input_beats++;
+#endif
+                    unpack_lanes: for (int lane = 0; lane < DDR_PACK; lane++) {
+                        #pragma HLS UNROLL
+                        int input_w = word * DDR_PACK + lane - row_base;
+                        if (input_w >= first_w && input_w < last_w) {
+                            row_buffer[input_w - tile_w] = ddr_get_lane(bits, lane);
+                        }
+                    }
+                }
+            }
+
+            transfer_row: for (int w = first_col; w < cols; w++) {
+                #pragma HLS PIPELINE II=1
+                input_buffer[n][h][w] = row_buffer[w];
+            }
+        }
+    }
+}
+
+// Function to load weights from packed DDR to on-chip buffer
+void load_weight_tile(
+    ddr_word_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int m_offset, int n_offset,
+    int M, int N, int K) {
+
+    #pragma HLS INLINE off
+
+    // Pre-compute limits
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+    const int K2 = K*K;
+    const int count = n_limit * K2;
+
+    // Initialize all weights to zero
+    clear_weights: for (int m = 0; m < TM; m++) {
+        for (int n = 0; n < TN; n++) {
+            #pragma HLS PIPELINE II=1
+            for (int k = 0; k < MAX_KERNEL_SIZE*MAX_KERNEL_SIZE; k++) {
+                weight_buffer[m][n][k] = 0;
+            }
+        }
+    }
+
+    // For one output channel the n_limit kernels of the tile are contiguous in
+    // the [M][N][K*K] layout, so they are read as a single run of words
+    load_weights_m: for (int m = 0; m < m_limit; m++) {
+        weight_t kernel_buffer[TN*MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+        #pragma HLS ARRAY_PARTITION variable=kernel_buffer cyclic factor=DDR_PACK
+
+        int base = (m + m_offset) * N * K2 + n_offset * K2;
+        int first_word = base / DDR_PACK;
+        int last_word = (base + count - 1) / DDR_PACK;
+
+        load_words: for (int word = first_word; word <= last_word; word++) {
+            #pragma HLS PIPELINE II=1
+            ddr_word_t bits = weights_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.read_beats++;
+            axi_traffic.weight_beats++;
+#endif
+            unpack_lanes: for (int lane = 0; lane < DDR_PACK; lane++) {
+                #pragma HLS UNROLL
+                int e = word * DDR_PACK + lane - base;
+                if (e >= 0 && e < count) {
+                    kernel_buffer[e] = ddr_get_lane<weight_t>(bits, lane);
+                }
+            }
+        }
+
+        // Scatter the run into weight_buffer[m][n][k]
+        int n = 0;
+        int k = 0;
+        scatter_weights: for (int e = 0; e < count; e++) {
+            #pragma HLS PIPELINE II=1
+            weight_buffer[m][n][k] = kernel_buffer[e];
+            if (++k == K2) {
+                k = 0;
+                n++;
+            }
+        }
+    }
+}
+
+// Function to load a weight tile from tile-major packed DDR weights. The whole
+// m_limit x n_limit x K*K tile is one run of words, read as a single burst.
+void load_weight_tile_tiled(
+    ddr_word_t* weights_ddr,
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int m_offset, int n_offset,
+    int M, int N, int K) {
+
+    #pragma HLS INLINE off
+
+    // Pre-compute limits
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+    const int K2 = K*K;
+    const int count = m_limit * n_limit * K2;
+    const int base = tiled_weight_offset(m_offset, n_offset, M, N, K);
+
+    weight_t tile_buffer[TM*TN*MAX_KERNEL_SIZE*MAX_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=tile_buffer cyclic factor=DDR_PACK
+
+    // Initialize all weights to zero
+    clear_weights: for (int m = 0; m < TM; m++) {
+        for (int n = 0; n < TN; n++) {
+            #pragma HLS PIPELINE II=1
+            for (int k = 0; k < MAX_KERNEL_SIZE*MAX_KERNEL_SIZE; k++) {
+                weight_buffer[m][n][k] = 0;
+            }
+        }
+    }
+
+    int first_word = base / DDR_PACK;
+    int last_word = (base + count - 1) / DDR_PACK;
+
+    load_words: for (int word = first_word; word <= last_word; word++) {
+        #pragma HLS PIPELINE II=1
+        ddr_word_t bits = weights_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.read_beats++;
+        axi_traffic.weight_beats++;
+#endif
+        unpack_lanes: for (int lane = 0; lane < DDR_PACK; lane++) {
+            #pragma HLS UNROLL
+            int e = word * DDR_PACK + lane - base;
+            if (e >= 0 && e < count) {
+                tile_buffer[e] = ddr_get_lane<weight_t>(bits, lane);
+            }
+        }
+    }
+
+    // Scatter the run into weight_buffer[m][n][k]
+    int m = 0;
+    int n = 0;
+    int k = 0;
+    scatter_weights: for (int e = 0; e < count; e++) {
+        #pragma HLS PIPELINE II=1
+        weight_buffer[m][n][k] = tile_buffer[e];
+        if (++k == K2) {
+            k = 0;
+            if (++n == n_limit) {
+                n = 0;
+                m++;
+            }
+        }
+    }
+}
+
+// Function to load bias values from packed DDR to on-chip buffer
+void load_bias(
+    ddr_word_t* bias_ddr,
+    weight_t bias_buffer[TM],
+    int m_offset, int M) {
+
+    #pragma HLS INLINE off
+
+    // Pre-compute limit
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+
+    weight_t bias_row[TM];
+    #pragma HLS ARRAY_PARTITION variable=bias_row complete
+
+    // Clear all bias values first
+    clear_bias: for (int m = 0; m < TM; m++) {
+        #pragma HLS UNROLL
+        bias_row[m] = 0;
+    }
+
+    int first_word = m_offset / DDR_PACK;
+    int last_word = (m_offset + m_limit - 1) / DDR_PACK;
+
+    load_words: for (int word = first_word; word <= last_word; word++) {
+        #pragma HLS PIPELINE II=1
+        ddr_word_t bits = bias_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.read_beats++;
+        axi_traffic.bias_beats++;
+#endif
+        unpack_lanes: for (int lane = 0; lane < DDR_PACK; lane++) {
+            #pragma HLS UNROLL
+            int m = word * DDR_PACK + lane - m_offset;
+            if (m >= 0 && m < m_limit) {
+                bias_row[m] = ddr_get_lane<weight_t>(bits, lane);
+            }
+        }
+    }
+
+    copy_bias: for (int m = 0; m < TM; m++) {
+        #pragma HLS PIPELINE II=1
+        bias_buffer[m] = bias_row[m];
+    }
+}
+
+// Function to store output feature map from on-chip buffer to packed DDR.
+// A tile row rarely starts or ends on a word boundary, and the neighbouring
+// lanes belong to other tiles, so partially covered words are read back and
+// merged before they are written.
+void store_output_block(
+    ddr_word_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
+    int m_offset, int h_offset, int w_offset,
+    int tr_bound, int tc_bound,
+    int M, int R, int C) {
+
+    #pragma HLS INLINE off
+
+    // Pre-compute limits
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    const int r_limit = ((h_offset + tr_bound) > R) ? (R - h_offset) : tr_bound;
+    const int c_limit = ((w_offset + tc_bound) > C) ? (C - w_offset) : tc_bound;
+
+    store_output: for (int m = 0; m < m_limit; m++) {
+        for (int r = 0; r < r_limit; r++) {
+            data_t row_buffer[TC];
+            #pragma HLS ARRAY_PARTITION variable=row_buffer complete
+
+            // Truncate the accumulators to data_t
+            fill_row: for (int c = 0; c < c_limit; c++) {
+                #pragma HLS PIPELINE II=1
+                row_buffer[c] = output_buffer[m][r][c];
+            }
+
+            int base = (m + m_offset) * R * C + (r + h_offset) * C + w_offset;
+            int first_word = base / DDR_PACK;
+            int last_word = (base + c_limit - 1) / DDR_PACK;
+
+            store_words: for (int word = first_word; word <= last_word; word++) {
+                #pragma HLS PIPELINE II=1
+                bool partial = (word * DDR_PACK < base) || (word * DDR_PACK + DDR_PACK > base + c_limit);
+                ddr_word_t bits = 0;
+                if (partial) {
+                    bits = output_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.read_beats++;
+#endif
+                }
+                pack_lanes: for (int lane = 0; lane < DDR_PACK; lane++) {
+                    #pragma HLS UNROLL
+                    int c = word * DDR_PACK + lane - base;
+                    if (c >= 0 && c < c_limit) {
+                        ddr_set_lane(bits, lane, row_buffer[c]);
+                    }
+                }
+                output_ddr[word] = bits;
+#if AXI_TRAFFIC_COUNTERS
+                axi_traffic.write_beats++;
+#endif
+            }
+        }
+    }
+}
+
+// A whole TR x TC tile, clipped to the R x C map
+void store_output_tile(
+    ddr_word_t* output_ddr,
+    acc_t output_buffer[TM][TR][TC],
+    int m_offset, int h_offset, int w_offset,
+    int M, int R, int C) {
+
+    #pragma HLS INLINE
+
+    store_output_block(output_ddr, output_buffer, m_offset, h_offset, w_offset, TR, TC, M, R, C);
+}
+
+// Function to load a chunk of the FC input vectors from packed DDR. A word is
+// read whenever the next element lies in another word than the previous one,
+// so a word shared by two images of a W = 1 input is read once.
+void load_fc_inputs(
+    ddr_word_t* input_ddr,
+    data_t fc_input[FC_INPUT_BUFFER_SIZE],
+    int first_image, int images, int N, int W,
+    int n_offset, int n_count) {
+
+    #pragma HLS INLINE off
+
+    ddr_word_t bits = 0;
+    int word = -1;
+
+    load_fc_images: for (int g = 0; g < images; g++) {
+        int b = (first_image + g) / W;
+        int c = (first_image + g) % W;
+
+        load_fc_features: for (int n = 0; n < n_count; n++) {
+            #pragma HLS PIPELINE II=1
+            int e = (b * N + n_offset + n) * W + c;
+            if (e / DDR_PACK != word) {
+                word = e / DDR_PACK;
+                bits = input_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+                axi_traffic.read_beats++;
+                axi_traffic.input_beats++;
+#endif
+            }
+            fc_input[g * n_count + n] = ddr_get_lane(bits, e % DDR_PACK);
+        }
+    }
+}
+
+// Function to stream the FC weights of an output channel group and a chunk
+// of input features from packed DDR, one element per cycle and one word read
+// at the start of every run and every DDR_PACK elements
+void stream_fc_weights(
+    ddr_word_t* weights_ddr,
+    hls::stream<weight_t>& weights,
+    int m_offset, int tm_bound, int N,
+    int n_offset, int n_count, bool tiled) {
+
+    #pragma HLS INLINE off
+
+    const bool one_run = tiled || n_count == N;
+    const int rows = one_run ? 1 : tm_bound;
+    const int run = one_run ? tm_bound * n_count : n_count;
+    const int base = m_offset * N + (tiled ? tm_bound * n_offset : n_offset);
+    ddr_word_t bits = 0;
+
+    stream_fc_rows: for (int r = 0; r < rows; r++) {
+        const int start = base + r * N;
+        stream_fc_weight: for (int e = start; e < start + run; e++) {
+            #pragma HLS PIPELINE II=1
+            if (e == start || e % DDR_PACK == 0) {
+                bits = weights_ddr[e / DDR_PACK];
+#if AXI_TRAFFIC_COUNTERS
+                axi_traffic.read_beats++;
+                axi_traffic.weight_beats++;
+#endif
+            }
+            weights.write(ddr_get_lane<weight_t>(bits, e % DDR_PACK));
+        }
+    }
+}
+
+// Function to store FC accumulators to packed DDR. The outputs of an image
+// are written word by word; a word the run of the image does not cover
+// completely (always when W > 1) is read back first.
+void store_fc_outputs(
+    ddr_word_t* output_ddr,
+    acc_t fc_acc[MAX_BATCH][TM],
+    int first_image, int images,
+    int m_offset, int tm_bound, int M, int W) {
+
+    #pragma HLS INLINE off
+
+    store_fc_images: for (int g = 0; g < images; g++) {
+        int b = (first_image + g) / W;
+        int c = (first_image + g) % W;
+        int base = (b * M + m_offset) * W + c;
+        int word = -1;
+        ddr_word_t bits = 0;
+
+        store_fc_features: for (int m = 0; m < tm_bound; m++) {
+            #pragma HLS PIPELINE II=1
+            int e = base + m * W;
+            if (e / DDR_PACK != word) {
+                if (word >= 0) {
+                    output_ddr[word] = bits;
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.write_beats++;
+#endif
+                }
+                word = e / DDR_PACK;
+                bool partial = (W > 1) || (word * DDR_PACK < base) || (word * DDR_PACK + DDR_PACK > base + tm_bound);
+                bits = 0;
+                if (partial) {
+                    bits = output_ddr[word];
+#if AXI_TRAFFIC_COUNTERS
+                    axi_traffic.read_beats++;
+#endif
+                }
+            }
+            ddr_set_lane(bits, e % DDR_PACK, data_t(fc_acc[g][m]));
+        }
+
+        output_ddr[word] = bits;
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.write_beats++;
+#endif
+    }
+}
@@ -0,0 +1,30 @@
+#include "ddr_packer.h"
+
+int ddr_packed_words(int count) {
+    return (count + DDR_PACK - 1) / DDR_PACK;
+}
+
+template <typename T>
+static std::vector<ddr_word_t> pack_elements(const std::vector<T>& values) {
+    std::vector<ddr_word_t> words(ddr_packed_words(static_cast<int>(values.size())), ddr_word_t(0));
+    for (size_t i = 0; i < values.size(); i++) {
+        ddr_set_lane(words[i / DDR_PACK], i % DDR_PACK, values[i]);
+    }
+    return words;
+}
+
+std::vector<ddr_word_t> ddr_pack(const std::vector<data_t>& values) {
+    return pack_elements(values);
+}
+
+std::vector<ddr_word_t> ddr_pack_weights(const std::vector<weight_t>& values) {
+    return pack_elements(values);
+}
+
+std::vector<data_t> ddr_unpack(const std::vector<ddr_word_t>& words, int count) {
+    std::vector<data_t> values(count);
+    for (int i = 0; i < count; i++) {
+        values[i] = ddr_get_lane(words[i / DDR_PACK], i % DDR_PACK);
+    }
+    return values;
+}
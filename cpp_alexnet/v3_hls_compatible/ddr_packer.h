@@ -0,0 +1,24 @@
+#ifndef DDR_PACKER_H
+#define DDR_PACKER_H
+
+#include <vector>
+#include "cnn_types.h"
+
+// Host-side packing of DDR tensors for fashion_mnist_cnn_accelerator_wide.
+// Element i goes to lane i % DDR_PACK of word i / DDR_PACK; the unused lanes
+// of the last word are zero. The layout of the elements themselves ([C][H][W]
+// activations, [M][N][K*K] weights) is unchanged, so the packed output of one
+// layer is the packed input of the next.
+
+// Number of DDR words holding `count` elements
+int ddr_packed_words(int count);
+
+std::vector<ddr_word_t> ddr_pack(const std::vector<data_t>& values);
+
+// Same for weight and bias tensors
+std::vector<ddr_word_t> ddr_pack_weights(const std::vector<weight_t>& values);
+
+// Unpack the first `count` elements of a packed tensor
+std::vector<data_t> ddr_unpack(const std::vector<ddr_word_t>& words, int count);
+
+#endif // DDR_PACKER_H
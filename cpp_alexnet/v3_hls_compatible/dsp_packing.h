@@ -0,0 +1,82 @@
+#ifndef DSP_PACKING_H
+#define DSP_PACKING_H
+
+#include "cnn_types.h"
+
+// Two signed products that share one operand from a single DSP48E2 multiply
+// (USE_DSP_PACKING=1). The 27-bit A port carries w_hi * 2^DSP_PACK_SHIFT + w_lo
+// and the B port the shared activation a, so the 45-bit product is
+//     p = w_hi * a * 2^DSP_PACK_SHIFT + w_lo * a
+// w_lo * a is the sign-extended low field of p. Its sign extension borrowed 1
+// from the high field when it is negative, which bit DSP_PACK_SHIFT - 1 of p
+// (the sign of the low field) gives back.
+
+#define DSP_PACK_SHIFT 18   // Low field of p: one B port width
+
+// Integer model of the packed multiply for WB-bit weights and AB-bit
+// activations: both products need |w * a| < 2^(DSP_PACK_SHIFT - 1), and the
+// packed weights must fit the 27-bit A port
+template <int WB, int AB>
+inline void dsp_dual_mul(ap_int<WB> w_lo, ap_int<WB> w_hi, ap_int<AB> a,
+    ap_int<WB + AB>& p_lo, ap_int<WB + AB>& p_hi) {
+
+    static_assert(WB + AB <= DSP_PACK_SHIFT - 1 && WB + DSP_PACK_SHIFT <= 27 && AB <= 18,
+        "the products do not fit a DSP48E2 pair");
+
+    #pragma HLS INLINE
+
+    // w_hi * 2^DSP_PACK_SHIFT as a bit placement, then w_lo sign-extended on top
+    ap_int<27 - DSP_PACK_SHIFT> w_hi_bits(w_hi);
+    ap_int<27> w_hi_field;
+    w_hi_field.range(26, DSP_PACK_SHIFT) = w_hi_bits.range(26 - DSP_PACK_SHIFT, 0);
+    ap_int<27> packed(w_hi_field + w_lo);
+    ap_int<45> p = packed * a;
+    #pragma HLS BIND_OP variable=p op=mul impl=dsp
+
+    ap_uint<1> borrow(p.range(DSP_PACK_SHIFT - 1, DSP_PACK_SHIFT - 1));
+    p_lo.range(WB + AB - 1, 0) = p.range(WB + AB - 1, 0);
+    p_hi.range(WB + AB - 1, 0) = p.range(DSP_PACK_SHIFT + WB + AB - 1, DSP_PACK_SHIFT);
+    p_hi = p_hi + borrow;
+}
+
+#if USE_DSP_PACKING
+// Full-precision product of weight_t and data_t, the type of weight * activation
+typedef ap_fixed<WEIGHT_BITS + ACT_BITS, WEIGHT_INT_BITS + ACT_INT_BITS> product_t;
+
+// Fixed-point products from the raw bits: the binary points simply add up
+inline void dsp_dual_mul(weight_t w_lo, weight_t w_hi, data_t a, product_t& p_lo, product_t& p_hi) {
+    #pragma HLS INLINE
+
+    ap_int<WEIGHT_BITS> w_lo_bits, w_hi_bits;
+    ap_int<ACT_BITS> a_bits;
+    w_lo_bits.range(WEIGHT_BITS - 1, 0) = w_lo.range(WEIGHT_BITS - 1, 0);
+    w_hi_bits.range(WEIGHT_BITS - 1, 0) = w_hi.range(WEIGHT_BITS - 1, 0);
+    a_bits.range(ACT_BITS - 1, 0) = a.range(ACT_BITS - 1, 0);
+
+    ap_int<WEIGHT_BITS + ACT_BITS> lo_bits, hi_bits;
+    dsp_dual_mul<WEIGHT_BITS, ACT_BITS>(w_lo_bits, w_hi_bits, a_bits, lo_bits, hi_bits);
+    p_lo.range(WEIGHT_BITS + ACT_BITS - 1, 0) = lo_bits.range(WEIGHT_BITS + ACT_BITS - 1, 0);
+    p_hi.range(WEIGHT_BITS + ACT_BITS - 1, 0) = hi_bits.range(WEIGHT_BITS + ACT_BITS - 1, 0);
+}
+
+// The too_limit (1 or 2) output channels from too_base of one too_batch_loop
+// iteration accumulate weight * activation from one DSP48E2; bit-exact with
+// the two separate multiplies
+inline void dsp_mac_pair(
+    acc_t output_buffer[TM][TR][TC],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int too_base, int too_limit, int tii, int k_idx, int trr, int tcc, data_t activation) {
+
+    #pragma HLS INLINE
+
+    weight_t w_hi = (too_limit == 2) ? weight_buffer[too_base + 1][tii][k_idx] : weight_t(0);
+    product_t p_lo, p_hi;
+    dsp_dual_mul(weight_buffer[too_base][tii][k_idx], w_hi, activation, p_lo, p_hi);
+    output_buffer[too_base][trr][tcc] += p_lo;
+    if (too_limit == 2) {
+        output_buffer[too_base + 1][trr][tcc] += p_hi;
+    }
+}
+#endif
+
+#endif // DSP_PACKING_H
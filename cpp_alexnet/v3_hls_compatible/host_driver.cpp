@@ -0,0 +1,613 @@
+#include "host_driver.h"
+#include "cnn_functions.h"
+#include "compute_units.h"
+#include "perf_model.h"
+#include "weight_layout.h"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+// The accelerator has a single resident store; this is the executor whose
+// weights it currently holds
+static const NetworkExecutor* residentOwner = nullptr;
+
+NetworkExecutor::NetworkExecutor(int in_channels, int in_height, int in_width)
+    : inChannels(in_channels), inHeight(in_height), inWidth(in_width), acceleratePoolFC(false),
+      fusePooling(false), residentWeights(false), residentLoaded(false), layerTable(false), tileMajorWeights(false),
+      parametersLoaded(false),
+      starts(0) {
+}
+
+NetworkExecutor::~NetworkExecutor() {
+    if (residentOwner == this) {
+        residentOwner = nullptr;
+    }
+}
+
+void NetworkExecutor::setAcceleratePoolFC(bool enable) {
+    acceleratePoolFC = enable;
+    residentLoaded = false;
+}
+
+void NetworkExecutor::setFusePooling(bool enable) {
+    fusePooling = enable;
+}
+
+void NetworkExecutor::setResidentWeights(bool enable) {
+    residentWeights = enable;
+}
+
+void NetworkExecutor::setLayerTable(bool enable) {
+    layerTable = enable;
+}
+
+void NetworkExecutor::setTileMajorWeights(bool enable) {
+    tileMajorWeights = enable;
+    parametersLoaded = false;
+}
+
+void NetworkExecutor::setComputeUnits(int count) {
+    if (count < 1) {
+        throw std::invalid_argument("at least one compute unit is needed");
+    }
+    computeUnits.reset(count > 1 ? new ComputeUnitPool(count) : nullptr);
+}
+
+void NetworkExecutor::loadResidentWeights() {
+    int offset = 0;
+    int layer_idx = 0;
+
+    for (HostLayer& layer : layers) {
+        layer.resident = false;
+        if (!runsOnAccelerator(layer)) {
+            continue;
+        }
+        int idx = layer_idx++;
+        if (layer.type == HOST_LAYER_MAXPOOL) {
+            continue;
+        }
+#if USE_LINE_BUFFER_ENGINE
+        // The line-buffer engine reads each weight once per layer anyway, and
+        // its single pass over the input beats the resident tiled path
+        if (line_buffer_fits(layer.config)) {
+            continue;
+        }
+#endif
+
+        int count = static_cast<int>(layer.weights_ddr.size() + layer.bias_ddr.size());
+        if (offset + count > RESIDENT_STORE_SIZE) {
+            continue;
+        }
+
+        // A preload call moves no activations
+        LayerConfig config = layer.config;
+        config.weight_mode = WEIGHTS_PRELOAD;
+        config.resident_offset = offset;
+        fashion_mnist_cnn_accelerator(nullptr, nullptr, layer.weights_ddr.data(), layer.bias_ddr.data(), config, idx);
+
+        layer.config.resident_offset = offset;
+        layer.resident = true;
+        offset += count;
+    }
+
+    residentLoaded = true;
+    residentOwner = this;
+}
+
+int NetworkExecutor::residentLayerCount() const {
+    return static_cast<int>(std::count_if(layers.begin(), layers.end(),
+        [](const HostLayer& layer) { return layer.resident; }));
+}
+
+HostLayer& NetworkExecutor::appendLayer(const std::string& name, HostLayerType type) {
+    HostLayer layer = HostLayer();
+    layer.name = name;
+    layer.type = type;
+    layer.config = default_layer_config();
+
+    // The input shape is the output shape of the previous layer
+    if (layers.empty()) {
+        layer.in_channels = inChannels;
+        layer.in_height = inHeight;
+        layer.in_width = inWidth;
+    }
+    else {
+        layer.in_channels = layers.back().out_channels;
+        layer.in_height = layers.back().out_height;
+        layer.in_width = layers.back().out_width;
+    }
+
+    layers.push_back(layer);
+    residentLoaded = false;
+    parametersLoaded = false;
+    return layers.back();
+}
+
+void NetworkExecutor::addConv(const std::string& name, int out_channels, int kernel_size, int stride, int padding,
+    const std::vector<float>& weights, const std::vector<float>& bias) {
+    if (kernel_size > MAX_KERNEL_SIZE || stride > MAX_STRIDE) {
+        throw std::invalid_argument(name + ": kernel size or stride exceeds MAX_KERNEL_SIZE/MAX_STRIDE of the accelerator");
+    }
+
+    HostLayer& layer = appendLayer(name, HOST_LAYER_CONV);
+    layer.kernel_size = kernel_size;
+    layer.stride = stride;
+    layer.padding = padding;
+    layer.relu = true;
+    layer.out_channels = out_channels;
+    layer.out_height = (layer.in_height + 2 * padding - kernel_size) / stride + 1;
+    layer.out_width = (layer.in_width + 2 * padding - kernel_size) / stride + 1;
+
+    if (weights.size() != static_cast<size_t>(out_channels * layer.in_channels * kernel_size * kernel_size) ||
+        bias.size() != static_cast<size_t>(out_channels)) {
+        throw std::invalid_argument(name + ": weight or bias size does not match the layer shape");
+    }
+
+    layer.config.input_channels = layer.in_channels;
+    layer.config.output_channels = out_channels;
+    layer.config.input_height = layer.in_height;
+    layer.config.input_width = layer.in_width;
+    layer.config.output_height = layer.out_height;
+    layer.config.output_width = layer.out_width;
+    layer.config.kernel_size = kernel_size;
+    layer.config.stride = stride;
+    layer.config.padding = padding;
+    layer.config.layer_type = LAYER_CONV;
+    layer.config.relu_enable = 1;
+    layer.config.reuse_enable = 1;
+
+    // Quantize once so every run() sends the same DDR contents to the accelerator
+    layer.weights_ddr.assign(weights.begin(), weights.end());
+    layer.bias_ddr.assign(bias.begin(), bias.end());
+}
+
+void NetworkExecutor::addMaxPool(const std::string& name, int pool_size, int stride) {
+    HostLayer& layer = appendLayer(name, HOST_LAYER_MAXPOOL);
+    layer.kernel_size = pool_size;
+    layer.stride = stride;
+    layer.out_channels = layer.in_channels;
+    layer.out_height = (layer.in_height - pool_size) / stride + 1;
+    layer.out_width = (layer.in_width - pool_size) / stride + 1;
+
+    layer.config.input_channels = layer.in_channels;
+    layer.config.output_channels = layer.in_channels;
+    layer.config.input_height = layer.in_height;
+    layer.config.input_width = layer.in_width;
+    layer.config.output_height = layer.out_height;
+    layer.config.output_width = layer.out_width;
+    layer.config.kernel_size = pool_size;
+    layer.config.stride = stride;
+    layer.config.padding = 0;
+    layer.config.layer_type = LAYER_MAXPOOL;
+}
+
+void NetworkExecutor::addFC(const std::string& name, int out_features, bool relu,
+    const std::vector<float>& weights, const std::vector<float>& bias) {
+    HostLayer& layer = appendLayer(name, HOST_LAYER_FC);
+    int in_features = layer.in_channels * layer.in_height * layer.in_width;
+    layer.relu = relu;
+    layer.out_channels = out_features;
+    layer.out_height = 1;
+    layer.out_width = 1;
+
+    if (weights.size() != static_cast<size_t>(out_features) * in_features ||
+        bias.size() != static_cast<size_t>(out_features)) {
+        throw std::invalid_argument(name + ": weight or bias size does not match the layer shape");
+    }
+
+    layer.fc_weights = weights;
+    layer.fc_bias = bias;
+
+    // One flattened input vector per image: [batch][in_features], batch_size set per call
+    layer.config.input_channels = in_features;
+    layer.config.output_channels = out_features;
+    layer.config.input_height = 1;
+    layer.config.input_width = 1;
+    layer.config.output_height = 1;
+    layer.config.output_width = 1;
+    layer.config.kernel_size = 1;
+    layer.config.stride = 1;
+    layer.config.padding = 0;
+    layer.config.layer_type = LAYER_FC;
+    layer.config.relu_enable = relu ? 1 : 0;
+    layer.config.reuse_enable = 1;
+
+    layer.weights_ddr.assign(weights.begin(), weights.end());
+    layer.bias_ddr.assign(bias.begin(), bias.end());
+}
+
+bool NetworkExecutor::runsOnAccelerator(const HostLayer& layer) const {
+    if (layer.type == HOST_LAYER_CONV) {
+        return true;
+    }
+    if (!acceleratePoolFC) {
+        return false;
+    }
+    return layer.type == HOST_LAYER_FC || (layer.kernel_size <= MAX_KERNEL_SIZE && layer.stride <= MAX_STRIDE);
+}
+
+bool NetworkExecutor::readsTileMajor(const HostLayer& layer) const {
+    if (!tileMajorWeights || layer.type == HOST_LAYER_MAXPOOL) {
+        return false;
+    }
+#if USE_LINE_BUFFER_ENGINE
+    // The line-buffer engine reads [M][N][K*K] weights
+    if (line_buffer_fits(layer.config)) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+// The pooled tile of a fused layer must fit the TR x TC output tile, and
+// perf_model must predict the fused call to beat the conv and pooling calls:
+// the smaller tiles of a fused call can cost more cycles than the pooling
+// call saves. config is the conv call as it would run unfused.
+bool NetworkExecutor::fusesNextPool(size_t index, const LayerConfig& config) const {
+    if (!fusePooling || layers[index].type != HOST_LAYER_CONV || index + 1 >= layers.size()) {
+        return false;
+    }
+    const HostLayer& pool = layers[index + 1];
+    if (pool.type != HOST_LAYER_MAXPOOL || !runsOnAccelerator(pool) || pool.kernel_size > TR || pool.kernel_size > TC) {
+        return false;
+    }
+
+    PerfModelParams params = perf_default_params();
+    LayerConfig pool_config = pool.config;
+    pool_config.batch_size = config.batch_size;
+    LayerConfig fused = config;
+    fused.pool_size = pool.kernel_size;
+    fused.pool_stride = pool.stride;
+    // Fusing also saves the start (or layer table entry) of the pooling call
+    long long call_cycles = layerTable ? perf_layer_descriptor_cycles(params) : params.start_cycles;
+    long long separate_cycles = perf_estimate_layer(config, params).total_cycles +
+        perf_estimate_layer(pool_config, params).total_cycles + call_cycles;
+    return perf_estimate_layer(fused, params).total_cycles < separate_cycles;
+}
+
+std::vector<float> NetworkExecutor::run(const std::vector<float>& input) {
+    return runBatch(std::vector<std::vector<float>>(1, input)).front();
+}
+
+std::vector<std::vector<float>> NetworkExecutor::runBatch(const std::vector<std::vector<float>>& inputs) {
+    size_t input_size = static_cast<size_t>(inChannels * inHeight * inWidth);
+    if (inputs.empty()) {
+        throw std::invalid_argument("empty batch");
+    }
+    for (const std::vector<float>& input : inputs) {
+        if (input.size() != input_size) {
+            throw std::invalid_argument("input size does not match the network input shape");
+        }
+    }
+    int batch = static_cast<int>(inputs.size());
+
+    // Two DDR-style activation regions of one buffer, large enough for any
+    // layer; image b of a layer with image size n starts at b * n
+    size_t image_size = input_size;
+    for (const HostLayer& layer : layers) {
+        image_size = std::max(image_size, static_cast<size_t>(layer.out_channels * layer.out_height * layer.out_width));
+    }
+    size_t region_size = image_size * batch;
+
+    // The re-layout is done once per layer
+    for (HostLayer& layer : layers) {
+        if (readsTileMajor(layer) && layer.weights_tiled.empty()) {
+            layer.weights_tiled = tile_major_weights(layer.weights_ddr, layer.config.output_channels,
+                layer.config.input_channels, layer.config.kernel_size);
+        }
+    }
+
+    std::vector<data_t> host_buffer;
+    data_t* buffer;
+    if (layerTable) {
+        // The layer table addresses the activations and the weights of every
+        // layer in two DDR buffers; the weights are copied once
+        if (!parametersLoaded) {
+            table = LayerTableBuilder();
+            for (HostLayer& layer : layers) {
+                layer.weight_offset = table.addParameters(readsTileMajor(layer) ? layer.weights_tiled : layer.weights_ddr);
+                layer.bias_offset = table.addParameters(layer.bias_ddr);
+            }
+            parametersLoaded = true;
+        }
+        table.clearActivations();
+        table.clearLayers();
+        table.addActivations(2 * region_size);
+        buffer = table.activations().data();
+    }
+    else {
+        host_buffer.resize(2 * region_size);
+        buffer = host_buffer.data();
+    }
+    data_t* current = buffer;
+    data_t* next = buffer + region_size;
+
+    for (int b = 0; b < batch; b++) {
+        std::copy(inputs[b].begin(), inputs[b].end(), current + b * input_size);
+    }
+
+    if (residentWeights && (!residentLoaded || residentOwner != this)) {
+        loadResidentWeights();
+    }
+
+    timings.clear();
+    starts = 0;
+    int layer_idx = 0;
+    PerfModelParams params = perf_default_params();
+    const double start_ms = perf_cycles_to_ms(params.start_cycles);
+    const double descriptor_ms = perf_cycles_to_ms(perf_layer_descriptor_cycles(params));
+
+    bool pooled = false;
+
+    // Layers of the pending layer table start at timings[table_first]
+    size_t table_first = 0;
+    auto runTable = [&]() {
+        if (table.layers().empty()) {
+            return;
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        table.run();
+        auto end = std::chrono::high_resolution_clock::now();
+        timings[table_first].run_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        timings[table_first].predicted_ms += start_ms;
+        table.clearLayers();
+        starts++;
+    };
+
+    for (size_t i = 0; i < layers.size(); i++) {
+        HostLayer& layer = layers[i];
+        HostLayerTiming timing;
+        timing.name = layer.name;
+        timing.on_accelerator = runsOnAccelerator(layer);
+        timing.fused = pooled;
+        timing.predicted_ms = 0.0;
+        timing.dense_macs = 0;
+        timing.skipped_macs = 0;
+        timing.gated_macs = 0;
+        timing.compute_units = timing.on_accelerator ? 1 : 0;
+
+        // The previous call already wrote the pooled map
+        if (pooled) {
+            timing.run_ms = 0.0;
+            timings.push_back(timing);
+            pooled = false;
+            continue;
+        }
+
+        int in_size = layer.in_channels * layer.in_height * layer.in_width;
+
+        // The host reads the activations: the pending layer table runs first
+        if (!timing.on_accelerator) {
+            runTable();
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        if (timing.on_accelerator) {
+            // Resident layers get no weight pointers: the call must not need them
+            bool resident = residentWeights && layer.resident;
+            bool tiled = !resident && readsTileMajor(layer);
+            LayerConfig config = layer.config;
+            if (tiled) {
+                config.weight_layout = WEIGHT_LAYOUT_TILED;
+            }
+            config.batch_size = batch;
+            if (resident) {
+                config.weight_mode = WEIGHTS_RESIDENT;
+            }
+            if (fusesNextPool(i, config)) {
+                config.pool_size = layers[i + 1].kernel_size;
+                config.pool_stride = layers[i + 1].stride;
+                pooled = true;
+            }
+            if (layerTable) {
+                // Runs with the rest of the table
+                if (table.layers().empty()) {
+                    table_first = timings.size();
+                }
+                table.addLayer(config, static_cast<int>(current - buffer), static_cast<int>(next - buffer),
+                    layer.weight_offset, layer.bias_offset);
+                layer_idx++;
+                timing.predicted_ms = perf_cycles_to_ms(perf_estimate_layer(config, params).total_cycles) + descriptor_ms;
+                timing.run_ms = 0.0;
+                timings.push_back(timing);
+                std::swap(current, next);
+                continue;
+            }
+
+            if (computeUnits && !resident && layer.type != HOST_LAYER_MAXPOOL) {
+                runOnComputeUnits(config, current, next,
+                    tiled ? layer.weights_tiled.data() : layer.weights_ddr.data(),
+                    layer.bias_ddr.data(), layer_idx++, timing);
+                starts += timing.compute_units;
+                auto end = std::chrono::high_resolution_clock::now();
+                timing.run_ms = std::chrono::duration<double, std::milli>(end - start).count();
+                timings.push_back(timing);
+                std::swap(current, next);
+                continue;
+            }
+
+            ZeroSkipCounters before = zero_skip_counters;
+            fashion_mnist_cnn_accelerator(
+                current,
+                next,
+                resident ? nullptr : (tiled ? layer.weights_tiled.data() : layer.weights_ddr.data()),
+                resident ? nullptr : layer.bias_ddr.data(),
+                config,
+                layer_idx++);
+            starts++;
+
+            // The zero-skip engine is modelled with the slots it issued in this call
+            long long slots = zero_skip_counters.pixel_slots - before.pixel_slots;
+            long long skipped = zero_skip_counters.skipped_slots - before.skipped_slots;
+            timing.dense_macs = zero_skip_counters.dense_macs - before.dense_macs;
+            timing.skipped_macs = zero_skip_counters.skipped_macs - before.skipped_macs;
+            timing.gated_macs = zero_skip_counters.gated_macs - before.gated_macs;
+            PerfModelParams call_params = params;
+            call_params.issued_slots = (slots > 0) ? 1.0 - static_cast<double>(skipped) / slots : 1.0;
+            timing.predicted_ms = perf_cycles_to_ms(perf_estimate_layer(config, call_params).total_cycles) + start_ms;
+        }
+        else {
+            size_t out_size = static_cast<size_t>(layer.out_channels * layer.out_height * layer.out_width);
+            for (int b = 0; b < batch; b++) {
+                if (layer.type == HOST_LAYER_MAXPOOL) {
+                    runMaxPool(layer, current + b * in_size, next + b * out_size);
+                }
+                else {
+                    runFC(layer, current + b * in_size, next + b * out_size);
+                }
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        timing.run_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        timings.push_back(timing);
+
+        std::swap(current, next);
+    }
+
+    runTable();
+
+    const HostLayer& last = layers.back();
+    size_t output_size = static_cast<size_t>(last.out_channels * last.out_height * last.out_width);
+    std::vector<std::vector<float>> outputs(batch, std::vector<float>(output_size));
+    for (int b = 0; b < batch; b++) {
+        for (size_t i = 0; i < output_size; i++) {
+            outputs[b][i] = current[b * output_size + i].to_float();
+        }
+    }
+    return outputs;
+}
+
+void NetworkExecutor::runOnComputeUnits(const LayerConfig& config, data_t* input, data_t* output,
+    weight_t* weights, weight_t* bias, int layer_idx, HostLayerTiming& timing) {
+    PerfModelParams params = perf_default_params();
+    std::vector<ComputeUnitSlice> slices = plan_output_channel_split(config, computeUnits->size(), params);
+    int cus = static_cast<int>(slices.size());
+
+    // [batch][M][plane] in DDR: with one image the slice of a CU
+    // is one contiguous block of the output, otherwise every CU writes its own
+    // [batch][m_count][plane] buffer and the host gathers them
+    const int M = config.output_channels;
+    const int batch = config.batch_size;
+    const size_t plane = static_cast<size_t>(fused_pool_extent(config.output_height, config.pool_size, config.pool_stride)) *
+        fused_pool_extent(config.output_width, config.pool_size, config.pool_stride);
+    const size_t kernel = static_cast<size_t>(config.input_channels) * config.kernel_size * config.kernel_size;
+    std::vector<std::vector<data_t>> slice_outputs(cus);
+    std::vector<ZeroSkipCounters> counters(cus);
+
+    std::vector<std::function<void()>> jobs(cus);
+    for (int cu = 0; cu < cus; cu++) {
+        const ComputeUnitSlice& slice = slices[cu];
+        data_t* slice_output = output + slice.m_offset * plane;
+        if (batch > 1) {
+            slice_outputs[cu].resize(batch * slice.m_count * plane);
+            slice_output = slice_outputs[cu].data();
+        }
+        jobs[cu] = [&, cu, slice_output]() {
+            LayerConfig slice_config = config;
+            slice_config.output_channels = slices[cu].m_count;
+            ZeroSkipCounters before = zero_skip_counters;
+            fashion_mnist_cnn_accelerator(
+                input,
+                slice_output,
+                weights + slices[cu].m_offset * kernel,
+                bias + slices[cu].m_offset,
+                slice_config,
+                layer_idx);
+            counters[cu].pixel_slots = zero_skip_counters.pixel_slots - before.pixel_slots;
+            counters[cu].skipped_slots = zero_skip_counters.skipped_slots - before.skipped_slots;
+            counters[cu].dense_macs = zero_skip_counters.dense_macs - before.dense_macs;
+            counters[cu].skipped_macs = zero_skip_counters.skipped_macs - before.skipped_macs;
+            counters[cu].gated_macs = zero_skip_counters.gated_macs - before.gated_macs;
+        };
+    }
+    computeUnits->run(jobs);
+
+    if (batch > 1) {
+        for (int cu = 0; cu < cus; cu++) {
+            size_t slice_size = slices[cu].m_count * plane;
+            for (int b = 0; b < batch; b++) {
+                std::copy(slice_outputs[cu].begin() + b * slice_size, slice_outputs[cu].begin() + (b + 1) * slice_size,
+                    output + (static_cast<size_t>(b) * M + slices[cu].m_offset) * plane);
+            }
+        }
+    }
+
+    // The CUs run concurrently after the host has started them one by one
+    double slowest_ms = 0.0;
+    for (int cu = 0; cu < cus; cu++) {
+        timing.dense_macs += counters[cu].dense_macs;
+        timing.skipped_macs += counters[cu].skipped_macs;
+        timing.gated_macs += counters[cu].gated_macs;
+        PerfModelParams call_params = params;
+        long long slots = counters[cu].pixel_slots;
+        call_params.issued_slots = (slots > 0) ? 1.0 - static_cast<double>(counters[cu].skipped_slots) / slots : 1.0;
+        LayerConfig slice_config = config;
+        slice_config.output_channels = slices[cu].m_count;
+        slowest_ms = std::max(slowest_ms, perf_cycles_to_ms(perf_estimate_layer(slice_config, call_params).total_cycles));
+    }
+    timing.predicted_ms = slowest_ms + cus * perf_cycles_to_ms(params.start_cycles);
+    timing.compute_units = cus;
+}
+
+void NetworkExecutor::runMaxPool(const HostLayer& layer, const data_t* input, data_t* output) const {
+    for (int c = 0; c < layer.out_channels; c++) {
+        for (int row = 0; row < layer.out_height; row++) {
+            for (int col = 0; col < layer.out_width; col++) {
+                data_t max_val = input[(c * layer.in_height + row * layer.stride) * layer.in_width + col * layer.stride];
+                for (int i = 0; i < layer.kernel_size; i++) {
+                    for (int j = 0; j < layer.kernel_size; j++) {
+                        int h = row * layer.stride + i;
+                        int w = col * layer.stride + j;
+                        data_t value = input[(c * layer.in_height + h) * layer.in_width + w];
+                        if (value > max_val) {
+                            max_val = value;
+                        }
+                    }
+                }
+                output[(c * layer.out_height + row) * layer.out_width + col] = max_val;
+            }
+        }
+    }
+}
+
+void NetworkExecutor::runFC(const HostLayer& layer, const data_t* input, data_t* output) const {
+    int in_features = layer.in_channels * layer.in_height * layer.in_width;
+
+    std::vector<float> input_float(in_features);
+    for (int j = 0; j < in_features; j++) {
+        input_float[j] = input[j].to_float();
+    }
+
+    for (int i = 0; i < layer.out_channels; i++) {
+        float sum = layer.fc_bias[i];
+        const float* row = &layer.fc_weights[static_cast<size_t>(i) * in_features];
+        for (int j = 0; j < in_features; j++) {
+            sum += row[j] * input_float[j];
+        }
+        if (layer.relu) {
+            sum = std::max(0.0f, sum);
+        }
+        output[i] = data_t(sum);
+    }
+}
+
+const std::vector<HostLayer>& NetworkExecutor::getLayers() const {
+    return layers;
+}
+
+const std::vector<HostLayerTiming>& NetworkExecutor::getTimings() const {
+    return timings;
+}
+
+int NetworkExecutor::acceleratorStarts() const {
+    return starts;
+}
+
+double NetworkExecutor::predictedTotalMs() const {
+    double total = 0.0;
+    for (const HostLayerTiming& timing : timings) {
+        total += timing.on_accelerator ? timing.predicted_ms : timing.run_ms;
+    }
+    return total;
+}
@@ -0,0 +1,175 @@
+#ifndef HOST_DRIVER_H
+#define HOST_DRIVER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "cnn_types.h"
+#include "layer_table.h"
+
+class ComputeUnitPool;
+
+// Host-side executor that runs a whole network through fashion_mnist_cnn_accelerator.
+// Every layer is one accelerator call: conv layers (with ReLU) as LAYER_CONV,
+// max-pooling as LAYER_MAXPOOL and fully-connected layers as LAYER_FC.
+// runBatch() passes all images of a batch to every call (LayerConfig.batch_size),
+// so weights fetched by the accelerator serve the whole batch. Pooling and
+// FC layers run on the host unless setAcceleratePoolFC(true) is set, and
+// pooling windows beyond MAX_KERNEL_SIZE/MAX_STRIDE always do.
+// Activations stay in data_t buffers laid out like the DDR buffers of the
+// accelerator ([B][C][H][W]); a [C][H][W] image is also the flattened FC input.
+// With setResidentWeights(true) the conv and FC weights are preloaded into the
+// persistent store of the accelerator once, and every image then only moves
+// activations. With setFusePooling(true) a conv layer followed by a max-pooling
+// layer on the accelerator is one call that writes only the pooled map, where
+// perf_model predicts that call to be faster.
+// With setLayerTable(true) consecutive accelerator layers are entries of one
+// layer table, and fashion_mnist_cnn_accelerator_network runs them with a
+// single start; the host only steps in for host layers.
+// With setTileMajorWeights(true) conv and FC layers read tile-major weights
+// (weight_layout.h), one DDR burst per weight tile.
+// With setComputeUnits(n) the conv and FC calls are split along their output
+// channels across n accelerator instances (compute_units.h), host threads in
+// C simulation.
+
+enum HostLayerType {
+    HOST_LAYER_CONV,
+    HOST_LAYER_MAXPOOL,
+    HOST_LAYER_FC
+};
+
+struct HostLayer {
+    std::string name;
+    HostLayerType type;
+
+    // Input and output shape, filled in when the layer is added
+    int in_channels, in_height, in_width;
+    int out_channels, out_height, out_width;
+
+    // Conv and max-pool window
+    int kernel_size;
+    int stride;
+    int padding;
+
+    bool relu;                        // FC only, conv layers always apply ReLU
+    LayerConfig config;               // Passed to the accelerator
+    bool resident;                    // Weights preloaded into the resident store
+    int weight_offset, bias_offset;   // Parameter buffer offsets of the layer table
+    std::vector<weight_t> weights_ddr; // Conv weights [M][N][K*K] or FC weights [out][in] in weight_t
+    std::vector<weight_t> weights_tiled; // Tile-major copy of weights_ddr (setTileMajorWeights)
+    std::vector<weight_t> bias_ddr;
+    std::vector<float> fc_weights;    // FC weights [out][in], input flattened as [C][H][W] (host path)
+    std::vector<float> fc_bias;
+};
+
+struct HostLayerTiming {
+    std::string name;
+    bool on_accelerator;
+    bool fused;           // Max-pooling done by the call of the preceding conv layer
+    double run_ms;        // Wall time of the accelerator C simulation or of the host code
+                          // (of a whole layer table start on its first layer)
+    double predicted_ms;  // perf_model estimate of the accelerator call, with the host
+                          // round trip of a start (layer table: descriptor read)
+
+    // zero_skip_counters of the call (USE_ZERO_SKIP_ENGINE=1 without the
+    // layer table, 0 otherwise)
+    long long dense_macs;
+    long long skipped_macs;
+    long long gated_macs;
+
+    int compute_units;    // Accelerator instances the call was split across
+};
+
+class NetworkExecutor {
+public:
+    NetworkExecutor(int in_channels, int in_height, int in_width);
+    ~NetworkExecutor();
+
+    // Conv weights are [out][in][K*K] (the layout of the weights_ddr port)
+    void addConv(const std::string& name, int out_channels, int kernel_size, int stride, int padding,
+        const std::vector<float>& weights, const std::vector<float>& bias);
+    void addMaxPool(const std::string& name, int pool_size, int stride);
+    // FC weights are [out][in] with the input flattened as [C][H][W]
+    void addFC(const std::string& name, int out_features, bool relu,
+        const std::vector<float>& weights, const std::vector<float>& bias);
+
+    // Run pooling and FC layers on the accelerator or on the host (default),
+    // where perf_model predicts them to be faster
+    void setAcceleratePoolFC(bool enable);
+
+    // Fuse max-pooling layers that run on the accelerator into the call of the
+    // conv layer before it (LayerConfig.pool_size) where perf_model predicts
+    // the fused call to be faster; off by default
+    void setFusePooling(bool enable);
+
+    // Two-phase weight protocol: one WEIGHTS_PRELOAD call per conv/FC layer
+    // fills the resident store (on the first run(), or explicitly with
+    // loadResidentWeights()), then every run() uses WEIGHTS_RESIDENT calls that
+    // do not touch the weight ports. Layers beyond RESIDENT_STORE_SIZE, in
+    // network order, keep reading their weights from DDR, as do the layers of
+    // the line-buffer engine.
+    void setResidentWeights(bool enable);
+
+    // Run consecutive accelerator layers with one start of
+    // fashion_mnist_cnn_accelerator_network; off by default
+    void setLayerTable(bool enable);
+
+    // Pass the conv and FC weights in the tile-major layout (WEIGHT_LAYOUT_TILED);
+    // off by default. Resident layers and the layers of the line-buffer engine
+    // keep the [M][N][K*K] layout.
+    void setTileMajorWeights(bool enable);
+
+    // Split every conv and FC call across count compute units, each with the
+    // weights and biases of its own output channels (plan_output_channel_split);
+    // 1, the default, drives a single instance. Resident layers and layer
+    // tables stay on the calling thread, which is the instance that holds the
+    // resident store.
+    void setComputeUnits(int count);
+
+    void loadResidentWeights();
+    int residentLayerCount() const;
+
+    // Run the network on a [C][H][W] input and return the output of the last layer
+    std::vector<float> run(const std::vector<float>& input);
+
+    // Run the network on a batch of [C][H][W] inputs with one accelerator call
+    // per layer for the whole batch; returns one output per input
+    std::vector<std::vector<float>> runBatch(const std::vector<std::vector<float>>& inputs);
+
+    const std::vector<HostLayer>& getLayers() const;
+    const std::vector<HostLayerTiming>& getTimings() const;
+
+    // Sum of the predicted accelerator latency and the measured host time of
+    // the last run() or runBatch() (all images of the batch)
+    double predictedTotalMs() const;
+
+    // Accelerator starts of the last run() or runBatch()
+    int acceleratorStarts() const;
+
+private:
+    // One image each
+    void runMaxPool(const HostLayer& layer, const data_t* input, data_t* output) const;
+    void runFC(const HostLayer& layer, const data_t* input, data_t* output) const;
+    HostLayer& appendLayer(const std::string& name, HostLayerType type);
+    bool runsOnAccelerator(const HostLayer& layer) const;
+    bool fusesNextPool(size_t index, const LayerConfig& config) const;
+    bool readsTileMajor(const HostLayer& layer) const;
+    void runOnComputeUnits(const LayerConfig& config, data_t* input, data_t* output,
+        weight_t* weights, weight_t* bias, int layer_idx, HostLayerTiming& timing);
+
+    int inChannels, inHeight, inWidth;
+    bool acceleratePoolFC;
+    bool fusePooling;
+    bool residentWeights;
+    bool residentLoaded;
+    bool layerTable;
+    bool tileMajorWeights;
+    bool parametersLoaded;     // Weights of every layer in table's parameter buffer
+    LayerTableBuilder table;
+    std::shared_ptr<ComputeUnitPool> computeUnits; // Null for a single instance
+    int starts;
+    std::vector<HostLayer> layers;
+    std::vector<HostLayerTiming> timings;
+};
+
+#endif // HOST_DRIVER_H
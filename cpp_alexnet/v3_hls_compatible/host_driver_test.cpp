@@ -0,0 +1,781 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ConvolutionalLayer.h"
+#include "FullyConnectedLayer.h"
+#include "MaxPoolingLayer.h"
+#include "Tensor3D.h"
+#include "cnn_functions.h"
+#include "host_driver.h"
+#include "perf_model.h"
+
+/**
+ * Runs whole networks through NetworkExecutor, once with every layer on the
+ * v3 accelerator and once with pooling/FC on the host. The output must match
+ * a data_t model of the network bit for bit and predict the class of the
+ * float v1 layers; the distance to v1 and the per-layer times are reported
+ * next to it. With resident weights the outputs of two images must not
+ * change while the DDR reads per image drop.
+ *
+ *   host_driver_test [fashion_mnist_weights_dir]
+ */
+
+// Float description of one layer, used to build both the executor and the v1 network
+struct LayerSpec {
+    std::string name;
+    HostLayerType type;
+    int outputs;       // Output channels (conv) or features (FC)
+    int kernelSize;    // Conv kernel or pooling window
+    int stride;
+    int padding;
+    bool relu;         // FC only
+    std::vector<float> weights;
+    std::vector<float> bias;
+};
+
+struct NetworkSpec {
+    std::string name;
+    int channels, height, width;
+    std::vector<LayerSpec> layers;
+    std::vector<float> input;
+    int expectedClass;  // -1 if unknown
+};
+
+static LayerSpec convSpec(const std::string& name, int outputs, int kernelSize, int stride, int padding) {
+    return LayerSpec{ name, HOST_LAYER_CONV, outputs, kernelSize, stride, padding, true, {}, {} };
+}
+
+static LayerSpec poolSpec(const std::string& name, int poolSize, int stride) {
+    return LayerSpec{ name, HOST_LAYER_MAXPOOL, 0, poolSize, stride, 0, false, {}, {} };
+}
+
+static LayerSpec fcSpec(const std::string& name, int outputs, bool relu) {
+    return LayerSpec{ name, HOST_LAYER_FC, outputs, 0, 0, 0, relu, {}, {} };
+}
+
+static bool readFloats(const std::string& path, std::vector<float>& data, size_t count) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open " << path << std::endl;
+        return false;
+    }
+    data.resize(count);
+    file.read(reinterpret_cast<char*>(data.data()), count * sizeof(float));
+    return static_cast<size_t>(file.gcount()) == count * sizeof(float);
+}
+
+// Conv weights of cpp_fashion_mnist are stored [h][w][c_in][c_out]; the accelerator wants [c_out][c_in][h][w]
+static std::vector<float> hwioToOihw(const std::vector<float>& hwio, int outputs, int inputs, int kernelSize) {
+    std::vector<float> oihw(hwio.size());
+    for (int o = 0; o < outputs; o++) {
+        for (int i = 0; i < inputs; i++) {
+            for (int h = 0; h < kernelSize; h++) {
+                for (int w = 0; w < kernelSize; w++) {
+                    oihw[((o * inputs + i) * kernelSize + h) * kernelSize + w] =
+                        hwio[((h * kernelSize + w) * inputs + i) * outputs + o];
+                }
+            }
+        }
+    }
+    return oihw;
+}
+
+// FC weights of cpp_fashion_mnist are stored [in][out] with the input flattened as [H][W][C];
+// the executor and v1 want [out][in] with the input flattened as [C][H][W]
+static std::vector<float> fcToOutIn(const std::vector<float>& inOut, int outputs, int channels, int height, int width) {
+    int inputs = channels * height * width;
+    std::vector<float> outIn(inOut.size());
+    for (int o = 0; o < outputs; o++) {
+        for (int c = 0; c < channels; c++) {
+            for (int h = 0; h < height; h++) {
+                for (int w = 0; w < width; w++) {
+                    int hwc = (h * width + w) * channels + c;
+                    outIn[o * inputs + (c * height + h) * width + w] = inOut[hwc * outputs + o];
+                }
+            }
+        }
+    }
+    return outIn;
+}
+
+static bool loadFashionMnist(const std::string& dir, NetworkSpec& net) {
+    net.name = "Fashion-MNIST";
+    net.channels = 1;
+    net.height = 28;
+    net.width = 28;
+    net.expectedClass = 9;  // test_image_real.bin, see test_info.txt
+
+    LayerSpec conv1 = convSpec("conv1", 32, 3, 1, 1);
+    LayerSpec conv2 = convSpec("conv2", 64, 3, 1, 1);
+    LayerSpec fc1 = fcSpec("fc1", 128, true);
+    LayerSpec fc2 = fcSpec("fc2", 10, false);
+    std::vector<float> raw;
+
+    bool ok = readFloats(dir + "/conv1_weights.bin", raw, 3 * 3 * 1 * 32);
+    conv1.weights = hwioToOihw(raw, 32, 1, 3);
+    ok = ok && readFloats(dir + "/conv1_bias.bin", conv1.bias, 32);
+    ok = ok && readFloats(dir + "/conv2_weights.bin", raw, 3 * 3 * 32 * 64);
+    conv2.weights = hwioToOihw(raw, 64, 32, 3);
+    ok = ok && readFloats(dir + "/conv2_bias.bin", conv2.bias, 64);
+    ok = ok && readFloats(dir + "/fc1_weights.bin", raw, 3136 * 128);
+    fc1.weights = fcToOutIn(raw, 128, 64, 7, 7);
+    ok = ok && readFloats(dir + "/fc1_bias.bin", fc1.bias, 128);
+    ok = ok && readFloats(dir + "/fc2_weights.bin", raw, 128 * 10);
+    fc2.weights = fcToOutIn(raw, 10, 128, 1, 1);
+    ok = ok && readFloats(dir + "/fc2_bias.bin", fc2.bias, 10);
+    ok = ok && readFloats(dir + "/test_image_real.bin", net.input, 28 * 28);
+
+    net.layers = { conv1, poolSpec("pool1", 2, 2), conv2, poolSpec("pool2", 2, 2), fc1, fc2 };
+    return ok;
+}
+
+// AlexNet scaled to a 64x64 input and to the K <= 5, S <= 2 limits of the accelerator
+static void makeScaledAlexNet(NetworkSpec& net, unsigned seed) {
+    net.name = "Scaled AlexNet";
+    net.channels = 3;
+    net.height = 64;
+    net.width = 64;
+    net.expectedClass = -1;
+    net.layers = {
+        convSpec("conv1", 32, 5, 2, 2),   // 32x32
+        poolSpec("pool1", 3, 2),          // 15x15
+        convSpec("conv2", 64, 5, 1, 2),   // 15x15
+        poolSpec("pool2", 3, 2),          // 7x7
+        convSpec("conv3", 96, 3, 1, 1),
+        convSpec("conv4", 64, 3, 1, 1),
+        convSpec("conv5", 64, 3, 1, 1),
+        poolSpec("pool5", 3, 2),          // 3x3
+        fcSpec("fc6", 256, true),
+        fcSpec("fc7", 256, true),
+        fcSpec("fc8", 10, false),
+    };
+
+    // Uniform He initialization keeps the activations inside the +/-32 range of
+    // data_t. Weights and biases are rounded to the nearest weight_t step and
+    // pixels to data_t, so v1 and the accelerator start from the same values
+    // and only the activation arithmetic differs. Truncating the weights
+    // instead would lose most of the +/-0.1 weights of conv3-conv5
+    const float weightStep = std::ldexp(1.0f, WEIGHT_INT_BITS - WEIGHT_BITS);
+    std::mt19937 gen(seed);
+    int channels = net.channels, height = net.height, width = net.width;
+    for (LayerSpec& layer : net.layers) {
+        int fanIn = 0;
+        size_t count = 0;
+        if (layer.type == HOST_LAYER_CONV) {
+            fanIn = channels * layer.kernelSize * layer.kernelSize;
+            count = static_cast<size_t>(layer.outputs) * fanIn;
+            height = (height + 2 * layer.padding - layer.kernelSize) / layer.stride + 1;
+            width = (width + 2 * layer.padding - layer.kernelSize) / layer.stride + 1;
+            channels = layer.outputs;
+        }
+        else if (layer.type == HOST_LAYER_MAXPOOL) {
+            height = (height - layer.kernelSize) / layer.stride + 1;
+            width = (width - layer.kernelSize) / layer.stride + 1;
+            continue;
+        }
+        else {
+            fanIn = channels * height * width;
+            count = static_cast<size_t>(layer.outputs) * fanIn;
+            channels = layer.outputs;
+            height = 1;
+            width = 1;
+        }
+
+        std::uniform_real_distribution<float> dist(-std::sqrt(6.0f / fanIn), std::sqrt(6.0f / fanIn));
+        layer.weights.resize(count);
+        layer.bias.resize(layer.outputs);
+        for (float& w : layer.weights) w = std::round(dist(gen) / weightStep) * weightStep;
+        for (float& b : layer.bias) b = std::round(0.1f * dist(gen) / weightStep) * weightStep;
+    }
+
+    std::uniform_real_distribution<float> pixel(0.0f, 1.0f);
+    net.input.resize(net.channels * net.height * net.width);
+    for (float& value : net.input) value = static_cast<float>(data_t(pixel(gen)));
+}
+
+// Every layer runs on the accelerator, so the feature tests cover pool and FC calls
+static NetworkExecutor buildExecutor(const NetworkSpec& net) {
+    NetworkExecutor executor(net.channels, net.height, net.width);
+    executor.setAcceleratePoolFC(true);
+    for (const LayerSpec& layer : net.layers) {
+        if (layer.type == HOST_LAYER_CONV) {
+            executor.addConv(layer.name, layer.outputs, layer.kernelSize, layer.stride, layer.padding, layer.weights, layer.bias);
+        }
+        else if (layer.type == HOST_LAYER_MAXPOOL) {
+            executor.addMaxPool(layer.name, layer.kernelSize, layer.stride);
+        }
+        else {
+            executor.addFC(layer.name, layer.outputs, layer.relu, layer.weights, layer.bias);
+        }
+    }
+    return executor;
+}
+
+static std::vector<std::unique_ptr<Layer>> buildV1Network(const NetworkSpec& net) {
+    std::vector<std::unique_ptr<Layer>> layers;
+    int channels = net.channels, height = net.height, width = net.width;
+
+    for (const LayerSpec& layer : net.layers) {
+        if (layer.type == HOST_LAYER_CONV) {
+            auto conv = std::make_unique<ConvolutionalLayer>(layer.name, channels, layer.outputs, layer.kernelSize, layer.stride, layer.padding);
+            conv->setWeights(layer.weights, layer.bias);
+            layers.push_back(std::move(conv));
+            height = (height + 2 * layer.padding - layer.kernelSize) / layer.stride + 1;
+            width = (width + 2 * layer.padding - layer.kernelSize) / layer.stride + 1;
+            channels = layer.outputs;
+        }
+        else if (layer.type == HOST_LAYER_MAXPOOL) {
+            layers.push_back(std::make_unique<MaxPoolingLayer>(layer.name, layer.kernelSize, layer.stride));
+            height = (height - layer.kernelSize) / layer.stride + 1;
+            width = (width - layer.kernelSize) / layer.stride + 1;
+        }
+        else {
+            // v1 FullyConnectedLayer applies ReLU to every layer except the one named fc8
+            std::string name = layer.relu ? layer.name : "fc8";
+            auto fc = std::make_unique<FullyConnectedLayer>(name, channels * height * width, layer.outputs);
+            fc->setWeights(layer.weights, layer.bias);
+            layers.push_back(std::move(fc));
+            channels = layer.outputs;
+            height = 1;
+            width = 1;
+        }
+    }
+    return layers;
+}
+
+// Bit-exact data_t model of the executor: conv accumulates weight_t * data_t
+// products in acc_t like conv2d_reference in cnn_top_test.cpp, pooling/FC match
+// the host code. FC layers accumulate in acc_t on the accelerator and in float
+// on the host.
+static std::vector<float> runFixedReference(const NetworkSpec& net, bool acceleratePoolFC) {
+    int channels = net.channels, height = net.height, width = net.width;
+    std::vector<data_t> current(net.input.begin(), net.input.end());
+
+    for (const LayerSpec& layer : net.layers) {
+        std::vector<data_t> next;
+        if (layer.type == HOST_LAYER_CONV) {
+            int K = layer.kernelSize, S = layer.stride, P = layer.padding;
+            int outHeight = (height + 2 * P - K) / S + 1;
+            int outWidth = (width + 2 * P - K) / S + 1;
+            next.resize(layer.outputs * outHeight * outWidth);
+            for (int m = 0; m < layer.outputs; m++) {
+                for (int r = 0; r < outHeight; r++) {
+                    for (int c = 0; c < outWidth; c++) {
+                        acc_t acc = weight_t(layer.bias[m]);
+                        for (int n = 0; n < channels; n++) {
+                            for (int i = 0; i < K; i++) {
+                                for (int j = 0; j < K; j++) {
+                                    int h = r * S + i - P;
+                                    int w = c * S + j - P;
+                                    if (h >= 0 && h < height && w >= 0 && w < width) {
+                                        acc += weight_t(layer.weights[((m * channels + n) * K + i) * K + j]) * current[(n * height + h) * width + w];
+                                    }
+                                }
+                            }
+                        }
+                        next[(m * outHeight + r) * outWidth + c] = (acc < 0) ? data_t(0) : data_t(acc);
+                    }
+                }
+            }
+            channels = layer.outputs;
+            height = outHeight;
+            width = outWidth;
+        }
+        else if (layer.type == HOST_LAYER_MAXPOOL) {
+            int outHeight = (height - layer.kernelSize) / layer.stride + 1;
+            int outWidth = (width - layer.kernelSize) / layer.stride + 1;
+            next.resize(channels * outHeight * outWidth);
+            for (int c = 0; c < channels; c++) {
+                for (int r = 0; r < outHeight; r++) {
+                    for (int col = 0; col < outWidth; col++) {
+                        data_t maxVal = current[(c * height + r * layer.stride) * width + col * layer.stride];
+                        for (int i = 0; i < layer.kernelSize; i++) {
+                            for (int j = 0; j < layer.kernelSize; j++) {
+                                data_t value = current[(c * height + r * layer.stride + i) * width + col * layer.stride + j];
+                                maxVal = (value > maxVal) ? value : maxVal;
+                            }
+                        }
+                        next[(c * outHeight + r) * outWidth + col] = maxVal;
+                    }
+                }
+            }
+            height = outHeight;
+            width = outWidth;
+        }
+        else {
+            int inputs = channels * height * width;
+            next.resize(layer.outputs);
+            for (int o = 0; o < layer.outputs && acceleratePoolFC; o++) {
+                acc_t acc = weight_t(layer.bias[o]);
+                for (int i = 0; i < inputs; i++) {
+                    acc += weight_t(layer.weights[static_cast<size_t>(o) * inputs + i]) * current[i];
+                }
+                next[o] = (layer.relu && acc < 0) ? data_t(0) : data_t(acc);
+            }
+            for (int o = 0; o < layer.outputs && !acceleratePoolFC; o++) {
+                float sum = layer.bias[o];
+                for (int i = 0; i < inputs; i++) {
+                    sum += layer.weights[static_cast<size_t>(o) * inputs + i] * current[i].to_float();
+                }
+                next[o] = data_t(layer.relu ? std::max(0.0f, sum) : sum);
+            }
+            channels = layer.outputs;
+            height = 1;
+            width = 1;
+        }
+        current.swap(next);
+    }
+
+    std::vector<float> output(current.size());
+    for (size_t i = 0; i < current.size(); i++) {
+        output[i] = current[i].to_float();
+    }
+    return output;
+}
+
+static int argmax(const std::vector<float>& values) {
+    int best = 0;
+    for (size_t i = 1; i < values.size(); i++) {
+        if (values[i] > values[best]) {
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+static bool testNetwork(const NetworkSpec& net, bool acceleratePoolFC) {
+    std::cout << "\n=== " << net.name << (acceleratePoolFC ? " (all layers on the accelerator)" : " (pool/FC on the host)")
+              << " ===" << std::endl;
+
+    NetworkExecutor executor = buildExecutor(net);
+    executor.setAcceleratePoolFC(acceleratePoolFC);
+    std::vector<float> output = executor.run(net.input);
+
+    // Float v1 reference, timed per layer
+    std::vector<std::unique_ptr<Layer>> v1Layers = buildV1Network(net);
+    Tensor3D current(net.channels, net.height, net.width);
+    current.getData() = net.input;
+    std::vector<double> v1Ms;
+    for (auto& layer : v1Layers) {
+        auto start = std::chrono::high_resolution_clock::now();
+        current = layer->forward(current);
+        auto end = std::chrono::high_resolution_clock::now();
+        v1Ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    const std::vector<float>& reference = current.getData();
+
+    std::printf("%-8s %-6s %10s %14s %10s\n", "layer", "where", "run (ms)", "predicted (ms)", "v1 (ms)");
+    double runTotal = 0.0, v1Total = 0.0;
+    const std::vector<HostLayerTiming>& timings = executor.getTimings();
+    for (size_t i = 0; i < timings.size(); i++) {
+        const HostLayerTiming& timing = timings[i];
+        if (timing.on_accelerator) {
+            std::printf("%-8s %-6s %10.3f %14.3f %10.3f\n", timing.name.c_str(), "FPGA", timing.run_ms, timing.predicted_ms, v1Ms[i]);
+        }
+        else {
+            std::printf("%-8s %-6s %10.3f %14s %10.3f\n", timing.name.c_str(), "host", timing.run_ms, "-", v1Ms[i]);
+        }
+        runTotal += timing.run_ms;
+        v1Total += v1Ms[i];
+    }
+    std::printf("%-8s %-6s %10.3f %14.3f %10.3f\n", "total", "", runTotal, executor.predictedTotalMs(), v1Total);
+    std::printf("(run = C simulation of the accelerator or host code; predicted = perf_model latency on the FPGA plus host time)\n");
+
+    // The executor must match the data_t model exactly
+    std::vector<float> fixedReference = runFixedReference(net, acceleratePoolFC);
+    bool exact = (output == fixedReference);
+    std::printf("Executor vs data_t reference: %s\n", exact ? "bit-exact" : "MISMATCH");
+
+    // Distance to the float network
+    float maxDiff = 0.0f, maxRef = 0.0f;
+    for (size_t i = 0; i < output.size(); i++) {
+        maxDiff = std::max(maxDiff, std::abs(output[i] - reference[i]));
+        maxRef = std::max(maxRef, std::abs(reference[i]));
+    }
+    int predicted = argmax(output);
+    int expected = argmax(reference);
+    std::printf("Executor vs float v1: max |diff| = %.4f (max |v1| = %.4f), top-1 executor = %d, v1 = %d",
+        maxDiff, maxRef, predicted, expected);
+    if (net.expectedClass >= 0) {
+        std::printf(", label = %d", net.expectedClass);
+    }
+    std::printf("\n");
+
+    // The label check on v1 validates the weight layout conversion, and the
+    // executor must predict the class of v1
+    bool pass = exact && predicted == expected && (net.expectedClass < 0 || expected == net.expectedClass);
+    std::cout << net.name << (pass ? " test PASSED!" : " test FAILED!") << std::endl;
+    return pass;
+}
+
+// Streams the weights of every layer vs. preloads them once into the resident
+// store, for two images
+static bool testResidentWeights(const NetworkSpec& net) {
+    std::cout << "\n=== " << net.name << " (resident weights) ===" << std::endl;
+
+    std::vector<std::vector<float>> images = { net.input, net.input };
+    std::reverse(images[1].begin(), images[1].end());
+
+    NetworkExecutor streaming = buildExecutor(net);
+    std::vector<std::vector<float>> expected;
+    axi_traffic = AxiTrafficCounters();
+    for (const std::vector<float>& image : images) {
+        expected.push_back(streaming.run(image));
+    }
+    long long streamingBeats = axi_traffic.read_beats / static_cast<long long>(images.size());
+
+    NetworkExecutor resident = buildExecutor(net);
+    resident.setResidentWeights(true);
+    axi_traffic = AxiTrafficCounters();
+    resident.loadResidentWeights();
+    long long preloadBeats = axi_traffic.read_beats;
+
+    bool exact = true;
+    axi_traffic = AxiTrafficCounters();
+    for (size_t i = 0; i < images.size(); i++) {
+        exact &= (resident.run(images[i]) == expected[i]);
+    }
+    long long residentBeats = axi_traffic.read_beats / static_cast<long long>(images.size());
+
+    std::printf("Resident layers: %d, preload: %lld read beats\n", resident.residentLayerCount(), preloadBeats);
+    std::printf("DDR read beats per image: %lld streaming, %lld resident (%lld saved)\n",
+        streamingBeats, residentBeats, streamingBeats - residentBeats);
+    std::printf("Resident vs streaming outputs: %s\n", exact ? "identical" : "MISMATCH");
+
+    bool pass = exact && resident.residentLayerCount() > 0 && residentBeats < streamingBeats;
+    std::cout << net.name << (pass ? " resident test PASSED!" : " resident test FAILED!") << std::endl;
+    return pass;
+}
+
+// Runs batches of B = 1, 4 and 16 images with one accelerator call per layer
+// and batch. Every output must equal the single-image run; reports the DDR
+// weight traffic per image and the throughput predicted by perf_model
+static bool testBatch(const NetworkSpec& net) {
+    std::cout << "\n=== " << net.name << " (batch mode) ===" << std::endl;
+
+    // Rotated copies of the input, so every image of a batch is different
+    const int maxBatch = 16;
+    std::vector<std::vector<float>> images(maxBatch, net.input);
+    for (int i = 1; i < maxBatch; i++) {
+        std::rotate(images[i].begin(), images[i].begin() + i * images[i].size() / maxBatch, images[i].end());
+    }
+
+    NetworkExecutor executor = buildExecutor(net);
+    std::vector<std::vector<float>> expected;
+    for (const std::vector<float>& image : images) {
+        expected.push_back(executor.run(image));
+    }
+
+    bool exact = true;
+    long long singleWeightBeats = 0;
+    long long batchWeightBeats = 0;
+    std::printf("%6s %20s %20s %16s %14s\n", "batch", "weight beats/image", "input beats/image", "predicted img/s", "C-sim img/s");
+    for (int batch : { 1, 4, 16 }) {
+        std::vector<std::vector<float>> inputs(images.begin(), images.begin() + batch);
+
+        axi_traffic = AxiTrafficCounters();
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::vector<float>> outputs = executor.runBatch(inputs);
+        auto end = std::chrono::high_resolution_clock::now();
+        double simMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        for (int b = 0; b < batch; b++) {
+            exact &= (outputs[b] == expected[b]);
+        }
+        long long weightBeats = axi_traffic.weight_beats / batch;
+        if (batch == 1) {
+            singleWeightBeats = weightBeats;
+        }
+        batchWeightBeats = weightBeats;
+
+        std::printf("%6d %20lld %20lld %16.1f %14.1f\n", batch, weightBeats, axi_traffic.input_beats / batch,
+            batch * 1000.0 / executor.predictedTotalMs(), batch * 1000.0 / simMs);
+    }
+    std::printf("Batched vs single-image outputs: %s\n", exact ? "identical" : "MISMATCH");
+
+    bool pass = exact && batchWeightBeats < singleWeightBeats;
+    std::cout << net.name << (pass ? " batch test PASSED!" : " batch test FAILED!") << std::endl;
+    return pass;
+}
+
+// Conv + max-pool pairs as one accelerator call where perf_model predicts a
+// gain, for one image and a batch of 4. The outputs must equal the unfused
+// run, and the fused run must write fewer DDR beats and never be predicted
+// slower; reports the beats and the perf_model latency per image
+static bool testFusedPooling(const NetworkSpec& net) {
+    std::cout << "\n=== " << net.name << " (fused conv+pool) ===" << std::endl;
+
+    std::vector<std::vector<float>> images(4, net.input);
+    for (size_t i = 1; i < images.size(); i++) {
+        std::rotate(images[i].begin(), images[i].begin() + i * images[i].size() / images.size(), images[i].end());
+    }
+
+    NetworkExecutor separate = buildExecutor(net);
+    NetworkExecutor fused = buildExecutor(net);
+    fused.setFusePooling(true);
+
+    bool exact = true;
+    bool fewerWrites = true;
+    bool notSlower = true;
+    std::printf("%6s %22s %22s %16s %16s\n", "batch", "written beats/image", "read beats/image", "separate ms", "fused ms");
+    for (int batch : { 1, 4 }) {
+        std::vector<std::vector<float>> inputs(images.begin(), images.begin() + batch);
+
+        axi_traffic = AxiTrafficCounters();
+        std::vector<std::vector<float>> expected = separate.runBatch(inputs);
+        AxiTrafficCounters before = axi_traffic;
+
+        axi_traffic = AxiTrafficCounters();
+        std::vector<std::vector<float>> outputs = fused.runBatch(inputs);
+        AxiTrafficCounters after = axi_traffic;
+
+        exact &= (outputs == expected);
+        fewerWrites &= (after.write_beats < before.write_beats);
+        notSlower &= (fused.predictedTotalMs() <= separate.predictedTotalMs());
+        std::printf("%6d %10lld -> %-9lld %10lld -> %-9lld %16.3f %16.3f\n", batch,
+            before.write_beats / batch, after.write_beats / batch, before.read_beats / batch, after.read_beats / batch,
+            separate.predictedTotalMs() / batch, fused.predictedTotalMs() / batch);
+    }
+
+    int fusedLayers = 0;
+    std::printf("Fused pooling layers:");
+    for (const HostLayerTiming& timing : fused.getTimings()) {
+        if (timing.fused) {
+            std::printf(" %s", timing.name.c_str());
+            fusedLayers++;
+        }
+    }
+    std::printf("%s\n", fusedLayers > 0 ? "" : " none");
+    std::printf("Fused vs separate outputs: %s\n", exact ? "identical" : "MISMATCH");
+
+    bool pass = exact && fewerWrites && notSlower && fusedLayers > 0;
+    std::cout << net.name << (pass ? " fused pooling test PASSED!" : " fused pooling test FAILED!") << std::endl;
+    return pass;
+}
+
+// Per-layer calls vs. one layer table start per run of accelerator layers,
+// for a batch of 1 and of 4. The outputs must be identical.
+static bool testLayerTable(const NetworkSpec& net) {
+    std::cout << "\n=== " << net.name << " (layer table) ===" << std::endl;
+
+    std::vector<std::vector<float>> images(4, net.input);
+    for (size_t i = 1; i < images.size(); i++) {
+        std::reverse(images[i].begin(), images[i].begin() + i * images[i].size() / images.size());
+    }
+
+    NetworkExecutor perLayer = buildExecutor(net);
+    NetworkExecutor table = buildExecutor(net);
+    table.setLayerTable(true);
+
+    bool exact = true;
+    bool fewerStarts = true;
+    std::printf("%6s %16s %16s %16s %16s\n", "batch", "per-layer starts", "table starts", "per-layer ms", "table ms");
+    for (int batch : { 1, 4 }) {
+        std::vector<std::vector<float>> inputs(images.begin(), images.begin() + batch);
+        std::vector<std::vector<float>> expected = perLayer.runBatch(inputs);
+        std::vector<std::vector<float>> outputs = table.runBatch(inputs);
+
+        exact &= (outputs == expected);
+        fewerStarts &= (table.acceleratorStarts() < perLayer.acceleratorStarts());
+        std::printf("%6d %16d %16d %16.3f %16.3f\n", batch, perLayer.acceleratorStarts(), table.acceleratorStarts(),
+            perLayer.predictedTotalMs(), table.predictedTotalMs());
+    }
+    std::printf("Layer table vs per-layer outputs: %s\n", exact ? "identical" : "MISMATCH");
+
+    bool pass = exact && fewerStarts;
+    std::cout << net.name << (pass ? " layer table test PASSED!" : " layer table test FAILED!") << std::endl;
+    return pass;
+}
+
+// Tile-major weights (one DDR burst per weight tile) vs. the [M][N][K*K]
+// layout, per call and in a layer table; the outputs must be identical
+static bool testTileMajorWeights(const NetworkSpec& net) {
+    std::cout << "\n=== " << net.name << " (tile-major weights) ===" << std::endl;
+
+    std::vector<std::vector<float>> images(4, net.input);
+    for (size_t i = 1; i < images.size(); i++) {
+        std::reverse(images[i].begin(), images[i].begin() + i * images[i].size() / images.size());
+    }
+
+    NetworkExecutor oihw = buildExecutor(net);
+    NetworkExecutor tiled = buildExecutor(net);
+    tiled.setTileMajorWeights(true);
+
+    bool exact = true;
+    bool faster = true;
+    std::printf("%6s %12s %12s %12s\n", "batch", "table", "OIHW ms", "tiled ms");
+    for (int batch : { 1, 4 }) {
+        bool useTable = (batch > 1);
+        oihw.setLayerTable(useTable);
+        tiled.setLayerTable(useTable);
+        std::vector<std::vector<float>> inputs(images.begin(), images.begin() + batch);
+        std::vector<std::vector<float>> expected = oihw.runBatch(inputs);
+        std::vector<std::vector<float>> outputs = tiled.runBatch(inputs);
+
+        exact &= (outputs == expected);
+        faster &= (tiled.predictedTotalMs() < oihw.predictedTotalMs());
+        std::printf("%6d %12s %12.3f %12.3f\n", batch, useTable ? "yes" : "no",
+            oihw.predictedTotalMs(), tiled.predictedTotalMs());
+    }
+    std::printf("Tile-major vs OIHW outputs: %s\n", exact ? "identical" : "MISMATCH");
+
+    bool pass = exact && faster;
+    std::cout << net.name << (pass ? " tile-major weights test PASSED!" : " tile-major weights test FAILED!") << std::endl;
+    return pass;
+}
+
+// Effective MAC savings of the zero-skip engine on the activations of the
+// network, per layer: MACs in skipped slots (cycles saved) and MACs gated off
+// in issued slots. The perf_model latency is given with and without skipping.
+static bool testZeroSkipping(const NetworkSpec& net) {
+    std::cout << "\n=== " << net.name << " (zero-activation skipping) ===" << std::endl;
+    if (!USE_ZERO_SKIP_ENGINE) {
+        std::cout << "Build with -DUSE_ZERO_SKIP_ENGINE=1 to count the skipped MACs" << std::endl;
+        return true;
+    }
+
+    NetworkExecutor executor = buildExecutor(net);
+    executor.run(net.input);
+
+    PerfModelParams dense = perf_default_params();
+    dense.zero_skip = false;
+
+    std::printf("%-8s %14s %10s %10s %12s %12s\n", "layer", "dense MACs", "skipped", "gated", "dense ms", "skipping ms");
+    long long denseTotal = 0, skippedTotal = 0, gatedTotal = 0;
+    double denseMs = 0.0, skippingMs = 0.0;
+    bool skipsAfterFirst = false;
+    const std::vector<HostLayer>& layers = executor.getLayers();
+    const std::vector<HostLayerTiming>& timings = executor.getTimings();
+    for (size_t i = 0; i < timings.size(); i++) {
+        const HostLayerTiming& timing = timings[i];
+        if (!timing.on_accelerator || timing.dense_macs == 0) {
+            continue;
+        }
+        double layerDenseMs = perf_cycles_to_ms(perf_estimate_layer(layers[i].config, dense).total_cycles);
+        std::printf("%-8s %14lld %9.1f%% %9.1f%% %12.3f %12.3f\n", timing.name.c_str(), timing.dense_macs,
+            100.0 * timing.skipped_macs / timing.dense_macs, 100.0 * timing.gated_macs / timing.dense_macs,
+            layerDenseMs, timing.predicted_ms);
+        denseTotal += timing.dense_macs;
+        skippedTotal += timing.skipped_macs;
+        gatedTotal += timing.gated_macs;
+        denseMs += layerDenseMs;
+        skippingMs += timing.predicted_ms;
+        skipsAfterFirst |= (i > 0 && timing.skipped_macs > 0);
+    }
+    if (denseTotal > 0) {
+        std::printf("%-8s %14lld %9.1f%% %9.1f%% %12.3f %12.3f\n", "total", denseTotal,
+            100.0 * skippedTotal / denseTotal, 100.0 * gatedTotal / denseTotal, denseMs, skippingMs);
+    }
+    std::printf("(skipped = MACs of pixels with all activations zero, no cycles spent; gated = zero activations in issued pixels)\n");
+
+    // The inputs of the layers after the first are post-ReLU
+    std::cout << net.name << (skipsAfterFirst ? " zero skipping test PASSED!" : " zero skipping test FAILED!") << std::endl;
+    return skipsAfterFirst;
+}
+
+// Output channels split across 1, 2 and 4 compute units (host threads in C
+// simulation), with fused pooling so the CUs write pooled maps where that is
+// predicted to pay off; batch 4 makes the host gather the per-CU outputs.
+// Outputs must match a single CU and the predicted latency must drop with
+// more CUs.
+static bool testComputeUnits(const NetworkSpec& net) {
+    std::cout << "\n=== " << net.name << " (compute units) ===" << std::endl;
+
+    std::vector<std::vector<float>> images(4, net.input);
+    for (size_t i = 1; i < images.size(); i++) {
+        std::reverse(images[i].begin(), images[i].begin() + i * images[i].size() / images.size());
+    }
+
+    bool exact = true;
+    bool faster = true;
+    std::printf("%6s %4s %8s %12s %12s %10s %10s\n", "batch", "CUs", "max CUs", "predicted ms", "wall ms",
+        "pred. x", "wall x");
+    for (int batch : { 1, 4 }) {
+        std::vector<std::vector<float>> inputs(images.begin(), images.begin() + batch);
+        std::vector<std::vector<float>> expected;
+        double singleMs = 0.0, singleWallMs = 0.0;
+        for (int cus : { 1, 2, 4 }) {
+            NetworkExecutor executor = buildExecutor(net);
+            executor.setFusePooling(true);
+            executor.setComputeUnits(cus);
+            executor.runBatch(inputs);  // Untimed first run
+
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::vector<float>> outputs = executor.runBatch(inputs);
+            auto end = std::chrono::high_resolution_clock::now();
+            double wallMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+            int maxCus = 0;
+            for (const HostLayerTiming& timing : executor.getTimings()) {
+                maxCus = std::max(maxCus, timing.compute_units);
+            }
+            if (cus == 1) {
+                expected = outputs;
+                singleMs = executor.predictedTotalMs();
+                singleWallMs = wallMs;
+            }
+            else {
+                exact &= (outputs == expected);
+                faster &= (executor.predictedTotalMs() < singleMs);
+            }
+            std::printf("%6d %4d %8d %12.3f %12.3f %9.2fx %9.2fx\n", batch, cus, maxCus,
+                executor.predictedTotalMs(), wallMs, singleMs / executor.predictedTotalMs(), singleWallMs / wallMs);
+        }
+    }
+    std::printf("Multi-CU vs single CU outputs: %s\n", exact ? "identical" : "MISMATCH");
+    std::printf("(wall x = C simulation on %u host threads, it depends on the cores of this machine)\n",
+        std::thread::hardware_concurrency());
+
+    bool pass = exact && faster;
+    std::cout << net.name << (pass ? " compute units test PASSED!" : " compute units test FAILED!") << std::endl;
+    return pass;
+}
+
+int main(int argc, char* argv[]) {
+    std::string weightsDir = (argc > 1) ? argv[1] : "../../cpp_fashion_mnist/weights";
+    bool allPassed = true;
+
+    NetworkSpec fashion;
+    if (loadFashionMnist(weightsDir, fashion)) {
+        allPassed &= testNetwork(fashion, true);
+        allPassed &= testNetwork(fashion, false);
+        allPassed &= testResidentWeights(fashion);
+        allPassed &= testBatch(fashion);
+        allPassed &= testFusedPooling(fashion);
+        allPassed &= testLayerTable(fashion);
+        allPassed &= testTileMajorWeights(fashion);
+        allPassed &= testZeroSkipping(fashion);
+        allPassed &= testComputeUnits(fashion);
+    }
+    else {
+        std::cout << "Fashion-MNIST weights not found in " << weightsDir << std::endl;
+        allPassed = false;
+    }
+
+    NetworkSpec alexnet;
+    makeScaledAlexNet(alexnet, 42);
+    allPassed &= testNetwork(alexnet, true);
+    allPassed &= testNetwork(alexnet, false);
+    allPassed &= testResidentWeights(alexnet);
+    allPassed &= testBatch(alexnet);
+    allPassed &= testFusedPooling(alexnet);
+    allPassed &= testLayerTable(alexnet);
+    allPassed &= testTileMajorWeights(alexnet);
+    allPassed &= testZeroSkipping(alexnet);
+    allPassed &= testComputeUnits(alexnet);
+
+    if (allPassed) {
+        std::cout << "\nAll tests PASSED!" << std::endl;
+        return 0;
+    }
+    std::cout << "\nSome tests FAILED!" << std::endl;
+    return 1;
+}
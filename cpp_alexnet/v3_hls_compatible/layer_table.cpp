@@ -0,0 +1,59 @@
+#include "layer_table.h"
+#include "cnn_functions.h"
+#include <stdexcept>
+
+int LayerTableBuilder::addActivations(size_t count) {
+    int offset = static_cast<int>(activationBuffer.size());
+    activationBuffer.resize(activationBuffer.size() + count, data_t(0));
+    return offset;
+}
+
+int LayerTableBuilder::addParameters(const std::vector<weight_t>& values) {
+    int offset = static_cast<int>(parameterBuffer.size());
+    parameterBuffer.insert(parameterBuffer.end(), values.begin(), values.end());
+    return offset;
+}
+
+void LayerTableBuilder::addLayer(const LayerConfig& config, int input_offset, int output_offset,
+    int weight_offset, int bias_offset) {
+    LayerDescriptor desc;
+    desc.config = config;
+    desc.input_offset = input_offset;
+    desc.output_offset = output_offset;
+    desc.weight_offset = weight_offset;
+    desc.bias_offset = bias_offset;
+    table.push_back(desc);
+}
+
+void LayerTableBuilder::clearActivations() {
+    activationBuffer.clear();
+}
+
+void LayerTableBuilder::clearLayers() {
+    table.clear();
+}
+
+void LayerTableBuilder::run() {
+    if (table.empty()) {
+        throw std::logic_error("empty layer table");
+    }
+    fashion_mnist_cnn_accelerator_network(
+        activationBuffer.data(),
+        activationBuffer.data(),
+        parameterBuffer.data(),
+        parameterBuffer.data(),
+        table.data(),
+        static_cast<int>(table.size()));
+}
+
+std::vector<data_t>& LayerTableBuilder::activations() {
+    return activationBuffer;
+}
+
+const std::vector<weight_t>& LayerTableBuilder::parameters() const {
+    return parameterBuffer;
+}
+
+const std::vector<LayerDescriptor>& LayerTableBuilder::layers() const {
+    return table;
+}
@@ -0,0 +1,41 @@
+#ifndef LAYER_TABLE_H
+#define LAYER_TABLE_H
+
+#include <vector>
+#include "cnn_types.h"
+
+// Host-side builder of the DDR buffers of fashion_mnist_cnn_accelerator_network:
+// an activation buffer, a parameter buffer with the weights and biases of the
+// layers, and the layer table. Every offset is in elements. The output of a
+// layer is the input of the next when their offsets are equal, so two
+// activation regions used in turn serve a whole network.
+class LayerTableBuilder {
+public:
+    // Reserve `count` zeroed activations and return their offset
+    int addActivations(size_t count);
+
+    // Append weights or biases to the parameter buffer and return their offset
+    int addParameters(const std::vector<weight_t>& values);
+
+    // Append a layer; pooling layers and WEIGHTS_RESIDENT calls do not read
+    // the parameter offsets
+    void addLayer(const LayerConfig& config, int input_offset, int output_offset,
+        int weight_offset = 0, int bias_offset = 0);
+
+    void clearActivations();
+    void clearLayers();
+
+    // Start the accelerator once for every layer of the table
+    void run();
+
+    std::vector<data_t>& activations();
+    const std::vector<weight_t>& parameters() const;
+    const std::vector<LayerDescriptor>& layers() const;
+
+private:
+    std::vector<data_t> activationBuffer;
+    std::vector<weight_t> parameterBuffer;
+    std::vector<LayerDescriptor> table;
+};
+
+#endif // LAYER_TABLE_H
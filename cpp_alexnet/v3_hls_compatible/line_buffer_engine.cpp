@@ -0,0 +1,330 @@
+#include "cnn_functions.h"
+#include <hls_stream.h>
+
+// Line-buffer streaming convolution engine (build with USE_LINE_BUFFER_ENGINE=1).
+// Each input channel plane is streamed once in raster order, zero padding
+// included, through a (K-1)-row line buffer into a K x K window. Every cycle
+// the window is multiplied with the kernels of TM output channel lanes, so an
+// output pixel is produced per cycle per lane. All M output planes are
+// accumulated on chip, so every input pixel and every weight is read from DDR
+// exactly once per layer and image; a fused max-pooling is applied to the
+// planes on chip before they are written. The images of a batch run back to
+// back: the planes of one image fill the accumulators, so the weights are read
+// again for every image.
+//
+// Window and weights are aligned to the bottom-right corner of the
+// MAX_KERNEL_SIZE x MAX_KERNEL_SIZE register file; the unused taps hold zero
+// weights, so all indices in the MAC are constants.
+
+#define LB_TAPS (MAX_KERNEL_SIZE*MAX_KERNEL_SIZE)
+
+// Function to load the kernels of all output channels for one input channel
+static void load_channel_weights(
+    weight_t* weights_ddr,
+    weight_t weight_regs[LB_MAX_OUTPUT_CHANNELS][LB_TAPS],
+    int n, int M, int N, int K) {
+
+    #pragma HLS INLINE off
+
+    const int K2 = K*K;
+    const int corner = MAX_KERNEL_SIZE - K;
+
+    clear_channel_weights: for (int m = 0; m < M; m++) {
+        #pragma HLS PIPELINE II=1
+        for (int k = 0; k < LB_TAPS; k++) {
+            weight_regs[m][k] = 0;
+        }
+    }
+
+    // Kernel tap (i, j) goes to register (corner + i, corner + j)
+    load_channel_m: for (int m = 0; m < M; m++) {
+        int i = 0;
+        int j = 0;
+        load_channel_k: for (int k = 0; k < K2; k++) {
+            #pragma HLS PIPELINE II=1
+            weight_regs[m][(corner + i) * MAX_KERNEL_SIZE + corner + j] = weights_ddr[(m * N + n) * K2 + k];
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.read_beats++;
+            axi_traffic.weight_beats++;
+#endif
+            if (++j == K) {
+                j = 0;
+                i++;
+            }
+        }
+    }
+}
+
+// Producer: the padded plane of input channel n in raster order
+static void stream_input_channel(
+    data_t* input_ddr,
+    hls::stream<data_t>& pixels,
+    int n, int H, int W, int P) {
+
+    #pragma HLS INLINE off
+
+    const int padded_H = H + 2*P;
+    const int padded_W = W + 2*P;
+
+    stream_rows: for (int ph = 0; ph < padded_H; ph++) {
+        stream_cols: for (int pw = 0; pw < padded_W; pw++) {
+            #pragma HLS PIPELINE II=1
+            int h = ph - P;
+            int w = pw - P;
+            data_t pixel = 0;
+            if (h >= 0 && h < H && w >= 0 && w < W) {
+                pixel = input_ddr[(n * H + h) * W + w];
+#if AXI_TRAFFIC_COUNTERS
+                axi_traffic.read_beats++;
+                axi_traffic.input_beats++;
+#endif
+            }
+            pixels.write(pixel);
+        }
+    }
+}
+
+// Consumer: shifts each pixel into the line buffer and window, then spends one
+// cycle per group of TM output channels on the window. The first input
+// channel starts the accumulators from the bias.
+static void conv_window_channel(
+    hls::stream<data_t>& pixels,
+    weight_t weight_regs[LB_MAX_OUTPUT_CHANNELS][LB_TAPS],
+    weight_t bias_regs[LB_MAX_OUTPUT_CHANNELS],
+    acc_t acc[LB_MAX_OUTPUT_CHANNELS][LB_MAX_OUTPUT_PIXELS],
+    bool first_channel,
+    int H, int W, int M, int R, int C, int K, int S, int P) {
+
+    #pragma HLS INLINE off
+
+    data_t line_buffer[MAX_KERNEL_SIZE-1][LB_MAX_WIDTH];
+    #pragma HLS ARRAY_PARTITION variable=line_buffer dim=1 complete
+
+    data_t window[MAX_KERNEL_SIZE][MAX_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=window complete
+
+    // Taps outside the K x K kernel read these zeros times zero weights
+    clear_line_buffer: for (int w = 0; w < LB_MAX_WIDTH; w++) {
+        #pragma HLS PIPELINE II=1
+        for (int i = 0; i < MAX_KERNEL_SIZE - 1; i++) {
+            line_buffer[i][w] = 0;
+        }
+    }
+    clear_window: for (int i = 0; i < MAX_KERNEL_SIZE; i++) {
+        #pragma HLS UNROLL
+        for (int j = 0; j < MAX_KERNEL_SIZE; j++) {
+            window[i][j] = 0;
+        }
+    }
+
+    const int padded_H = H + 2*P;
+    const int padded_W = W + 2*P;
+    const int groups = (M + TM - 1) / TM;
+    const int steps = padded_H * padded_W * groups;
+
+    int ph = 0;
+    int pw = 0;
+    int group = 0;
+
+    window_loop: for (int step = 0; step < steps; step++) {
+        #pragma HLS PIPELINE II=1
+        #pragma HLS DEPENDENCE variable=acc inter false
+
+        // New pixel: shift the line buffer column and the window
+        if (group == 0) {
+            data_t column[MAX_KERNEL_SIZE];
+            #pragma HLS ARRAY_PARTITION variable=column complete
+
+            data_t pixel = pixels.read();
+            read_column: for (int i = 0; i < MAX_KERNEL_SIZE - 1; i++) {
+                column[i] = line_buffer[i][pw];
+            }
+            column[MAX_KERNEL_SIZE-1] = pixel;
+
+            shift_column: for (int i = 0; i < MAX_KERNEL_SIZE - 1; i++) {
+                line_buffer[i][pw] = column[i + 1];
+            }
+
+            shift_window: for (int i = 0; i < MAX_KERNEL_SIZE; i++) {
+                for (int j = 0; j < MAX_KERNEL_SIZE - 1; j++) {
+                    window[i][j] = window[i][j + 1];
+                }
+                window[i][MAX_KERNEL_SIZE-1] = column[i];
+            }
+        }
+
+        // The window ends at (ph, pw); S <= MAX_STRIDE = 2, so the stride
+        // test and the division are bit operations
+        int oh = ph - (K - 1);
+        int ow = pw - (K - 1);
+        int r = (S == 2) ? (oh >> 1) : oh;
+        int c = (S == 2) ? (ow >> 1) : ow;
+        bool on_stride = (S == 1) || ((oh & 1) == 0 && (ow & 1) == 0);
+
+        if (oh >= 0 && ow >= 0 && on_stride && r < R && c < C) {
+            int pixel_idx = r * C + c;
+
+            lane_loop: for (int lane = 0; lane < TM; lane++) {
+                #pragma HLS UNROLL
+                int m = group * TM + lane;
+                if (m < M) {
+                    acc_t sum = first_channel ? acc_t(bias_regs[m]) : acc[m][pixel_idx];
+                    tap_loop: for (int k = 0; k < LB_TAPS; k++) {
+                        sum += weight_regs[m][k] * window[k / MAX_KERNEL_SIZE][k % MAX_KERNEL_SIZE];
+                    }
+                    acc[m][pixel_idx] = sum;
+                }
+            }
+        }
+
+        if (++group == groups) {
+            group = 0;
+            if (++pw == padded_W) {
+                pw = 0;
+                ph++;
+            }
+        }
+    }
+}
+
+// One input channel: the DDR reader and the window run concurrently. The
+// plane is channel image_n + n of the input, image_n = b * N for image b.
+static void line_buffer_channel(
+    data_t* input_ddr,
+    weight_t weight_regs[LB_MAX_OUTPUT_CHANNELS][LB_TAPS],
+    weight_t bias_regs[LB_MAX_OUTPUT_CHANNELS],
+    acc_t acc[LB_MAX_OUTPUT_CHANNELS][LB_MAX_OUTPUT_PIXELS],
+    int n, int image_n, int H, int W, int M, int R, int C, int K, int S, int P) {
+
+    #pragma HLS INLINE off
+    #pragma HLS DATAFLOW
+
+    // The window consumes a pixel every `groups` cycles; a line of slack
+    // keeps the reader bursting
+    hls::stream<data_t> pixels("pixels");
+    #pragma HLS STREAM variable=pixels depth=LB_MAX_WIDTH
+
+    stream_input_channel(input_ddr, pixels, image_n + n, H, W, P);
+    conv_window_channel(pixels, weight_regs, bias_regs, acc, n == 0, H, W, M, R, C, K, S, P);
+}
+
+// Function to write the accumulated planes, with optional ReLU, truncated to
+// data_t, to output channels [image_m, image_m + M)
+static void write_output_planes(
+    data_t* output_ddr,
+    acc_t acc[LB_MAX_OUTPUT_CHANNELS][LB_MAX_OUTPUT_PIXELS],
+    int image_m, int M, int R, int C, int relu_enable) {
+
+    #pragma HLS INLINE off
+
+    const int plane = R * C;
+
+    write_planes: for (int m = 0; m < M; m++) {
+        write_pixels: for (int p = 0; p < plane; p++) {
+            #pragma HLS PIPELINE II=1
+            acc_t value = acc[m][p];
+            if (relu_enable && value < 0) {
+                value = 0;
+            }
+            output_ddr[(image_m + m) * plane + p] = data_t(value);
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.write_beats++;
+#endif
+        }
+    }
+}
+
+// Fused max-pooling: the same planes pooled on chip, one DDR write per pooled
+// pixel. The whole plane is on chip, so windows overlapping any boundary need
+// no special handling.
+static void write_pooled_planes(
+    data_t* output_ddr,
+    acc_t acc[LB_MAX_OUTPUT_CHANNELS][LB_MAX_OUTPUT_PIXELS],
+    int image_m, int M, int R, int C, int relu_enable, int pool_size, int pool_stride) {
+
+    #pragma HLS INLINE off
+
+    const int PR = fused_pool_extent(R, pool_size, pool_stride);
+    const int PC = fused_pool_extent(C, pool_size, pool_stride);
+    const int window = pool_size * pool_size;
+
+    write_pooled: for (int m = 0; m < M; m++) {
+        write_pooled_pixels: for (int p = 0; p < PR * PC; p++) {
+            int pr = p / PC;
+            int pc = p % PC;
+            data_t max_value = 0;
+            pool_window: for (int k = 0; k < window; k++) {
+                #pragma HLS PIPELINE II=1
+                int r = pr * pool_stride + k / pool_size;
+                int c = pc * pool_stride + k % pool_size;
+                acc_t value = acc[m][r * C + c];
+                if (relu_enable && value < 0) {
+                    value = 0;
+                }
+                // Compared as data_t, like a separate pooling layer
+                if (k == 0 || data_t(value) > max_value) {
+                    max_value = data_t(value);
+                }
+            }
+            output_ddr[(image_m + m) * PR * PC + p] = max_value;
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.write_beats++;
+#endif
+        }
+    }
+}
+
+void line_buffer_conv(
+    data_t* input_ddr,
+    data_t* output_ddr,
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    LayerConfig layer_config) {
+
+    #pragma HLS INLINE off
+
+    int N = layer_config.input_channels;
+    int M = layer_config.output_channels;
+    int H = layer_config.input_height;
+    int W = layer_config.input_width;
+    int R = layer_config.output_height;
+    int C = layer_config.output_width;
+    int K = layer_config.kernel_size;
+    int S = layer_config.stride;
+    int P = layer_config.padding;
+
+    // Output channel m lives in bank m % TM, the bank of its lane
+    static CU_LOCAL acc_t acc[LB_MAX_OUTPUT_CHANNELS][LB_MAX_OUTPUT_PIXELS];
+    #pragma HLS ARRAY_PARTITION variable=acc dim=1 cyclic factor=TM
+
+    weight_t weight_regs[LB_MAX_OUTPUT_CHANNELS][LB_TAPS];
+    #pragma HLS ARRAY_PARTITION variable=weight_regs dim=1 cyclic factor=TM
+    #pragma HLS ARRAY_PARTITION variable=weight_regs dim=2 complete
+
+    weight_t bias_regs[LB_MAX_OUTPUT_CHANNELS];
+    #pragma HLS ARRAY_PARTITION variable=bias_regs cyclic factor=TM
+
+    load_bias_regs: for (int m = 0; m < M; m++) {
+        #pragma HLS PIPELINE II=1
+        bias_regs[m] = bias_ddr[m];
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.read_beats++;
+        axi_traffic.bias_beats++;
+#endif
+    }
+
+    batch_loop: for (int b = 0; b < layer_config.batch_size; b++) {
+        channel_loop: for (int n = 0; n < N; n++) {
+            load_channel_weights(weights_ddr, weight_regs, n, M, N, K);
+            line_buffer_channel(input_ddr, weight_regs, bias_regs, acc, n, b * N, H, W, M, R, C, K, S, P);
+        }
+
+        if (layer_config.pool_size > 0) {
+            write_pooled_planes(output_ddr, acc, b * M, M, R, C, layer_config.relu_enable,
+                layer_config.pool_size, layer_config.pool_stride);
+        }
+        else {
+            write_output_planes(output_ddr, acc, b * M, M, R, C, layer_config.relu_enable);
+        }
+    }
+}
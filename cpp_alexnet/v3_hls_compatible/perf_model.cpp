@@ -0,0 +1,1132 @@
+#include "perf_model.h"
+#include <algorithm>
+
+// Each model_* function mirrors the loop nest of the function with the same
+// name. A pipelined loop takes (trips - 1) * II + depth cycles, where the
+// effective II is the larger of the declared II and the number of accesses a
+// single BRAM bank or AXI port has to serve per iteration.
+
+static long long pipelined(long long trips, int ii, int depth) {
+    return (trips > 0) ? (trips - 1) * ii + depth : 0;
+}
+
+// Cycles a bank needs to serve `accesses` reads/writes in one iteration
+static int bank_ii(int accesses, const PerfModelParams& params) {
+    return (accesses + params.bram_ports - 1) / params.bram_ports;
+}
+
+static int ceil_div(int a, int b) {
+    return (a + b - 1) / b;
+}
+
+// Contiguous read of `beats` elements on m_axi bundle `bundle` (PERF_BUNDLE_*),
+// split into AXI_BURST_LEN bursts. Returns the cycles not hidden by the
+// issuing pipeline.
+static long long axi_read(long long beats, int bundle, PerfEstimate& est, const PerfModelParams& params) {
+    if (beats <= 0) {
+        return 0;
+    }
+    long long bursts = (beats + AXI_BURST_LEN - 1) / AXI_BURST_LEN;
+    est.read_beats += beats;
+    est.bundle_beats[bundle] += beats;
+    est.read_bursts += bursts;
+    return params.axi_read_latency + bursts * params.burst_overhead;
+}
+
+static long long axi_write(long long beats, int bundle, PerfEstimate& est, const PerfModelParams& params) {
+    if (beats <= 0) {
+        return 0;
+    }
+    long long bursts = (beats + AXI_BURST_LEN - 1) / AXI_BURST_LEN;
+    est.write_beats += beats;
+    est.bundle_beats[bundle] += beats;
+    est.write_bursts += bursts;
+    return params.axi_write_latency + bursts * params.burst_overhead;
+}
+
+// Number of DDR words covering elements [first, first + count) of a packed tensor
+static int packed_words(long long first, int count) {
+    return (count > 0) ? static_cast<int>((first + count - 1) / DDR_PACK - first / DDR_PACK + 1) : 0;
+}
+
+static void model_load_input_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int n_offset, int h_offset, int w_offset,
+    int N, int H, int W, int S, int P) {
+
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+    long long cycles = params.call_overhead;
+
+    // clear_input: h loop pipelined, w unrolled into one bank of input_buffer
+    cycles += TN * (pipelined(INPUT_TILE_HEIGHT, bank_ii(INPUT_TILE_WIDTH, params), params.pipeline_depth) + params.loop_overhead);
+
+    if (params.packed_axi) {
+        // load_words reads one word per cycle into a fully partitioned row_buffer
+        int first_w = std::max(0, w_offset * S - P);
+        int last_w = std::min(W, w_offset * S - P + INPUT_TILE_WIDTH);
+
+        for (int n = 0; n < n_limit; n++) {
+            for (int h = 0; h < INPUT_TILE_HEIGHT; h++) {
+                int input_h = h + h_offset * S - P;
+                if (input_h >= 0 && input_h < H && first_w < last_w) {
+                    long long row_base = (long long)(n + n_offset) * H * W + (long long)input_h * W;
+                    int words = packed_words(row_base + first_w, last_w - first_w);
+                    cycles += pipelined(words, 1, params.pipeline_depth) + axi_read(words, PERF_BUNDLE_INPUT, est, params);
+                }
+                cycles += 1 + pipelined(INPUT_TILE_WIDTH, 1, params.pipeline_depth);
+                cycles += 2 * params.loop_overhead;
+            }
+            cycles += params.loop_overhead;
+        }
+
+        est.load_input_cycles += cycles;
+        return;
+    }
+
+    // load_input: only the in-bounds part of each row is read from DDR
+    int first_w = std::max(0, P - w_offset * S);
+    int last_w = std::min(INPUT_TILE_WIDTH, W + P - w_offset * S);
+    int row_beats = std::max(0, last_w - first_w);
+
+    for (int n = 0; n < n_limit; n++) {
+        for (int h = 0; h < INPUT_TILE_HEIGHT; h++) {
+            int input_h = h + h_offset * S - P;
+            int beats = (input_h >= 0 && input_h < H) ? row_beats : 0;
+
+            // load_row (II=2) and transfer_row (II=1)
+            cycles += std::max(pipelined(INPUT_TILE_WIDTH, 2, params.pipeline_depth), (long long)beats)
+                + axi_read(beats, PERF_BUNDLE_INPUT, est, params);
+            cycles += pipelined(INPUT_TILE_WIDTH, 1, params.pipeline_depth);
+            cycles += 2 * params.loop_overhead;
+        }
+        cycles += params.loop_overhead;
+    }
+
+    est.load_input_cycles += cycles;
+}
+
+// load_input_window of the reuse schedule: rows [0, rows), columns [first_col, cols)
+static void model_load_input_window(
+    PerfEstimate& est, const PerfModelParams& params,
+    int n_offset, int h_offset, int w_offset, int first_col, int rows, int cols,
+    int N, int H, int W, int S, int P) {
+
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+    const int tile_w = w_offset * S - P;
+    const int first_w = std::max(0, tile_w + first_col);
+    const int last_w = std::min(W, tile_w + cols);
+    const int row_beats = std::max(0, last_w - first_w);
+    long long cycles = params.call_overhead;
+
+    for (int n = 0; n < n_limit; n++) {
+        for (int h = 0; h < rows; h++) {
+            int input_h = h + h_offset * S - P;
+            bool in_rows = (input_h >= 0 && input_h < H);
+
+            if (params.packed_axi) {
+                // clear_row unrolled, load_words and transfer_row at II=1
+                if (in_rows && row_beats > 0) {
+                    long long row_base = (long long)(n + n_offset) * H * W + (long long)input_h * W;
+                    int words = packed_words(row_base + first_w, row_beats);
+                    cycles += pipelined(words, 1, params.pipeline_depth) + axi_read(words, PERF_BUNDLE_INPUT, est, params);
+                }
+                cycles += 1 + pipelined(cols - first_col, 1, params.pipeline_depth);
+            }
+            else {
+                // load_window_row (II=2) writes input_buffer directly
+                int beats = in_rows ? row_beats : 0;
+                cycles += std::max(pipelined(cols - first_col, 2, params.pipeline_depth), (long long)beats)
+                    + axi_read(beats, PERF_BUNDLE_INPUT, est, params);
+            }
+            cycles += params.loop_overhead;
+        }
+        cycles += params.loop_overhead;
+    }
+
+    est.load_input_cycles += cycles;
+}
+
+// save_input_halo / restore_input_halo: one column of all TN channels per cycle
+static void model_input_halo(PerfEstimate& est, const PerfModelParams& params, int halo_cols, int rows) {
+    est.load_input_cycles += params.call_overhead
+        + rows * (pipelined(halo_cols, 1, params.pipeline_depth) + params.loop_overhead);
+}
+
+// With `resident` the tile is copied from the resident store (load_resident_weight_tile),
+// with `tiled` it is read from tile-major weights (load_weight_tile_tiled)
+static void model_load_weight_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int m_offset, int n_offset, int M, int N, int K, bool resident = false, bool tiled = false) {
+
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+    const int K2 = K * K;
+    long long cycles = params.call_overhead;
+
+    // clear_weights: n loop pipelined, k unrolled into one weight_buffer bank
+    cycles += TM * (pipelined(TN, bank_ii(MAX_KERNEL_SIZE * MAX_KERNEL_SIZE, params), params.pipeline_depth) + params.loop_overhead);
+
+    if (resident) {
+        // resident_weights_k: one on-chip read per cycle, no AXI traffic
+        cycles += (long long)m_limit * n_limit * (pipelined(K2, 1, params.pipeline_depth) + params.loop_overhead);
+        est.load_weight_cycles += cycles;
+        return;
+    }
+
+    if (tiled) {
+        // load_tile_burst (or load_words and scatter_weights): the whole tile
+        // is one run of elements
+        const int count = m_limit * n_limit * K2;
+        if (params.packed_axi) {
+            int words = packed_words(tiled_weight_offset(m_offset, n_offset, M, N, K), count);
+            cycles += pipelined(words, 1, params.pipeline_depth) + axi_read(words, PERF_BUNDLE_WEIGHTS, est, params);
+        }
+        cycles += pipelined(count, 1, params.pipeline_depth);
+        if (!params.packed_axi) {
+            cycles += axi_read(count, PERF_BUNDLE_WEIGHTS, est, params);
+        }
+
+        est.load_weight_cycles += cycles;
+        return;
+    }
+
+    if (params.packed_axi) {
+        // One run of words per output channel, then scatter_weights at II=1
+        const int count = n_limit * K2;
+        for (int m = 0; m < m_limit; m++) {
+            long long base = (long long)(m + m_offset) * N * K2 + (long long)n_offset * K2;
+            int words = packed_words(base, count);
+            cycles += pipelined(words, 1, params.pipeline_depth) + axi_read(words, PERF_BUNDLE_WEIGHTS, est, params);
+            cycles += pipelined(count, 1, params.pipeline_depth);
+            cycles += params.loop_overhead;
+        }
+
+        est.load_weight_cycles += cycles;
+        return;
+    }
+
+    // load_weights_k: the 4 weights of an iteration share one AXI port
+    // (1 beat per cycle) and are written into one bank
+    const int batch_ii = std::max(4, bank_ii(4, params));
+    const int batches = ceil_div(K2, 4);
+
+    for (int m = 0; m < m_limit; m++) {
+        for (int n = 0; n < n_limit; n++) {
+            cycles += pipelined(batches, batch_ii, params.pipeline_depth) + axi_read(K2, PERF_BUNDLE_WEIGHTS, est, params);
+            cycles += params.loop_overhead;
+        }
+        cycles += params.loop_overhead;
+    }
+
+    est.load_weight_cycles += cycles;
+}
+
+static void model_load_bias(PerfEstimate& est, const PerfModelParams& params, int m_offset, int M,
+    bool resident = false) {
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+
+    long long cycles = params.call_overhead;
+    if (resident) {
+        cycles += pipelined(TM, 1, params.pipeline_depth);
+    }
+    else if (params.packed_axi) {
+        // clear_bias unrolled, load_words and copy_bias at II=1
+        int words = packed_words(m_offset, m_limit);
+        cycles += 1 + pipelined(words, 1, params.pipeline_depth) + axi_read(words, PERF_BUNDLE_BIAS, est, params);
+        cycles += pipelined(TM, 1, params.pipeline_depth);
+    }
+    else {
+        cycles += pipelined(TM, 1, params.pipeline_depth);
+        cycles += pipelined(m_limit, 1, params.pipeline_depth) + axi_read(m_limit, PERF_BUNDLE_BIAS, est, params);
+    }
+
+    est.load_bias_cycles += cycles;
+}
+
+// init_output_buffer is INLINE, so it has no call overhead
+static void model_init_output_buffer(PerfEstimate& est, const PerfModelParams& params) {
+    est.init_output_cycles += TM * (pipelined(TR, bank_ii(TC, params), params.pipeline_depth) + params.loop_overhead);
+}
+
+// systolic_compute_tile: per kernel tap, TN cycles of weight shift (TM
+// weights from the two weight_buffer banks of a row) and a pass of
+// P + TN + TM - 2 cycles through the array, P = tr_bound * tc_bound
+static void model_systolic_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int kernel_size, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
+
+    long long shift = pipelined(TN, bank_ii(TM / 2, params), params.pipeline_depth);
+    long long pass = pipelined(tr_bound * tc_bound + TN + TM - 2, 1, params.mac_depth);
+    long long taps = (long long)kernel_size * kernel_size;
+
+    est.compute_cycles += params.call_overhead + taps * (shift + pass + 2 * params.loop_overhead);
+    est.macs += taps * tm_bound * tn_bound * tr_bound * tc_bound;
+}
+
+// too_batch_loop: two output maps per iteration, tii unrolled. Each
+// output_buffer bank sees one read and one write, each weight_buffer bank
+// TN / 2 reads and each input_buffer bank one read.
+static long long model_too_batch_loop(const PerfModelParams& params, int tm_bound) {
+    const int batch_ii = std::max(bank_ii(2, params), bank_ii((TN + 1) / 2, params));
+    return pipelined(ceil_div(tm_bound, 2), batch_ii, params.mac_depth);
+}
+
+// zero_skip_compute_tile: per kernel tap, compact_loop at II=1 over the
+// P = tr_bound * tc_bound pixels, then a too_batch_loop for each of the
+// issued_slots * P pixels with a nonzero activation
+static void model_zero_skip_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int kernel_size, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
+
+    const long long pixels = (long long)tr_bound * tc_bound;
+    const long long issued = (long long)(pixels * params.issued_slots + 0.5);
+
+    long long compact = pipelined(pixels, 1, params.pipeline_depth) + params.loop_overhead;
+    long long nz_pixels = issued * (model_too_batch_loop(params, tm_bound) + params.loop_overhead) + params.loop_overhead;
+    long long j_cycles = kernel_size * (compact + nz_pixels + params.loop_overhead);
+    long long i_cycles = kernel_size * (j_cycles + params.loop_overhead);
+
+    est.compute_cycles += params.call_overhead + i_cycles;
+    est.macs += (long long)kernel_size * kernel_size * tm_bound * tn_bound * tr_bound * tc_bound;
+}
+
+static void model_compute_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int kernel_size, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
+
+    if (params.systolic) {
+        model_systolic_tile(est, params, kernel_size, tm_bound, tn_bound, tr_bound, tc_bound);
+        return;
+    }
+    if (params.zero_skip) {
+        model_zero_skip_tile(est, params, kernel_size, tm_bound, tn_bound, tr_bound, tc_bound);
+        return;
+    }
+
+    const long long batch_cycles = model_too_batch_loop(params, tm_bound);
+
+    // i_loop -> j_loop -> trr_loop -> tcc_loop are not pipelined
+    long long tcc_cycles = tc_bound * (batch_cycles + params.loop_overhead);
+    long long trr_cycles = tr_bound * (tcc_cycles + params.loop_overhead);
+    long long j_cycles = kernel_size * (trr_cycles + params.loop_overhead);
+    long long i_cycles = kernel_size * (j_cycles + params.loop_overhead);
+
+    est.compute_cycles += params.call_overhead + i_cycles;
+    est.macs += (long long)kernel_size * kernel_size * tm_bound * tn_bound * tr_bound * tc_bound;
+}
+
+static void model_pool_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int kernel_size, int tr_bound, int tc_bound) {
+
+    // pool_j_loop: tii unrolled, each output_buffer bank holds TN / 2 of the
+    // channels and sees one read and one write for each of them
+    const int ii = bank_ii(2 * ceil_div(TN, 2), params);
+    long long j_cycles = pipelined(kernel_size, ii, params.pipeline_depth);
+
+    // pool_r_loop -> pool_c_loop -> pool_i_loop are not pipelined
+    long long i_cycles = kernel_size * (j_cycles + params.loop_overhead);
+    long long c_cycles = tc_bound * (i_cycles + params.loop_overhead);
+    long long r_cycles = tr_bound * (c_cycles + params.loop_overhead);
+
+    est.compute_cycles += params.call_overhead + r_cycles;
+}
+
+static void model_apply_relu(PerfEstimate& est, const PerfModelParams& params, int tm, int tr) {
+    // r loop pipelined, c unrolled: TC reads and TC writes on one bank
+    est.relu_cycles += params.call_overhead
+        + tm * (pipelined(tr, bank_ii(2 * TC, params), params.pipeline_depth) + params.loop_overhead);
+}
+
+static void model_pool_output_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int pool_size, int tm_bound, int tr_bound, int tc_bound) {
+
+    // pool_out_j_loop pipelined, the loops around it are not
+    long long i_cycles = pool_size * (pipelined(pool_size, 1, params.pipeline_depth) + params.loop_overhead);
+    long long c_cycles = tc_bound * (i_cycles + params.loop_overhead);
+    long long r_cycles = tr_bound * (c_cycles + params.loop_overhead);
+
+    est.compute_cycles += params.call_overhead + tm_bound * (r_cycles + params.loop_overhead);
+}
+
+static void model_store_output_block(
+    PerfEstimate& est, const PerfModelParams& params,
+    int m_offset, int h_offset, int w_offset, int tr_bound, int tc_bound, int M, int R, int C) {
+
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    const int r_limit = ((h_offset + tr_bound) > R) ? (R - h_offset) : tr_bound;
+    const int c_limit = ((w_offset + tc_bound) > C) ? (C - w_offset) : tc_bound;
+    long long cycles = params.call_overhead;
+
+    for (int m = 0; m < m_limit; m++) {
+        for (int r = 0; r < r_limit; r++) {
+            // fill_row (II=1) and store_row (II=2)
+            cycles += pipelined(c_limit, 1, params.pipeline_depth);
+            if (params.packed_axi) {
+                // store_words: one word per cycle, partially covered words are read back first
+                long long base = (long long)(m + m_offset) * R * C + (long long)(r + h_offset) * C + w_offset;
+                int words = packed_words(base, c_limit);
+                int partial = 0;
+                for (long long word = base / DDR_PACK; word < base / DDR_PACK + words; word++) {
+                    if (word * DDR_PACK < base || word * DDR_PACK + DDR_PACK > base + c_limit) {
+                        partial++;
+                    }
+                }
+                cycles += pipelined(words, 1, params.pipeline_depth) + axi_read(partial, PERF_BUNDLE_OUTPUT, est, params)
+                    + axi_write(words, PERF_BUNDLE_OUTPUT, est, params);
+            }
+            else {
+                cycles += std::max(pipelined(c_limit, 2, params.pipeline_depth), (long long)c_limit)
+                    + axi_write(c_limit, PERF_BUNDLE_OUTPUT, est, params);
+            }
+            cycles += 2 * params.loop_overhead;
+        }
+        cycles += params.loop_overhead;
+    }
+
+    est.store_output_cycles += cycles;
+}
+
+static void model_store_output_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int m_offset, int h_offset, int w_offset, int M, int R, int C) {
+
+    model_store_output_block(est, params, m_offset, h_offset, w_offset, TR, TC, M, R, C);
+}
+
+// write_output_tile of cnn_top.cpp: ReLU, then the tile or its fused pooling
+static void model_write_output_tile(
+    PerfEstimate& est, const PerfModelParams& params,
+    int m_offset, int h_offset, int w_offset, int M, int R, int C,
+    int tm_bound, int tr_bound, int tc_bound, bool relu, int pool_size, int pool_stride) {
+
+    if (relu) {
+        model_apply_relu(est, params, tm_bound, tr_bound);
+    }
+    if (pool_size > 0) {
+        int pr_bound = fused_pool_extent(tr_bound, pool_size, pool_stride);
+        int pc_bound = fused_pool_extent(tc_bound, pool_size, pool_stride);
+        model_pool_output_tile(est, params, pool_size, tm_bound, pr_bound, pc_bound);
+        model_store_output_block(est, params, m_offset, h_offset, w_offset, pr_bound, pc_bound, M, R, C);
+    }
+    else {
+        model_store_output_tile(est, params, m_offset, h_offset, w_offset, M, R, C);
+    }
+}
+
+// A contiguous run of `beats` goes out as bursts; strided accesses (FC inputs
+// and outputs with W > 1) are a transfer per beat
+static long long axi_run(long long beats, bool contiguous, bool write, int bundle, PerfEstimate& est, const PerfModelParams& params) {
+    if (contiguous) {
+        return write ? axi_write(beats, bundle, est, params) : axi_read(beats, bundle, est, params);
+    }
+    long long cycles = 0;
+    for (long long beat = 0; beat < beats; beat++) {
+        cycles += write ? axi_write(1, bundle, est, params) : axi_read(1, bundle, est, params);
+    }
+    return cycles;
+}
+
+// load_fc_inputs: one pipelined run of n_count elements per image; the packed
+// loader reads a word whenever the element leaves the previous one
+static void model_load_fc_inputs(
+    PerfEstimate& est, const PerfModelParams& params,
+    int first_image, int images, int N, int W, int n_offset, int n_count) {
+
+    long long cycles = params.call_overhead;
+    long long word = -1;
+
+    for (int g = 0; g < images; g++) {
+        int b = (first_image + g) / W;
+        int c = (first_image + g) % W;
+        long long beats = n_count;
+        if (params.packed_axi) {
+            beats = 0;
+            for (int n = 0; n < n_count; n++) {
+                long long e = ((long long)b * N + n_offset + n) * W + c;
+                if (e / DDR_PACK != word) {
+                    word = e / DDR_PACK;
+                    beats++;
+                }
+            }
+        }
+        cycles += pipelined(n_count, 1, params.pipeline_depth) + axi_run(beats, W == 1, false, PERF_BUNDLE_INPUT, est, params)
+            + params.loop_overhead;
+    }
+
+    est.load_input_cycles += cycles;
+}
+
+// fc_weight_pass: the weight reader (one element per cycle) and fc_tile (one
+// MAC per weight and image) run as a dataflow region, so the slower of the
+// two counts. The reader streams one run, or one run per output channel for
+// a chunk of OIHW rows. Returns the cycles of the pass.
+static long long model_fc_weight_pass(
+    PerfEstimate& est, const PerfModelParams& params,
+    int m_offset, int tm_bound, int N, int n_offset, int n_count, int images,
+    bool resident, bool tiled, bool relu, bool first_chunk, bool last_chunk) {
+
+    const long long count = (long long)tm_bound * n_count;
+    const bool one_run = tiled || n_count == N;
+    const int rows = one_run ? 1 : tm_bound;
+    const int run = one_run ? static_cast<int>(count) : n_count;
+    const long long base = (long long)m_offset * N + (tiled ? (long long)tm_bound * n_offset : n_offset);
+
+    long long reader = params.call_overhead;
+    for (int r = 0; r < rows; r++) {
+        reader += pipelined(run, 1, params.pipeline_depth);
+        if (rows > 1) {
+            reader += params.loop_overhead;
+        }
+        if (!resident) {
+            long long beats = params.packed_axi ? packed_words(base + (long long)r * N, run) : run;
+            reader += axi_read(beats, PERF_BUNDLE_WEIGHTS, est, params);
+        }
+    }
+    est.load_weight_cycles += reader;
+
+    // fc_init on the first chunk, then fc_mac_loop over all weights and
+    // images, then fc_relu after the last chunk
+    long long mac = params.call_overhead + pipelined(count * images, 1, params.mac_depth);
+    if (first_chunk) {
+        mac += images * (pipelined(TM, 1, params.pipeline_depth) + params.loop_overhead);
+    }
+    if (relu && last_chunk) {
+        mac += images * (pipelined(tm_bound, 1, params.pipeline_depth) + params.loop_overhead);
+    }
+    est.compute_cycles += mac;
+    est.macs += count * images;
+
+    return params.call_overhead + std::max(reader, mac);
+}
+
+// store_fc_outputs: one pipelined run of tm_bound outputs per image; the
+// packed store writes a word per change of word and reads back the partial ones
+static void model_store_fc_outputs(
+    PerfEstimate& est, const PerfModelParams& params,
+    int first_image, int images, int m_offset, int tm_bound, int M, int W) {
+
+    long long cycles = params.call_overhead;
+
+    for (int g = 0; g < images; g++) {
+        int b = (first_image + g) / W;
+        int c = (first_image + g) % W;
+        long long base = ((long long)b * M + m_offset) * W + c;
+        long long words = tm_bound;
+        long long partial = 0;
+        if (params.packed_axi) {
+            words = 0;
+            long long word = -1;
+            for (int m = 0; m < tm_bound; m++) {
+                long long e = base + (long long)m * W;
+                if (e / DDR_PACK != word) {
+                    word = e / DDR_PACK;
+                    words++;
+                    if (W > 1 || word * DDR_PACK < base || word * DDR_PACK + DDR_PACK > base + tm_bound) {
+                        partial++;
+                    }
+                }
+            }
+        }
+        cycles += pipelined(tm_bound, 1, params.pipeline_depth)
+            + axi_run(partial, W == 1, false, PERF_BUNDLE_OUTPUT, est, params)
+            + axi_run(words, W == 1, true, PERF_BUNDLE_OUTPUT, est, params) + params.loop_overhead;
+    }
+
+    est.store_output_cycles += cycles;
+}
+
+static long long load_cycles(const PerfEstimate& est) {
+    return est.load_input_cycles + est.load_weight_cycles + est.load_bias_cycles;
+}
+
+static long long compute_stage_cycles(const PerfEstimate& est) {
+    return est.init_output_cycles + est.compute_cycles + est.relu_cycles;
+}
+
+// Step loop of fashion_mnist_cnn_accelerator_pingpong: per step, the load of
+// the next step, the compute of this step and the store of the previous output
+// tile run concurrently, so a step takes as long as its slowest stage. The
+// per-function cycles in `est` are busy cycles; the overlapped latency is returned.
+static long long model_pingpong_layer(
+    PerfEstimate& est, const PerfModelParams& params, bool pool, bool relu, bool tiled,
+    int N, int M, int input_H, int input_W, int output_H, int output_W, int K, int S, int P) {
+
+    const int tn_steps = pool ? 1 : ceil_div(N, TN);
+    const int tr_steps = ceil_div(output_H, TR);
+    const int tc_steps = ceil_div(output_W, TC);
+    const int channel_tiles = pool ? ceil_div(N, TN) : ceil_div(M, TM);
+    const int total_steps = channel_tiles * tr_steps * tc_steps * tn_steps;
+
+    // Loads one step and returns its cycles
+    auto load_step = [&](int step) {
+        long long before = load_cycles(est);
+        int tn = step % tn_steps;
+        int tile = step / tn_steps;
+        int r_offset = ((tile / tc_steps) % tr_steps) * TR;
+        int c_offset = (tile % tc_steps) * TC;
+        int channel_offset = (tile / (tc_steps * tr_steps)) * (pool ? TN : TM);
+        int n_offset = pool ? channel_offset : tn * TN;
+
+        model_load_input_tile(est, params, n_offset, r_offset, c_offset, N, input_H, input_W, S, P);
+        if (!pool) {
+            model_load_weight_tile(est, params, channel_offset, n_offset, M, N, K, false, tiled);
+            if (tn == 0) {
+                model_load_bias(est, params, channel_offset, M);
+            }
+        }
+        return load_cycles(est) - before;
+    };
+
+    auto store_tile = [&](int tile) {
+        long long before = est.store_output_cycles;
+        int r_offset = ((tile / tc_steps) % tr_steps) * TR;
+        int c_offset = (tile % tc_steps) * TC;
+        int m_offset = (tile / (tc_steps * tr_steps)) * (pool ? TN : TM);
+        int tm_bound = std::min(pool ? TN : TM, (pool ? N : M) - m_offset);
+        model_store_output_tile(est, params, m_offset, r_offset, c_offset, m_offset + tm_bound, output_H, output_W);
+        return est.store_output_cycles - before;
+    };
+
+    long long cycles = load_step(0);
+
+    for (int step = 0; step < total_steps; step++) {
+        int tn = step % tn_steps;
+        int tile = step / tn_steps;
+        int tr_bound = std::min(TR, output_H - ((tile / tc_steps) % tr_steps) * TR);
+        int tc_bound = std::min(TC, output_W - (tile % tc_steps) * TC);
+        int channel_offset = (tile / (tc_steps * tr_steps)) * (pool ? TN : TM);
+        int tm_bound = std::min(pool ? TN : TM, (pool ? N : M) - channel_offset);
+
+        long long load = (step + 1 < total_steps) ? load_step(step + 1) : 0;
+
+        long long before = compute_stage_cycles(est);
+        if (pool) {
+            model_pool_tile(est, params, K, tr_bound, tc_bound);
+        }
+        else {
+            if (tn == 0) {
+                model_init_output_buffer(est, params);
+            }
+            int n_offset = tn * TN;
+            model_compute_tile(est, params, K, tm_bound, std::min(TN, N - n_offset), tr_bound, tc_bound);
+        }
+        if (tn == tn_steps - 1 && relu) {
+            model_apply_relu(est, params, tm_bound, tr_bound);
+        }
+        long long compute = compute_stage_cycles(est) - before;
+
+        long long store = (tn == 0 && step > 0) ? store_tile(tile - 1) : 0;
+
+        cycles += std::max(load, std::max(compute, store)) + params.call_overhead;
+    }
+
+    return cycles + store_tile(total_steps / tn_steps - 1);
+}
+
+// preload_resident_weights: one element per cycle into the store, the AXI
+// reads overlap with the copy
+static long long model_preload(PerfEstimate& est, const PerfModelParams& params, long long weight_count, int M) {
+    long long weight_beats = params.packed_axi ? (weight_count + DDR_PACK - 1) / DDR_PACK : weight_count;
+    long long bias_beats = params.packed_axi ? (M + DDR_PACK - 1) / DDR_PACK : M;
+
+    long long weights = params.call_overhead + pipelined(weight_count, 1, params.pipeline_depth) + axi_read(weight_beats, PERF_BUNDLE_WEIGHTS, est, params);
+    long long bias = pipelined(M, 1, params.pipeline_depth) + axi_read(bias_beats, PERF_BUNDLE_BIAS, est, params);
+    est.load_weight_cycles += weights;
+    est.load_bias_cycles += bias;
+    return weights + bias;
+}
+
+// line_buffer_conv: per input channel the kernels of all M outputs are
+// loaded, then the DDR reader and the window loop (one cycle per pixel and
+// TM-lane group) run as a dataflow region, so the slower of the two counts.
+// The window loop visits every padded pixel whatever the stride and only
+// masks the off-stride windows, so the stride does not change the cycles.
+// The accumulated planes are written once per image at the end.
+static long long model_line_buffer_layer(
+    PerfEstimate& est, const PerfModelParams& params,
+    int B, int N, int M, int H, int W, int R, int C, int K, int P,
+    int pool_size, int pool_stride) {
+
+    const int padded_H = H + 2 * P;
+    const int padded_W = W + 2 * P;
+    const int groups = ceil_div(M, TM);
+    const int K2 = K * K;
+
+    long long bias = pipelined(M, 1, params.pipeline_depth) + axi_read(M, PERF_BUNDLE_BIAS, est, params);
+    est.load_bias_cycles += bias;
+    long long cycles = params.call_overhead + bias;
+
+    for (int b = 0; b < B; b++) {
+        for (int n = 0; n < N; n++) {
+            // load_channel_weights: clear, then one K*K run per output channel
+            long long weights = params.call_overhead + pipelined(M, 1, params.pipeline_depth);
+            for (int m = 0; m < M; m++) {
+                weights += pipelined(K2, 1, params.pipeline_depth) + axi_read(K2, PERF_BUNDLE_WEIGHTS, est, params) + params.loop_overhead;
+            }
+            est.load_weight_cycles += weights;
+
+            // stream_input_channel: one in-bounds run of W pixels per input row
+            long long reader = params.call_overhead;
+            for (int ph = 0; ph < padded_H; ph++) {
+                bool in_rows = (ph >= P && ph < P + H);
+                reader += pipelined(padded_W, 1, params.pipeline_depth) + (in_rows ? axi_read(W, PERF_BUNDLE_INPUT, est, params) : 0)
+                    + params.loop_overhead;
+            }
+            est.load_input_cycles += reader;
+
+            // conv_window_channel: clear_line_buffer, then window_loop at II=1
+            long long window = params.call_overhead + pipelined(LB_MAX_WIDTH, 1, params.pipeline_depth)
+                + pipelined((long long)padded_H * padded_W * groups, 1, params.mac_depth);
+            est.compute_cycles += window;
+            est.macs += (long long)K2 * M * R * C;
+
+            cycles += weights + std::max(reader, window) + params.call_overhead;
+        }
+
+        // write_output_planes: the M planes are one contiguous run;
+        // write_pooled_planes spends a pipelined window per pooled pixel
+        const int PR = fused_pool_extent(R, pool_size, pool_stride);
+        const int PC = fused_pool_extent(C, pool_size, pool_stride);
+        long long store = params.call_overhead + axi_write((long long)M * PR * PC, PERF_BUNDLE_OUTPUT, est, params);
+        for (int m = 0; m < M; m++) {
+            if (pool_size > 0) {
+                store += (long long)PR * PC * (pipelined(pool_size * pool_size, 1, params.pipeline_depth) + params.loop_overhead);
+            }
+            else {
+                store += pipelined(R * C, 1, params.pipeline_depth);
+            }
+            store += params.loop_overhead;
+        }
+        est.store_output_cycles += store;
+        cycles += store;
+    }
+
+    return cycles;
+}
+
+PerfModelParams perf_default_params() {
+    PerfModelParams params;
+    params.bram_ports = 2;
+    params.pipeline_depth = 3;
+    params.mac_depth = 6;
+    params.loop_overhead = 1;
+    params.call_overhead = 2;
+    params.axi_read_latency = 30;
+    params.axi_write_latency = 10;
+    params.burst_overhead = 2;
+    params.start_cycles = 2000;
+    params.packed_axi = false;
+    params.pingpong = false;
+    params.line_buffer = (USE_LINE_BUFFER_ENGINE != 0);
+    params.systolic = (USE_SYSTOLIC_ENGINE != 0);
+    params.zero_skip = (USE_ZERO_SKIP_ENGINE != 0);
+    params.dsp_packing = (USE_DSP_PACKING != 0);
+    params.issued_slots = 1.0;
+    return params;
+}
+
+PerfEstimate perf_estimate_layer(const LayerConfig& layer_config, const PerfModelParams& params) {
+    PerfEstimate est = PerfEstimate();
+
+    int N = layer_config.input_channels;
+    int M = layer_config.output_channels;
+    int input_H = layer_config.input_height;
+    int input_W = layer_config.input_width;
+    int output_H = layer_config.output_height;
+    int output_W = layer_config.output_width;
+    int K = layer_config.kernel_size;
+    int S = layer_config.stride;
+    int P = layer_config.padding;
+
+    // Same FC geometry as cnn_top.cpp
+    if (layer_config.layer_type == LAYER_FC) {
+        input_H = 1;
+        output_H = 1;
+        output_W = input_W;
+        K = 1;
+        S = 1;
+        P = 0;
+    }
+    est.supported = (K <= MAX_KERNEL_SIZE && S <= MAX_STRIDE);
+
+    // Tile geometry of a fused max-pooling (see cnn_top.cpp)
+    const int pool_size = (layer_config.layer_type == LAYER_CONV) ? layer_config.pool_size : 0;
+    const int pool_stride = layer_config.pool_stride;
+    const int pool_K = (pool_size > 0) ? pool_size : 1;
+    const int pool_S = (pool_size > 0) ? pool_stride : 1;
+    const int pool_tr = (TR - pool_K) / pool_S + 1;
+    const int pool_tc = (TC - pool_K) / pool_S + 1;
+    const int store_H = fused_pool_extent(output_H, pool_size, pool_stride);
+    const int store_W = fused_pool_extent(output_W, pool_size, pool_stride);
+    const bool relu = (layer_config.relu_enable != 0);
+
+    // The ping-pong top rejects the layers it does not implement
+    if (params.pingpong && !pingpong_supports(layer_config)) {
+        est.supported = false;
+        return est;
+    }
+
+    if (layer_config.weight_mode == WEIGHTS_PRELOAD) {
+        est.total_cycles = model_preload(est, params, (long long)M * N * K * K, M);
+        return est;
+    }
+    const bool resident = (layer_config.weight_mode == WEIGHTS_RESIDENT);
+    const bool tiled = (layer_config.weight_layout == WEIGHT_LAYOUT_TILED);
+
+    // Images of the batch are channel ranges of one tensor (see cnn_top.cpp)
+    const int B = layer_config.batch_size;
+
+    // Only the data_t top dispatches to the line-buffer engine
+    if (params.line_buffer && !params.packed_axi && !params.pingpong && !resident && line_buffer_fits(layer_config)) {
+        est.total_cycles = model_line_buffer_layer(est, params, B, N, M, input_H, input_W, output_H, output_W, K, P,
+            layer_config.pool_size, layer_config.pool_stride);
+        return est;
+    }
+
+    // The ping-pong top runs the images one after the other
+    if (params.pingpong) {
+        for (int b = 0; b < B; b++) {
+            est.total_cycles += model_pingpong_layer(est, params, layer_config.layer_type == LAYER_MAXPOOL,
+                layer_config.relu_enable != 0, tiled, N, M, input_H, input_W, output_H, output_W, K, S, P);
+        }
+        return est;
+    }
+
+    // Dedicated FC path of cnn_top.cpp: every output channel group streams
+    // its weights past the input vectors of a group of up to MAX_BATCH images,
+    // chunk by chunk in alternating order when the vectors do not fit fc_input
+    if (layer_config.layer_type == LAYER_FC && N <= FC_INPUT_BUFFER_SIZE) {
+        const int images = B * output_W;
+        const int tm_steps = (M + TM - 1) / TM;
+        long long passes = 0;
+
+        for (int i0 = 0; i0 < images; i0 += MAX_BATCH) {
+            int group_bound = std::min(MAX_BATCH, images - i0);
+            int chunk = fc_input_chunk(N, group_bound);
+            int chunk_steps = (N + chunk - 1) / chunk;
+            int loaded = -1;
+
+            for (int tm = 0; tm < tm_steps; tm++) {
+                int m_offset = tm * TM;
+                int tm_bound = std::min(TM, M - m_offset);
+                model_load_bias(est, params, m_offset, M, resident);
+
+                for (int k = 0; k < chunk_steps; k++) {
+                    int c = (tm % 2 == 0) ? k : (chunk_steps - 1 - k);
+                    int n_offset = c * chunk;
+                    int n_count = std::min(chunk, N - n_offset);
+                    if (c != loaded) {
+                        model_load_fc_inputs(est, params, i0, group_bound, N, output_W, n_offset, n_count);
+                        loaded = c;
+                    }
+                    passes += model_fc_weight_pass(est, params, m_offset, tm_bound, N, n_offset, n_count,
+                        group_bound, resident, tiled, relu, k == 0, k == chunk_steps - 1);
+                }
+                model_store_fc_outputs(est, params, i0, group_bound, m_offset, tm_bound, M, output_W);
+            }
+        }
+
+        est.total_cycles = est.load_input_cycles + est.load_bias_cycles + passes + est.store_output_cycles;
+        return est;
+    }
+
+    if (layer_config.layer_type == LAYER_MAXPOOL) {
+        int tn_steps = (N + TN - 1) / TN;
+        int tr_steps = (output_H + TR - 1) / TR;
+        int tc_steps = (output_W + TC - 1) / TC;
+
+        for (int b = 0; b < B; b++) {
+            for (int tn = 0; tn < tn_steps; tn++) {
+                int n_offset = b * N + tn * TN;
+                int tn_bound = (N - tn * TN < TN) ? (N - tn * TN) : TN;
+
+                for (int tr = 0; tr < tr_steps; tr++) {
+                    int r_offset = tr * TR;
+                    int tr_bound = (output_H - r_offset < TR) ? (output_H - r_offset) : TR;
+
+                    for (int tc = 0; tc < tc_steps; tc++) {
+                        int c_offset = tc * TC;
+                        int tc_bound = (output_W - c_offset < TC) ? (output_W - c_offset) : TC;
+                        int rows = (tr_bound - 1) * S + K;
+                        int cols = (tc_bound - 1) * S + K;
+
+                        model_load_input_window(est, params, n_offset, r_offset, c_offset, 0, rows, cols,
+                            b * N + N, input_H, input_W, S, P);
+                        model_pool_tile(est, params, K, tr_bound, tc_bound);
+                        if (layer_config.relu_enable) {
+                            model_apply_relu(est, params, tn_bound, tr_bound);
+                        }
+                        model_store_output_tile(est, params, n_offset, r_offset, c_offset, n_offset + tn_bound, output_H, output_W);
+                    }
+                }
+            }
+        }
+    }
+    else if (layer_config.reuse_enable && N <= MAX_RESIDENT_CHANNELS) {
+        int tm_steps = (M + TM - 1) / TM;
+        int tn_steps = (N + TN - 1) / TN;
+        int tr_steps = (store_H + pool_tr - 1) / pool_tr;
+        int tc_steps = (store_W + pool_tc - 1) / pool_tc;
+        int shared_cols = K - S + (pool_K - pool_S) * S;
+        int halo_cols = std::max(0, std::min(shared_cols, MAX_KERNEL_SIZE - 1));
+
+        for (int tm = 0; tm < tm_steps; tm++) {
+            int m_offset = tm * TM;
+            int tm_bound = (M - m_offset < TM) ? (M - m_offset) : TM;
+            model_load_bias(est, params, m_offset, M, resident);
+
+            // Weights are loaded once per output channel group for all images
+            for (int tn = 0; tn < tn_steps; tn++) {
+                model_load_weight_tile(est, params, m_offset, tn * TN, M, N, K, resident, tiled);
+            }
+
+            for (int b = 0; b < B; b++) {
+                for (int tr = 0; tr < tr_steps; tr++) {
+                    int pr_offset = tr * pool_tr;
+                    int pr_bound = std::min(pool_tr, store_H - pr_offset);
+                    int r_offset = pr_offset * pool_S;
+                    int tr_bound = (pr_bound - 1) * pool_S + pool_K;
+                    int rows = (tr_bound - 1) * S + K;
+
+                    for (int tc = 0; tc < tc_steps; tc++) {
+                        int pc_offset = tc * pool_tc;
+                        int pc_bound = std::min(pool_tc, store_W - pc_offset);
+                        int c_offset = pc_offset * pool_S;
+                        int tc_bound = (pc_bound - 1) * pool_S + pool_K;
+                        int cols = (tc_bound - 1) * S + K;
+
+                        model_init_output_buffer(est, params);
+
+                        for (int tn = 0; tn < tn_steps; tn++) {
+                            int n_offset = tn * TN;
+                            int tn_bound = (N - n_offset < TN) ? (N - n_offset) : TN;
+
+                            if (tc > 0) {
+                                model_input_halo(est, params, halo_cols, rows);
+                            }
+                            model_load_input_window(est, params, b * N + n_offset, r_offset, c_offset, (tc > 0) ? halo_cols : 0,
+                                rows, cols, b * N + N, input_H, input_W, S, P);
+                            if (tc + 1 < tc_steps) {
+                                model_input_halo(est, params, halo_cols, rows);
+                            }
+                            model_compute_tile(est, params, K, tm_bound, tn_bound, tr_bound, tc_bound);
+                        }
+
+                        model_write_output_tile(est, params, b * M + m_offset, pr_offset, pc_offset, b * M + M, store_H, store_W,
+                            tm_bound, tr_bound, tc_bound, relu, pool_size, pool_stride);
+                    }
+                }
+            }
+        }
+    }
+    else if (N <= TN && M <= TM && output_H <= TR && output_W <= TC) {
+        model_load_bias(est, params, 0, M, resident);
+        model_load_weight_tile(est, params, 0, 0, M, N, K, resident, tiled);
+        for (int b = 0; b < B; b++) {
+            model_load_input_tile(est, params, b * N, 0, 0, b * N + N, input_H, input_W, S, P);
+            model_init_output_buffer(est, params);
+            model_compute_tile(est, params, K, M, N, output_H, output_W);
+            model_write_output_tile(est, params, b * M, 0, 0, b * M + M, store_H, store_W,
+                M, output_H, output_W, relu, pool_size, pool_stride);
+        }
+    }
+    else {
+        int tm_steps = (M + TM - 1) / TM;
+        int tn_steps = (N + TN - 1) / TN;
+        int tr_steps = (store_H + pool_tr - 1) / pool_tr;
+        int tc_steps = (store_W + pool_tc - 1) / pool_tc;
+
+        // Each weight tile serves the up to MAX_BATCH images of a batch group
+        for (int b0 = 0; b0 < B; b0 += MAX_BATCH) {
+            int batch_bound = std::min(MAX_BATCH, B - b0);
+
+            for (int tm = 0; tm < tm_steps; tm++) {
+                int m_offset = tm * TM;
+                int tm_bound = (M - m_offset < TM) ? (M - m_offset) : TM;
+                model_load_bias(est, params, m_offset, M, resident);
+
+                for (int tr = 0; tr < tr_steps; tr++) {
+                    int pr_offset = tr * pool_tr;
+                    int pr_bound = std::min(pool_tr, store_H - pr_offset);
+                    int r_offset = pr_offset * pool_S;
+                    int tr_bound = (pr_bound - 1) * pool_S + pool_K;
+
+                    for (int tc = 0; tc < tc_steps; tc++) {
+                        int pc_offset = tc * pool_tc;
+                        int pc_bound = std::min(pool_tc, store_W - pc_offset);
+                        int c_offset = pc_offset * pool_S;
+                        int tc_bound = (pc_bound - 1) * pool_S + pool_K;
+
+                        for (int b = 0; b < batch_bound; b++) {
+                            model_init_output_buffer(est, params);
+                        }
+
+                        for (int tn = 0; tn < tn_steps; tn++) {
+                            int n_offset = tn * TN;
+                            int tn_bound = (N - n_offset < TN) ? (N - n_offset) : TN;
+
+                            model_load_weight_tile(est, params, m_offset, n_offset, M, N, K, resident, tiled);
+                            for (int b = 0; b < batch_bound; b++) {
+                                int image_n = (b0 + b) * N;
+                                model_load_input_tile(est, params, image_n + n_offset, r_offset, c_offset, image_n + N, input_H, input_W, S, P);
+                                model_compute_tile(est, params, K, tm_bound, tn_bound, tr_bound, tc_bound);
+                            }
+                        }
+
+                        for (int b = 0; b < batch_bound; b++) {
+                            int image_m = (b0 + b) * M;
+                            model_write_output_tile(est, params, image_m + m_offset, pr_offset, pc_offset, image_m + M, store_H, store_W,
+                                tm_bound, tr_bound, tc_bound, relu, pool_size, pool_stride);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    est.total_cycles = est.load_input_cycles + est.load_weight_cycles + est.load_bias_cycles
+        + est.init_output_cycles + est.compute_cycles + est.relu_cycles + est.store_output_cycles;
+    return est;
+}
+
+PerfEstimate perf_estimate_network(
+    const std::vector<LayerConfig>& layers,
+    const PerfModelParams& params,
+    std::vector<PerfEstimate>* per_layer) {
+
+    PerfEstimate total = PerfEstimate();
+    total.supported = true;
+    if (per_layer) {
+        per_layer->clear();
+    }
+
+    for (const LayerConfig& layer : layers) {
+        PerfEstimate est = perf_estimate_layer(layer, params);
+        total.load_input_cycles += est.load_input_cycles;
+        total.load_weight_cycles += est.load_weight_cycles;
+        total.load_bias_cycles += est.load_bias_cycles;
+        total.init_output_cycles += est.init_output_cycles;
+        total.compute_cycles += est.compute_cycles;
+        total.relu_cycles += est.relu_cycles;
+        total.store_output_cycles += est.store_output_cycles;
+        total.total_cycles += est.total_cycles;
+        total.read_beats += est.read_beats;
+        total.write_beats += est.write_beats;
+        total.read_bursts += est.read_bursts;
+        total.write_bursts += est.write_bursts;
+        for (int b = 0; b < PERF_BUNDLES; b++) {
+            total.bundle_beats[b] += est.bundle_beats[b];
+        }
+        total.macs += est.macs;
+        total.supported = total.supported && est.supported;
+        if (per_layer) {
+            per_layer->push_back(est);
+        }
+    }
+    return total;
+}
+
+// Banks of at most this many bits are mapped to LUTRAM instead of block RAM
+#define PERF_LUTRAM_MAX_BITS 1024
+
+// 18Kb block RAMs for one bank of `depth` x `width` bits, using the cheapest
+// of the 16K x 1 ... 512 x 36 aspect ratios
+static int bram18k_bank(long long depth, int width) {
+    if (depth * width <= PERF_LUTRAM_MAX_BITS) {
+        return 0;
+    }
+    static const int widths[] = { 1, 2, 4, 9, 18, 36 };
+    static const int depths[] = { 16384, 8192, 4096, 2048, 1024, 512 };
+    long long best = -1;
+    for (int i = 0; i < 6; i++) {
+        long long count = (long long)ceil_div(width, widths[i]) * ((depth + depths[i] - 1) / depths[i]);
+        if (best < 0 || count < best) {
+            best = count;
+        }
+    }
+    return static_cast<int>(best);
+}
+
+static int bram18k_array(int banks, long long elements, int width) {
+    return banks * bram18k_bank((elements + banks - 1) / banks, width);
+}
+
+PerfResources perf_estimate_resources(int weight_bits, int act_bits, int acc_bits, const PerfModelParams& params) {
+    PerfResources res = PerfResources();
+    const int K2 = MAX_KERNEL_SIZE * MAX_KERNEL_SIZE;
+    const int copies = params.pingpong ? 2 : 1;
+
+    // compute_tile: too_inner_loop (2) x tii_loop (TN) per cycle, or TM x TN
+    // PEs of the systolic array; the line-buffer engine adds TM lanes of
+    // MAX_KERNEL_SIZE^2 taps
+    res.multipliers = params.systolic ? TM * TN : 2 * TN;
+    // fc_tile of the process_layer tops has its own MAC
+    if (!params.pingpong) {
+        res.multipliers += 1;
+    }
+    if (params.line_buffer && !params.packed_axi && !params.pingpong) {
+        res.multipliers += TM * K2;
+    }
+    int wide = std::max(weight_bits, act_bits);
+    int narrow = std::min(weight_bits, act_bits);
+    res.dsp_per_multiplier = ceil_div(wide, 27) * ceil_div(narrow, 18);
+    res.dsp = res.multipliers * res.dsp_per_multiplier;
+
+    // The two too_inner_loop multipliers of each tii share one DSP48E2
+    if (params.dsp_packing && !params.systolic && weight_bits <= 8 && act_bits <= 8) {
+        res.packed_multipliers = 2 * TN;
+        res.dsp -= TN;
+    }
+
+    // Tile buffers with the bank counts of their ARRAY_PARTITION pragmas
+    res.bram18k += copies * bram18k_array(TN, (long long)TN * INPUT_TILE_HEIGHT * INPUT_TILE_WIDTH, act_bits);
+    res.bram18k += copies * bram18k_array(4, (long long)TM * TN * K2, weight_bits);
+    // output_buffer: the systolic array needs one bank per output channel
+    int output_banks = params.systolic ? TM : 2;
+    res.bram18k += params.pingpong ? 2 * bram18k_array(output_banks, (long long)TM * TR * TC, acc_bits)
+        : bram18k_array(output_banks, (long long)MAX_BATCH * TM * TR * TC, acc_bits);
+
+    if (!params.pingpong) {
+        // pool_buffer of the fused conv+pool tiles
+        res.bram18k += bram18k_array(1, (long long)TM * TR * TC, acc_bits);
+        // Reuse schedule caches and the resident weight store
+        res.bram18k += bram18k_array(4, (long long)MAX_RESIDENT_TILES * TM * TN * K2, weight_bits);
+        res.bram18k += bram18k_array(TN, (long long)MAX_RESIDENT_TILES * TN * INPUT_TILE_HEIGHT * (MAX_KERNEL_SIZE - 1), act_bits);
+        res.bram18k += bram18k_array(1, RESIDENT_STORE_SIZE, weight_bits);
+        // fc_input of the FC path
+        res.bram18k += bram18k_array(1, FC_INPUT_BUFFER_SIZE, act_bits);
+    }
+    if (params.line_buffer && !params.packed_axi && !params.pingpong) {
+        res.bram18k += bram18k_array(TM, (long long)LB_MAX_OUTPUT_CHANNELS * LB_MAX_OUTPUT_PIXELS, acc_bits);
+        res.bram18k += bram18k_array(MAX_KERNEL_SIZE - 1, (long long)(MAX_KERNEL_SIZE - 1) * LB_MAX_WIDTH, act_bits);
+    }
+    return res;
+}
+
+long long perf_layer_descriptor_cycles(const PerfModelParams& params) {
+    const int words = static_cast<int>(sizeof(LayerDescriptor) / sizeof(int));
+    const int bursts = (words + AXI_BURST_LEN - 1) / AXI_BURST_LEN;
+    return pipelined(words, 1, params.pipeline_depth) + params.axi_read_latency + bursts * params.burst_overhead;
+}
+
+PerfCounters perf_predict_counters(const PerfEstimate& est) {
+    PerfCounters counters;
+    counters.total_cycles = est.total_cycles;
+    const long long transfer_cycles[PERF_BUNDLES] = {
+        est.load_input_cycles, est.store_output_cycles, est.load_weight_cycles, est.load_bias_cycles };
+    for (int b = 0; b < PERF_BUNDLES; b++) {
+        counters.words[b] = est.bundle_beats[b];
+        counters.stall_cycles[b] = std::max(0LL, transfer_cycles[b] - est.bundle_beats[b]);
+    }
+    return counters;
+}
+
+double perf_cycles_to_ms(long long cycles) {
+    return cycles / (PERF_CLOCK_MHZ * 1000.0);
+}
+
+int perf_beat_bytes(const PerfModelParams& params) {
+    return params.packed_axi ? DDR_INTERFACE_WIDTH / 8 : PERF_ELEMENT_BYTES;
+}
@@ -0,0 +1,103 @@
+#ifndef PERF_MODEL_H
+#define PERF_MODEL_H
+
+#include <vector>
+#include "cnn_types.h"
+
+// Accelerator clock (clock=200MHz in mnist_hls_config.cfg)
+#define PERF_CLOCK_MHZ 200
+
+// Bytes per element on the m_axi ports (data_t and weight_t are padded to 16 bits)
+#define PERF_ELEMENT_BYTES 2
+
+// Micro-architecture assumptions of the model. The defaults are typical
+// values for Vitis HLS at 200 MHz on the KV260 and can be recalibrated
+// against a synthesis or co-simulation report.
+typedef struct {
+    int bram_ports;        // Ports per BRAM bank (true dual-port)
+    int pipeline_depth;    // Depth of the copy/clear/ReLU pipelines
+    int mac_depth;         // Depth of the compute_tile multiply-accumulate pipeline
+    int loop_overhead;     // Entry/exit cycles per iteration of a non-pipelined loop
+    int call_overhead;     // Start/finish cycles of an INLINE off sub-function
+    int axi_read_latency;  // Cycles from the first read request to the first data beat
+    int axi_write_latency; // Cycles from the last write beat to the write response
+    int burst_overhead;    // Address-phase cycles per AXI burst
+    int start_cycles;      // Host round trip of one accelerator start: s_axilite writes of
+                           // the arguments, ap_start and ap_done polling
+    bool packed_axi;       // Model fashion_mnist_cnn_accelerator_wide (DDR_PACK elements per beat)
+    bool pingpong;         // Model fashion_mnist_cnn_accelerator_pingpong (overlapped load/compute/store)
+    bool line_buffer;      // Model the USE_LINE_BUFFER_ENGINE build (default: as compiled)
+    bool systolic;         // Model the USE_SYSTOLIC_ENGINE build (default: as compiled)
+    bool zero_skip;        // Model the USE_ZERO_SKIP_ENGINE build (default: as compiled)
+    bool dsp_packing;      // Model the USE_DSP_PACKING build: two products of at most
+                           // 8 x 8 bits per DSP48E2 (default: as compiled)
+    double issued_slots;   // zero_skip: fraction of pixel slots with a nonzero activation,
+                           // e.g. measured by zero_skip_counters (default: 1, no zeros)
+} PerfModelParams;
+
+// Cycle and AXI traffic estimate of one or more fashion_mnist_cnn_accelerator calls
+typedef struct {
+    // Cycles spent in each function (busy cycles; with pingpong they overlap)
+    long long load_input_cycles;
+    long long load_weight_cycles;
+    long long load_bias_cycles;
+    long long init_output_cycles;
+    long long compute_cycles;      // compute_tile and pool_output_tile, or pool_tile for max-pooling layers
+    long long relu_cycles;
+    long long store_output_cycles;
+    long long total_cycles;
+
+    // AXI traffic, one beat per data_t element (per DDR word with packed_axi)
+    long long read_beats;
+    long long write_beats;
+    long long read_bursts;
+    long long write_bursts;
+    long long bundle_beats[PERF_BUNDLES]; // read_beats + write_beats per m_axi bundle (PERF_BUNDLE_*)
+
+    long long macs;        // Useful multiply-accumulates of the layer(s)
+    bool supported;        // False if a layer exceeds MAX_KERNEL_SIZE or MAX_STRIDE, or the modelled top rejects it
+} PerfEstimate;
+
+// DSP and BRAM estimate of one accelerator build
+typedef struct {
+    int multipliers;         // weight_t x data_t multipliers working in parallel
+    int dsp_per_multiplier;  // DSP48E2 slices (27 x 18 signed) per multiplier
+    int packed_multipliers;  // Multipliers sharing a DSP48E2 with another one (dsp_packing)
+    int dsp;
+    int bram18k;             // 18Kb block RAMs of the on-chip buffers
+} PerfResources;
+
+PerfModelParams perf_default_params();
+
+// Estimate one accelerator call by walking the same loop nest as cnn_top.cpp
+PerfEstimate perf_estimate_layer(const LayerConfig& layer_config, const PerfModelParams& params);
+
+// Estimate a sequence of accelerator calls (one per LayerConfig). The per-layer
+// estimates are returned in per_layer when it is not null.
+PerfEstimate perf_estimate_network(
+    const std::vector<LayerConfig>& layers,
+    const PerfModelParams& params,
+    std::vector<PerfEstimate>* per_layer);
+
+// Estimate the multipliers and buffers of the build selected by params for
+// the given weight_t, data_t and acc_t widths (the cycle estimates above do not
+// depend on the precision: every element keeps its DDR_ELEMENT_BITS lane)
+PerfResources perf_estimate_resources(int weight_bits, int act_bits, int acc_bits, const PerfModelParams& params);
+
+// Read of one LayerDescriptor, in 32-bit words, by fashion_mnist_cnn_accelerator_network
+long long perf_layer_descriptor_cycles(const PerfModelParams& params);
+
+// PerfCounters that fashion_mnist_cnn_accelerator_counted should report for
+// the call(s) of an estimate: the words are the bundle beats, and the stall
+// cycles of a bundle are the cycles of its load or store functions beyond one
+// per beat. Exact for the words; the cycles are only as good as the params.
+// The hardware times transfers to DDR only, so compare the stall cycles of
+// WEIGHTS_FROM_DDR calls of the tiled engine (not USE_LINE_BUFFER_ENGINE).
+PerfCounters perf_predict_counters(const PerfEstimate& est);
+
+double perf_cycles_to_ms(long long cycles);
+
+// Bytes moved by one AXI beat
+int perf_beat_bytes(const PerfModelParams& params);
+
+#endif // PERF_MODEL_H
@@ -0,0 +1,287 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "perf_model.h"
+
+/**
+ * Prints the perf_model estimate of fashion_mnist_cnn_accelerator (data_t AXI
+ * ports), fashion_mnist_cnn_accelerator_wide (128-bit packed AXI ports) and
+ * fashion_mnist_cnn_accelerator_pingpong (double-buffered tiles) for every conv
+ * layer of a network and for the whole sequence, and the data_t AXI estimate
+ * again with the reuse schedule (LayerConfig.reuse_enable), with the
+ * line-buffer engine (USE_LINE_BUFFER_ENGINE=1) and with the systolic array
+ * (USE_SYSTOLIC_ENGINE=1). For the built-in networks it also compares every
+ * conv layer followed by a max-pooling call with the fused conv+pool call, and
+ * one start per layer with one start of the layer table for all layers.
+ *
+ *   perf_report                 Fashion-MNIST and AlexNet conv layers
+ *   perf_report <layers.txt>    One layer per line: name N H W M K S P
+ */
+
+struct NamedLayer {
+    std::string name;
+    LayerConfig config;
+};
+
+// Max-pooling that follows a conv layer of the network
+struct PoolAfter {
+    std::string conv;
+    int size;
+    int stride;
+};
+
+static LayerConfig make_conv_config(int N, int H, int W, int M, int K, int S, int P) {
+    LayerConfig config = default_layer_config();
+    config.input_channels = N;
+    config.output_channels = M;
+    config.input_height = H;
+    config.input_width = W;
+    config.output_height = (H + 2 * P - K) / S + 1;
+    config.output_width = (W + 2 * P - K) / S + 1;
+    config.kernel_size = K;
+    config.stride = S;
+    config.padding = P;
+    config.layer_type = LAYER_CONV;
+    config.relu_enable = 1;
+    return config;
+}
+
+static std::vector<NamedLayer> fashion_mnist_layers() {
+    return {
+        { "conv1", make_conv_config( 1, 28, 28, 32, 3, 1, 1) },
+        { "conv2", make_conv_config(32, 14, 14, 64, 3, 1, 1) },
+    };
+}
+
+static std::vector<NamedLayer> alexnet_layers() {
+    return {
+        { "conv1", make_conv_config(  3, 224, 224,  64, 11, 4, 2) },
+        { "conv2", make_conv_config( 64,  27,  27, 192,  5, 1, 2) },
+        { "conv3", make_conv_config(192,  13,  13, 384,  3, 1, 1) },
+        { "conv4", make_conv_config(384,  13,  13, 256,  3, 1, 1) },
+        { "conv5", make_conv_config(256,  13,  13, 256,  3, 1, 1) },
+    };
+}
+
+static std::vector<PoolAfter> fashion_mnist_pools() {
+    return { { "conv1", 2, 2 }, { "conv2", 2, 2 } };
+}
+
+static std::vector<PoolAfter> alexnet_pools() {
+    return { { "conv1", 3, 2 }, { "conv2", 3, 2 }, { "conv5", 3, 2 } };
+}
+
+static bool read_layers(const char* path, std::vector<NamedLayer>& layers) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream fields(line);
+        NamedLayer layer;
+        int N, H, W, M, K, S, P;
+        if (!(fields >> layer.name >> N >> H >> W >> M >> K >> S >> P)) {
+            std::cerr << "Malformed layer line: " << line << std::endl;
+            return false;
+        }
+        layer.config = make_conv_config(N, H, W, M, K, S, P);
+        layers.push_back(layer);
+    }
+    return true;
+}
+
+static void print_row(const char* name, const PerfEstimate& est, const PerfModelParams& params) {
+    double ms = perf_cycles_to_ms(est.total_cycles);
+    double megabytes = (est.read_beats + est.write_beats) * perf_beat_bytes(params) / 1.0e6;
+    double gops = (ms > 0.0) ? 2.0 * est.macs / (ms * 1.0e6) : 0.0;
+
+    std::printf("%-8s %12lld %9.1f%% %9.1f%% %9.1f%% %9.1f%% %9.3f %9.3f %8.3f%s\n",
+        name,
+        est.total_cycles,
+        100.0 * est.load_input_cycles / est.total_cycles,
+        100.0 * est.load_weight_cycles / est.total_cycles,
+        100.0 * est.compute_cycles / est.total_cycles,
+        100.0 * (est.load_bias_cycles + est.init_output_cycles + est.relu_cycles + est.store_output_cycles) / est.total_cycles,
+        ms,
+        megabytes,
+        gops,
+        est.supported ? "" : "  (exceeds MAX_KERNEL_SIZE/MAX_STRIDE)");
+}
+
+static void report_network(const char* title, const std::vector<NamedLayer>& layers, const PerfModelParams& params,
+    bool reuse = false) {
+    std::vector<LayerConfig> configs;
+    for (const NamedLayer& layer : layers) {
+        configs.push_back(layer.config);
+        configs.back().reuse_enable = reuse ? 1 : 0;
+    }
+
+    std::vector<PerfEstimate> per_layer;
+    PerfEstimate total = perf_estimate_network(configs, params, &per_layer);
+
+    std::printf("\n=== %s, %s%s%s%s ===\n", title,
+        params.pingpong ? "double-buffered tiles" : (params.packed_axi ? "128-bit packed AXI" : "data_t AXI"),
+        reuse ? ", reuse schedule" : "",
+        (params.line_buffer && !params.pingpong && !params.packed_axi) ? ", line-buffer engine" : "",
+        params.systolic ? ", systolic array" : "");
+    std::printf("%-8s %12s %10s %10s %10s %10s %9s %9s %8s\n",
+        "layer", "cycles", "in load", "w load", "compute", "other", "ms", "AXI MB", "GOP/s");
+    for (size_t i = 0; i < layers.size(); i++) {
+        print_row(layers[i].name.c_str(), per_layer[i], params);
+    }
+    print_row("total", total, params);
+    if (params.pingpong) {
+        std::printf("(function shares are busy cycles; load, compute and store overlap, so they add up to more than 100%%)\n");
+    }
+}
+
+// Conv call plus max-pooling call vs. one conv call with the pooling fused,
+// both with the reuse schedule the host driver uses for conv layers
+static void report_fused_pooling(const char* title, const std::vector<NamedLayer>& layers,
+    const std::vector<PoolAfter>& pools, const PerfModelParams& params) {
+    std::printf("\n=== %s, conv + max-pool calls vs. fused pooling, data_t AXI, reuse schedule ===\n", title);
+    std::printf("%-8s %6s %12s %12s %11s %11s %11s\n",
+        "layer", "pool", "cycles", "fused", "AXI MB", "fused MB", "written MB");
+    for (const PoolAfter& pool : pools) {
+        for (const NamedLayer& layer : layers) {
+            if (layer.name != pool.conv) {
+                continue;
+            }
+            LayerConfig conv = layer.config;
+            conv.reuse_enable = 1;
+            LayerConfig pool_config = conv;
+            pool_config.input_channels = conv.output_channels;
+            pool_config.input_height = conv.output_height;
+            pool_config.input_width = conv.output_width;
+            pool_config.output_height = fused_pool_extent(conv.output_height, pool.size, pool.stride);
+            pool_config.output_width = fused_pool_extent(conv.output_width, pool.size, pool.stride);
+            pool_config.kernel_size = pool.size;
+            pool_config.stride = pool.stride;
+            pool_config.padding = 0;
+            pool_config.layer_type = LAYER_MAXPOOL;
+            pool_config.relu_enable = 0;
+            LayerConfig fused = conv;
+            fused.pool_size = pool.size;
+            fused.pool_stride = pool.stride;
+
+            PerfEstimate separate = perf_estimate_network({ conv, pool_config }, params, nullptr);
+            PerfEstimate together = perf_estimate_layer(fused, params);
+            double beat_mb = perf_beat_bytes(params) / 1.0e6;
+            char window[16];
+            std::snprintf(window, sizeof(window), "%d/%d", pool.size, pool.stride);
+            std::printf("%-8s %6s %12lld %12lld %11.3f %11.3f %5.3f->%-5.3f%s\n",
+                layer.name.c_str(), window, separate.total_cycles, together.total_cycles,
+                (separate.read_beats + separate.write_beats) * beat_mb,
+                (together.read_beats + together.write_beats) * beat_mb,
+                separate.write_beats * beat_mb, together.write_beats * beat_mb,
+                together.supported ? "" : "  (exceeds MAX_KERNEL_SIZE/MAX_STRIDE)");
+        }
+    }
+}
+
+// One accelerator start per layer vs. one start of
+// fashion_mnist_cnn_accelerator_network reading a LayerDescriptor per layer
+static void report_layer_table(const char* title, const std::vector<NamedLayer>& layers, const PerfModelParams& params) {
+    std::vector<LayerConfig> configs;
+    for (const NamedLayer& layer : layers) {
+        configs.push_back(layer.config);
+    }
+    long long layer_cycles = perf_estimate_network(configs, params, nullptr).total_cycles;
+    long long count = static_cast<long long>(layers.size());
+    long long per_layer = layer_cycles + count * params.start_cycles;
+    long long table = layer_cycles + params.start_cycles + count * perf_layer_descriptor_cycles(params);
+
+    std::printf("\n=== %s, %lld layers, per-layer starts vs. layer table (%d cycles per start) ===\n",
+        title, count, params.start_cycles);
+    std::printf("%-12s %12s %12s %9s\n", "", "cycles", "overhead", "ms");
+    std::printf("%-12s %12lld %12lld %9.3f\n", "per-layer", per_layer, per_layer - layer_cycles, perf_cycles_to_ms(per_layer));
+    std::printf("%-12s %12lld %12lld %9.3f\n", "layer table", table, table - layer_cycles, perf_cycles_to_ms(table));
+}
+
+// Weight loads of every layer from [M][N][K*K] weights (one burst per kernel
+// row of a tile) vs. tile-major weights (one burst per tile)
+static void report_weight_layout(const char* title, const std::vector<NamedLayer>& layers, const PerfModelParams& params) {
+    std::printf("\n=== %s, %s AXI, OIHW vs. tile-major weights ===\n", title,
+        params.packed_axi ? "packed" : "element");
+    std::printf("%-8s %12s %12s %12s %12s %9s %9s\n", "layer", "wload OIHW", "wload tiled",
+        "bursts OIHW", "bursts tiled", "ms OIHW", "ms tiled");
+    long long total[2] = {0, 0};
+    for (const NamedLayer& layer : layers) {
+        LayerConfig tiled = layer.config;
+        tiled.weight_layout = WEIGHT_LAYOUT_TILED;
+        PerfEstimate a = perf_estimate_layer(layer.config, params);
+        PerfEstimate b = perf_estimate_layer(tiled, params);
+        total[0] += a.total_cycles;
+        total[1] += b.total_cycles;
+        std::printf("%-8s %12lld %12lld %12lld %12lld %9.3f %9.3f\n", layer.name.c_str(),
+            a.load_weight_cycles, b.load_weight_cycles, a.read_bursts, b.read_bursts,
+            perf_cycles_to_ms(a.total_cycles), perf_cycles_to_ms(b.total_cycles));
+    }
+    std::printf("%-8s %12s %12s %12s %12s %9.3f %9.3f\n", "total", "", "", "", "",
+        perf_cycles_to_ms(total[0]), perf_cycles_to_ms(total[1]));
+}
+
+int main(int argc, char* argv[]) {
+    // The first three tables model the tiled engine whatever the build
+    PerfModelParams params = perf_default_params();
+    params.line_buffer = false;
+    params.systolic = false;
+    params.zero_skip = false;
+    PerfModelParams packed_params = params;
+    packed_params.packed_axi = true;
+    PerfModelParams pingpong_params = params;
+    pingpong_params.pingpong = true;
+    PerfModelParams line_buffer_params = params;
+    line_buffer_params.line_buffer = true;
+    PerfModelParams systolic_params = params;
+    systolic_params.systolic = true;
+
+    std::printf("v3 accelerator performance model at %d MHz (Tm=%d Tn=%d Tr=%d Tc=%d, AXI burst %d)\n",
+        PERF_CLOCK_MHZ, TM, TN, TR, TC, AXI_BURST_LEN);
+
+    if (argc > 1) {
+        std::vector<NamedLayer> layers;
+        if (!read_layers(argv[1], layers)) {
+            return 1;
+        }
+        report_network(argv[1], layers, params);
+        report_network(argv[1], layers, packed_params);
+        report_network(argv[1], layers, pingpong_params);
+        report_network(argv[1], layers, params, true);
+        report_network(argv[1], layers, line_buffer_params);
+        report_network(argv[1], layers, systolic_params);
+        return 0;
+    }
+
+    report_network("Fashion-MNIST", fashion_mnist_layers(), params);
+    report_network("Fashion-MNIST", fashion_mnist_layers(), packed_params);
+    report_network("Fashion-MNIST", fashion_mnist_layers(), pingpong_params);
+    report_network("Fashion-MNIST", fashion_mnist_layers(), params, true);
+    report_network("Fashion-MNIST", fashion_mnist_layers(), line_buffer_params);
+    report_network("Fashion-MNIST", fashion_mnist_layers(), systolic_params);
+    report_fused_pooling("Fashion-MNIST", fashion_mnist_layers(), fashion_mnist_pools(), params);
+    report_layer_table("Fashion-MNIST", fashion_mnist_layers(), params);
+    report_weight_layout("Fashion-MNIST", fashion_mnist_layers(), params);
+    report_weight_layout("Fashion-MNIST", fashion_mnist_layers(), packed_params);
+    report_network("AlexNet", alexnet_layers(), params);
+    report_network("AlexNet", alexnet_layers(), packed_params);
+    report_network("AlexNet", alexnet_layers(), pingpong_params);
+    report_network("AlexNet", alexnet_layers(), params, true);
+    report_network("AlexNet", alexnet_layers(), line_buffer_params);
+    report_network("AlexNet", alexnet_layers(), systolic_params);
+    report_fused_pooling("AlexNet", alexnet_layers(), alexnet_pools(), params);
+    report_layer_table("AlexNet", alexnet_layers(), params);
+    report_weight_layout("AlexNet", alexnet_layers(), params);
+    report_weight_layout("AlexNet", alexnet_layers(), packed_params);
+    return 0;
+}
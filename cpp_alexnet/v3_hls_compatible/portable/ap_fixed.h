@@ -0,0 +1,286 @@
+/******************************************************************************
+ * Portable replacement for the Xilinx ap_fixed.h header
+ *
+ * Integer-backed ap_fixed<W, I, Q, O> for W <= 64 that reproduces the bit-level
+ * behaviour of the Xilinx type for the modes used by the accelerator:
+ *   - AP_TRN (default): quantize towards minus infinity (floor)
+ *   - AP_RND: quantize to the nearest value, ties towards plus infinity
+ *   - AP_WRAP (default): keep the low W bits (two's complement wrap-around)
+ *   - AP_SAT: clamp to the representable range
+ * Arithmetic follows the Xilinx full-precision result types: a + b and a - b
+ * grow by one integer bit, a * b has W1 + W2 bits, and the result is only
+ * quantized when it is assigned (or compound-assigned) to a narrower type.
+ *
+ * Requires GCC or Clang (__int128 is used for exact intermediate shifts).
+ ******************************************************************************/
+
+#ifndef PORTABLE_AP_FIXED_H
+#define PORTABLE_AP_FIXED_H
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+#include "ap_int.h"
+
+template <int W, int I, ap_q_mode Q = AP_TRN, ap_o_mode O = AP_WRAP, int N = 0>
+class ap_fixed;
+
+#define AP_FIXED_TPL(n) int W##n, int I##n, ap_q_mode Q##n, ap_o_mode O##n, int N##n
+#define AP_FIXED_TYPE(n) ap_fixed<W##n, I##n, Q##n, O##n, N##n>
+
+namespace ap_portable {
+
+__extension__ typedef __int128 int128_t;
+
+constexpr int max_int(int a, int b) { return a > b ? a : b; }
+
+// Result types of the full-precision operators (same rules as the Xilinx RType)
+template <int W1, int I1, int W2, int I2>
+struct fixed_rtype {
+    static const int F1 = W1 - I1;
+    static const int F2 = W2 - I2;
+    static const int plus_i = max_int(I1, I2) + 1;
+    typedef ap_fixed<plus_i + max_int(F1, F2), plus_i> plus;
+    typedef ap_fixed<W1 + W2, I1 + I2> mult;
+    typedef ap_fixed<W1 + max_int(F2, 0) + 1, I1 + F2 + 1> div;
+};
+
+// Integers take part in fixed-point arithmetic as ap_fixed<bits, bits>
+template <typename T>
+struct int_fixed {
+    static_assert(sizeof(T) <= 4, "portable ap_fixed arithmetic supports integers up to 32 bits");
+    static const int bits = 8 * static_cast<int>(sizeof(T)) + (std::is_signed<T>::value ? 0 : 1);
+    typedef ap_fixed<bits, bits> type;
+};
+
+// v * 2^shift without signed-overflow undefined behaviour
+inline int64_t shift_left(int64_t v, int shift) {
+    return static_cast<int64_t>(static_cast<uint64_t>(v) << shift);
+}
+
+// Compare two raw values with f1 and f2 fractional bits: <0, 0 or >0
+inline int compare_raw(int64_t v1, int f1, int64_t v2, int f2) {
+    const int f = max_int(f1, f2);
+    const int128_t a = static_cast<int128_t>(v1) * (static_cast<int128_t>(1) << (f - f1));
+    const int128_t b = static_cast<int128_t>(v2) * (static_cast<int128_t>(1) << (f - f2));
+    return (a < b) ? -1 : ((a > b) ? 1 : 0);
+}
+
+} // namespace ap_portable
+
+template <int W, int I, ap_q_mode Q, ap_o_mode O, int N>
+class ap_fixed {
+    static_assert(W >= 1 && W <= 64, "portable ap_fixed supports 1 to 64 bits");
+    static_assert(W >= I, "portable ap_fixed needs a non-negative number of fractional bits");
+    static_assert(Q == AP_TRN || Q == AP_RND, "portable ap_fixed supports AP_TRN and AP_RND quantization");
+    static_assert(O == AP_WRAP || O == AP_SAT, "portable ap_fixed supports AP_WRAP and AP_SAT overflow");
+    static_assert(N == 0, "portable ap_fixed does not model saturation bits");
+
+    typedef ap_portable::int128_t int128_t;
+
+public:
+    static const int width = W;
+    static const int iwidth = I;
+    static const ap_q_mode qmode = Q;
+    static const ap_o_mode omode = O;
+
+    // Raw two's complement value, i.e. the represented number times 2^(W - I)
+    int64_t V;
+
+    ap_fixed() : V(0) {}
+
+    template <AP_FIXED_TPL(2)>
+    ap_fixed(const AP_FIXED_TYPE(2)& other) : V(quantize(other.V, W2 - I2)) {}
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    ap_fixed(T value) : V(quantize(static_cast<int128_t>(value), 0)) {}
+
+    ap_fixed(float value) : V(from_double(value)) {}
+    ap_fixed(double value) : V(from_double(value)) {}
+
+    double to_double() const { return std::ldexp(static_cast<double>(V), -(W - I)); }
+    float to_float() const { return static_cast<float>(to_double()); }
+
+    // Integer part, rounded towards zero like a C cast
+    int to_int() const {
+        const int64_t scale = static_cast<int64_t>(1) << (W - I);
+        return static_cast<int>(V / scale);
+    }
+
+    operator double() const { return to_double(); }
+
+    // Raw bits, e.g. for packing into a wide DDR word
+    ap_portable::range_ref<ap_fixed> range(int hi, int lo) { return ap_portable::range_ref<ap_fixed>(*this, hi, lo); }
+    ap_portable::range_ref<const ap_fixed> range(int hi, int lo) const { return ap_portable::range_ref<const ap_fixed>(*this, hi, lo); }
+
+    unsigned long long get_range(int hi, int lo) const {
+        return ap_portable::get_bits(static_cast<uint64_t>(V), hi, lo);
+    }
+    void set_range(int hi, int lo, unsigned long long value) {
+        V = ap_portable::wrap_signed(static_cast<uint64_t>(ap_portable::set_bits(static_cast<uint64_t>(V), hi, lo, value)), W);
+    }
+
+    ap_fixed<W + 1, I + 1> operator-() const {
+        ap_fixed<W + 1, I + 1> result;
+        result.V = -V;
+        return result;
+    }
+
+    ap_fixed operator+() const { return *this; }
+
+    template <AP_FIXED_TPL(2)>
+    ap_fixed& operator+=(const AP_FIXED_TYPE(2)& rhs) { return *this = *this + rhs; }
+    template <AP_FIXED_TPL(2)>
+    ap_fixed& operator-=(const AP_FIXED_TYPE(2)& rhs) { return *this = *this - rhs; }
+    template <AP_FIXED_TPL(2)>
+    ap_fixed& operator*=(const AP_FIXED_TYPE(2)& rhs) { return *this = *this * rhs; }
+    template <AP_FIXED_TPL(2)>
+    ap_fixed& operator/=(const AP_FIXED_TYPE(2)& rhs) { return *this = *this / rhs; }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    ap_fixed& operator+=(T rhs) { return *this += typename ap_portable::int_fixed<T>::type(rhs); }
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    ap_fixed& operator-=(T rhs) { return *this -= typename ap_portable::int_fixed<T>::type(rhs); }
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    ap_fixed& operator*=(T rhs) { return *this *= typename ap_portable::int_fixed<T>::type(rhs); }
+
+private:
+    // Quantize a raw value with src_frac fractional bits, then handle overflow
+    static int64_t quantize(int128_t src, int src_frac) {
+        const int frac = W - I;
+        if (src_frac > frac) {
+            const int drop = src_frac - frac;
+            if (Q == AP_RND) {
+                src += static_cast<int128_t>(1) << (drop - 1);
+            }
+            return overflow(src >> drop);
+        }
+        return overflow(src * (static_cast<int128_t>(1) << (frac - src_frac)));
+    }
+
+    static int64_t overflow(int128_t value) {
+        if (O == AP_SAT) {
+            const int128_t max_raw = (static_cast<int128_t>(1) << (W - 1)) - 1;
+            const int128_t min_raw = -max_raw - 1;
+            return static_cast<int64_t>(value > max_raw ? max_raw : (value < min_raw ? min_raw : value));
+        }
+        return ap_portable::wrap_signed(static_cast<uint64_t>(value), W);
+    }
+
+    static int64_t from_double(double value) {
+        double scaled = std::ldexp(value, W - I);
+        scaled = (Q == AP_RND) ? std::floor(scaled + 0.5) : std::floor(scaled);
+        if (O == AP_SAT) {
+            const double limit = std::ldexp(1.0, W - 1);
+            if (scaled >= limit) return overflow(static_cast<int128_t>(1) << W);
+            if (scaled < -limit) return overflow(-(static_cast<int128_t>(1) << W));
+            return static_cast<int64_t>(scaled);
+        }
+        // fmod is exact, so reducing modulo 2^W first keeps the integer conversion in range
+        return overflow(static_cast<int128_t>(std::fmod(scaled, std::ldexp(1.0, W))));
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Fixed-point operators
+// ---------------------------------------------------------------------------
+
+template <AP_FIXED_TPL(1), AP_FIXED_TPL(2)>
+inline typename ap_portable::fixed_rtype<W1, I1, W2, I2>::plus
+operator+(const AP_FIXED_TYPE(1)& a, const AP_FIXED_TYPE(2)& b) {
+    typename ap_portable::fixed_rtype<W1, I1, W2, I2>::plus result;
+    const int frac = result.width - result.iwidth;
+    result.V = ap_portable::shift_left(a.V, frac - (W1 - I1)) + ap_portable::shift_left(b.V, frac - (W2 - I2));
+    return result;
+}
+
+template <AP_FIXED_TPL(1), AP_FIXED_TPL(2)>
+inline typename ap_portable::fixed_rtype<W1, I1, W2, I2>::plus
+operator-(const AP_FIXED_TYPE(1)& a, const AP_FIXED_TYPE(2)& b) {
+    typename ap_portable::fixed_rtype<W1, I1, W2, I2>::plus result;
+    const int frac = result.width - result.iwidth;
+    result.V = ap_portable::shift_left(a.V, frac - (W1 - I1)) - ap_portable::shift_left(b.V, frac - (W2 - I2));
+    return result;
+}
+
+template <AP_FIXED_TPL(1), AP_FIXED_TPL(2)>
+inline typename ap_portable::fixed_rtype<W1, I1, W2, I2>::mult
+operator*(const AP_FIXED_TYPE(1)& a, const AP_FIXED_TYPE(2)& b) {
+    typename ap_portable::fixed_rtype<W1, I1, W2, I2>::mult result;
+    result.V = a.V * b.V;
+    return result;
+}
+
+// Keeps the fractional bits of the dividend; the quotient truncates towards zero
+template <AP_FIXED_TPL(1), AP_FIXED_TPL(2)>
+inline typename ap_portable::fixed_rtype<W1, I1, W2, I2>::div
+operator/(const AP_FIXED_TYPE(1)& a, const AP_FIXED_TYPE(2)& b) {
+    typename ap_portable::fixed_rtype<W1, I1, W2, I2>::div result;
+    result.V = ap_portable::shift_left(a.V, ap_portable::max_int(W2 - I2, 0)) / b.V;
+    return result;
+}
+
+#define AP_FIXED_COMPARE_OP(op)                                                        \
+    template <AP_FIXED_TPL(1), AP_FIXED_TPL(2)>                                        \
+    inline bool operator op(const AP_FIXED_TYPE(1)& a, const AP_FIXED_TYPE(2)& b) {    \
+        return ap_portable::compare_raw(a.V, W1 - I1, b.V, W2 - I2) op 0;              \
+    }                                                                                  \
+    template <AP_FIXED_TPL(1), typename T,                                             \
+              typename std::enable_if<std::is_integral<T>::value, int>::type = 0>      \
+    inline bool operator op(const AP_FIXED_TYPE(1)& a, T b) {                          \
+        return ap_portable::compare_raw(a.V, W1 - I1, static_cast<int64_t>(b), 0) op 0; \
+    }                                                                                  \
+    template <AP_FIXED_TPL(1), typename T,                                             \
+              typename std::enable_if<std::is_integral<T>::value, int>::type = 0>      \
+    inline bool operator op(T a, const AP_FIXED_TYPE(1)& b) {                          \
+        return ap_portable::compare_raw(static_cast<int64_t>(a), 0, b.V, W1 - I1) op 0; \
+    }                                                                                  \
+    template <AP_FIXED_TPL(1)>                                                         \
+    inline bool operator op(const AP_FIXED_TYPE(1)& a, double b) {                     \
+        return a.to_double() op b;                                                     \
+    }                                                                                  \
+    template <AP_FIXED_TPL(1)>                                                         \
+    inline bool operator op(double a, const AP_FIXED_TYPE(1)& b) {                     \
+        return a op b.to_double();                                                     \
+    }
+
+AP_FIXED_COMPARE_OP(==)
+AP_FIXED_COMPARE_OP(!=)
+AP_FIXED_COMPARE_OP(<)
+AP_FIXED_COMPARE_OP(<=)
+AP_FIXED_COMPARE_OP(>)
+AP_FIXED_COMPARE_OP(>=)
+
+#undef AP_FIXED_COMPARE_OP
+
+// Mixed fixed/integer arithmetic converts the integer to ap_fixed<bits, bits> first
+#define AP_FIXED_INT_ARITH_OP(op)                                                      \
+    template <AP_FIXED_TPL(1), typename T,                                             \
+              typename std::enable_if<std::is_integral<T>::value, int>::type = 0>      \
+    inline auto operator op(const AP_FIXED_TYPE(1)& a, T b)                            \
+        -> decltype(a op typename ap_portable::int_fixed<T>::type(b)) {                \
+        return a op typename ap_portable::int_fixed<T>::type(b);                       \
+    }                                                                                  \
+    template <AP_FIXED_TPL(1), typename T,                                             \
+              typename std::enable_if<std::is_integral<T>::value, int>::type = 0>      \
+    inline auto operator op(T a, const AP_FIXED_TYPE(1)& b)                            \
+        -> decltype(typename ap_portable::int_fixed<T>::type(a) op b) {                \
+        return typename ap_portable::int_fixed<T>::type(a) op b;                       \
+    }
+
+AP_FIXED_INT_ARITH_OP(+)
+AP_FIXED_INT_ARITH_OP(-)
+AP_FIXED_INT_ARITH_OP(*)
+
+#undef AP_FIXED_INT_ARITH_OP
+
+template <AP_FIXED_TPL(1)>
+inline std::ostream& operator<<(std::ostream& os, const AP_FIXED_TYPE(1)& value) {
+    return os << value.to_double();
+}
+
+#undef AP_FIXED_TPL
+#undef AP_FIXED_TYPE
+
+#endif // PORTABLE_AP_FIXED_H
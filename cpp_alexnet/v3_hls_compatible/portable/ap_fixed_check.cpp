@@ -0,0 +1,281 @@
+/******************************************************************************
+ * Randomized bit-exactness check for the fixed-point arithmetic of the
+ * accelerator.
+ *
+ * Uses only the public ap_fixed API, so the same file builds against the
+ * portable headers (-Iportable) and against the Xilinx reference headers
+ * (Vitis HLS include directory or the open-source HLS_arbitrary_Precision_Types
+ * repository). Every result is compared against an independent integer model
+ * of AP_TRN/AP_WRAP, and with --trace every value is also printed so the output
+ * of both builds can be diffed line by line.
+ ******************************************************************************/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "cnn_types.h"
+#include "cnn_functions.h"
+
+typedef ap_fixed<16, 5> wide_t;   // cpp_fashion_mnist float24_t
+typedef ap_fixed<24, 12> product_t; // Full-precision data_t * data_t
+
+// The integer model below is written for the default precision of cnn_params.h
+static_assert(data_t::width == 12 && data_t::iwidth == 6 && weight_t::width == 12 && weight_t::iwidth == 6
+    && acc_t::width == 24 && acc_t::iwidth == 10,
+    "ap_fixed_check needs the default ap_fixed<12,6> data and weights and ap_fixed<24,10> accumulator");
+
+// Raw acc_t has ACC_FRAC fractional bits against the 6 of data_t and weight_t
+static const int ACC_WIDTH = 24;
+static const int ACC_FRAC = 14;
+
+static bool trace = false;
+static int failures = 0;
+
+// ---------------------------------------------------------------------------
+// Integer golden model: raw values scaled by 2^F, AP_TRN = floor, AP_WRAP = mod 2^W
+// ---------------------------------------------------------------------------
+
+static int64_t wrapRaw(int64_t raw, int width) {
+    const int64_t modulus = static_cast<int64_t>(1) << width;
+    int64_t wrapped = ((raw % modulus) + modulus) % modulus;
+    return (wrapped >= modulus / 2) ? wrapped - modulus : wrapped;
+}
+
+static int64_t floorShift(int64_t raw, int shift) {
+    const int64_t divisor = static_cast<int64_t>(1) << shift;
+    int64_t quotient = raw / divisor;
+    return (raw % divisor != 0 && raw < 0) ? quotient - 1 : quotient;
+}
+
+// Raw value of a double quantized to <width, iwidth> with AP_TRN/AP_WRAP
+static int64_t goldenFromDouble(double value, int width, int iwidth) {
+    double scaled = std::floor(std::ldexp(value, width - iwidth));
+    return wrapRaw(static_cast<int64_t>(scaled), width);
+}
+
+static int64_t rawOf(double value, int width, int iwidth) {
+    return static_cast<int64_t>(std::ldexp(value, width - iwidth));
+}
+
+static void check(const char* what, int index, double actual, double expected) {
+    if (trace) {
+        std::printf("%s %d %.17g\n", what, index, actual);
+    }
+    if (actual != expected) {
+        if (failures < 10) {
+            std::printf("MISMATCH %s[%d]: actual=%.17g expected=%.17g\n", what, index, actual, expected);
+        }
+        failures++;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scalar operations
+// ---------------------------------------------------------------------------
+
+static void checkScalarOps(std::mt19937& gen, int count) {
+    // Wider than the +/-32 range of data_t so the wrap-around path is exercised
+    std::uniform_real_distribution<double> wideDist(-80.0, 80.0);
+    std::uniform_real_distribution<float> unitDist(-1.0f, 1.0f);
+
+    for (int i = 0; i < count; i++) {
+        double x = wideDist(gen);
+        double y = wideDist(gen);
+        float f = unitDist(gen) * 4.0f;
+
+        // Conversion from double and float
+        data_t a = data_t(x);
+        data_t b = data_t(y);
+        data_t c = data_t(f);
+        check("from_double", i, a.to_double(), std::ldexp(static_cast<double>(goldenFromDouble(x, 12, 6)), -6));
+        check("from_float", i, c.to_double(), std::ldexp(static_cast<double>(goldenFromDouble(f, 12, 6)), -6));
+
+        int64_t rawA = rawOf(a.to_double(), 12, 6);
+        int64_t rawB = rawOf(b.to_double(), 12, 6);
+        int64_t rawC = rawOf(c.to_double(), 12, 6);
+
+        // Full-precision product and sum, then quantized back to data_t
+        product_t product = a * b;
+        check("mul_full", i, product.to_double(), std::ldexp(static_cast<double>(rawA * rawB), -12));
+
+        data_t sum = a + b;
+        check("add", i, sum.to_double(), std::ldexp(static_cast<double>(wrapRaw(rawA + rawB, 12)), -6));
+
+        data_t diff = a - b;
+        check("sub", i, diff.to_double(), std::ldexp(static_cast<double>(wrapRaw(rawA - rawB, 12)), -6));
+
+        // Multiply-accumulate exactly as written in compute_tile
+        data_t acc = c;
+        acc += a * b;
+        int64_t accRaw = wrapRaw(rawC + floorShift(rawA * rawB, 6), 12);
+        check("mac", i, acc.to_double(), std::ldexp(static_cast<double>(accRaw), -6));
+
+        // Comparisons used by apply_relu and the testbench
+        check("lt_zero", i, (a < 0) ? 1.0 : 0.0, (rawA < 0) ? 1.0 : 0.0);
+        check("lt", i, (a < b) ? 1.0 : 0.0, (rawA < rawB) ? 1.0 : 0.0);
+        check("eq", i, (a == b) ? 1.0 : 0.0, (rawA == rawB) ? 1.0 : 0.0);
+
+        // Conversion between formats: data_t -> ap_fixed<16,5> -> data_t
+        wide_t widened = a;
+        int64_t widenedRaw = wrapRaw(rawA * 32, 16);
+        check("to_wide", i, widened.to_double(), std::ldexp(static_cast<double>(widenedRaw), -11));
+        data_t narrowed = widened;
+        check("to_narrow", i, narrowed.to_double(), std::ldexp(static_cast<double>(wrapRaw(floorShift(widenedRaw, 5), 12)), -6));
+
+        // Negation and integer operands
+        data_t negated = -a;
+        check("neg", i, negated.to_double(), std::ldexp(static_cast<double>(wrapRaw(-rawA, 12)), -6));
+        data_t scaled = a * 3;
+        check("mul_int", i, scaled.to_double(), std::ldexp(static_cast<double>(wrapRaw(rawA * 3, 12)), -6));
+
+        // Raw bits through one 16-bit lane of a 128-bit DDR word
+        int lane = i % 8;
+        ap_uint<128> word = 0;
+        word.range(16 * lane + 11, 16 * lane) = a.range(11, 0);
+        data_t unpacked;
+        unpacked.range(11, 0) = word.range(16 * lane + 11, 16 * lane);
+        check("range_bits", i, static_cast<double>(a.range(11, 0).to_uint64()), static_cast<double>(rawA & 0xFFF));
+        check("range_uint", i, static_cast<double>(word.range(16 * lane + 15, 16 * lane).to_uint()), static_cast<double>(rawA & 0xFFF));
+        check("range_lane", i, unpacked.to_double(), a.to_double());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Whole accelerator on random layers
+// ---------------------------------------------------------------------------
+
+// Integer model of one conv + ReLU layer. The 12 fractional bits of a product
+// fit acc_t exactly, the sum wraps mod 2^24 and is floored to data_t when it is
+// stored, so the order of the accumulation (and therefore the tiling) does not
+// change the result.
+static void goldenConvLayer(
+    const std::vector<int64_t>& input, const std::vector<int64_t>& weights,
+    const std::vector<int64_t>& bias, std::vector<int64_t>& output,
+    int N, int H, int W, int M, int R, int C, int K, int S, int P) {
+    for (int m = 0; m < M; m++) {
+        for (int r = 0; r < R; r++) {
+            for (int c = 0; c < C; c++) {
+                int64_t acc = bias[m] << (ACC_FRAC - 6);
+                for (int n = 0; n < N; n++) {
+                    for (int i = 0; i < K; i++) {
+                        for (int j = 0; j < K; j++) {
+                            int h = r * S + i - P;
+                            int w = c * S + j - P;
+                            if (h < 0 || h >= H || w < 0 || w >= W) {
+                                continue;
+                            }
+                            int64_t product = weights[((m * N + n) * K + i) * K + j] * input[(n * H + h) * W + w];
+                            acc = wrapRaw(acc + (product << (ACC_FRAC - 12)), ACC_WIDTH);
+                        }
+                    }
+                }
+                output[(m * R + r) * C + c] = (acc < 0) ? 0 : wrapRaw(floorShift(acc, ACC_FRAC - 6), 12);
+            }
+        }
+    }
+}
+
+static void checkAccelerator(std::mt19937& gen, int count) {
+    std::uniform_int_distribution<int> kernelDist(1, MAX_KERNEL_SIZE);
+    std::uniform_int_distribution<int> strideDist(1, MAX_STRIDE);
+    std::uniform_int_distribution<int> channelDist(1, 12);
+    std::uniform_real_distribution<float> valueDist(-2.0f, 2.0f);
+
+    data_t* input_ddr = new data_t[TEST_MAX_INPUT_SIZE]();
+    data_t* output_ddr = new data_t[TEST_MAX_OUTPUT_SIZE]();
+    weight_t* weights_ddr = new weight_t[TEST_MAX_WEIGHT_SIZE]();
+    weight_t* bias_ddr = new weight_t[TEST_MAX_BIAS_SIZE]();
+
+    int layers = 0;
+    while (layers < count) {
+        int N = channelDist(gen);
+        int M = channelDist(gen);
+        int K = kernelDist(gen);
+        int S = strideDist(gen);
+        int P = std::uniform_int_distribution<int>(0, K / 2)(gen);
+        int H = std::uniform_int_distribution<int>(K, 20)(gen);
+        int W = std::uniform_int_distribution<int>(K, 20)(gen);
+        int R = (H + 2 * P - K) / S + 1;
+        int C = (W + 2 * P - K) / S + 1;
+
+        // Draw again until the layer fits the co-simulation buffers
+        if (N * H * W > TEST_MAX_INPUT_SIZE || M * R * C > TEST_MAX_OUTPUT_SIZE ||
+            M * N * K * K > TEST_MAX_WEIGHT_SIZE || M > TEST_MAX_BIAS_SIZE) {
+            continue;
+        }
+
+        std::vector<int64_t> inputRaw(N * H * W);
+        std::vector<int64_t> weightRaw(M * N * K * K);
+        std::vector<int64_t> biasRaw(M);
+        std::vector<int64_t> expected(M * R * C);
+
+        for (size_t i = 0; i < inputRaw.size(); i++) {
+            input_ddr[i] = data_t(valueDist(gen));
+            inputRaw[i] = rawOf(input_ddr[i].to_double(), 12, 6);
+        }
+        for (size_t i = 0; i < weightRaw.size(); i++) {
+            weights_ddr[i] = weight_t(valueDist(gen));
+            weightRaw[i] = rawOf(weights_ddr[i].to_double(), 12, 6);
+        }
+        for (size_t i = 0; i < biasRaw.size(); i++) {
+            bias_ddr[i] = weight_t(valueDist(gen));
+            biasRaw[i] = rawOf(bias_ddr[i].to_double(), 12, 6);
+        }
+
+        LayerConfig layer_config = default_layer_config();
+        layer_config.input_channels = N;
+        layer_config.output_channels = M;
+        layer_config.input_height = H;
+        layer_config.input_width = W;
+        layer_config.output_height = R;
+        layer_config.output_width = C;
+        layer_config.kernel_size = K;
+        layer_config.stride = S;
+        layer_config.padding = P;
+        layer_config.layer_type = LAYER_CONV;
+        layer_config.relu_enable = 1;
+
+        fashion_mnist_cnn_accelerator(input_ddr, output_ddr, weights_ddr, bias_ddr, layer_config, 0);
+        goldenConvLayer(inputRaw, weightRaw, biasRaw, expected, N, H, W, M, R, C, K, S, P);
+
+        if (trace) {
+            std::printf("layer %d N=%d M=%d H=%d W=%d K=%d S=%d P=%d\n", layers, N, M, H, W, K, S, P);
+        }
+        for (int i = 0; i < M * R * C; i++) {
+            check("conv", i, output_ddr[i].to_double(), std::ldexp(static_cast<double>(expected[i]), -6));
+        }
+        layers++;
+    }
+
+    delete[] input_ddr;
+    delete[] output_ddr;
+    delete[] weights_ddr;
+    delete[] bias_ddr;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seed = 2024;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--trace") == 0) {
+            trace = true;
+        }
+        else {
+            seed = static_cast<unsigned>(std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+
+    std::mt19937 gen(seed);
+    checkScalarOps(gen, 20000);
+    checkAccelerator(gen, 50);
+
+    if (failures == 0) {
+        std::printf("ap_fixed check PASSED (seed %u)\n", seed);
+        return 0;
+    }
+    std::printf("ap_fixed check FAILED: %d mismatches (seed %u)\n", failures, seed);
+    return 1;
+}
@@ -0,0 +1,146 @@
+/******************************************************************************
+ * Portable replacement for the Xilinx ap_int.h header
+ *
+ * Lets the v3 accelerator sources build as an ordinary C++ library (GCC/Clang)
+ * without Vitis HLS. Put this directory first on the include path:
+ *     g++ -Iportable ...
+ * Only the subset of the arbitrary precision types used by the accelerator is
+ * provided: ap_int<W> for W <= 64 and ap_uint<W> for W <= 128 (wide DDR words),
+ * backed by native integers and wrapping modulo 2^W like the Xilinx types, with
+ * range(hi, lo) bit-slice access of up to 64 bits.
+ ******************************************************************************/
+
+#ifndef PORTABLE_AP_INT_H
+#define PORTABLE_AP_INT_H
+
+#include <cstdint>
+#include <iostream>
+#include <type_traits>
+
+// Quantization and overflow modes, same names and order as the Xilinx headers
+enum ap_q_mode { AP_RND, AP_RND_ZERO, AP_RND_MIN_INF, AP_RND_INF, AP_RND_CONV, AP_TRN, AP_TRN_ZERO };
+enum ap_o_mode { AP_SAT, AP_SAT_ZERO, AP_SAT_SYM, AP_WRAP, AP_WRAP_SM };
+
+namespace ap_portable {
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+// Keep the low `width` bits of `bits` and sign-extend them
+inline int64_t wrap_signed(uint64_t bits, int width) {
+    const int unused = 64 - width;
+    return static_cast<int64_t>(bits << unused) >> unused;
+}
+
+// Keep the low `width` bits of `bits`
+inline uint64_t wrap_unsigned(uint64_t bits, int width) {
+    return (width >= 64) ? bits : (bits & ((uint64_t(1) << width) - 1));
+}
+
+inline uint128_t wrap_unsigned(uint128_t bits, int width) {
+    return (width >= 128) ? bits : (bits & ((uint128_t(1) << width) - 1));
+}
+
+// Replace bits [lo, hi] of `bits` with the low bits of `value`
+inline uint128_t set_bits(uint128_t bits, int hi, int lo, uint64_t value) {
+    const uint128_t mask = wrap_unsigned(~uint128_t(0), hi - lo + 1) << lo;
+    return (bits & ~mask) | ((uint128_t(value) << lo) & mask);
+}
+
+inline uint64_t get_bits(uint128_t bits, int hi, int lo) {
+    return static_cast<uint64_t>(wrap_unsigned(bits >> lo, hi - lo + 1));
+}
+
+// Bits [lo, hi] of an ap_int, ap_uint or ap_fixed, as returned by range().
+// Reads and writes go through the get_range/set_range members of the owner.
+template <typename Owner>
+class range_ref {
+public:
+    range_ref(Owner& owner, int hi, int lo) : owner(owner), hi(hi), lo(lo) {}
+
+    operator unsigned long long() const { return owner.get_range(hi, lo); }
+    unsigned to_uint() const { return static_cast<unsigned>(owner.get_range(hi, lo)); }
+    unsigned long long to_uint64() const { return owner.get_range(hi, lo); }
+    int length() const { return hi - lo + 1; }
+
+    range_ref& operator=(unsigned long long value) {
+        owner.set_range(hi, lo, value);
+        return *this;
+    }
+    range_ref& operator=(const range_ref& other) {
+        return *this = static_cast<unsigned long long>(other);
+    }
+    template <typename Other>
+    range_ref& operator=(const range_ref<Other>& other) {
+        return *this = static_cast<unsigned long long>(other);
+    }
+
+private:
+    Owner& owner;
+    const int hi;
+    const int lo;
+};
+
+} // namespace ap_portable
+
+template <int W>
+class ap_int {
+    static_assert(W >= 1 && W <= 64, "portable ap_int supports 1 to 64 bits");
+
+public:
+    static const int width = W;
+
+    ap_int() : V(0) {}
+    ap_int(long long value) : V(ap_portable::wrap_signed(static_cast<uint64_t>(value), W)) {}
+
+    operator long long() const { return V; }
+
+    int to_int() const { return static_cast<int>(V); }
+    long long to_int64() const { return V; }
+
+    ap_portable::range_ref<ap_int> range(int hi, int lo) { return ap_portable::range_ref<ap_int>(*this, hi, lo); }
+    ap_portable::range_ref<const ap_int> range(int hi, int lo) const { return ap_portable::range_ref<const ap_int>(*this, hi, lo); }
+
+    unsigned long long get_range(int hi, int lo) const {
+        return ap_portable::get_bits(static_cast<uint64_t>(V), hi, lo);
+    }
+    void set_range(int hi, int lo, unsigned long long value) {
+        V = ap_portable::wrap_signed(static_cast<uint64_t>(ap_portable::set_bits(static_cast<uint64_t>(V), hi, lo, value)), W);
+    }
+
+private:
+    int64_t V;
+};
+
+template <int W>
+class ap_uint {
+    static_assert(W >= 1 && W <= 128, "portable ap_uint supports 1 to 128 bits");
+
+    typedef typename std::conditional<(W <= 64), uint64_t, ap_portable::uint128_t>::type storage_t;
+
+public:
+    static const int width = W;
+
+    ap_uint() : V(0) {}
+    ap_uint(unsigned long long value) : V(ap_portable::wrap_unsigned(static_cast<storage_t>(value), W)) {}
+
+    // Conversions keep the low 64 bits when W > 64
+    operator unsigned long long() const { return static_cast<unsigned long long>(V); }
+
+    unsigned to_uint() const { return static_cast<unsigned>(V); }
+    unsigned long long to_uint64() const { return static_cast<unsigned long long>(V); }
+
+    ap_portable::range_ref<ap_uint> range(int hi, int lo) { return ap_portable::range_ref<ap_uint>(*this, hi, lo); }
+    ap_portable::range_ref<const ap_uint> range(int hi, int lo) const { return ap_portable::range_ref<const ap_uint>(*this, hi, lo); }
+
+    unsigned long long get_range(int hi, int lo) const {
+        return ap_portable::get_bits(V, hi, lo);
+    }
+    void set_range(int hi, int lo, unsigned long long value) {
+        V = static_cast<storage_t>(ap_portable::set_bits(V, hi, lo, value));
+    }
+
+private:
+    storage_t V;
+};
+
+#endif // PORTABLE_AP_INT_H
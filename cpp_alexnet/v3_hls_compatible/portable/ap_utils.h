@@ -0,0 +1,16 @@
+/******************************************************************************
+ * Portable replacement for the Xilinx ap_utils.h header
+ *
+ * ap_wait() and ap_wait_n() mark clock boundaries for the HLS scheduler, for
+ * example inside a #pragma HLS PROTOCOL region. C simulation has no clock, so
+ * they do nothing here.
+ ******************************************************************************/
+
+#ifndef PORTABLE_AP_UTILS_H
+#define PORTABLE_AP_UTILS_H
+
+inline void ap_wait() {}
+
+inline void ap_wait_n(int) {}
+
+#endif // PORTABLE_AP_UTILS_H
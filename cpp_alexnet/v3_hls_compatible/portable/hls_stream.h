@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Portable replacement for the Xilinx hls_stream.h header
+ *
+ * hls::stream<T> as an unbounded FIFO for C simulation with GCC/Clang. Like
+ * the Xilinx C model, reading an empty stream prints a warning and returns a
+ * default-constructed value (in RTL the read would block forever).
+ ******************************************************************************/
+
+#ifndef PORTABLE_HLS_STREAM_H
+#define PORTABLE_HLS_STREAM_H
+
+#include <deque>
+#include <iostream>
+#include <string>
+
+namespace hls {
+
+template <typename T>
+class stream {
+public:
+    stream() : name_("hls::stream") {}
+    explicit stream(const char* name) : name_(name) {}
+
+    void write(const T& value) {
+        fifo_.push_back(value);
+    }
+
+    T read() {
+        if (fifo_.empty()) {
+            std::cerr << "WARNING: hls::stream '" << name_ << "' is read while empty" << std::endl;
+            return T();
+        }
+        T value = fifo_.front();
+        fifo_.pop_front();
+        return value;
+    }
+
+    void read(T& value) {
+        value = read();
+    }
+
+    bool read_nb(T& value) {
+        if (fifo_.empty()) {
+            return false;
+        }
+        value = read();
+        return true;
+    }
+
+    bool write_nb(const T& value) {
+        write(value);
+        return true;
+    }
+
+    bool empty() const { return fifo_.empty(); }
+    bool full() const { return false; }
+    size_t size() const { return fifo_.size(); }
+
+    void operator<<(const T& value) { write(value); }
+    void operator>>(T& value) { read(value); }
+
+private:
+    // Streams are channels between processes, not values
+    stream(const stream&);
+    stream& operator=(const stream&);
+
+    std::deque<T> fifo_;
+    std::string name_;
+};
+
+} // namespace hls
+
+#endif // PORTABLE_HLS_STREAM_H
@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "host_driver.h"
+#include "perf_model.h"
+
+/**
+ * Precision sweep of the Fashion-MNIST network. Every configuration runs the
+ * whole network through a model of the accelerator arithmetic with its own
+ * weight_t, data_t and acc_t, and is compared with the float network: top-1
+ * agreement and logit error over the labelled test image and shifted copies.
+ * (test_image2/3.bin use another input scaling and test_image1.bin is not an
+ * image, so they are left out.)
+ * perf_estimate_resources() gives the DSP and BRAM cost of each configuration.
+ * The configuration the accelerator is compiled with (cnn_params.h) also runs
+ * through NetworkExecutor, which must match the model bit for bit.
+ *
+ *   precision_sweep [fashion_mnist_weights_dir]
+ */
+
+struct SweepLayer {
+    std::string name;
+    HostLayerType type;
+    int outputs;       // Output channels (conv) or features (FC)
+    int kernelSize;    // Conv kernel or pooling window
+    int stride;
+    int padding;
+    bool relu;         // FC only, conv layers always apply ReLU
+    std::vector<float> weights;  // [out][in][K][K] or [out][in]
+    std::vector<float> bias;
+};
+
+// Reference precision: the same model in float
+struct float_precision {
+    typedef float weight_t;
+    typedef float data_t;
+    typedef float acc_t;
+};
+
+static const int IMAGE_SIZE = 28;
+static const int EXPECTED_CLASS = 9;  // test_image_real.bin, see test_info.txt
+
+static bool readFloats(const std::string& path, std::vector<float>& data, size_t count) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Unable to open " << path << std::endl;
+        return false;
+    }
+    data.resize(count);
+    file.read(reinterpret_cast<char*>(data.data()), count * sizeof(float));
+    return static_cast<size_t>(file.gcount()) == count * sizeof(float);
+}
+
+// Conv weights of cpp_fashion_mnist are stored [h][w][c_in][c_out]
+static std::vector<float> hwioToOihw(const std::vector<float>& hwio, int outputs, int inputs, int kernelSize) {
+    std::vector<float> oihw(hwio.size());
+    for (int o = 0; o < outputs; o++) {
+        for (int i = 0; i < inputs; i++) {
+            for (int k = 0; k < kernelSize * kernelSize; k++) {
+                oihw[(o * inputs + i) * kernelSize * kernelSize + k] = hwio[(k * inputs + i) * outputs + o];
+            }
+        }
+    }
+    return oihw;
+}
+
+// FC weights are stored [in][out] with the input flattened as [H][W][C]
+static std::vector<float> fcToOutIn(const std::vector<float>& inOut, int outputs, int channels, int height, int width) {
+    int inputs = channels * height * width;
+    std::vector<float> outIn(inOut.size());
+    for (int o = 0; o < outputs; o++) {
+        for (int c = 0; c < channels; c++) {
+            for (int hw = 0; hw < height * width; hw++) {
+                outIn[o * inputs + c * height * width + hw] = inOut[(hw * channels + c) * outputs + o];
+            }
+        }
+    }
+    return outIn;
+}
+
+static bool loadNetwork(const std::string& dir, std::vector<SweepLayer>& layers) {
+    SweepLayer conv1 = { "conv1", HOST_LAYER_CONV, 32, 3, 1, 1, true, {}, {} };
+    SweepLayer pool1 = { "pool1", HOST_LAYER_MAXPOOL, 0, 2, 2, 0, false, {}, {} };
+    SweepLayer conv2 = { "conv2", HOST_LAYER_CONV, 64, 3, 1, 1, true, {}, {} };
+    SweepLayer pool2 = { "pool2", HOST_LAYER_MAXPOOL, 0, 2, 2, 0, false, {}, {} };
+    SweepLayer fc1 = { "fc1", HOST_LAYER_FC, 128, 0, 0, 0, true, {}, {} };
+    SweepLayer fc2 = { "fc2", HOST_LAYER_FC, 10, 0, 0, 0, false, {}, {} };
+    std::vector<float> raw;
+
+    bool ok = readFloats(dir + "/conv1_weights.bin", raw, 3 * 3 * 1 * 32);
+    conv1.weights = hwioToOihw(raw, 32, 1, 3);
+    ok = ok && readFloats(dir + "/conv1_bias.bin", conv1.bias, 32);
+    ok = ok && readFloats(dir + "/conv2_weights.bin", raw, 3 * 3 * 32 * 64);
+    conv2.weights = hwioToOihw(raw, 64, 32, 3);
+    ok = ok && readFloats(dir + "/conv2_bias.bin", conv2.bias, 64);
+    ok = ok && readFloats(dir + "/fc1_weights.bin", raw, 3136 * 128);
+    fc1.weights = fcToOutIn(raw, 128, 64, 7, 7);
+    ok = ok && readFloats(dir + "/fc1_bias.bin", fc1.bias, 128);
+    ok = ok && readFloats(dir + "/fc2_weights.bin", raw, 128 * 10);
+    fc2.weights = fcToOutIn(raw, 10, 128, 1, 1);
+    ok = ok && readFloats(dir + "/fc2_bias.bin", fc2.bias, 10);
+
+    layers = { conv1, pool1, conv2, pool2, fc1, fc2 };
+    return ok;
+}
+
+// Image moved by (dx, dy) pixels, zero filled
+static std::vector<float> shiftImage(const std::vector<float>& image, int dx, int dy) {
+    std::vector<float> shifted(image.size(), 0.0f);
+    for (int h = 0; h < IMAGE_SIZE; h++) {
+        for (int w = 0; w < IMAGE_SIZE; w++) {
+            int sh = h - dy;
+            int sw = w - dx;
+            if (sh >= 0 && sh < IMAGE_SIZE && sw >= 0 && sw < IMAGE_SIZE) {
+                shifted[h * IMAGE_SIZE + w] = image[sh * IMAGE_SIZE + sw];
+            }
+        }
+    }
+    return shifted;
+}
+
+// The arithmetic of NetworkExecutor with every layer on the accelerator:
+// weight_t x data_t products are truncated to acc_t and accumulated from the
+// bias, ReLU runs on acc_t and the result is truncated to data_t
+template <typename P>
+static std::vector<float> runModel(const std::vector<SweepLayer>& layers, const std::vector<float>& image) {
+    typedef typename P::weight_t W;
+    typedef typename P::data_t A;
+    typedef typename P::acc_t ACC;
+
+    int channels = 1, height = IMAGE_SIZE, width = IMAGE_SIZE;
+    std::vector<A> current(image.begin(), image.end());
+
+    for (const SweepLayer& layer : layers) {
+        std::vector<A> next;
+        if (layer.type == HOST_LAYER_CONV) {
+            int K = layer.kernelSize, S = layer.stride, Pd = layer.padding;
+            int outHeight = (height + 2 * Pd - K) / S + 1;
+            int outWidth = (width + 2 * Pd - K) / S + 1;
+            next.resize(layer.outputs * outHeight * outWidth);
+            for (int m = 0; m < layer.outputs; m++) {
+                for (int r = 0; r < outHeight; r++) {
+                    for (int c = 0; c < outWidth; c++) {
+                        ACC acc = W(layer.bias[m]);
+                        for (int n = 0; n < channels; n++) {
+                            for (int i = 0; i < K; i++) {
+                                for (int j = 0; j < K; j++) {
+                                    int h = r * S + i - Pd;
+                                    int w = c * S + j - Pd;
+                                    if (h >= 0 && h < height && w >= 0 && w < width) {
+                                        acc += W(layer.weights[((m * channels + n) * K + i) * K + j]) * current[(n * height + h) * width + w];
+                                    }
+                                }
+                            }
+                        }
+                        next[(m * outHeight + r) * outWidth + c] = (acc < 0) ? A(0) : A(acc);
+                    }
+                }
+            }
+            channels = layer.outputs;
+            height = outHeight;
+            width = outWidth;
+        }
+        else if (layer.type == HOST_LAYER_MAXPOOL) {
+            int outHeight = (height - layer.kernelSize) / layer.stride + 1;
+            int outWidth = (width - layer.kernelSize) / layer.stride + 1;
+            next.resize(channels * outHeight * outWidth);
+            for (int c = 0; c < channels; c++) {
+                for (int r = 0; r < outHeight; r++) {
+                    for (int col = 0; col < outWidth; col++) {
+                        A maxVal = current[(c * height + r * layer.stride) * width + col * layer.stride];
+                        for (int i = 0; i < layer.kernelSize; i++) {
+                            for (int j = 0; j < layer.kernelSize; j++) {
+                                A value = current[(c * height + r * layer.stride + i) * width + col * layer.stride + j];
+                                maxVal = (value > maxVal) ? value : maxVal;
+                            }
+                        }
+                        next[(c * outHeight + r) * outWidth + col] = maxVal;
+                    }
+                }
+            }
+            height = outHeight;
+            width = outWidth;
+        }
+        else {
+            int inputs = channels * height * width;
+            next.resize(layer.outputs);
+            for (int o = 0; o < layer.outputs; o++) {
+                ACC acc = W(layer.bias[o]);
+                for (int i = 0; i < inputs; i++) {
+                    acc += W(layer.weights[static_cast<size_t>(o) * inputs + i]) * current[i];
+                }
+                next[o] = (layer.relu && acc < 0) ? A(0) : A(acc);
+            }
+            channels = layer.outputs;
+            height = 1;
+            width = 1;
+        }
+        current.swap(next);
+    }
+
+    std::vector<float> logits(current.size());
+    for (size_t i = 0; i < current.size(); i++) {
+        logits[i] = static_cast<float>(current[i]);
+    }
+    return logits;
+}
+
+struct SweepRow {
+    std::string name;
+    int weightBits, actBits, accBits;
+    bool build;  // Precision of this accelerator build
+    std::vector<std::vector<float>> logits;
+};
+
+template <int WB, int WI, int AB, int AI, int CB, int CI>
+static SweepRow sweepRow(const std::vector<SweepLayer>& layers, const std::vector<std::vector<float>>& images) {
+    typedef cnn_precision<WB, WI, AB, AI, CB, CI> P;
+    SweepRow row;
+    char name[64];
+    std::snprintf(name, sizeof(name), "<%d,%d> <%d,%d> <%d,%d>", WB, WI, AB, AI, CB, CI);
+    row.name = name;
+    row.weightBits = WB;
+    row.actBits = AB;
+    row.accBits = CB;
+    row.build = (WB == WEIGHT_BITS && WI == WEIGHT_INT_BITS && AB == ACT_BITS && AI == ACT_INT_BITS
+        && CB == ACC_BITS && CI == ACC_INT_BITS);
+    for (const std::vector<float>& image : images) {
+        row.logits.push_back(runModel<P>(layers, image));
+    }
+    return row;
+}
+
+static int argmax(const std::vector<float>& values) {
+    return static_cast<int>(std::max_element(values.begin(), values.end()) - values.begin());
+}
+
+// Runs the build precision through the accelerator C simulation
+static bool checkExecutor(const std::vector<SweepLayer>& layers, const std::vector<std::vector<float>>& images,
+    const SweepRow& row) {
+    NetworkExecutor executor(1, IMAGE_SIZE, IMAGE_SIZE);
+    executor.setAcceleratePoolFC(true);
+    for (const SweepLayer& layer : layers) {
+        if (layer.type == HOST_LAYER_CONV) {
+            executor.addConv(layer.name, layer.outputs, layer.kernelSize, layer.stride, layer.padding, layer.weights, layer.bias);
+        }
+        else if (layer.type == HOST_LAYER_MAXPOOL) {
+            executor.addMaxPool(layer.name, layer.kernelSize, layer.stride);
+        }
+        else {
+            executor.addFC(layer.name, layer.outputs, layer.relu, layer.weights, layer.bias);
+        }
+    }
+
+    bool exact = true;
+    for (size_t i = 0; i < images.size(); i++) {
+        exact &= (executor.run(images[i]) == row.logits[i]);
+    }
+    return exact;
+}
+
+int main(int argc, char* argv[]) {
+    std::string weightsDir = (argc > 1) ? argv[1] : "../../cpp_fashion_mnist/weights";
+
+    std::vector<SweepLayer> layers;
+    std::vector<float> real;
+    if (!loadNetwork(weightsDir, layers) ||
+        !readFloats(weightsDir + "/test_image_real.bin", real, IMAGE_SIZE * IMAGE_SIZE)) {
+        std::cout << "Fashion-MNIST weights not found in " << weightsDir << std::endl;
+        return 1;
+    }
+
+    // The test image first, then copies moved by one pixel in every direction
+    // and by two pixels along the axes
+    std::vector<std::vector<float>> images = { real };
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            bool near = (std::abs(dx) <= 1 && std::abs(dy) <= 1);
+            if ((dx != 0 || dy != 0) && (near || dx == 0 || dy == 0)) {
+                images.push_back(shiftImage(real, dx, dy));
+            }
+        }
+    }
+
+    std::vector<std::vector<float>> reference;
+    for (const std::vector<float>& image : images) {
+        reference.push_back(runModel<float_precision>(layers, image));
+    }
+
+    // <total bits, integer bits> of weight_t, data_t and acc_t. The trained
+    // weights lie in (-1, 1), activations and logits in (-16, 16).
+    std::vector<SweepRow> rows;
+    rows.push_back(sweepRow<16, 2, 16, 6, 32, 12>(layers, images));
+    rows.push_back(sweepRow<12, 6, 12, 6, 12, 6>(layers, images));
+    rows.push_back(sweepRow<12, 2, 12, 6, 12, 6>(layers, images));
+    rows.push_back(sweepRow<12, 2, 12, 6, 24, 10>(layers, images));
+    rows.push_back(sweepRow<10, 1, 12, 6, 24, 10>(layers, images));
+    rows.push_back(sweepRow<8, 1, 12, 6, 24, 10>(layers, images));
+    rows.push_back(sweepRow<8, 1, 10, 5, 20, 8>(layers, images));
+    rows.push_back(sweepRow<8, 1, 8, 4, 16, 6>(layers, images));
+    rows.push_back(sweepRow<6, 1, 8, 4, 16, 6>(layers, images));
+    rows.push_back(sweepRow<4, 1, 8, 4, 16, 6>(layers, images));
+    if (std::none_of(rows.begin(), rows.end(), [](const SweepRow& row) { return row.build; })) {
+        rows.push_back(sweepRow<WEIGHT_BITS, WEIGHT_INT_BITS, ACT_BITS, ACT_INT_BITS, ACC_BITS, ACC_INT_BITS>(layers, images));
+    }
+
+    PerfModelParams params = perf_default_params();
+    params.dsp_packing = false;
+    PerfModelParams packing = params;
+    packing.dsp_packing = true;
+    std::printf("Fashion-MNIST precision sweep, %d inputs (test_image_real.bin and shifted copies)\n", static_cast<int>(images.size()));
+    std::printf("Float network on test_image_real.bin: class %d (label %d)\n\n", argmax(reference[0]), EXPECTED_CLASS);
+    std::printf("%-28s %9s %6s %12s %12s %6s %6s %6s\n", "weight / data / acc", "top-1", "label", "max |diff|", "mean |diff|",
+        "DSP", "packed", "BRAM");
+
+    const SweepRow* cheapest = nullptr;
+    PerfResources cheapestRes = PerfResources();
+    for (const SweepRow& row : rows) {
+        int agree = 0;
+        double maxDiff = 0.0, sumDiff = 0.0;
+        int count = 0;
+        for (size_t i = 0; i < images.size(); i++) {
+            agree += (argmax(row.logits[i]) == argmax(reference[i])) ? 1 : 0;
+            for (size_t k = 0; k < reference[i].size(); k++) {
+                double diff = std::abs(row.logits[i][k] - reference[i][k]);
+                maxDiff = std::max(maxDiff, diff);
+                sumDiff += diff;
+                count++;
+            }
+        }
+        PerfResources res = perf_estimate_resources(row.weightBits, row.actBits, row.accBits, params);
+        PerfResources packed = perf_estimate_resources(row.weightBits, row.actBits, row.accBits, packing);
+        std::printf("%-28s %6d/%-2d %6s %12.4f %12.4f %6d %6d %6d%s\n", row.name.c_str(), agree, static_cast<int>(images.size()),
+            (argmax(row.logits[0]) == EXPECTED_CLASS) ? "yes" : "no", maxDiff, sumDiff / count, res.dsp, packed.dsp,
+            res.bram18k, row.build ? "  (build)" : "");
+
+        bool keepsAccuracy = (agree == static_cast<int>(images.size()));
+        if (keepsAccuracy && (!cheapest || res.dsp < cheapestRes.dsp ||
+            (res.dsp == cheapestRes.dsp && res.bram18k < cheapestRes.bram18k))) {
+            cheapest = &row;
+            cheapestRes = res;
+        }
+    }
+    std::printf("(top-1 = inputs classified like the float network; DSP and BRAM from perf_estimate_resources,\n"
+        " packed = DSP of the USE_DSP_PACKING build, two products of at most 8 x 8 bits per DSP48E2)\n");
+
+    if (cheapest) {
+        std::printf("\nCheapest precision with full top-1 agreement: %s\n", cheapest->name.c_str());
+    }
+
+    // The model row of the build precision must be what the accelerator computes
+    bool pass = true;
+    for (const SweepRow& row : rows) {
+        if (row.build) {
+            bool exact = checkExecutor(layers, images, row);
+            std::printf("\nNetworkExecutor vs model at the build precision %s: %s\n", row.name.c_str(), exact ? "bit-exact" : "MISMATCH");
+            pass = exact;
+        }
+    }
+    std::cout << (pass ? "Precision sweep PASSED!" : "Precision sweep FAILED!") << std::endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+#include "cnn_functions.h"
+
+// Systolic-array conv engine (build with USE_SYSTOLIC_ENGINE=1), a drop-in
+// replacement for compute_tile. A TN x TM grid of processing elements works
+// on one kernel tap at a time:
+//   - the TN x TM weights of the tap are shifted into the grid from the top,
+//     one row per cycle, and stay there for the pass
+//   - input channel n enters row n from the left, skewed by n cycles, one
+//     output pixel per cycle, and moves one PE to the right per cycle
+//   - partial sums move one PE down per cycle; column m leaves the grid as
+//     the sum over the TN input channels of output channel m, and is added to
+//     output_buffer (skewed by m cycles)
+// The cycle loop updates every register from the values of the previous
+// cycle, so the C code is also a cycle-accurate model of the array: a pass of
+// P pixels takes TN + P + TN + TM - 2 cycles (weight shift, then fill, stream
+// and drain). Every loop body is fully unrolled over the grid and has constant
+// indices, which keeps the HLS schedule small.
+//
+// Each product is truncated to acc_t and acc_t wraps, so the sum does not
+// depend on the order of the additions and the result is bit-exact with
+// compute_tile.
+
+#ifndef __SYNTHESIS__
+CU_LOCAL long long systolic_array_cycles = 0;
+#endif
+
+// Delay from the first input row to the output of the last column
+#define SYSTOLIC_LATENCY (TN + TM - 1)
+
+void systolic_compute_tile(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    acc_t output_buffer[TM][TR][TC],
+    int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
+
+    #pragma HLS INLINE off
+
+    // PE registers
+    weight_t weight_regs[TN][TM];
+    #pragma HLS ARRAY_PARTITION variable=weight_regs complete dim=0
+    data_t act_regs[TN][TM];
+    #pragma HLS ARRAY_PARTITION variable=act_regs complete dim=0
+    acc_t psum_regs[TN][TM];
+    #pragma HLS ARRAY_PARTITION variable=psum_regs complete dim=0
+
+    // Input skew: row n sees the pixel read n cycles earlier
+    data_t skew_regs[TN][TN];
+    #pragma HLS ARRAY_PARTITION variable=skew_regs complete dim=0
+
+    // Position of the pixel read d + 1 cycles ago; column m writes the
+    // pixel read TN - 1 + m cycles before its partial sum leaves the grid
+    bool valid_line[SYSTOLIC_LATENCY];
+    int row_line[SYSTOLIC_LATENCY];
+    int col_line[SYSTOLIC_LATENCY];
+    #pragma HLS ARRAY_PARTITION variable=valid_line complete
+    #pragma HLS ARRAY_PARTITION variable=row_line complete
+    #pragma HLS ARRAY_PARTITION variable=col_line complete
+
+    const int pixels = tr_bound * tc_bound;
+    const int cycles = pixels + SYSTOLIC_LATENCY - 1;
+
+    tap_i_loop: for (int i = 0; i < kernel_size; i++) {
+        tap_j_loop: for (int j = 0; j < kernel_size; j++) {
+            int k_idx = i * kernel_size + j;
+
+            // Weights enter at the top and move down one row per cycle; after
+            // TN cycles row n holds the weights of input channel n
+            weight_shift: for (int s = 0; s < TN; s++) {
+                #pragma HLS PIPELINE II=1
+                int n_in = TN - 1 - s;
+                shift_m: for (int m = 0; m < TM; m++) {
+                    shift_n: for (int n = TN - 1; n > 0; n--) {
+                        weight_regs[n][m] = weight_regs[n-1][m];
+                    }
+                    weight_regs[0][m] = (m < tm_bound && n_in < tn_bound) ? weight_buffer[m][n_in][k_idx] : weight_t(0);
+                }
+#ifndef __SYNTHESIS__
+                systolic_array_cycles++;
+#endif
+            }
+
+            // Empty pipeline
+            clear_regs: for (int n = 0; n < TN; n++) {
+                for (int m = 0; m < TM; m++) {
+                    act_regs[n][m] = 0;
+                    psum_regs[n][m] = 0;
+                }
+                for (int d = 0; d < TN; d++) {
+                    skew_regs[n][d] = 0;
+                }
+            }
+            clear_lines: for (int d = 0; d < SYSTOLIC_LATENCY; d++) {
+                valid_line[d] = false;
+                row_line[d] = 0;
+                col_line[d] = 0;
+            }
+
+            int r_in = 0;
+            int c_in = 0;
+
+            array_cycle: for (int t = 0; t < cycles; t++) {
+                #pragma HLS PIPELINE II=1
+                #pragma HLS DEPENDENCE variable=output_buffer inter false
+
+                // Column of input pixel t, one element per input_buffer partition
+                bool read_valid = (t < pixels);
+                int h = r_in * stride + i;
+                int w = c_in * stride + j;
+                data_t column[TN];
+                #pragma HLS ARRAY_PARTITION variable=column complete
+                read_column: for (int n = 0; n < TN; n++) {
+                    column[n] = (read_valid && n < tn_bound) ? input_buffer[n][h][w] : data_t(0);
+                }
+
+                // PEs from the bottom-right corner, so every PE reads the
+                // registers of its left and upper neighbours before they change
+                pe_n: for (int n = TN - 1; n >= 0; n--) {
+                    data_t row_in = (n == 0) ? column[0] : skew_regs[n][n-1];
+                    pe_m: for (int m = TM - 1; m >= 0; m--) {
+                        data_t act = (m == 0) ? row_in : act_regs[n][m-1];
+                        acc_t psum_in = (n == 0) ? acc_t(0) : psum_regs[n-1][m];
+                        acc_t psum = psum_in;
+                        psum += weight_regs[n][m] * act;
+                        psum_regs[n][m] = psum;
+                        act_regs[n][m] = act;
+                    }
+                }
+
+                // Column m finished the pixel read TN - 1 + m cycles ago
+                drain_m: for (int m = 0; m < TM; m++) {
+                    int d = TN - 2 + m;
+                    bool out_valid = (d < 0) ? read_valid : valid_line[d];
+                    int r = (d < 0) ? r_in : row_line[d];
+                    int c = (d < 0) ? c_in : col_line[d];
+                    if (out_valid && m < tm_bound) {
+                        output_buffer[m][r][c] += psum_regs[TN-1][m];
+                    }
+                }
+
+                // Advance the skew and position registers
+                skew_n: for (int n = 1; n < TN; n++) {
+                    for (int d = TN - 1; d > 0; d--) {
+                        skew_regs[n][d] = skew_regs[n][d-1];
+                    }
+                    skew_regs[n][0] = column[n];
+                }
+                line_d: for (int d = SYSTOLIC_LATENCY - 1; d > 0; d--) {
+                    valid_line[d] = valid_line[d-1];
+                    row_line[d] = row_line[d-1];
+                    col_line[d] = col_line[d-1];
+                }
+                valid_line[0] = read_valid;
+                row_line[0] = r_in;
+                col_line[0] = c_in;
+
+                if (++c_in == tc_bound) {
+                    c_in = 0;
+                    r_in++;
+                }
+#ifndef __SYNTHESIS__
+                systolic_array_cycles++;
+#endif
+            }
+        }
+    }
+}
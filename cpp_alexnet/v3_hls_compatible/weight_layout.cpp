@@ -0,0 +1,43 @@
+#include "weight_layout.h"
+
+// Visit the kernels in tile-major order: f(tiled_index, oihw_index) for
+// every element, tiled_index running from 0 to M * N * K*K - 1
+template <typename F>
+static void for_each_tiled_element(int M, int N, int K, F f) {
+    const int K2 = K * K;
+    int tiled_index = 0;
+    for (int m_offset = 0; m_offset < M; m_offset += TM) {
+        int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+        for (int n_offset = 0; n_offset < N; n_offset += TN) {
+            int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+            for (int m = 0; m < m_limit; m++) {
+                for (int n = 0; n < n_limit; n++) {
+                    for (int k = 0; k < K2; k++) {
+                        f(tiled_index++, ((m_offset + m) * N + n_offset + n) * K2 + k);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+static std::vector<T> to_tile_major(const std::vector<T>& oihw, int M, int N, int K) {
+    std::vector<T> tiled(oihw.size());
+    for_each_tiled_element(M, N, K, [&](int t, int o) { tiled[t] = oihw[o]; });
+    return tiled;
+}
+
+std::vector<weight_t> tile_major_weights(const std::vector<weight_t>& oihw, int M, int N, int K) {
+    return to_tile_major(oihw, M, N, K);
+}
+
+std::vector<float> tile_major_weights(const std::vector<float>& oihw, int M, int N, int K) {
+    return to_tile_major(oihw, M, N, K);
+}
+
+std::vector<weight_t> oihw_weights(const std::vector<weight_t>& tiled, int M, int N, int K) {
+    std::vector<weight_t> oihw(tiled.size());
+    for_each_tiled_element(M, N, K, [&](int t, int o) { oihw[o] = tiled[t]; });
+    return oihw;
+}
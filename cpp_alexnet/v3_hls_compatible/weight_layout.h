@@ -0,0 +1,24 @@
+#ifndef WEIGHT_LAYOUT_H
+#define WEIGHT_LAYOUT_H
+
+#include <vector>
+#include "cnn_types.h"
+
+// Host-side re-layout of conv and FC weights for WEIGHT_LAYOUT_TILED calls.
+// The [M][N][K*K] weights are reordered into the order the accelerator
+// consumes them: tile (m_offset, n_offset) of TM x TN kernels is stored as one
+// contiguous [m_limit][n_limit][K*K] block at tiled_weight_offset(), output
+// channel tiles outermost and input channel tiles inside them. The size is
+// unchanged (edge tiles are not padded), and biases need no re-layout since
+// load_bias already reads TM consecutive values.
+// An FC layer with F inputs uses N = F and K = 1.
+
+std::vector<weight_t> tile_major_weights(const std::vector<weight_t>& oihw, int M, int N, int K);
+
+// Same for float weights (offline conversion of the weight files)
+std::vector<float> tile_major_weights(const std::vector<float>& oihw, int M, int N, int K);
+
+// Inverse re-layout, back to [M][N][K*K]
+std::vector<weight_t> oihw_weights(const std::vector<weight_t>& tiled, int M, int N, int K);
+
+#endif // WEIGHT_LAYOUT_H
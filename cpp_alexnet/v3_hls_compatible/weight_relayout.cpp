@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+#include "weight_layout.h"
+
+/**
+ * Offline weight re-layout for WEIGHT_LAYOUT_TILED layers. Reads float32
+ * weights in [M][N][K][K] order (FC layers: [M][N] with K = 1) and writes them
+ * in the tile-major order of weight_layout.h, so that every TM x TN weight tile
+ * is one contiguous DDR burst. Bias files are already in tile order.
+ *
+ *   weight_relayout <oihw.bin> <tiled.bin> M N K
+ */
+
+int main(int argc, char* argv[]) {
+    if (argc != 6) {
+        std::fprintf(stderr, "Usage: %s <oihw.bin> <tiled.bin> M N K\n", argv[0]);
+        return 1;
+    }
+    int M = std::atoi(argv[3]);
+    int N = std::atoi(argv[4]);
+    int K = std::atoi(argv[5]);
+    if (M <= 0 || N <= 0 || K <= 0) {
+        std::fprintf(stderr, "Error: M, N and K must be positive\n");
+        return 1;
+    }
+    size_t count = static_cast<size_t>(M) * N * K * K;
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if (!input.is_open()) {
+        std::fprintf(stderr, "Error: Unable to open %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<float> oihw(count);
+    input.read(reinterpret_cast<char*>(oihw.data()), count * sizeof(float));
+    if (static_cast<size_t>(input.gcount()) != count * sizeof(float) || input.peek() != EOF) {
+        std::fprintf(stderr, "Error: %s does not hold %d x %d x %d x %d floats\n", argv[1], M, N, K, K);
+        return 1;
+    }
+
+    std::vector<float> tiled = tile_major_weights(oihw, M, N, K);
+
+    std::ofstream output(argv[2], std::ios::binary);
+    output.write(reinterpret_cast<const char*>(tiled.data()), count * sizeof(float));
+    if (!output) {
+        std::fprintf(stderr, "Error: Unable to write %s\n", argv[2]);
+        return 1;
+    }
+    std::printf("%s: %d x %d x %d x %d weights, %d x %d tiles of Tm=%d Tn=%d -> %s\n",
+        argv[1], M, N, K, K, (M + TM - 1) / TM, (N + TN - 1) / TN, TM, TN, argv[2]);
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "cnn_functions.h"
+
+// Persistent on-chip weight store. Its contents survive between accelerator
+// calls: one WEIGHTS_PRELOAD call per layer copies the weights and biases in,
+// after which WEIGHTS_RESIDENT calls fetch their tiles from here and only the
+// activations cross the AXI ports. The host assigns resident_offset.
+static CU_LOCAL weight_t resident_store[RESIDENT_STORE_SIZE];
+
+// Function to copy the weights and biases of a layer from DDR to the store
+void preload_resident_weights(
+    weight_t* weights_ddr,
+    weight_t* bias_ddr,
+    int offset, int weight_count, int M) {
+
+    #pragma HLS INLINE off
+
+    // Layers that do not fit are left to the host, which checks the size
+    if (offset < 0 || offset + weight_count + M > RESIDENT_STORE_SIZE) {
+        return;
+    }
+
+    preload_weights: for (int e = 0; e < weight_count; e++) {
+        #pragma HLS PIPELINE II=1
+        resident_store[offset + e] = weights_ddr[e];
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.read_beats++;
+        axi_traffic.weight_beats++;
+#endif
+    }
+
+    preload_bias: for (int m = 0; m < M; m++) {
+        #pragma HLS PIPELINE II=1
+        resident_store[offset + weight_count + m] = bias_ddr[m];
+#if AXI_TRAFFIC_COUNTERS
+        axi_traffic.read_beats++;
+        axi_traffic.bias_beats++;
+#endif
+    }
+}
+
+// Same from packed DDR: one word is read every DDR_PACK elements
+void preload_resident_weights(
+    ddr_word_t* weights_ddr,
+    ddr_word_t* bias_ddr,
+    int offset, int weight_count, int M) {
+
+    #pragma HLS INLINE off
+
+    if (offset < 0 || offset + weight_count + M > RESIDENT_STORE_SIZE) {
+        return;
+    }
+
+    ddr_word_t bits = 0;
+
+    preload_weights: for (int e = 0; e < weight_count; e++) {
+        #pragma HLS PIPELINE II=1
+        if (e % DDR_PACK == 0) {
+            bits = weights_ddr[e / DDR_PACK];
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.read_beats++;
+            axi_traffic.weight_beats++;
+#endif
+        }
+        resident_store[offset + e] = ddr_get_lane<weight_t>(bits, e % DDR_PACK);
+    }
+
+    preload_bias: for (int m = 0; m < M; m++) {
+        #pragma HLS PIPELINE II=1
+        if (m % DDR_PACK == 0) {
+            bits = bias_ddr[m / DDR_PACK];
+#if AXI_TRAFFIC_COUNTERS
+            axi_traffic.read_beats++;
+            axi_traffic.bias_beats++;
+#endif
+        }
+        resident_store[offset + weight_count + m] = ddr_get_lane<weight_t>(bits, m % DDR_PACK);
+    }
+}
+
+// Function to fill a weight tile from the store, same layout as load_weight_tile
+void load_resident_weight_tile(
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    int offset, int m_offset, int n_offset,
+    int M, int N, int K) {
+
+    #pragma HLS INLINE off
+
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+    const int n_limit = ((n_offset + TN) > N) ? (N - n_offset) : TN;
+    const int K2 = K*K;
+
+    clear_weights: for (int m = 0; m < TM; m++) {
+        for (int n = 0; n < TN; n++) {
+            #pragma HLS PIPELINE II=1
+            for (int k = 0; k < MAX_KERNEL_SIZE*MAX_KERNEL_SIZE; k++) {
+                weight_buffer[m][n][k] = 0;
+            }
+        }
+    }
+
+    resident_weights_m: for (int m = 0; m < m_limit; m++) {
+        resident_weights_n: for (int n = 0; n < n_limit; n++) {
+            int base = offset + (m + m_offset) * N * K2 + (n + n_offset) * K2;
+            resident_weights_k: for (int k = 0; k < K2; k++) {
+                #pragma HLS PIPELINE II=1
+                weight_buffer[m][n][k] = resident_store[base + k];
+            }
+        }
+    }
+}
+
+// Function to fill the bias buffer from the store
+void load_resident_bias(
+    weight_t bias_buffer[TM],
+    int bias_offset, int m_offset, int M) {
+
+    #pragma HLS INLINE off
+
+    const int m_limit = ((m_offset + TM) > M) ? (M - m_offset) : TM;
+
+    resident_bias: for (int m = 0; m < TM; m++) {
+        #pragma HLS PIPELINE II=1
+        bias_buffer[m] = (m < m_limit) ? resident_store[bias_offset + m_offset + m] : weight_t(0);
+    }
+}
+
+// Function to stream the FC weights of an output channel group and a chunk
+// of input features from the store, in the order of stream_fc_weights
+void stream_resident_fc_weights(
+    hls::stream<weight_t>& weights,
+    int offset, int m_offset, int tm_bound, int N,
+    int n_offset, int n_count, bool tiled) {
+
+    #pragma HLS INLINE off
+
+    const bool one_run = tiled || n_count == N;
+    const int rows = one_run ? 1 : tm_bound;
+    const int run = one_run ? tm_bound * n_count : n_count;
+    const int base = offset + m_offset * N + (tiled ? tm_bound * n_offset : n_offset);
+
+    resident_fc_rows: for (int r = 0; r < rows; r++) {
+        resident_fc_weight: for (int e = 0; e < run; e++) {
+            #pragma HLS PIPELINE II=1
+            weights.write(resident_store[base + r * N + e]);
+        }
+    }
+}
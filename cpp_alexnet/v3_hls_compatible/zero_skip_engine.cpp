@@ -0,0 +1,109 @@
+#include "cnn_functions.h"
+#include "dsp_packing.h"
+
+// Zero-skipping conv engine (build with USE_ZERO_SKIP_ENGINE=1), a drop-in
+// replacement for compute_tile. The inputs of every layer after the first are
+// post-ReLU, so many activations are zero. For each kernel tap:
+//   - compact_loop keeps the output pixels whose input position is nonzero in
+//     at least one of the tn_bound channels, one pixel per cycle
+//   - nz_pixel_loop runs the too_batch_loop of compute_tile on those pixels
+//     only, and gates the products of zero activations inside them
+// The TN input channels of a pixel share one pipeline iteration, so cycles
+// are saved on whole pixels; a single zero channel only saves a multiply.
+//
+// A skipped or gated product is zero, so the result is bit-exact with
+// compute_tile.
+
+#ifndef __SYNTHESIS__
+CU_LOCAL ZeroSkipCounters zero_skip_counters = ZeroSkipCounters();
+#endif
+
+void zero_skip_compute_tile(
+    data_t input_buffer[TN][INPUT_TILE_HEIGHT][INPUT_TILE_WIDTH],
+    weight_t weight_buffer[TM][TN][MAX_KERNEL_SIZE*MAX_KERNEL_SIZE],
+    acc_t output_buffer[TM][TR][TC],
+    int kernel_size, int stride, int tm_bound, int tn_bound, int tr_bound, int tc_bound) {
+
+    #pragma HLS INLINE off
+
+    // Output pixels of the current tap with a nonzero activation
+    int pixel_row[TR*TC];
+    int pixel_col[TR*TC];
+
+    const int pixels = tr_bound * tc_bound;
+
+    i_loop: for (int i = 0; i < kernel_size; i++) {
+        j_loop: for (int j = 0; j < kernel_size; j++) {
+            int k_idx = i * kernel_size + j;
+
+            // One pixel per cycle, one read per input_buffer bank
+            int count = 0;
+            int r_in = 0;
+            int c_in = 0;
+            compact_loop: for (int p = 0; p < pixels; p++) {
+                #pragma HLS PIPELINE II=1
+                int h = r_in * stride + i;
+                int w = c_in * stride + j;
+                bool nonzero = false;
+                compact_n: for (int tii = 0; tii < TN; tii++) {
+                    #pragma HLS UNROLL
+                    nonzero |= (tii < tn_bound && input_buffer[tii][h][w] != 0);
+                }
+                if (nonzero) {
+                    pixel_row[count] = r_in;
+                    pixel_col[count] = c_in;
+                    count++;
+                }
+                if (++c_in == tc_bound) {
+                    c_in = 0;
+                    r_in++;
+                }
+            }
+
+            nz_pixel_loop: for (int p = 0; p < count; p++) {
+                int trr = pixel_row[p];
+                int tcc = pixel_col[p];
+                int h = trr * stride + i;
+                int w = tcc * stride + j;
+
+                too_batch_loop: for (int too_base = 0; too_base < tm_bound; too_base += 2) {
+                    int too_limit = ((too_base + 2) <= tm_bound) ? 2 : (tm_bound - too_base);
+
+                    #pragma HLS PIPELINE II=1
+                    tii_loop: for (int tii = 0; tii < tn_bound; tii++) {
+                        data_t activation = input_buffer[tii][h][w];
+#if USE_DSP_PACKING
+                        // Both output channels from one DSP48E2, gated off together
+                        if (activation != 0) {
+                            dsp_mac_pair(output_buffer, weight_buffer, too_base, too_limit, tii, k_idx, trr, tcc, activation);
+                        }
+#else
+                        too_inner_loop: for (int too_offset = 0; too_offset < too_limit; too_offset++) {
+                            #pragma HLS UNROLL
+                            int too = too_base + too_offset;
+
+                            // Multiplier gated off for a zero activation
+                            if (activation != 0) {
+                                output_buffer[too][trr][tcc] += weight_buffer[too][tii][k_idx] * activation;
+                            }
+                        }
+#endif
+#ifndef __SYNTHESIS__
+                        if (activation == 0) {
+                            zero_skip_counters.gated_macs += too_limit;
+                        }
+#endif
+                    }
+                }
+            }
+
+#ifndef __SYNTHESIS__
+            long long slot_macs = (long long)tm_bound * tn_bound;
+            zero_skip_counters.pixel_slots += pixels;
+            zero_skip_counters.skipped_slots += pixels - count;
+            zero_skip_counters.dense_macs += pixels * slot_macs;
+            zero_skip_counters.skipped_macs += (pixels - count) * slot_macs;
+#endif
+        }
+    }
+}
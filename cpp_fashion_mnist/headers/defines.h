@@ -62,6 +62,13 @@ typedef ap_fixed<EXP_WIDTH, INT_WIDTH> float24_t;
 #define FC2_BIAS_SIZE 10
 #define FC2_ACT_SIZE 10
 
+// nnet() mode, an s_axilite register: NNET_LOAD_WEIGHTS copies the conv1 and
+// conv2 filters into their on-chip caches and runs the image; NNET_INFER runs
+// the image with the cached filters and does not read conv1_weights or
+// conv2_weights. Load once, then infer every further image.
+#define NNET_LOAD_WEIGHTS 0
+#define NNET_INFER 1
+
 // Optimization parameters for AMD Kria KV260
 // These are tuned for the enhanced resources of the KV260
 
@@ -20,6 +20,15 @@
 #endif
 #define DEBUG_ARRAY(name, arr, size, max_print)
 
+#ifndef __SYNTHESIS__
+// Weight words read from DDR since the testbench last cleared the counter
+// (C simulation only)
+long long nnet_weight_words = 0;
+#define COUNT_WEIGHT_WORDS(n) (nnet_weight_words += (n))
+#else
+#define COUNT_WEIGHT_WORDS(n)
+#endif
+
 // Simple inline functions for index calculation
 inline int conv1_weight_idx(int c_out, int c_in, int h, int w) {
     #pragma HLS INLINE
@@ -42,12 +51,17 @@ inline int get_3d_index(int ch, int row, int col, int height, int width) {
     return ch * height * width + row * width + col;
 }
 
-// CONV1 with extensive debugging
+// CONV1: one output pixel per cycle. The image and, with load_weights, all
+// filters are copied on chip, in memory order; the filters stay in
+// weight_cache for later calls. Each filter pass then streams the image
+// through a line buffer and applies the 3x3 window of every input channel in
+// parallel.
 void conv_layer1_minimal(
     float24_t* output,
     const float24_t* input,
     const float24_t* weights,
-    const float24_t* bias) {
+    const float24_t* bias,
+    bool load_weights) {
     
     #pragma HLS INLINE off
     
@@ -55,34 +69,115 @@ void conv_layer1_minimal(
     
     const int padding = 1;
     
+    float24_t image_cache[CONV1_CHANNELS][IMAGE_SIZE * IMAGE_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=image_cache dim=1 complete
+    static float24_t weight_cache[CONV1_FILTERS][CONV1_CHANNELS * CONV1_KERNEL_SIZE * CONV1_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=weight_cache dim=2 complete
+    
+    CONV1_LOAD_IMAGE: for (int if_idx = 0; if_idx < CONV1_CHANNELS; if_idx++) {
+        for (int i = 0; i < IMAGE_SIZE * IMAGE_SIZE; i++) {
+            #pragma HLS PIPELINE II=1
+            image_cache[if_idx][i] = input[if_idx * IMAGE_SIZE * IMAGE_SIZE + i];
+        }
+    }
+    
+    if (load_weights) {
+        CONV1_LOAD_WEIGHTS: for (int ki = 0; ki < CONV1_KERNEL_SIZE; ki++) {
+            for (int kj = 0; kj < CONV1_KERNEL_SIZE; kj++) {
+                for (int if_idx = 0; if_idx < CONV1_CHANNELS; if_idx++) {
+                    for (int of = 0; of < CONV1_FILTERS; of++) {
+                        #pragma HLS PIPELINE II=1
+                        weight_cache[of][(if_idx * CONV1_KERNEL_SIZE + ki) * CONV1_KERNEL_SIZE + kj] =
+                            weights[conv1_weight_idx(of, if_idx, ki, kj)];
+                        COUNT_WEIGHT_WORDS(1);
+                    }
+                }
+            }
+        }
+    }
+    
+    float24_t line_buffer[CONV1_KERNEL_SIZE - 1][CONV1_CHANNELS][IMAGE_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=line_buffer dim=1 complete
+    #pragma HLS ARRAY_PARTITION variable=line_buffer dim=2 complete
+    float24_t window[CONV1_CHANNELS][CONV1_KERNEL_SIZE][CONV1_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=window dim=0 complete
+    float24_t filter[CONV1_CHANNELS * CONV1_KERNEL_SIZE * CONV1_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=filter dim=0 complete
+    
+    CONV1_CLEAR: for (int col = 0; col < IMAGE_SIZE; col++) {
+        #pragma HLS PIPELINE II=1
+        for (int if_idx = 0; if_idx < CONV1_CHANNELS; if_idx++) {
+            for (int ki = 0; ki < CONV1_KERNEL_SIZE; ki++) {
+                if (ki < CONV1_KERNEL_SIZE - 1) {
+                    line_buffer[ki][if_idx][col] = float24_t(0);
+                }
+                for (int kj = 0; kj < CONV1_KERNEL_SIZE; kj++) {
+                    window[if_idx][ki][kj] = float24_t(0);
+                }
+            }
+        }
+    }
+    
     CONV1_FILTER: for (int of = 0; of < CONV1_FILTERS; of++) {
-        CONV1_ROW: for (int row = 0; row < IMAGE_SIZE; row++) {
-            #pragma HLS LOOP_TRIPCOUNT min=28 max=28
-            
-            CONV1_COL: for (int col = 0; col < IMAGE_SIZE; col++) {
-                #pragma HLS PIPELINE II=9
+        CONV1_FILTER_LOAD: for (int k = 0; k < CONV1_CHANNELS * CONV1_KERNEL_SIZE * CONV1_KERNEL_SIZE; k++) {
+            #pragma HLS UNROLL
+            filter[k] = weight_cache[of][k];
+        }
+        
+        // The pixel loop runs one row and one column past the image, so the
+        // window holds input rows row-2..row and columns col-2..col: the
+        // padded neighbourhood of output (row-1, col-1). Window taps outside
+        // the image (padding, or stale line buffer contents) read as zero.
+        CONV1_ROW: for (int row = 0; row <= IMAGE_SIZE; row++) {
+            CONV1_COL: for (int col = 0; col <= IMAGE_SIZE; col++) {
+                #pragma HLS PIPELINE II=1
                 
-                float24_t sum = bias[of];
+                CONV1_SHIFT: for (int if_idx = 0; if_idx < CONV1_CHANNELS; if_idx++) {
+                    for (int ki = 0; ki < CONV1_KERNEL_SIZE; ki++) {
+                        for (int kj = 0; kj < CONV1_KERNEL_SIZE - 1; kj++) {
+                            window[if_idx][ki][kj] = window[if_idx][ki][kj + 1];
+                        }
+                    }
+                    if (col < IMAGE_SIZE) {
+                        float24_t pixel = float24_t(0);
+                        if (row < IMAGE_SIZE) {
+                            pixel = image_cache[if_idx][row * IMAGE_SIZE + col];
+                        }
+                        for (int ki = 0; ki < CONV1_KERNEL_SIZE - 1; ki++) {
+                            window[if_idx][ki][CONV1_KERNEL_SIZE - 1] = line_buffer[ki][if_idx][col];
+                        }
+                        window[if_idx][CONV1_KERNEL_SIZE - 1][CONV1_KERNEL_SIZE - 1] = pixel;
+                        for (int ki = 0; ki < CONV1_KERNEL_SIZE - 2; ki++) {
+                            line_buffer[ki][if_idx][col] = line_buffer[ki + 1][if_idx][col];
+                        }
+                        line_buffer[CONV1_KERNEL_SIZE - 2][if_idx][col] = pixel;
+                    }
+                }
                 
-                for (int ki = 0; ki < CONV1_KERNEL_SIZE; ki++) {
-                    for (int kj = 0; kj < CONV1_KERNEL_SIZE; kj++) {
-                        for (int if_idx = 0; if_idx < CONV1_CHANNELS; if_idx++) {
-                            int in_row = row + ki - padding;
-                            int in_col = col + kj - padding;
-                            
-                            float24_t input_val = float24_t(0);
-                            if (in_row >= 0 && in_row < IMAGE_SIZE && 
-                                in_col >= 0 && in_col < IMAGE_SIZE) {
-                                input_val = input[get_3d_index(if_idx, in_row, in_col, IMAGE_SIZE, IMAGE_SIZE)];
+                int out_row = row - padding;
+                int out_col = col - padding;
+                if (out_row >= 0 && out_col >= 0) {
+                    float24_t sum = bias[of];
+                    
+                    for (int if_idx = 0; if_idx < CONV1_CHANNELS; if_idx++) {
+                        for (int ki = 0; ki < CONV1_KERNEL_SIZE; ki++) {
+                            for (int kj = 0; kj < CONV1_KERNEL_SIZE; kj++) {
+                                int in_row = out_row + ki - padding;
+                                int in_col = out_col + kj - padding;
+                                
+                                float24_t input_val = float24_t(0);
+                                if (in_row >= 0 && in_row < IMAGE_SIZE &&
+                                    in_col >= 0 && in_col < IMAGE_SIZE) {
+                                    input_val = window[if_idx][ki][kj];
+                                }
+                                
+                                sum += input_val * filter[(if_idx * CONV1_KERNEL_SIZE + ki) * CONV1_KERNEL_SIZE + kj];
                             }
-                            
-                            int weight_idx = conv1_weight_idx(of, if_idx, ki, kj);
-                            sum += input_val * weights[weight_idx];
                         }
                     }
+                    
+                    output[get_3d_index(of, out_row, out_col, IMAGE_SIZE, IMAGE_SIZE)] = relu(sum);
                 }
-                
-                output[get_3d_index(of, row, col, IMAGE_SIZE, IMAGE_SIZE)] = relu(sum);
             }
         }
     }
@@ -122,11 +217,18 @@ void pool_layer1_minimal(
     DEBUG_PRINT("[DEBUG] Finished pool_layer1_minimal");
 }
 
+// CONV2: same structure as CONV1 on the pooled maps, which are already on
+// chip: the input channels are read in parallel (pool1_out is partitioned by
+// channel) and each output pixel takes one cycle with CONV1_FILTERS * 9 MACs.
+// That costs 288 DSPs, and the weight cache splits into 288 memories of
+// CONV2_FILTERS words, which are kept in LUTRAM: as BRAM18 they would take
+// every block RAM of the KV260.
 void conv_layer2_minimal(
     float24_t* output,
     const float24_t* input,
     const float24_t* weights,
-    const float24_t* bias) {
+    const float24_t* bias,
+    bool load_weights) {
     
     #pragma HLS INLINE off
     
@@ -134,32 +236,103 @@ void conv_layer2_minimal(
     
     const int padding = 1;
     
+    static float24_t weight_cache[CONV2_FILTERS][CONV1_FILTERS * CONV2_KERNEL_SIZE * CONV2_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=weight_cache dim=2 complete
+    #pragma HLS BIND_STORAGE variable=weight_cache type=ram_1p impl=lutram
+    
+    if (load_weights) {
+        CONV2_LOAD_WEIGHTS: for (int ki = 0; ki < CONV2_KERNEL_SIZE; ki++) {
+            for (int kj = 0; kj < CONV2_KERNEL_SIZE; kj++) {
+                for (int if_idx = 0; if_idx < CONV1_FILTERS; if_idx++) {
+                    for (int of = 0; of < CONV2_FILTERS; of++) {
+                        #pragma HLS PIPELINE II=1
+                        weight_cache[of][(if_idx * CONV2_KERNEL_SIZE + ki) * CONV2_KERNEL_SIZE + kj] =
+                            weights[conv2_weight_idx(of, if_idx, ki, kj)];
+                        COUNT_WEIGHT_WORDS(1);
+                    }
+                }
+            }
+        }
+    }
+    
+    float24_t line_buffer[CONV2_KERNEL_SIZE - 1][CONV1_FILTERS][P1_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=line_buffer dim=1 complete
+    #pragma HLS ARRAY_PARTITION variable=line_buffer dim=2 complete
+    float24_t window[CONV1_FILTERS][CONV2_KERNEL_SIZE][CONV2_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=window dim=0 complete
+    float24_t filter[CONV1_FILTERS * CONV2_KERNEL_SIZE * CONV2_KERNEL_SIZE];
+    #pragma HLS ARRAY_PARTITION variable=filter dim=0 complete
+    
+    CONV2_CLEAR: for (int col = 0; col < P1_SIZE; col++) {
+        #pragma HLS PIPELINE II=1
+        for (int if_idx = 0; if_idx < CONV1_FILTERS; if_idx++) {
+            for (int ki = 0; ki < CONV2_KERNEL_SIZE; ki++) {
+                if (ki < CONV2_KERNEL_SIZE - 1) {
+                    line_buffer[ki][if_idx][col] = float24_t(0);
+                }
+                for (int kj = 0; kj < CONV2_KERNEL_SIZE; kj++) {
+                    window[if_idx][ki][kj] = float24_t(0);
+                }
+            }
+        }
+    }
+    
     CONV2_FILTER: for (int of = 0; of < CONV2_FILTERS; of++) {
-        CONV2_ROW: for (int row = 0; row < P1_SIZE; row++) {
-            CONV2_COL: for (int col = 0; col < P1_SIZE; col++) {
-                #pragma HLS PIPELINE II=12
-                
-                float24_t sum = bias[of];
+        CONV2_FILTER_LOAD: for (int k = 0; k < CONV1_FILTERS * CONV2_KERNEL_SIZE * CONV2_KERNEL_SIZE; k++) {
+            #pragma HLS UNROLL
+            filter[k] = weight_cache[of][k];
+        }
+        
+        CONV2_ROW: for (int row = 0; row <= P1_SIZE; row++) {
+            CONV2_COL: for (int col = 0; col <= P1_SIZE; col++) {
+                #pragma HLS PIPELINE II=1
                 
-                for (int if_idx = 0; if_idx < CONV1_FILTERS; if_idx++) {
+                CONV2_SHIFT: for (int if_idx = 0; if_idx < CONV1_FILTERS; if_idx++) {
                     for (int ki = 0; ki < CONV2_KERNEL_SIZE; ki++) {
-                        for (int kj = 0; kj < CONV2_KERNEL_SIZE; kj++) {
-                            int in_row = row + ki - padding;
-                            int in_col = col + kj - padding;
-                            
-                            float24_t input_val = float24_t(0);
-                            if (in_row >= 0 && in_row < P1_SIZE && 
-                                in_col >= 0 && in_col < P1_SIZE) {
-                                input_val = input[get_3d_index(if_idx, in_row, in_col, P1_SIZE, P1_SIZE)];
-                            }
-                            
-                            int weight_idx = conv2_weight_idx(of, if_idx, ki, kj);
-                            sum += input_val * weights[weight_idx];
+                        for (int kj = 0; kj < CONV2_KERNEL_SIZE - 1; kj++) {
+                            window[if_idx][ki][kj] = window[if_idx][ki][kj + 1];
+                        }
+                    }
+                    if (col < P1_SIZE) {
+                        float24_t pixel = float24_t(0);
+                        if (row < P1_SIZE) {
+                            pixel = input[get_3d_index(if_idx, row, col, P1_SIZE, P1_SIZE)];
+                        }
+                        for (int ki = 0; ki < CONV2_KERNEL_SIZE - 1; ki++) {
+                            window[if_idx][ki][CONV2_KERNEL_SIZE - 1] = line_buffer[ki][if_idx][col];
+                        }
+                        window[if_idx][CONV2_KERNEL_SIZE - 1][CONV2_KERNEL_SIZE - 1] = pixel;
+                        for (int ki = 0; ki < CONV2_KERNEL_SIZE - 2; ki++) {
+                            line_buffer[ki][if_idx][col] = line_buffer[ki + 1][if_idx][col];
                         }
+                        line_buffer[CONV2_KERNEL_SIZE - 2][if_idx][col] = pixel;
                     }
                 }
                 
-                output[get_3d_index(of, row, col, P1_SIZE, P1_SIZE)] = relu(sum);
+                int out_row = row - padding;
+                int out_col = col - padding;
+                if (out_row >= 0 && out_col >= 0) {
+                    float24_t sum = bias[of];
+                    
+                    for (int if_idx = 0; if_idx < CONV1_FILTERS; if_idx++) {
+                        for (int ki = 0; ki < CONV2_KERNEL_SIZE; ki++) {
+                            for (int kj = 0; kj < CONV2_KERNEL_SIZE; kj++) {
+                                int in_row = out_row + ki - padding;
+                                int in_col = out_col + kj - padding;
+                                
+                                float24_t input_val = float24_t(0);
+                                if (in_row >= 0 && in_row < P1_SIZE &&
+                                    in_col >= 0 && in_col < P1_SIZE) {
+                                    input_val = window[if_idx][ki][kj];
+                                }
+                                
+                                sum += input_val * filter[(if_idx * CONV2_KERNEL_SIZE + ki) * CONV2_KERNEL_SIZE + kj];
+                            }
+                        }
+                    }
+                    
+                    output[get_3d_index(of, out_row, out_col, P1_SIZE, P1_SIZE)] = relu(sum);
+                }
             }
         }
     }
@@ -210,22 +383,30 @@ void fc_layer1_minimal(
     DEBUG_PRINT("[DEBUG] Starting fc_layer1_minimal");
     DEBUG_ARRAY("FC1 input", input, FC1_WEIGHTS_H, 10);
     
-    // Initialize output with bias
-    for (int j = 0; j < FC1_WEIGHTS_W; j++) {
-        output[j] = bias[j];
+    // One accumulator per output. The weights are [input][output], so with
+    // the outputs in the inner loop the whole matrix is read once in memory
+    // order as one sequential burst. Each accumulator sums its products in
+    // input order, one output per cycle.
+    float24_t acc[FC1_WEIGHTS_W];
+    
+    FC1_INIT: for (int j = 0; j < FC1_WEIGHTS_W; j++) {
+        #pragma HLS PIPELINE II=1
+        acc[j] = float24_t(0);
     }
     
-    // Process one output at a time - CLEAN AND SIMPLE
-    for (int j = 0; j < FC1_WEIGHTS_W; j++) {
-        float24_t acc = float24_t(0);
-        
-        for (int i = 0; i < FC1_WEIGHTS_H; i++) {
+    FC1_IN: for (int i = 0; i < FC1_WEIGHTS_H; i++) {
+        FC1_OUT: for (int j = 0; j < FC1_WEIGHTS_W; j++) {
             #pragma HLS PIPELINE II=1
-            acc += input[i] * weights[i * FC1_WEIGHTS_W + j];
+            // acc[j] is updated again FC1_WEIGHTS_W iterations later
+            #pragma HLS DEPENDENCE variable=acc inter false
+            acc[j] += input[i] * weights[i * FC1_WEIGHTS_W + j];
+            COUNT_WEIGHT_WORDS(1);
         }
-        
-        output[j] += acc;
-        output[j] = relu(output[j]);
+    }
+    
+    FC1_BIAS: for (int j = 0; j < FC1_WEIGHTS_W; j++) {
+        #pragma HLS PIPELINE II=1
+        output[j] = relu(bias[j] + acc[j]);
     }
     
     DEBUG_ARRAY("FC1 output", output, FC1_WEIGHTS_W, 10);
@@ -262,21 +443,29 @@ void fc_layer2_minimal(
     
     float24_t raw_output[FC2_WEIGHTS_W];
     
-    // Initialize with bias
-    for (int j = 0; j < FC2_WEIGHTS_W; j++) {
-        raw_output[j] = bias[j];
+    // Same weight streaming as FC1: the [input][output] matrix is read once
+    // in memory order. With only FC2_WEIGHTS_W outputs an accumulator comes
+    // back before its previous update has left the pipeline, so the
+    // accumulators live in registers and the dependence is kept.
+    float24_t acc[FC2_WEIGHTS_W];
+    #pragma HLS ARRAY_PARTITION variable=acc complete
+    
+    FC2_INIT: for (int j = 0; j < FC2_WEIGHTS_W; j++) {
+        #pragma HLS UNROLL
+        acc[j] = float24_t(0);
     }
     
-    // Process one output at a time
-    for (int j = 0; j < FC2_WEIGHTS_W; j++) {
-        float24_t acc = float24_t(0);
-        
-        for (int i = 0; i < FC1_WEIGHTS_W; i++) {
+    FC2_IN: for (int i = 0; i < FC1_WEIGHTS_W; i++) {
+        FC2_OUT: for (int j = 0; j < FC2_WEIGHTS_W; j++) {
             #pragma HLS PIPELINE II=1
-            acc += input[i] * weights[i * FC2_WEIGHTS_W + j];
+            acc[j] += input[i] * weights[i * FC2_WEIGHTS_W + j];
+            COUNT_WEIGHT_WORDS(1);
         }
-        
-        raw_output[j] += acc;
+    }
+    
+    FC2_BIAS: for (int j = 0; j < FC2_WEIGHTS_W; j++) {
+        #pragma HLS UNROLL
+        raw_output[j] = bias[j] + acc[j];
     }
     
     DEBUG_ARRAY("FC2 raw_output", raw_output, FC2_WEIGHTS_W, 10);
@@ -322,7 +511,8 @@ void nnet(
     float24_t* fc1_bias,
     float24_t* fc2_weights,
     float24_t* fc2_bias,
-    float24_t* predictions
+    float24_t* predictions,
+    int mode
 ) {
     // MAXI interfaces with proper alignment and burst lengths
     #pragma HLS INTERFACE m_axi port=image offset=slave bundle=gmem0 depth=784 max_read_burst_length=256 max_write_burst_length=256
@@ -336,8 +526,12 @@ void nnet(
     #pragma HLS INTERFACE m_axi port=fc2_bias offset=slave bundle=gmem8 depth=10 max_read_burst_length=16
     #pragma HLS INTERFACE m_axi port=predictions offset=slave bundle=gmem9 depth=10 max_write_burst_length=16
     
+    #pragma HLS INTERFACE s_axilite port=mode bundle=control
     #pragma HLS INTERFACE s_axilite port=return bundle=control
     
+    // The conv filters persist in the weight caches of the conv layers
+    bool load_weights = (mode != NNET_INFER);
+    
     // Local copies of bias values
     float24_t local_conv1_bias[CONV1_FILTERS];
     float24_t local_conv2_bias[CONV2_FILTERS];
@@ -370,6 +564,8 @@ void nnet(
     // Intermediate buffers
     static float24_t conv1_out[CONV1_FILTERS * IMAGE_SIZE * IMAGE_SIZE];
     static float24_t pool1_out[CONV1_FILTERS * P1_SIZE * P1_SIZE];
+    // conv_layer2_minimal reads all channels of a pixel in the same cycle
+    #pragma HLS ARRAY_PARTITION variable=pool1_out block factor=CONV1_FILTERS
     static float24_t conv2_out[CONV2_FILTERS * P1_SIZE * P1_SIZE];
     static float24_t pool2_out[CONV2_FILTERS * P2_SIZE * P2_SIZE];
     static float24_t flattened[FC1_WEIGHTS_H];
@@ -378,9 +574,9 @@ void nnet(
     DEBUG_PRINT("[DEBUG] Starting nnet function");
     
     // Run network
-    conv_layer1_minimal(conv1_out, image, conv1_weights, local_conv1_bias);
+    conv_layer1_minimal(conv1_out, image, conv1_weights, local_conv1_bias, load_weights);
     pool_layer1_minimal(pool1_out, conv1_out);
-    conv_layer2_minimal(conv2_out, pool1_out, conv2_weights, local_conv2_bias);
+    conv_layer2_minimal(conv2_out, pool1_out, conv2_weights, local_conv2_bias, load_weights);
     pool_layer2_minimal(pool2_out, conv2_out);
     flatten_minimal(flattened, pool2_out);
     fc_layer1_minimal(fc1_out, flattened, fc1_weights, local_fc1_bias);
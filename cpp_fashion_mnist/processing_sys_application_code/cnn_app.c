@@ -25,6 +25,7 @@
 #define AP_CTRL_IDLE_BIT       0x4
 
 #define CTRL_REG_OFFSET        0x00
+#define MODE_REG_OFFSET        0x10  // s_axi_control: nnet() mode
 
 // DDR memory regions - using AXI interface base addresses from updated address map
 #define IMAGE_DDR_ADDR         0x04000000UL  // gmem0: 0x4000000 (64MB)
@@ -264,6 +265,11 @@ int run_cnn_single_image(void) {
         return CNN_ERROR_ACCELERATOR;
     }
 
+    // This run is the first image, so it copies the conv filters on chip.
+    // Further images can start with NNET_INFER and skip those reads.
+    xil_printf("  Setting mode: NNET_LOAD_WEIGHTS -> offset 0x%02x\r\n", MODE_REG_OFFSET);
+    Xil_Out32(ACCEL_CTRL_BASEADDR + MODE_REG_OFFSET, NNET_LOAD_WEIGHTS);
+
     // Step 4: Start accelerator
     xil_printf("\r\nStep 4: Start accelerator...\r\n");
     xil_printf("  Writing START bit to control register at 0x%08x\r\n",
@@ -40,6 +40,10 @@ extern const char* FASHION_CLASSES[10];
 #define AP_READY_BIT           0x1
 #define AP_START_BIT           0x1
 
+// nnet() mode register values (headers/defines.h)
+#define NNET_LOAD_WEIGHTS      0
+#define NNET_INFER             1
+
 // Input data pointer registers
 #define IMAGE_ADDR_OFFSET        0x10
 #define CONV1_WEIGHTS_ADDR_OFFSET 0x18
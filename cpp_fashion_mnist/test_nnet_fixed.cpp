@@ -12,8 +12,10 @@
 #include <iomanip>
 #include <chrono>
 #include <sstream>
+#include <random>
 #include "headers/defines.h"
 #include "headers/activations.h"
+#include <hls_math.h>
 
 // Function declaration for the nnet accelerator
 void nnet(
@@ -26,9 +28,21 @@ void nnet(
     float24_t* fc1_bias,
     float24_t* fc2_weights,
     float24_t* fc2_bias,
-    float24_t* predictions
+    float24_t* predictions,
+    int mode
 );
 
+// Layers of nnet_fixed.cpp checked against the references below
+void conv_layer1_minimal(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias,
+                         bool load_weights);
+void conv_layer2_minimal(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias,
+                         bool load_weights);
+void fc_layer1_minimal(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias);
+void fc_layer2_minimal(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias);
+
+// Weight words nnet() read from DDR (C simulation counter in nnet_fixed.cpp)
+extern long long nnet_weight_words;
+
 // Fashion-MNIST class names
 const std::vector<std::string> FASHION_CLASSES = {
     "T-shirt/top", "Trouser", "Pullover", "Dress", "Coat",
@@ -223,6 +237,321 @@ void print_predictions(const float24_t* predictions) {
               << ") with confidence: " << std::fixed << std::setprecision(6) << max_prob << std::endl;
 }
 
+// Random network parameters and images for the self-checks, which do not need
+// the weight files
+struct RandomNetwork {
+    std::vector<float24_t> conv1_weights, conv1_bias, conv2_weights, conv2_bias;
+    std::vector<float24_t> fc1_weights, fc1_bias, fc2_weights, fc2_bias;
+};
+
+void fill_random(std::vector<float24_t>& data, size_t count, std::mt19937& gen, float low, float high) {
+    std::uniform_real_distribution<float> dist(low, high);
+    data.resize(count);
+    for (float24_t& value : data) {
+        value = float24_t(dist(gen));
+    }
+}
+
+RandomNetwork make_random_network(std::mt19937& gen) {
+    RandomNetwork net;
+    fill_random(net.conv1_weights, CONV1_FILTERS * CONV1_CHANNELS * CONV1_KERNEL_SIZE * CONV1_KERNEL_SIZE, gen, -0.5f, 0.5f);
+    fill_random(net.conv1_bias, CONV1_FILTERS, gen, -0.1f, 0.1f);
+    fill_random(net.conv2_weights, CONV2_FILTERS * CONV1_FILTERS * CONV2_KERNEL_SIZE * CONV2_KERNEL_SIZE, gen, -0.1f, 0.1f);
+    fill_random(net.conv2_bias, CONV2_FILTERS, gen, -0.1f, 0.1f);
+    fill_random(net.fc1_weights, FC1_WEIGHTS_H * FC1_WEIGHTS_W, gen, -0.05f, 0.05f);
+    fill_random(net.fc1_bias, FC1_WEIGHTS_W, gen, -0.1f, 0.1f);
+    fill_random(net.fc2_weights, FC1_WEIGHTS_W * FC2_WEIGHTS_W, gen, -0.2f, 0.2f);
+    fill_random(net.fc2_bias, FC2_WEIGHTS_W, gen, -0.1f, 0.1f);
+    return net;
+}
+
+void run_nnet(RandomNetwork& net, std::vector<float24_t>& conv1_weights, std::vector<float24_t>& conv2_weights,
+              std::vector<float24_t>& image, std::vector<float24_t>& predictions, int mode) {
+    predictions.assign(FC2_WEIGHTS_W, float24_t(0));
+    nnet(image.data(), conv1_weights.data(), net.conv1_bias.data(), conv2_weights.data(), net.conv2_bias.data(),
+         net.fc1_weights.data(), net.fc1_bias.data(), net.fc2_weights.data(), net.fc2_bias.data(),
+         predictions.data(), mode);
+}
+
+// Preload/infer protocol: an NNET_INFER call must give the same predictions
+// as an NNET_LOAD_WEIGHTS call on the same image, with the conv weights in DDR
+// overwritten so that reading them would show, and read fewer weight words
+bool check_weight_modes() {
+    std::cout << "\n============ SELF-CHECK: NNET_LOAD_WEIGHTS vs NNET_INFER ============" << std::endl;
+    std::mt19937 gen(2024);
+    RandomNetwork net = make_random_network(gen);
+    std::vector<float24_t> poisoned_conv1(net.conv1_weights.size(), float24_t(-8.0f));
+    std::vector<float24_t> poisoned_conv2(net.conv2_weights.size(), float24_t(-8.0f));
+    std::vector<float24_t> predictions, reference;
+
+    bool pass = true;
+    long long load_words = 0, infer_words = 0;
+    for (int image_idx = 0; image_idx < 3; image_idx++) {
+        std::vector<float24_t> image;
+        fill_random(image, IMAGE_CHANNELS * IMAGE_SIZE * IMAGE_SIZE, gen, 0.0f, 1.0f);
+
+        // The first image loads the weights, the others only infer
+        nnet_weight_words = 0;
+        if (image_idx == 0) {
+            run_nnet(net, net.conv1_weights, net.conv2_weights, image, predictions, NNET_LOAD_WEIGHTS);
+        }
+        else {
+            run_nnet(net, poisoned_conv1, poisoned_conv2, image, predictions, NNET_INFER);
+        }
+        long long words = nnet_weight_words;
+
+        nnet_weight_words = 0;
+        run_nnet(net, net.conv1_weights, net.conv2_weights, image, reference, NNET_LOAD_WEIGHTS);
+        load_words = nnet_weight_words;
+        if (image_idx > 0) {
+            infer_words = words;
+        }
+
+        bool identical = (predictions == reference);
+        pass = pass && identical;
+        std::cout << "Image " << image_idx << " (" << (image_idx == 0 ? "load" : "infer") << "): "
+                  << words << " weight words, predictions " << (identical ? "identical" : "DIFFERENT") << std::endl;
+    }
+
+    long long saved = load_words - infer_words;
+    long long conv_words = CONV1_FILTERS * CONV1_CHANNELS * CONV1_KERNEL_SIZE * CONV1_KERNEL_SIZE +
+                           CONV2_FILTERS * CONV1_FILTERS * CONV2_KERNEL_SIZE * CONV2_KERNEL_SIZE;
+    pass = pass && (saved == conv_words);
+    std::cout << "Weight words per image: " << load_words << " with NNET_LOAD_WEIGHTS, " << infer_words
+              << " with NNET_INFER (" << saved << " saved)" << std::endl;
+    std::cout << "Weight mode check " << (pass ? "PASSED" : "FAILED") << std::endl;
+    return pass;
+}
+
+// Conv weights are [kernel row][kernel col][input channel][filter]
+inline int conv_weight_idx(int c_out, int c_in, int h, int w, int channels, int filters) {
+    return ((h * CONV1_KERNEL_SIZE + w) * channels + c_in) * filters + c_out;
+}
+
+// Reference CONV1, the layer before line buffers: every tap read from the
+// input in memory, products summed in kernel order
+void reference_conv_layer1(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias) {
+    const int padding = 1;
+    for (int of = 0; of < CONV1_FILTERS; of++) {
+        for (int row = 0; row < IMAGE_SIZE; row++) {
+            for (int col = 0; col < IMAGE_SIZE; col++) {
+                float24_t sum = bias[of];
+                for (int ki = 0; ki < CONV1_KERNEL_SIZE; ki++) {
+                    for (int kj = 0; kj < CONV1_KERNEL_SIZE; kj++) {
+                        for (int if_idx = 0; if_idx < CONV1_CHANNELS; if_idx++) {
+                            int in_row = row + ki - padding;
+                            int in_col = col + kj - padding;
+                            float24_t input_val = float24_t(0);
+                            if (in_row >= 0 && in_row < IMAGE_SIZE && in_col >= 0 && in_col < IMAGE_SIZE) {
+                                input_val = input[(if_idx * IMAGE_SIZE + in_row) * IMAGE_SIZE + in_col];
+                            }
+                            sum += input_val * weights[conv_weight_idx(of, if_idx, ki, kj, CONV1_CHANNELS, CONV1_FILTERS)];
+                        }
+                    }
+                }
+                output[(of * IMAGE_SIZE + row) * IMAGE_SIZE + col] = relu(sum);
+            }
+        }
+    }
+}
+
+// Reference CONV2, the layer before line buffers
+void reference_conv_layer2(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias) {
+    const int padding = 1;
+    for (int of = 0; of < CONV2_FILTERS; of++) {
+        for (int row = 0; row < P1_SIZE; row++) {
+            for (int col = 0; col < P1_SIZE; col++) {
+                float24_t sum = bias[of];
+                for (int if_idx = 0; if_idx < CONV1_FILTERS; if_idx++) {
+                    for (int ki = 0; ki < CONV2_KERNEL_SIZE; ki++) {
+                        for (int kj = 0; kj < CONV2_KERNEL_SIZE; kj++) {
+                            int in_row = row + ki - padding;
+                            int in_col = col + kj - padding;
+                            float24_t input_val = float24_t(0);
+                            if (in_row >= 0 && in_row < P1_SIZE && in_col >= 0 && in_col < P1_SIZE) {
+                                input_val = input[(if_idx * P1_SIZE + in_row) * P1_SIZE + in_col];
+                            }
+                            sum += input_val * weights[conv_weight_idx(of, if_idx, ki, kj, CONV1_FILTERS, CONV2_FILTERS)];
+                        }
+                    }
+                }
+                output[(of * P1_SIZE + row) * P1_SIZE + col] = relu(sum);
+            }
+        }
+    }
+}
+
+// Reference FC1, the layer before weight streaming: one output at a time, its
+// products summed in input order
+void reference_fc_layer1(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias) {
+    for (int j = 0; j < FC1_WEIGHTS_W; j++) {
+        output[j] = bias[j];
+    }
+    for (int j = 0; j < FC1_WEIGHTS_W; j++) {
+        float24_t acc = float24_t(0);
+        for (int i = 0; i < FC1_WEIGHTS_H; i++) {
+            acc += input[i] * weights[i * FC1_WEIGHTS_W + j];
+        }
+        output[j] += acc;
+        output[j] = relu(output[j]);
+    }
+}
+
+// Reference FC2 and softmax, the layer before weight streaming
+void reference_fc_layer2(float24_t* output, const float24_t* input, const float24_t* weights, const float24_t* bias) {
+    float24_t raw_output[FC2_WEIGHTS_W];
+    for (int j = 0; j < FC2_WEIGHTS_W; j++) {
+        raw_output[j] = bias[j];
+    }
+    for (int j = 0; j < FC2_WEIGHTS_W; j++) {
+        float24_t acc = float24_t(0);
+        for (int i = 0; i < FC1_WEIGHTS_W; i++) {
+            acc += input[i] * weights[i * FC2_WEIGHTS_W + j];
+        }
+        raw_output[j] += acc;
+    }
+
+    float24_t max_val = raw_output[0];
+    for (int j = 1; j < FC2_WEIGHTS_W; j++) {
+        if (raw_output[j] > max_val) max_val = raw_output[j];
+    }
+    float24_t sum_exp = float24_t(0);
+    float24_t exp_vals[FC2_WEIGHTS_W];
+    for (int j = 0; j < FC2_WEIGHTS_W; j++) {
+        float diff = (float)(raw_output[j] - max_val);
+        exp_vals[j] = hls::exp(diff);
+        sum_exp += exp_vals[j];
+    }
+    for (int j = 0; j < FC2_WEIGHTS_W; j++) {
+        if (sum_exp != float24_t(0)) {
+            output[j] = exp_vals[j] / sum_exp;
+        }
+        else {
+            output[j] = (j == 0) ? float24_t(1.0) : float24_t(0.0);
+        }
+    }
+}
+
+// Outputs whose exact bias + sum of products lies outside the float24_t
+// range, so that their accumulator wraps on the way
+int count_wrapped_outputs(const std::vector<float24_t>& input, const std::vector<float24_t>& weights,
+                          const std::vector<float24_t>& bias, int num_inputs, int num_outputs) {
+    const double limit = std::ldexp(1.0, INT_WIDTH - 1);
+    int wrapped = 0;
+    for (int j = 0; j < num_outputs; j++) {
+        double sum = bias[j].to_double();
+        for (int i = 0; i < num_inputs; i++) {
+            sum += input[i].to_double() * weights[i * num_outputs + j].to_double();
+        }
+        if (sum < -limit || sum >= limit) {
+            wrapped++;
+        }
+    }
+    return wrapped;
+}
+
+// Conv output pixels whose exact sum lies outside the float24_t range
+int count_wrapped_pixels(const std::vector<float24_t>& input, const std::vector<float24_t>& weights,
+                         const std::vector<float24_t>& bias, int channels, int filters, int size) {
+    const double limit = std::ldexp(1.0, INT_WIDTH - 1);
+    int wrapped = 0;
+    for (int of = 0; of < filters; of++) {
+        for (int row = 0; row < size; row++) {
+            for (int col = 0; col < size; col++) {
+                double sum = bias[of].to_double();
+                for (int if_idx = 0; if_idx < channels; if_idx++) {
+                    for (int ki = 0; ki < CONV1_KERNEL_SIZE; ki++) {
+                        for (int kj = 0; kj < CONV1_KERNEL_SIZE; kj++) {
+                            int in_row = row + ki - 1;
+                            int in_col = col + kj - 1;
+                            if (in_row >= 0 && in_row < size && in_col >= 0 && in_col < size) {
+                                sum += input[(if_idx * size + in_row) * size + in_col].to_double() *
+                                       weights[conv_weight_idx(of, if_idx, ki, kj, channels, filters)].to_double();
+                            }
+                        }
+                    }
+                }
+                if (sum < -limit || sum >= limit) {
+                    wrapped++;
+                }
+            }
+        }
+    }
+    return wrapped;
+}
+
+// Random-data scales for the reference checks: "wrapping" drives the
+// accumulators out of range. Each layer sums in the same order as its
+// reference, so the two must wrap identically and stay bit-exact.
+struct CheckScale { const char* label; float input; float weight; bool wraps; };
+
+bool report_layer_check(const char* name, const CheckScale& scale, int wrapped, int total, bool identical) {
+    std::cout << name << " " << scale.label << ": " << wrapped << "/" << total
+              << " accumulators wrap, outputs " << (identical ? "identical" : "DIFFERENT") << std::endl;
+    return identical && (wrapped > 0) == scale.wraps;
+}
+
+bool check_conv_layer(const char* name, int channels, int filters, int size, const CheckScale (&scales)[2],
+                      void (*layer)(float24_t*, const float24_t*, const float24_t*, const float24_t*, bool),
+                      void (*reference)(float24_t*, const float24_t*, const float24_t*, const float24_t*),
+                      std::mt19937& gen) {
+    bool pass = true;
+    for (const CheckScale& scale : scales) {
+        std::vector<float24_t> input, weights, bias;
+        fill_random(input, channels * size * size, gen, -scale.input, scale.input);
+        fill_random(weights, filters * channels * CONV1_KERNEL_SIZE * CONV1_KERNEL_SIZE, gen, -scale.weight, scale.weight);
+        fill_random(bias, filters, gen, -0.5f, 0.5f);
+
+        std::vector<float24_t> output(filters * size * size), expected(filters * size * size);
+        layer(output.data(), input.data(), weights.data(), bias.data(), true);
+        reference(expected.data(), input.data(), weights.data(), bias.data());
+
+        int wrapped = count_wrapped_pixels(input, weights, bias, channels, filters, size);
+        pass = report_layer_check(name, scale, wrapped, filters * size * size, output == expected) && pass;
+    }
+    return pass;
+}
+
+bool check_fc_layer(const char* name, int num_inputs, int num_outputs,
+                    void (*layer)(float24_t*, const float24_t*, const float24_t*, const float24_t*),
+                    void (*reference)(float24_t*, const float24_t*, const float24_t*, const float24_t*),
+                    std::mt19937& gen) {
+    const CheckScale scales[] = {{"in range", 1.0f, 0.02f, false}, {"wrapping", 8.0f, 2.0f, true}};
+
+    bool pass = true;
+    for (const CheckScale& scale : scales) {
+        std::vector<float24_t> input, weights, bias;
+        fill_random(input, num_inputs, gen, -scale.input, scale.input);
+        fill_random(weights, num_inputs * num_outputs, gen, -scale.weight, scale.weight);
+        fill_random(bias, num_outputs, gen, -0.5f, 0.5f);
+
+        std::vector<float24_t> output(num_outputs), expected(num_outputs);
+        layer(output.data(), input.data(), weights.data(), bias.data());
+        reference(expected.data(), input.data(), weights.data(), bias.data());
+
+        int wrapped = count_wrapped_outputs(input, weights, bias, num_inputs, num_outputs);
+        pass = report_layer_check(name, scale, wrapped, num_outputs, output == expected) && pass;
+    }
+    return pass;
+}
+
+// The reordered layers against the references they replaced
+bool check_layers_against_reference() {
+    std::cout << "\n============ SELF-CHECK: LAYERS vs REFERENCES ============" << std::endl;
+    std::mt19937 gen(470);
+    const CheckScale conv1_scales[] = {{"in range", 1.0f, 0.5f, false}, {"wrapping", 8.0f, 2.0f, true}};
+    const CheckScale conv2_scales[] = {{"in range", 1.0f, 0.02f, false}, {"wrapping", 4.0f, 1.0f, true}};
+    bool pass = true;
+    pass = check_conv_layer("CONV1", CONV1_CHANNELS, CONV1_FILTERS, IMAGE_SIZE, conv1_scales,
+                            conv_layer1_minimal, reference_conv_layer1, gen) && pass;
+    pass = check_conv_layer("CONV2", CONV1_FILTERS, CONV2_FILTERS, P1_SIZE, conv2_scales,
+                            conv_layer2_minimal, reference_conv_layer2, gen) && pass;
+    pass = check_fc_layer("FC1", FC1_WEIGHTS_H, FC1_WEIGHTS_W, fc_layer1_minimal, reference_fc_layer1, gen) && pass;
+    pass = check_fc_layer("FC2", FC1_WEIGHTS_W, FC2_WEIGHTS_W, fc_layer2_minimal, reference_fc_layer2, gen) && pass;
+    std::cout << "Reference check " << (pass ? "PASSED" : "FAILED") << std::endl;
+    return pass;
+}
+
 struct TestInfo {
     std::string filename;
     int expected_class;
@@ -296,6 +625,9 @@ void run_batch_test(int num_samples = 10) {
     // Batch processing with timing
     auto batch_start = std::chrono::high_resolution_clock::now();
     
+    // The first image that runs copies the conv filters on chip, the others reuse them
+    bool weights_loaded = false;
+    
     for (int i = 0; i < actual_samples; i++) {
         const TestInfo& info = test_info[i];
         std::string image_path = test_dataset_dir + info.filename;
@@ -337,7 +669,9 @@ void run_batch_test(int num_samples = 10) {
         
         // Run inference with explicit array passing
         nnet(g_image, g_conv1_weights, g_conv1_bias, g_conv2_weights, g_conv2_bias,
-             g_fc1_weights, g_fc1_bias, g_fc2_weights, g_fc2_bias, g_predictions);
+             g_fc1_weights, g_fc1_bias, g_fc2_weights, g_fc2_bias, g_predictions,
+             weights_loaded ? NNET_INFER : NNET_LOAD_WEIGHTS);
+        weights_loaded = true;
         
         auto inference_end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double, std::milli> inference_time = inference_end - inference_start;
@@ -455,6 +789,12 @@ int main() {
     
     std::cout << "[TESTBENCH DEBUG] Initialized all arrays with recognizable values" << std::endl;
 
+    // Self-checks on random data, before the weight files are needed
+    if (!check_weight_modes() || !check_layers_against_reference()) {
+        std::cerr << "Self-checks FAILED" << std::endl;
+        return -1;
+    }
+
     // Measure weight loading time specifically
     auto weight_load_start = std::chrono::high_resolution_clock::now();
     